@@ -6,9 +6,11 @@
 #define __NBL_ASSET_I_ASSET_MANAGER_H_INCLUDED__
 
 #include <array>
+#include <future>
 #include <ostream>
 
 #include "nbl/core/declarations.h"
+#include "nbl/core/execution.h"
 #include "nbl/system/path.h"
 #include "CConcurrentObjectCache.h"
 
@@ -431,6 +433,23 @@ class NBL_API2 IAssetManager : public core::IReferenceCounted, public core::Quit
             return getAssetWholeBundleRestore(_file, _supposedFilename, _params, &m_defaultLoaderOverride);
         }
 
+        //! Loads a batch of independent assets concurrently on the parallel execution policy's worker pool, meant for texture-heavy scenes which are bound by CPU decoding.
+        /** The bundles are written to `_out` in the same order as the filenames in [_filenamesBegin,_filenamesEnd).
+        Mind the threading caveat from the class description, the same file appearing twice in one batch may end up as two copies in the cache, so deduplicate the filenames beforehand.
+        The `_override` gets invoked from many threads at once and needs to be thread-safe, the default one is. */
+        void getAssets(SAssetBundle* _out, const std::string* _filenamesBegin, const std::string* _filenamesEnd, const IAssetLoader::SAssetLoadParams& _params, IAssetLoader::IAssetLoaderOverride* _override)
+        {
+            core::for_each(core::execution::par,_filenamesBegin,_filenamesEnd,[&](const std::string& filename) -> void
+                {
+                    _out[std::distance(_filenamesBegin,&filename)] = getAsset(filename,_params,_override);
+                }
+            );
+        }
+        void getAssets(SAssetBundle* _out, const std::string* _filenamesBegin, const std::string* _filenamesEnd, const IAssetLoader::SAssetLoadParams& _params)
+        {
+            getAssets(_out,_filenamesBegin,_filenamesEnd,_params,&m_defaultLoaderOverride);
+        }
+
         //TODO change name
 		//! Check whether Assets exist in cache using a key and optionally their types
 		/*
@@ -680,6 +699,32 @@ class NBL_API2 IAssetManager : public core::IReferenceCounted, public core::Quit
             return writeAsset(_file, _params, nullptr);
         }
 
+        //! Encodes and writes out a whole batch of assets (e.g. screenshot or bake dumps) concurrently, without stalling the calling thread.
+        /** The requests get written on the parallel execution policy's worker pool, and because the actual file writes are done by the `ISystem`'s
+        dispatcher thread, writing one asset to disk overlaps with the encoding of the others. The root assets and the asset manager are kept alive
+        until the returned future is ready, but whatever `SAssetWriteParams::userData`, `encryptionKey` or `_override` point to needs to be kept alive by you.
+        The `_override` (if any) gets invoked from many threads at once and needs to be thread-safe.
+        The future holds whether each request was written successfully, in the same order as `_requests`. */
+        std::future<core::vector<bool>> writeAssetsAsync(core::vector<std::pair<std::string,IAssetWriter::SAssetWriteParams>>&& _requests, IAssetWriter::IAssetWriterOverride* _override=nullptr)
+        {
+            core::vector<core::smart_refctd_ptr<const IAsset>> keepAlive(_requests.size());
+            for (size_t i=0ull; i<_requests.size(); i++)
+                keepAlive[i] = core::smart_refctd_ptr<const IAsset>(_requests[i].second.rootAsset);
+
+            return std::async(std::launch::async,[self=core::smart_refctd_ptr<IAssetManager>(this),requests=std::move(_requests),keepAlive=std::move(keepAlive),_override]() -> core::vector<bool>
+                {
+                    // `std::vector<bool>` packs bits so it can't be written to concurrently
+                    core::vector<uint8_t> written(requests.size(),false);
+                    core::for_each(core::execution::par,requests.begin(),requests.end(),[&](const auto& request) -> void
+                        {
+                            written[std::distance(requests.data(),&request)] = self->writeAsset(request.first,request.second,_override);
+                        }
+                    );
+                    return core::vector<bool>(written.begin(),written.end());
+                }
+            );
+        }
+
         // Asset Loaders [FOLLOWING ARE NOT THREAD SAFE]
         uint32_t getAssetLoaderCount() { return static_cast<uint32_t>(m_loaders.vector.size()); }
 
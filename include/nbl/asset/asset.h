@@ -37,6 +37,7 @@
 #include "nbl/asset/filters/CFlattenRegionsImageFilter.h"
 #include "nbl/asset/filters/CMipMapGenerationImageFilter.h"
 #include "nbl/asset/filters/CSummedAreaTableImageFilter.h"
+#include "nbl/asset/filters/CFFTConvolutionImageFilter.h"
 
 // shaders
 #include "nbl/asset/ICPUShader.h"
@@ -22,7 +22,9 @@ namespace nbl::asset
 			EBCT_LZ4 = 0x02,
 			EBCT_LZ4_AES128_GCM = 0x03,
 			EBCT_LZMA = 0x04,
-			EBCT_LZMA_AES128_GCM = 0x05
+			EBCT_LZMA_AES128_GCM = 0x05,
+			EBCT_ZSTD = 0x06,
+			EBCT_ZSTD_AES128_GCM = 0x07
 		};
 		//! Type of blob enumeration
 		enum E_BLOB_TYPE
@@ -96,14 +96,84 @@ namespace asset
 #include "nbl/nblunpack.h"
 
 
+#include "nbl/nblpack.h"
+	//! Entry of the v4 blob table.
+	/** The table is a tightly packed array of these placed after all the blobs, so a writer can stream blobs out
+	and a reader can use the table straight from a mapped file.
+	*/
+	struct BlobTableEntryV4
+	{
+		//! Counted from the start of the file
+		uint64_t offset;
+		uint64_t handle;
+		//! Size as stored in the file
+		uint64_t blobSize;
+		uint64_t blobSizeDecompr;
+		uint32_t blobType;
+		uint8_t compressionType;
+		uint8_t dummy[3];
+		//! XXHash_256 of the data as stored in the file
+		uint64_t blobHash[4];
+
+		//! Assigns sizes and calculates hash of data.
+		void finalize(const void* _data, size_t _sizeDecompr, size_t _sizeCompr, uint8_t _comprType)
+		{
+			blobSizeDecompr = _sizeDecompr;
+			blobSize = _sizeCompr;
+			compressionType = _comprType;
+			core::XXHash_256(_data, blobSize, blobHash);
+		}
+		//! Calculates hash from `_data` and compares to current one (`blobHash` member).
+		bool validate(const void* _data) const
+		{
+			uint64_t tmpHash[4];
+			core::XXHash_256(_data, blobSize, tmpHash);
+			return memcmp(tmpHash, blobHash, sizeof(tmpHash))==0;
+		}
+	} PACK_STRUCT;
+
+	//! Header of a v4 file, the 32 bytes of `fileHeader` are laid out the same as in the older versions.
+	struct BAWFileHeaderV4
+	{
+		static constexpr uint64_t version = 4u;
+
+		uint64_t fileHeader[4];
+
+		uint32_t blobCount;
+		uint32_t reserved;
+		//! Counted from the start of the file
+		uint64_t blobTableOffset;
+		//! XXHash_256 of the blob table
+		uint64_t blobTableHash[4];
+
+		void init()
+		{
+			memset(this, 0, sizeof(BAWFileHeaderV4));
+			memcpy(fileHeader, BAWFileVn<version>::HEADER_STRING, strlen(BAWFileVn<version>::HEADER_STRING));
+			fileHeader[3] = version;
+		}
+		bool isValid() const
+		{
+			BAWFileHeaderV4 ref;
+			ref.init();
+			return memcmp(fileHeader, ref.fileHeader, sizeof(fileHeader))==0;
+		}
+	} PACK_STRUCT;
+#include "nbl/nblunpack.h"
+
+
 	// ===============
 	// .baw VERSION 
 	// ===============
-	constexpr uint32_t CurrentBAWFormatVersion = 3u;
-	using BlobHeaderV3 = BlobHeaderVn<CurrentBAWFormatVersion>;
-	using BAWFileV3 = BAWFileVn<CurrentBAWFormatVersion>;
-
-	using BlobHeaderLatest = BlobHeaderV3;
+	constexpr uint32_t CurrentBAWFormatVersion = 4u;
+	using BlobHeaderV3 = BlobHeaderVn<3u>;
+	using BAWFileV3 = BAWFileVn<3u>;
+	//! v4 files locate their blobs through the blob table, the per-blob header layout is unchanged from v3
+	using BlobHeaderV4 = BlobHeaderVn<CurrentBAWFormatVersion>;
+
+	using BlobHeaderLatest = BlobHeaderV4;
+	using BlobTableEntryLatest = BlobTableEntryV4;
+	using BAWFileHeaderLatest = BAWFileHeaderV4;
 
 	bool encAes128gcm(const void* _input, size_t _inSize, void* _output, size_t _outSize, const unsigned char* _key, const unsigned char* _iv, void* _tag);
 	bool decAes128gcm(const void* _input, size_t _inSize, void* _output, size_t _outSize, const unsigned char* _key, const unsigned char* _iv, void* _tag);
@@ -0,0 +1,84 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_ASSET_C_BAW_FILE_READER_H_INCLUDED_
+#define _NBL_ASSET_C_BAW_FILE_READER_H_INCLUDED_
+
+#include <mutex>
+
+#include "nbl/system/IFile.h"
+#include "nbl/asset/ICPUBuffer.h"
+#include "nbl/asset/bawformat/CBAWFile.h"
+
+namespace nbl::asset
+{
+
+//! Random access to the blobs of a .baw v4 file
+/**
+	Only the header and the blob table are read on creation (or used in-place if the file is mapped),
+	blobs get decompressed and validated the first time they're asked for, then stay cached.
+	All methods are thread-safe, independent blobs get materialized in parallel by `prefetch`.
+*/
+class CBAWFileReader final : public core::IReferenceCounted
+{
+	public:
+		static constexpr uint32_t InvalidBlobIx = ~0u;
+
+		//! Returns nullptr if `_file` is not a well formed v4 file
+		static core::smart_refctd_ptr<CBAWFileReader> create(core::smart_refctd_ptr<system::IFile>&& _file, system::logger_opt_ptr _logger=nullptr);
+
+		//! Only checks the header string and version
+		static bool isBAWv4File(system::IFile* _file);
+
+		inline uint32_t getBlobCount() const { return m_header.blobCount; }
+		inline const BlobTableEntryV4& getBlobEntry(uint32_t _ix) const { return m_table[_ix]; }
+		//! Returns `InvalidBlobIx` if there's no blob with such handle
+		inline uint32_t findBlob(uint64_t _handle) const
+		{
+			auto found = m_handleToIx.find(_handle);
+			return found!=m_handleToIx.end() ? found->second:InvalidBlobIx;
+		}
+
+		//! Checks hashes of all blobs in parallel without decompressing them, returns the number of corrupted ones
+		uint32_t validateAll() const;
+
+		//! Decompressed contents of a blob, nullptr if it failed to read, validate or decompress
+		core::smart_refctd_ptr<ICPUBuffer> getBlobData(uint32_t _ix);
+
+		//! Materializes the blobs at `_ixBegin`-`_ixEnd` in parallel so later `getBlobData` calls don't have to wait
+		void prefetch(const uint32_t* _ixBegin, const uint32_t* _ixEnd);
+		void prefetchAll();
+
+		//! Evicts a materialized blob from the cache, outstanding references stay valid
+		void release(uint32_t _ix);
+
+	protected:
+		CBAWFileReader(core::smart_refctd_ptr<system::IFile>&& _file, system::logger_opt_ptr _logger) : m_file(std::move(_file)), m_logger(_logger) {}
+		~CBAWFileReader() = default;
+
+	private:
+		bool readBlobTable();
+		core::smart_refctd_ptr<ICPUBuffer> materialize(uint32_t _ix) const;
+		bool decompress(uint8_t _comprType, void* _dst, size_t _dstSize, const void* _src, size_t _srcSize) const;
+
+		struct SBlobState
+		{
+			std::mutex mutex;
+			core::smart_refctd_ptr<ICPUBuffer> data;
+			bool failed = false;
+		};
+
+		core::smart_refctd_ptr<system::IFile> m_file;
+		system::logger_opt_ptr m_logger;
+		BAWFileHeaderV4 m_header;
+		// points either into the mapped file or into `m_tableStorage`
+		const BlobTableEntryV4* m_table = nullptr;
+		core::vector<BlobTableEntryV4> m_tableStorage;
+		core::unordered_map<uint64_t,uint32_t> m_handleToIx;
+		std::unique_ptr<SBlobState[]> m_blobs;
+};
+
+}
+
+#endif
@@ -0,0 +1,47 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_ASSET_C_BAW_FILE_WRITER_H_INCLUDED_
+#define _NBL_ASSET_C_BAW_FILE_WRITER_H_INCLUDED_
+
+#include "nbl/system/IFile.h"
+#include "nbl/asset/ICPUBuffer.h"
+#include "nbl/asset/bawformat/CBAWFile.h"
+
+namespace nbl::asset
+{
+
+//! Gathers blobs and writes them out as a .baw v4 file
+/**
+	Blobs get compressed and hashed in parallel on `write`, a blob which doesn't shrink is stored raw.
+	The layout is: header, blobs (each aligned to 16 bytes) and the blob table at the end.
+*/
+class CBAWFileWriter
+{
+	public:
+		//! Returns false if the handle is already taken or the coding type is not supported
+		bool addBlob(Blob::E_BLOB_TYPE _type, uint64_t _handle, core::smart_refctd_ptr<const ICPUBuffer>&& _data, Blob::E_BLOB_CODING_TYPE _coding=Blob::EBCT_RAW);
+
+		inline uint32_t getBlobCount() const { return m_blobs.size(); }
+
+		//! Whether blobs can be encoded with `_coding` in this build
+		static bool isCodingSupported(Blob::E_BLOB_CODING_TYPE _coding);
+
+		bool write(system::IFile* _file, system::logger_opt_ptr _logger=nullptr) const;
+
+	private:
+		struct SBlob
+		{
+			core::smart_refctd_ptr<const ICPUBuffer> data;
+			uint64_t handle;
+			Blob::E_BLOB_TYPE type;
+			Blob::E_BLOB_CODING_TYPE coding;
+		};
+		core::vector<SBlob> m_blobs;
+		core::unordered_set<uint64_t> m_handles;
+};
+
+}
+
+#endif
@@ -0,0 +1,622 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_ASSET_C_FFT_CONVOLUTION_IMAGE_FILTER_H_INCLUDED_
+#define _NBL_ASSET_C_FFT_CONVOLUTION_IMAGE_FILTER_H_INCLUDED_
+
+#include "nbl/core/declarations.h"
+
+#include <numeric>
+#include <optional>
+#include <thread>
+
+#include "nbl/asset/format/decodePixels.h"
+#include "nbl/asset/format/encodePixels.h"
+#include "nbl/asset/filters/CMatchedSizeInOutImageFilterCommon.h"
+
+namespace nbl::asset
+{
+
+//! Convolves a 2D image with an arbitrarily large kernel image through FFTs, the host path for bloom, lens flares and other large kernels
+/*
+	Computes `out(p) = sum_t kernel(t)*in(p+kernelCenter-t)` for every output texel and channel, treating texels outside of
+	the input's `inOffset,extent` window as zero. Both the input and the kernel get zero-padded to power of two sizes big enough
+	for the convolution not to wrap around, so the cost depends on `extent+kernelExtent` rather than their product.
+
+	The transforms are real-to-complex (every row of `N` reals is one `N/2` complex FFT plus a split step), done with radix-4 Stockham
+	butterflies on SSE registers holding 4 rows or 4 columns at once, and the row and column passes are spread over the `ExecutionPolicy`.
+
+	The spectrum of the kernel is kept in `CState::kernelSpectrum`, so executing the same state on more images (or layers) of the same size
+	only transforms the kernel once. A kernel with a single channel gets applied to every channel of the input.
+
+	Only non-integer 2D formats are supported, the output has to have the same channel count as the input and can't be block compressed.
+*/
+class CFFTConvolutionImageFilter : public CMatchedSizeInOutImageFilterCommon
+{
+	public:
+		virtual ~CFFTConvolutionImageFilter() {}
+
+		//! Transformed kernel, tied to the padded size it was created for
+		class CKernelSpectrum final : public core::IReferenceCounted
+		{
+			public:
+				inline const VkExtent3D& getPaddedExtent() const {return m_paddedExtent;}
+				inline const VkExtent3D& getKernelExtent() const {return m_kernelExtent;}
+				inline uint32_t getChannelCount() const {return m_channelCount;}
+
+				//! Whether convolving an `extent` sized window of an image with `channelCount` channels can reuse this spectrum
+				inline bool isUsableFor(const VkExtent3D& extent, const uint32_t channelCount) const
+				{
+					if (m_channelCount!=1u && m_channelCount!=channelCount)
+						return false;
+					return m_paddedExtent.width>=extent.width+m_kernelExtent.width-1u && m_paddedExtent.height>=extent.height+m_kernelExtent.height-1u;
+				}
+
+			protected:
+				friend class CFFTConvolutionImageFilter;
+
+				CKernelSpectrum(const VkExtent3D& paddedExtent, const VkExtent3D& kernelExtent, const uint32_t channelCount)
+					: m_paddedExtent(paddedExtent), m_kernelExtent(kernelExtent), m_channelCount(channelCount),
+					m_planes(getPlaneFloatCount(paddedExtent)*2u*channelCount,0.f) {}
+				~CKernelSpectrum() = default;
+
+				VkExtent3D m_paddedExtent;
+				VkExtent3D m_kernelExtent;
+				uint32_t m_channelCount;
+				// real and imaginary plane per channel, in the same layout as the scratch and premultiplied by the inverse transform's normalization
+				core::vector<float> m_planes;
+		};
+
+		class CState : public CMatchedSizeInOutImageFilterCommon::state_type
+		{
+			public:
+				CState() = default;
+				virtual ~CState() = default;
+
+				const ICPUImage* kernel = nullptr;											//!< only read when `kernelSpectrum` is missing or unusable for the current `extent`
+				uint32_t kernelMipLevel = 0u;
+				uint32_t kernelLayer = 0u;
+				core::vectorSIMDi32 kernelCenter = core::vectorSIMDi32(-1);					//!< texel of the kernel landing on the output texel, negative components mean the middle of the kernel
+				bool normalizeKernel = false;												//!< scale every kernel channel to sum up to 1 before convolving
+				core::smart_refctd_ptr<const CKernelSpectrum> kernelSpectrum;				//!< cache, gets (re)created by `execute` from `kernel` when needed, reset it after changing the kernel
+				uint8_t* scratchMemory = nullptr;											//!< at least `getRequiredScratchByteSize(inImage,getPaddedExtent())` bytes
+				size_t scratchMemoryByteSize = 0u;
+
+				//! Size the transforms will be done at
+				inline VkExtent3D getPaddedExtent() const
+				{
+					if (kernelSpectrum && inImage && kernelSpectrum->isUsableFor(extent,getFormatChannelCount(inImage->getCreationParameters().format)))
+						return kernelSpectrum->getPaddedExtent();
+					if (kernel)
+					{
+						const auto kernelSize = kernel->getMipSize(kernelMipLevel);
+						return CFFTConvolutionImageFilter::getPaddedExtent(extent,{kernelSize.x,kernelSize.y,kernelSize.z});
+					}
+					return {0u,0u,0u};
+				}
+
+				static inline size_t getRequiredScratchByteSize(const ICPUImage* inputImage, const VkExtent3D& paddedExtent)
+				{
+					return getPlaneFloatCount(paddedExtent)*2ull*getFormatChannelCount(inputImage->getCreationParameters().format)*sizeof(float);
+				}
+		};
+		using state_type = CState;
+
+		//! Smallest transform size for which the convolution doesn't wrap around, rows are at least 8 and columns 4 long so that every SIMD group is full
+		static inline VkExtent3D getPaddedExtent(const VkExtent3D& extent, const VkExtent3D& kernelExtent)
+		{
+			return {
+				core::max(core::roundUpToPoT(extent.width+kernelExtent.width-1u),8u),
+				core::max(core::roundUpToPoT(extent.height+kernelExtent.height-1u),4u),
+				1u
+			};
+		}
+
+		//! Transforms a kernel (one layer of one mip level) for convolutions at `paddedExtent`, returns nullptr if the kernel doesn't fit or has an unsupported format
+		template<class ExecutionPolicy>
+		static inline core::smart_refctd_ptr<CKernelSpectrum> createKernelSpectrum(
+			ExecutionPolicy&& policy, const ICPUImage* kernel, const uint32_t mipLevel, const uint32_t layer,
+			core::vectorSIMDi32 center, const VkExtent3D& paddedExtent, const bool normalize=false
+		)
+		{
+			if (!kernel || mipLevel>=kernel->getCreationParameters().mipLevels || layer>=kernel->getCreationParameters().arrayLayers)
+				return nullptr;
+			const auto format = kernel->getCreationParameters().format;
+			if (isIntegerFormat(format) || getFormatChannelCount(format)>MaxChannels)
+				return nullptr;
+			const auto kernelSize = kernel->getMipSize(mipLevel);
+			if (kernelSize.z!=1u || !isValidPaddedExtent(paddedExtent) || kernelSize.x>paddedExtent.width || kernelSize.y>paddedExtent.height)
+				return nullptr;
+			for (auto i=0u; i<2u; i++)
+			if (center[i]<0)
+				center[i] = kernelSize[i]/2u;
+
+			const uint32_t channelCount = getFormatChannelCount(format);
+			auto spectrum = core::smart_refctd_ptr<CKernelSpectrum>(new CKernelSpectrum(paddedExtent,{kernelSize.x,kernelSize.y,1u},channelCount),core::dont_grab);
+			SLayout layout(paddedExtent,spectrum->m_planes.data(),channelCount);
+			const STransformPlan plan(paddedExtent);
+
+			// place the kernel's center at the origin, wrapping around, so that the output lines up with the input
+			decodeIntoPlanes(policy,kernel,mipLevel,layer,{0u,0u,0u},{kernelSize.x,kernelSize.y,1u},layout,[&](const uint32_t x, const uint32_t y) -> core::vector3du32_SIMD
+			{
+				return core::vector3du32_SIMD(
+					uint32_t(int32_t(x)-center.x)&(paddedExtent.width-1u),
+					uint32_t(int32_t(y)-center.y)&(paddedExtent.height-1u),
+					0u
+				);
+			});
+			rowPass<false>(policy,plan,layout,paddedExtent.height);
+			columnPass(policy,plan,layout,nullptr);
+
+			// fold the `1/(N/2)` and `1/height` of the inverse transforms in
+			const float inverseNormalization = 1.f/float(layout.halfWidth*paddedExtent.height);
+			for (auto c=0u; c<channelCount; c++)
+			{
+				float* re = layout.getPlane(c,false);
+				float* im = layout.getPlane(c,true);
+				float scale = inverseNormalization;
+				// DC term is the sum of the kernel
+				if (normalize && core::abs(re[0])>FLT_MIN)
+					scale /= re[0];
+				std::transform(re,re+layout.planeFloatCount,re,[scale](const float v) {return v*scale;});
+				std::transform(im,im+layout.planeFloatCount,im,[scale](const float v) {return v*scale;});
+			}
+			return spectrum;
+		}
+		static inline core::smart_refctd_ptr<CKernelSpectrum> createKernelSpectrum(
+			const ICPUImage* kernel, const uint32_t mipLevel, const uint32_t layer,
+			const core::vectorSIMDi32& center, const VkExtent3D& paddedExtent, const bool normalize=false
+		)
+		{
+			return createKernelSpectrum(core::execution::seq,kernel,mipLevel,layer,center,paddedExtent,normalize);
+		}
+
+		static inline bool validate(state_type* state)
+		{
+			if (!CMatchedSizeInOutImageFilterCommon::validate(state))
+				return false;
+
+			const auto inFormat = state->inImage->getCreationParameters().format;
+			const auto outFormat = state->outImage->getCreationParameters().format;
+			if (state->extent.depth!=1u)
+				return false;
+			if (isIntegerFormat(inFormat) || isIntegerFormat(outFormat) || isBlockCompressionFormat(outFormat))
+				return false;
+			const auto channelCount = getFormatChannelCount(inFormat);
+			if (channelCount>MaxChannels || getFormatChannelCount(outFormat)!=channelCount)
+				return false;
+
+			const bool spectrumUsable = state->kernelSpectrum && state->kernelSpectrum->isUsableFor(state->extent,channelCount);
+			if (!spectrumUsable)
+			{
+				if (!state->kernel)
+					return false;
+				const auto kernelFormat = state->kernel->getCreationParameters().format;
+				const auto kernelChannelCount = getFormatChannelCount(kernelFormat);
+				if (isIntegerFormat(kernelFormat) || (kernelChannelCount!=1u && kernelChannelCount!=channelCount))
+					return false;
+			}
+
+			const auto paddedExtent = state->getPaddedExtent();
+			if (!isValidPaddedExtent(paddedExtent))
+				return false;
+			if (!state->scratchMemory || state->scratchMemoryByteSize<state_type::getRequiredScratchByteSize(state->inImage,paddedExtent))
+				return false;
+
+			return true;
+		}
+
+		template<class ExecutionPolicy>
+		static inline bool execute(ExecutionPolicy&& policy, state_type* state)
+		{
+			if (!validate(state))
+				return false;
+
+			const auto inFormat = state->inImage->getCreationParameters().format;
+			const auto channelCount = getFormatChannelCount(inFormat);
+			const auto paddedExtent = state->getPaddedExtent();
+			// a spectrum of the right size can still be unusable, e.g. it has a different channel count than the input
+			if (!state->kernelSpectrum || !state->kernelSpectrum->isUsableFor(state->extent,channelCount))
+			{
+				state->kernelSpectrum = createKernelSpectrum(policy,state->kernel,state->kernelMipLevel,state->kernelLayer,state->kernelCenter,paddedExtent,state->normalizeKernel);
+				if (!state->kernelSpectrum)
+					return false;
+			}
+
+			SLayout layout(paddedExtent,reinterpret_cast<float*>(state->scratchMemory),channelCount);
+			const STransformPlan plan(paddedExtent);
+			// only the rows holding the input (rounded up to a SIMD group) are non-zero before the column pass, and needed after it
+			const uint32_t usedRows = core::roundUp(state->extent.height,LaneCount);
+			for (auto layer=0u; layer<state->layerCount; layer++)
+			{
+				decodeIntoPlanes(policy,state->inImage,state->inMipLevel,state->inBaseLayer+layer,state->inOffset,state->extent,layout,[](const uint32_t x, const uint32_t y) -> core::vector3du32_SIMD
+				{
+					return core::vector3du32_SIMD(x,y,0u);
+				});
+				rowPass<false>(policy,plan,layout,usedRows);
+				columnPass(policy,plan,layout,state->kernelSpectrum.get());
+				rowPass<true>(policy,plan,layout,usedRows);
+				encodeFromPlanes(policy,state,state->outBaseLayer+layer,layout);
+			}
+			return true;
+		}
+		static inline bool execute(state_type* state)
+		{
+			return execute(core::execution::seq,state);
+		}
+
+	private:
+		static inline constexpr uint32_t MaxChannels = 4u;
+		static inline constexpr uint32_t LaneCount = 4u;
+		// more batches than cores so that uneven progress of the threads evens out
+		static inline constexpr uint32_t BatchesPerCore = 4u;
+
+		static inline bool isValidPaddedExtent(const VkExtent3D& paddedExtent)
+		{
+			return paddedExtent.width>=8u && paddedExtent.height>=LaneCount && core::isPoT(paddedExtent.width) && core::isPoT(paddedExtent.height);
+		}
+
+		// A row of `width` reals `x` is stored as `width/2` complex numbers `x[2k]+i*x[2k+1]` and transforms in-place into `width/2+1` complex bins,
+		// so every channel needs a real and an imaginary plane of `(width/2+LaneCount)*height` floats.
+		static inline size_t getPlaneFloatCount(const VkExtent3D& paddedExtent)
+		{
+			return size_t(paddedExtent.width/2u+LaneCount)*paddedExtent.height;
+		}
+		struct SLayout
+		{
+			SLayout(const VkExtent3D& paddedExtent, float* _planes, const uint32_t _channelCount)
+				: planes(_planes), halfWidth(paddedExtent.width/2u), pitch(halfWidth+LaneCount), height(paddedExtent.height),
+				planeFloatCount(getPlaneFloatCount(paddedExtent)), channelCount(_channelCount) {}
+
+			inline float* getPlane(const uint32_t channel, const bool imaginary) const
+			{
+				return planes+(channel*2u+(imaginary ? 1u:0u))*planeFloatCount;
+			}
+
+			float* planes;
+			uint32_t halfWidth;
+			uint32_t pitch;
+			uint32_t height;
+			size_t planeFloatCount;
+			uint32_t channelCount;
+		};
+
+		// `exp(-2*pi*i*k/N)` for `k<N`
+		struct STwiddles
+		{
+			STwiddles(const uint32_t N) : cos(N), sin(N)
+			{
+				for (auto k=0u; k<N; k++)
+				{
+					const double angle = -2.0*core::PI<double>()*double(k)/double(N);
+					cos[k] = std::cos(angle);
+					sin[k] = std::sin(angle);
+				}
+			}
+
+			core::vector<float> cos;
+			core::vector<float> sin;
+		};
+		// every table the transforms at one padded size need, built once per `execute` or `createKernelSpectrum`
+		struct STransformPlan
+		{
+			STransformPlan(const VkExtent3D& paddedExtent) : rowTwiddles(paddedExtent.width/2u), halfRowTwiddles(paddedExtent.width), columnTwiddles(paddedExtent.height) {}
+
+			STwiddles rowTwiddles;
+			STwiddles halfRowTwiddles;
+			STwiddles columnTwiddles;
+		};
+
+		static inline void complexMul(const __m128 aRe, const __m128 aIm, const __m128 bRe, const __m128 bIm, __m128& outRe, __m128& outIm)
+		{
+			outRe = _mm_sub_ps(_mm_mul_ps(aRe,bRe),_mm_mul_ps(aIm,bIm));
+			outIm = _mm_add_ps(_mm_mul_ps(aRe,bIm),_mm_mul_ps(aIm,bRe));
+		}
+
+		//! Unnormalized complex FFT of `N` elements on 4 independent sequences at once (one per lane), `workRe` and `workIm` must hold `N` elements too
+		template<bool Inverse>
+		static inline void fft(__m128* re, __m128* im, __m128* workRe, __m128* workIm, const uint32_t N, const STwiddles& twiddles)
+		{
+			// the inverse transform is the forward one with `i` replaced by `-i`
+			const __m128 sign = _mm_set1_ps(Inverse ? -1.f:1.f);
+			__m128* srcRe = re;
+			__m128* srcIm = im;
+			__m128* dstRe = workRe;
+			__m128* dstIm = workIm;
+			// Stockham autosort, `n` is the length of the sub-transforms and `s` how many of them are interleaved
+			uint32_t n = N, s = 1u;
+			for (; n>=4u; n>>=2u, s<<=2u)
+			{
+				const uint32_t n1 = n>>2u;
+				for (auto p=0u; p<n1; p++)
+				{
+					const __m128 w1Re = _mm_set1_ps(twiddles.cos[p*s]);
+					const __m128 w1Im = _mm_mul_ps(_mm_set1_ps(twiddles.sin[p*s]),sign);
+					const __m128 w2Re = _mm_set1_ps(twiddles.cos[2u*p*s]);
+					const __m128 w2Im = _mm_mul_ps(_mm_set1_ps(twiddles.sin[2u*p*s]),sign);
+					const __m128 w3Re = _mm_set1_ps(twiddles.cos[3u*p*s]);
+					const __m128 w3Im = _mm_mul_ps(_mm_set1_ps(twiddles.sin[3u*p*s]),sign);
+					const uint32_t in = s*p, out = s*4u*p;
+					for (auto q=0u; q<s; q++)
+					{
+						const uint32_t a = in+q, b = a+s*n1, c = b+s*n1, d = c+s*n1;
+						const __m128 apcRe = _mm_add_ps(srcRe[a],srcRe[c]);
+						const __m128 apcIm = _mm_add_ps(srcIm[a],srcIm[c]);
+						const __m128 amcRe = _mm_sub_ps(srcRe[a],srcRe[c]);
+						const __m128 amcIm = _mm_sub_ps(srcIm[a],srcIm[c]);
+						const __m128 bpdRe = _mm_add_ps(srcRe[b],srcRe[d]);
+						const __m128 bpdIm = _mm_add_ps(srcIm[b],srcIm[d]);
+						// i*(b-d)
+						const __m128 jbmdRe = _mm_mul_ps(_mm_sub_ps(srcIm[d],srcIm[b]),sign);
+						const __m128 jbmdIm = _mm_mul_ps(_mm_sub_ps(srcRe[b],srcRe[d]),sign);
+
+						const uint32_t y = out+q;
+						dstRe[y] = _mm_add_ps(apcRe,bpdRe);
+						dstIm[y] = _mm_add_ps(apcIm,bpdIm);
+						complexMul(_mm_sub_ps(amcRe,jbmdRe),_mm_sub_ps(amcIm,jbmdIm),w1Re,w1Im,dstRe[y+s],dstIm[y+s]);
+						complexMul(_mm_sub_ps(apcRe,bpdRe),_mm_sub_ps(apcIm,bpdIm),w2Re,w2Im,dstRe[y+2u*s],dstIm[y+2u*s]);
+						complexMul(_mm_add_ps(amcRe,jbmdRe),_mm_add_ps(amcIm,jbmdIm),w3Re,w3Im,dstRe[y+3u*s],dstIm[y+3u*s]);
+					}
+				}
+				std::swap(srcRe,dstRe);
+				std::swap(srcIm,dstIm);
+			}
+			// odd power of two, one radix-2 stage left without any twiddles
+			if (n==2u)
+			{
+				for (auto q=0u; q<s; q++)
+				{
+					dstRe[q] = _mm_add_ps(srcRe[q],srcRe[q+s]);
+					dstIm[q] = _mm_add_ps(srcIm[q],srcIm[q+s]);
+					dstRe[q+s] = _mm_sub_ps(srcRe[q],srcRe[q+s]);
+					dstIm[q+s] = _mm_sub_ps(srcIm[q],srcIm[q+s]);
+				}
+				std::swap(srcRe,dstRe);
+				std::swap(srcIm,dstIm);
+			}
+			if (srcRe!=re)
+			{
+				std::copy_n(srcRe,N,re);
+				std::copy_n(srcIm,N,im);
+			}
+		}
+
+		// `halfTwiddles` are for `2*halfWidth`, the pairs `k` and `halfWidth-k` depend on each other so they get computed together in-place
+		static inline void splitRealForward(__m128* re, __m128* im, const uint32_t halfWidth, const STwiddles& halfTwiddles)
+		{
+			const __m128 half = _mm_set1_ps(0.5f);
+			re[halfWidth] = re[0];
+			im[halfWidth] = im[0];
+			for (auto k=0u; k<=halfWidth/2u; k++)
+			{
+				const uint32_t l = halfWidth-k;
+				const __m128 evenRe = _mm_mul_ps(_mm_add_ps(re[k],re[l]),half);
+				const __m128 evenIm = _mm_mul_ps(_mm_sub_ps(im[k],im[l]),half);
+				const __m128 oddRe = _mm_mul_ps(_mm_sub_ps(re[k],re[l]),half);
+				const __m128 oddIm = _mm_mul_ps(_mm_add_ps(im[k],im[l]),half);
+				const __m128 wRe = _mm_set1_ps(halfTwiddles.cos[k]);
+				const __m128 wIm = _mm_set1_ps(halfTwiddles.sin[k]);
+				const __m128 tRe = _mm_add_ps(_mm_mul_ps(wRe,oddIm),_mm_mul_ps(wIm,oddRe));
+				const __m128 tIm = _mm_sub_ps(_mm_mul_ps(wIm,oddIm),_mm_mul_ps(wRe,oddRe));
+				re[k] = _mm_add_ps(evenRe,tRe);
+				im[k] = _mm_add_ps(evenIm,tIm);
+				re[l] = _mm_sub_ps(evenRe,tRe);
+				im[l] = _mm_sub_ps(tIm,evenIm);
+			}
+		}
+		static inline void splitRealInverse(__m128* re, __m128* im, const uint32_t halfWidth, const STwiddles& halfTwiddles)
+		{
+			const __m128 half = _mm_set1_ps(0.5f);
+			for (auto k=0u; k<=halfWidth/2u; k++)
+			{
+				const uint32_t l = halfWidth-k;
+				const __m128 evenRe = _mm_mul_ps(_mm_add_ps(re[k],re[l]),half);
+				const __m128 evenIm = _mm_mul_ps(_mm_sub_ps(im[k],im[l]),half);
+				const __m128 oddRe = _mm_mul_ps(_mm_sub_ps(re[k],re[l]),half);
+				const __m128 oddIm = _mm_mul_ps(_mm_add_ps(im[k],im[l]),half);
+				const __m128 wRe = _mm_set1_ps(halfTwiddles.cos[k]);
+				const __m128 wIm = _mm_set1_ps(halfTwiddles.sin[k]);
+				const __m128 uRe = _mm_sub_ps(_mm_mul_ps(oddRe,wIm),_mm_mul_ps(oddIm,wRe));
+				const __m128 uIm = _mm_add_ps(_mm_mul_ps(oddRe,wRe),_mm_mul_ps(oddIm,wIm));
+				re[k] = _mm_add_ps(evenRe,uRe);
+				im[k] = _mm_add_ps(evenIm,uIm);
+				re[l] = _mm_sub_ps(evenRe,uRe);
+				im[l] = _mm_sub_ps(uIm,evenIm);
+			}
+		}
+
+		//! Calls `f(task,buffers)` for every task, the tasks get split into a few batches per core and every batch allocates its `bufferCount` SIMD registers of scratch once
+		template<class ExecutionPolicy, typename F>
+		static inline void parallelFor(ExecutionPolicy&& policy, const uint32_t count, const size_t bufferCount, F&& f)
+		{
+			constexpr bool is_seq_policy_v = std::is_same_v<std::remove_reference_t<ExecutionPolicy>,core::execution::sequenced_policy>;
+			const uint32_t batchCount = is_seq_policy_v ? 1u:core::min(count,core::max(std::thread::hardware_concurrency(),1u)*BatchesPerCore);
+			core::vector<uint32_t> batches(batchCount);
+			std::iota(batches.begin(),batches.end(),0u);
+			std::for_each(std::forward<ExecutionPolicy>(policy),batches.begin(),batches.end(),[&](const uint32_t batch) -> void
+			{
+				core::vector<__m128> buffers(bufferCount);
+				const uint32_t end = uint64_t(count)*(batch+1u)/batchCount;
+				for (uint32_t task=uint64_t(count)*batch/batchCount; task<end; task++)
+					f(task,buffers.data());
+			});
+		}
+
+		//! Transforms groups of 4 rows, transposing them in and out of the SIMD lanes
+		template<bool Inverse, class ExecutionPolicy>
+		static inline void rowPass(ExecutionPolicy&& policy, const STransformPlan& plan, const SLayout& layout, const uint32_t rowCount)
+		{
+			const uint32_t N = layout.halfWidth;
+			const STwiddles& twiddles = plan.rowTwiddles;
+			const STwiddles& halfTwiddles = plan.halfRowTwiddles;
+			const uint32_t groupCount = rowCount/LaneCount;
+			parallelFor(policy,groupCount*layout.channelCount,(N+LaneCount)*4u,[&](const uint32_t task, __m128* buffers) -> void
+			{
+				__m128* re = buffers;
+				__m128* im = re+N+LaneCount;
+				const size_t rowOffset = size_t(task%groupCount)*LaneCount*layout.pitch;
+				float* rowsRe = layout.getPlane(task/groupCount,false)+rowOffset;
+				float* rowsIm = layout.getPlane(task/groupCount,true)+rowOffset;
+
+				auto gather = [&](const float* rows, __m128* out, const uint32_t count) -> void
+				{
+					for (auto k=0u; k<count; k+=LaneCount)
+					{
+						__m128 r0 = _mm_loadu_ps(rows+k);
+						__m128 r1 = _mm_loadu_ps(rows+layout.pitch+k);
+						__m128 r2 = _mm_loadu_ps(rows+layout.pitch*2u+k);
+						__m128 r3 = _mm_loadu_ps(rows+layout.pitch*3u+k);
+						_MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+						out[k] = r0;
+						out[k+1u] = r1;
+						out[k+2u] = r2;
+						out[k+3u] = r3;
+					}
+				};
+				auto scatter = [&](const __m128* in, float* rows, const uint32_t count) -> void
+				{
+					for (auto k=0u; k<count; k+=LaneCount)
+					{
+						__m128 r0 = in[k], r1 = in[k+1u], r2 = in[k+2u], r3 = in[k+3u];
+						_MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+						_mm_storeu_ps(rows+k,r0);
+						_mm_storeu_ps(rows+layout.pitch+k,r1);
+						_mm_storeu_ps(rows+layout.pitch*2u+k,r2);
+						_mm_storeu_ps(rows+layout.pitch*3u+k,r3);
+					}
+				};
+
+				if constexpr (Inverse)
+				{
+					gather(rowsRe,re,N+LaneCount);
+					gather(rowsIm,im,N+LaneCount);
+					splitRealInverse(re,im,N,halfTwiddles);
+					fft<true>(re,im,im+N+LaneCount,im+(N+LaneCount)*2u,N,twiddles);
+					scatter(re,rowsRe,N);
+					scatter(im,rowsIm,N);
+				}
+				else
+				{
+					gather(rowsRe,re,N);
+					gather(rowsIm,im,N);
+					fft<false>(re,im,im+N+LaneCount,im+(N+LaneCount)*2u,N,twiddles);
+					splitRealForward(re,im,N,halfTwiddles);
+					std::fill_n(re+N+1u,LaneCount-1u,_mm_setzero_ps());
+					std::fill_n(im+N+1u,LaneCount-1u,_mm_setzero_ps());
+					scatter(re,rowsRe,N+LaneCount);
+					scatter(im,rowsIm,N+LaneCount);
+				}
+			});
+		}
+
+		//! Transforms groups of 4 adjacent columns, if `kernel` is given it multiplies by its spectrum and transforms back right away while the columns are hot
+		template<class ExecutionPolicy>
+		static inline void columnPass(ExecutionPolicy&& policy, const STransformPlan& plan, const SLayout& layout, const CKernelSpectrum* kernel)
+		{
+			const uint32_t N = layout.height;
+			const STwiddles& twiddles = plan.columnTwiddles;
+			const uint32_t groupCount = layout.pitch/LaneCount;
+			std::optional<SLayout> kernelLayout;
+			if (kernel)
+				kernelLayout.emplace(kernel->getPaddedExtent(),const_cast<float*>(kernel->m_planes.data()),kernel->getChannelCount());
+			parallelFor(policy,groupCount*layout.channelCount,N*4u,[&](const uint32_t task, __m128* buffers) -> void
+			{
+				__m128* re = buffers;
+				__m128* im = re+N;
+				const uint32_t channel = task/groupCount;
+				const uint32_t column = (task%groupCount)*LaneCount;
+				float* columnsRe = layout.getPlane(channel,false)+column;
+				float* columnsIm = layout.getPlane(channel,true)+column;
+
+				for (auto y=0u; y<N; y++)
+				{
+					re[y] = _mm_loadu_ps(columnsRe+y*layout.pitch);
+					im[y] = _mm_loadu_ps(columnsIm+y*layout.pitch);
+				}
+				fft<false>(re,im,im+N,im+N*2u,N,twiddles);
+				if (kernel)
+				{
+					const uint32_t kernelChannel = kernel->getChannelCount()>1u ? channel:0u;
+					const float* kernelRe = kernelLayout->getPlane(kernelChannel,false)+column;
+					const float* kernelIm = kernelLayout->getPlane(kernelChannel,true)+column;
+					for (auto y=0u; y<N; y++)
+						complexMul(re[y],im[y],_mm_loadu_ps(kernelRe+y*layout.pitch),_mm_loadu_ps(kernelIm+y*layout.pitch),re[y],im[y]);
+					fft<true>(re,im,im+N,im+N*2u,N,twiddles);
+				}
+				for (auto y=0u; y<N; y++)
+				{
+					_mm_storeu_ps(columnsRe+y*layout.pitch,re[y]);
+					_mm_storeu_ps(columnsIm+y*layout.pitch,im[y]);
+				}
+			});
+		}
+
+		//! Zeroes the planes and decodes the `offset,extent` window of an image layer into them, `remap` gives the padded texel coordinate
+		template<class ExecutionPolicy, typename Remap>
+		static inline void decodeIntoPlanes(
+			ExecutionPolicy&& policy, const ICPUImage* image, const uint32_t mipLevel, const uint32_t layer,
+			const VkOffset3D& offset, const VkExtent3D& extent, const SLayout& layout, Remap&& remap
+		)
+		{
+			std::fill_n(layout.planes,layout.planeFloatCount*2u*layout.channelCount,0.f);
+
+			const auto format = image->getCreationParameters().format;
+			const auto blockDims = getBlockDimensions(format);
+			const uint8_t* inData = reinterpret_cast<const uint8_t*>(image->getBuffer()->getPointer());
+			auto decode = [&](uint32_t readBlockArrayOffset, core::vectorSIMDu32 readBlockPos) -> void
+			{
+				const core::vectorSIMDu32 localPos = readBlockPos*blockDims-core::vectorSIMDu32(offset.x,offset.y,offset.z);
+				const void* srcPix[4] = {inData+readBlockArrayOffset,nullptr,nullptr,nullptr};
+				for (auto blockY=0u; blockY<blockDims.y; blockY++)
+				for (auto blockX=0u; blockX<blockDims.x; blockX++)
+				{
+					const uint32_t x = localPos.x+blockX, y = localPos.y+blockY;
+					if (x>=extent.width || y>=extent.height)
+						continue;
+					double decodeBuffer[MaxChannels] = {};
+					decodePixelsRuntime(format,srcPix,decodeBuffer,blockX,blockY);
+					const auto padded = remap(x,y);
+					// even texels of a row go into the real plane and odd ones into the imaginary
+					const size_t planeOffset = size_t(padded.y)*layout.pitch+(padded.x>>1u);
+					for (auto c=0u; c<layout.channelCount; c++)
+						layout.getPlane(c,padded.x&0x1u)[planeOffset] = float(decodeBuffer[c]);
+				}
+			};
+
+			IImage::SSubresourceLayers subresource = {static_cast<IImage::E_ASPECT_FLAGS>(0u),mipLevel,layer,1u};
+			CMatchedSizeInOutImageFilterCommon::state_type::TexelRange range = {offset,extent};
+			CBasicImageFilterCommon::clip_region_functor_t clipFunctor(subresource,range,format);
+
+			const auto& regions = image->getRegions(mipLevel);
+			CBasicImageFilterCommon::executePerRegion(policy,image,decode,regions.begin(),regions.end(),clipFunctor);
+		}
+
+		template<class ExecutionPolicy>
+		static inline void encodeFromPlanes(ExecutionPolicy&& policy, state_type* state, const uint32_t layer, const SLayout& layout)
+		{
+			const auto outFormat = state->outImage->getCreationParameters().format;
+			uint8_t* outData = reinterpret_cast<uint8_t*>(state->outImage->getBuffer()->getPointer());
+			auto encode = [&](uint32_t writeBlockArrayOffset, core::vectorSIMDu32 writeBlockPos) -> void
+			{
+				// output format cannot be block compressed so block==texel
+				const uint32_t x = writeBlockPos.x-state->outOffset.x, y = writeBlockPos.y-state->outOffset.y;
+				const size_t planeOffset = size_t(y)*layout.pitch+(x>>1u);
+				double encodeBuffer[MaxChannels] = {};
+				for (auto c=0u; c<layout.channelCount; c++)
+					encodeBuffer[c] = layout.getPlane(c,x&0x1u)[planeOffset];
+				encodePixelsRuntime(outFormat,outData+writeBlockArrayOffset,encodeBuffer);
+			};
+
+			IImage::SSubresourceLayers subresource = {static_cast<IImage::E_ASPECT_FLAGS>(0u),state->outMipLevel,layer,1u};
+			CMatchedSizeInOutImageFilterCommon::state_type::TexelRange range = {state->outOffset,state->extent};
+			CBasicImageFilterCommon::clip_region_functor_t clipFunctor(subresource,range,outFormat);
+
+			const auto& outRegions = state->outImage->getRegions(state->outMipLevel);
+			CBasicImageFilterCommon::executePerRegion(policy,state->outImage,encode,outRegions.begin(),outRegions.end(),clipFunctor);
+		}
+};
+
+} // end namespace nbl::asset
+
+#endif
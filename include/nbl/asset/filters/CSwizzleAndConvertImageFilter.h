@@ -90,7 +90,7 @@ class CSwizzleAndConvertImageFilterBase : public CSwizzleableAndDitherableFilter
 					return true;
 				};
 				CMatchedSizeInOutImageFilterCommon::commonExecute(state,perOutputRegion);
-				state->normalization.finalize<encodeBufferType>();
+				state->normalization.template finalize<encodeBufferType>();
 			}
 		}
 };
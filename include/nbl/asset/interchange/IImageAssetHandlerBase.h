@@ -8,6 +8,7 @@
 #include "nbl/core/declarations.h"
 
 #include "nbl/system/ILogger.h"
+#include "nbl/system/IFile.h"
 
 #include "nbl/asset/filters/CCopyImageFilter.h"
 #include "nbl/asset/filters/CSwizzleAndConvertImageFilter.h"
@@ -171,6 +172,32 @@ class IImageAssetHandlerBase : public virtual core::IReferenceCounted
 			return newImage;
 		}
 
+		/*
+			Returns a pointer to the entire contents of the file, so that codecs can be fed
+			from a single contiguous span instead of issuing an `IFile::read` per callback.
+			If the file is mapped no copy is made at all, otherwise the file is read in one go
+			into `fallbackStorage` which must outlive the use of the returned pointer.
+			Returns nullptr on failure.
+		*/
+
+		static inline const uint8_t* getWholeFileSpan(system::IFile* file, core::vector<uint8_t>& fallbackStorage)
+		{
+			if (!file)
+				return nullptr;
+
+			const size_t size = file->getSize();
+			const system::IFile* constFile = file;
+			if (const auto* mapped=reinterpret_cast<const uint8_t*>(constFile->getMappedPointer()))
+				return mapped;
+
+			fallbackStorage.resize(size);
+			system::IFile::success_t success;
+			file->read(success,fallbackStorage.data(),0ull,size);
+			if (!success)
+				return nullptr;
+			return fallbackStorage.data();
+		}
+
 		/*
 			Performs image's texel flip. A processing image must
 			be have appropriate texel buffer and regions attached.
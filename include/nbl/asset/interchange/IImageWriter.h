@@ -22,6 +22,83 @@ namespace asset
 class IImageWriter : public IAssetWriter, public IImageAssetHandlerBase
 {
 	public:
+		//! Optional encoder settings for the PNG, JPG and EXR writers, handed to them by an `IImageWriterOverride`
+		/**
+			Any member left at its default makes the writer derive the setting from the `E_WRITER_FLAGS` and the
+			`compressionLevel` it gets from the `IAssetWriterOverride`, same as when a plain `IAssetWriterOverride` is used.
+		*/
+		struct SEncoderParams
+		{
+			//! same bits as libpng's `PNG_FILTER_*`, can be combined to let libpng pick adaptively per row
+			enum E_PNG_FILTER : uint8_t
+			{
+				EPF_DEFAULT = 0x00u,
+				EPF_NONE = 0x08u,
+				EPF_SUB = 0x10u,
+				EPF_UP = 0x20u,
+				EPF_AVG = 0x40u,
+				EPF_PAETH = 0x80u,
+				EPF_ALL = EPF_NONE|EPF_SUB|EPF_UP|EPF_AVG|EPF_PAETH
+			};
+			//! same values as zlib's deflate strategies, except that `EPS_DEFAULT` leaves libpng's own choice
+			enum E_PNG_STRATEGY : uint8_t
+			{
+				EPS_DEFAULT = 0u,
+				EPS_FILTERED = 1u,
+				EPS_HUFFMAN_ONLY = 2u,
+				EPS_RLE = 3u
+			};
+			//! same values as OpenEXR's `Imf::Compression`
+			enum E_EXR_COMPRESSION : uint8_t
+			{
+				EEC_NONE = 0u,
+				EEC_RLE = 1u,
+				EEC_ZIPS = 2u,
+				EEC_ZIP = 3u,
+				EEC_PIZ = 4u,
+				EEC_PXR24 = 5u,
+				EEC_B44 = 6u,
+				EEC_B44A = 7u,
+				EEC_DWAA = 8u,
+				EEC_DWAB = 9u,
+				//! not an OpenEXR value, ZIP unless `EWF_COMPRESSED` and a `compressionLevel` above 0.5 pick PIZ
+				EEC_DERIVE = 0xffu
+			};
+
+			//! zlib level from 0 (just store, fastest) to 9 (smallest), negative means derive from `compressionLevel`
+			int8_t pngCompressionLevel = -1;
+			E_PNG_FILTER pngFilter = EPF_DEFAULT;
+			E_PNG_STRATEGY pngStrategy = EPS_DEFAULT;
+			//! from 1 to 100, 0 means derive from `compressionLevel`
+			uint8_t jpegQuality = 0u;
+			E_EXR_COMPRESSION exrCompression = EEC_DERIVE;
+			//! threads OpenEXR may use to compress the scanline blocks, its global thread pool gets grown to that many if smaller, 0 means use the pool as it is
+			uint16_t exrThreadCount = 0u;
+		};
+
+		//! Pass one as the `IAssetWriterOverride` to choose the `SEncoderParams`, or derive from it to choose them per image
+		class IImageWriterOverride : public IAssetWriterOverride
+		{
+			public:
+				IImageWriterOverride() = default;
+				IImageWriterOverride(const SEncoderParams& _encoderParams) : encoderParams(_encoderParams) {}
+
+				//! Settings to encode `image` with, the same ones for every image unless overridden
+				inline virtual SEncoderParams getEncoderParams(const SAssetWriteContext& ctx, const IAsset* image, const uint32_t& hierarchyLevel)
+				{
+					return encoderParams;
+				}
+
+				SEncoderParams encoderParams;
+		};
+
+		//! What the writers encode `image` with, all defaults unless `_override` is an `IImageWriterOverride`
+		static inline SEncoderParams getEncoderParams(IAssetWriterOverride* _override, const SAssetWriteContext& ctx, const IAsset* image, const uint32_t hierarchyLevel=0u)
+		{
+			if (auto* imageOverride = dynamic_cast<IImageWriterOverride*>(_override))
+				return imageOverride->getEncoderParams(ctx,image,hierarchyLevel);
+			return SEncoderParams();
+		}
 
 	protected:
 
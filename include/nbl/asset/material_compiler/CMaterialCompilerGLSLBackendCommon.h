@@ -9,6 +9,7 @@
 #include <nbl/core/declarations.h>
 
 #include <ostream>
+#include <mutex>
 
 #include <nbl/asset/utils/ICPUVirtualTexture.h>
 #include <nbl/asset/material_compiler/IR.h>
@@ -204,6 +205,11 @@ public:
 		{
 			i = core::bitfieldInsert<instr_t>(i, ix, BITFIELDS_BSDF_BUF_OFFSET_SHIFT, BITFIELDS_BSDF_BUF_OFFSET_WIDTH);
 		}
+		// the specials without operands leave the BSDF data offset unused
+		inline static bool opHasBSDFData(E_OPCODE op)
+		{
+			return op!=OP_SET_GEOM_NORMAL && op!=OP_INVALID && op!=OP_NOOP;
+		}
 
 		// TODO: Instruction ID needs to be renamed for better semantics
 		inline static instr_id_t getInstrId(const instr_t& i)
@@ -593,10 +599,6 @@ public:
 		friend class CMaterialCompilerGLSLBackendCommon;
 
 		//users should not touch this
-		core::vector<instr_stream::intermediate::SBSDFUnion> bsdfData;
-		// TODO: HARDER DEDUPLICATION, hash & compare contents not only pointers!
-		core::unordered_map<const IR::INode*, size_t> bsdfDataIndexMap;
-
 		using VTallocKey = std::pair<const asset::ICPUImageView*, const asset::ICPUSampler*>;
 		struct VTallocKeyHash
 		{
@@ -606,6 +608,10 @@ public:
 			}
 		};
 		core::unordered_map<VTallocKey, instr_stream::VTID, VTallocKeyHash> VTallocMap;
+		std::mutex VTallocMutex;
+
+		// thread-safe
+		instr_stream::VTID packTexture(const IR::INode::STextureSource& tex);
 
 	public:
 		struct VT
@@ -708,6 +714,50 @@ public:
 		//one element for each input IR root node
 		core::unordered_map<const IR::INode*, instr_streams_t> streams;
 
+		// Alternative layout produced by `canonicalizeStreams`, streams of materials differing only in parameters are stored once.
+		// BSDF data indices in `instructions` are slots of the material's parameter block. To consume it, compile the shaders with `#define SHARED_STREAMS`,
+		// make `nbl_glsl_MC_fetchInstr` read `instructions` and `nbl_glsl_MC_fetchParamBlockEntry` read `paramBlocks`,
+		// then set `nbl_glsl_MC_paramBlockOffset` to the material's `paramBlockOffset` before running its streams.
+		struct shared_streams_t
+		{
+			struct material_ref_t
+			{
+				// offsets into `instructions`, prefetch stream is still the one in `result_t::prefetch_stream`
+				instr_streams_t streams;
+				// range of `paramBlocks`
+				uint32_t paramBlockOffset;
+				uint32_t paramBlockSize;
+			};
+
+			instr_stream::traversal_t instructions;
+			// indices into `result_t::bsdfData`
+			core::vector<uint32_t> paramBlocks;
+			// `instructions` in variable length encoding (see `encodeVariableLength`), empty unless requested
+			core::vector<uint8_t> encodedInstructions;
+
+			core::unordered_map<const IR::INode*, material_ref_t> materials;
+		} shared;
+
+		struct stream_statistics_t
+		{
+			uint32_t remAndPdfInstrCount = 0u;
+			uint32_t genChoiceInstrCount = 0u;
+			uint32_t normPrecompInstrCount = 0u;
+			uint32_t texPrefetchInstrCount = 0u;
+			uint32_t bsdfDataCount = 0u;
+
+			// in bytes
+			size_t instructionsSize = 0ull;
+			size_t prefetchStreamSize = 0ull;
+			size_t bsdfDataSize = 0ull;
+
+			// only filled by `canonicalizeStreams`
+			uint32_t uniqueTraversalCount = 0u;
+			size_t sharedInstructionsSize = 0ull;
+			size_t paramBlocksSize = 0ull;
+			size_t encodedInstructionsSize = 0ull;
+		} statistics;
+
 		//has to go after #version and before required user-provided descriptors and functions
 		std::string fragmentShaderSource_declarations;
 		//has to go after required user-provided descriptors and functions and before the rest of shader (especially entry point function)
@@ -716,7 +766,22 @@ public:
 
 	void debugPrint(std::ostream& _out, const result_t::instr_streams_t& _streams, const result_t& _res, const SContext* _ctx) const;
 
-	virtual result_t compile(SContext* _ctx, IR* _ir, E_GENERATOR_STREAM_TYPE _generatorChoiceStream=EGST_PRESENT);
+	// The IR is only read, apart from its temporary nodes. `_parallel` compiles the roots on all cores, the result is bit-identical either way.
+	virtual result_t compile(SContext* _ctx, IR* _ir, E_GENERATOR_STREAM_TYPE _generatorChoiceStream=EGST_PRESENT, const bool _parallel=true);
+
+	enum E_INSTR_ENCODING
+	{
+		EIE_FIXED_64BIT,
+		// for storage and transfer only, has to be decoded before use
+		EIE_VARIABLE_LENGTH
+	};
+	// Fills `result_t::shared` and the related statistics, leaves the rest of `_res` intact.
+	static void canonicalizeStreams(result_t& _res, E_INSTR_ENCODING _encoding=EIE_FIXED_64BIT);
+
+	// Every instruction is XORed with the previous one and the result is written as a LEB128 varint.
+	static core::vector<uint8_t> encodeVariableLength(const instr_stream::traversal_t& _stream);
+	// Returns false if the data is malformed.
+	static bool decodeVariableLength(const uint8_t* _data, size_t _size, instr_stream::traversal_t& _outStream);
 };
 
 }
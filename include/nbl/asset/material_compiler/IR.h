@@ -9,66 +9,86 @@
 #include <nbl/core/containers/refctd_dynamic_array.h>
 #include <nbl/asset/ICPUImageView.h>
 #include <nbl/asset/ICPUSampler.h>
-#include <nbl/core/alloc/LinearAddressAllocator.h>
+#include <nbl/core/algorithm/utility.h>
+
+#include <mutex>
 
 namespace nbl::asset::material_compiler
 {
 
 class IR : public core::IReferenceCounted
 {
+    // Chunked arena, chunks are never reallocated so node pointers stay valid for the lifetime of the IR no matter how much it grows
     class SBackingMemManager
     {
-        _NBL_STATIC_INLINE_CONSTEXPR size_t INITIAL_MEM_SIZE = 1ull<<20;
-        _NBL_STATIC_INLINE_CONSTEXPR size_t MAX_MEM_SIZE = 1ull<<20;
+        _NBL_STATIC_INLINE_CONSTEXPR size_t CHUNK_SIZE = 1ull<<20;
         _NBL_STATIC_INLINE_CONSTEXPR size_t ALIGNMENT = _NBL_SIMD_ALIGNMENT;
 
-        uint8_t* mem;
-        size_t currSz;
-        using addr_alctr_t = core::LinearAddressAllocator<uint32_t>;
-        addr_alctr_t addrAlctr;
+        struct SChunk
+        {
+            uint8_t* mem;
+            size_t size;
+        };
+        core::vector<SChunk> chunks;
+        // chunks after `currChunk` are kept around after a rollback for reuse
+        uint32_t currChunk = 0u;
+        size_t currOffset = 0ull;
+        size_t allocatedSize = 0ull;
 
     public:
-        SBackingMemManager() : mem(nullptr), currSz(INITIAL_MEM_SIZE), addrAlctr(nullptr, 0u, 0u, ALIGNMENT, MAX_MEM_SIZE) {
-            mem = reinterpret_cast<uint8_t*>(_NBL_ALIGNED_MALLOC(currSz, ALIGNMENT));
-        }
+        struct cursor_t
+        {
+            uint32_t chunk;
+            size_t offset;
+            size_t allocatedSize;
+        };
+
+        SBackingMemManager() = default;
+        SBackingMemManager(const SBackingMemManager&) = delete;
         ~SBackingMemManager() {
-            _NBL_ALIGNED_FREE(mem);
+            for (auto& chunk : chunks)
+                _NBL_ALIGNED_FREE(chunk.mem);
         }
 
         uint8_t* alloc(size_t bytes)
         {
-            auto addr = addrAlctr.alloc_addr(bytes, ALIGNMENT);
-            assert(addr != addr_alctr_t::invalid_address);
-            //TODO reallocation will invalidate all pointers to nodes, so...
-            //1) never reallocate (just have reasonably big buffer for nodes)
-            //2) make some node_handle class that will work as pointer but is based on offset instead of actual address
-            if (addr+bytes > currSz) {
-                size_t newSz = currSz<<1;
-                if (newSz > MAX_MEM_SIZE) {
-                    addrAlctr.free_addr(addr, bytes);
-                    return nullptr;
+            size_t addr = core::alignUp(currOffset,ALIGNMENT);
+            if (chunks.empty() || addr+bytes>chunks[currChunk].size)
+            {
+                // find the next chunk big enough, oversized allocations get a chunk of their own
+                uint32_t next = chunks.empty() ? 0u:(currChunk+1u);
+                while (next<chunks.size() && chunks[next].size<bytes)
+                    next++;
+                if (next==chunks.size())
+                {
+                    const size_t chunkSz = core::max(CHUNK_SIZE,core::alignUp(bytes,ALIGNMENT));
+                    chunks.push_back({reinterpret_cast<uint8_t*>(_NBL_ALIGNED_MALLOC(chunkSz,ALIGNMENT)),chunkSz});
                 }
-
-                void* newMem = _NBL_ALIGNED_MALLOC(newSz, ALIGNMENT);
-                memcpy(newMem, mem, currSz);
-                _NBL_ALIGNED_FREE(mem);
-                mem = reinterpret_cast<uint8_t*>(newMem);
-                currSz = newSz;
+                currChunk = next;
+                addr = 0ull;
             }
+            currOffset = addr+bytes;
+            allocatedSize += bytes;
 
-            return mem+addr;
+            return chunks[currChunk].mem+addr;
         }
 
-        uint32_t getAllocatedSize() const
+        size_t getAllocatedSize() const
         {
-            return addrAlctr.get_allocated_size();
+            return allocatedSize;
         }
 
-        void freeLastAllocatedBytes(uint32_t _bytes)
+        cursor_t getCursor() const
+        {
+            return {currChunk,currOffset,allocatedSize};
+        }
+        //! frees everything allocated after `_cursor` was taken
+        void rollback(const cursor_t& _cursor)
         {
-            assert(addrAlctr.get_allocated_size() >= _bytes);
-            const uint32_t newCursor = addrAlctr.get_allocated_size() - _bytes;
-            addrAlctr.reset(newCursor);
+            assert(_cursor.allocatedSize<=allocatedSize);
+            currChunk = _cursor.chunk;
+            currOffset = _cursor.offset;
+            allocatedSize = _cursor.allocatedSize;
         }
     };
 
@@ -112,7 +132,10 @@ public:
         for (INode* n : tmp)
             n->~INode();
         tmp.clear();
-        memMgr.freeLastAllocatedBytes(tmpSize);
+        // memory can only be given back if no persistent node got allocated after the temporaries,
+        // that's the case when everything allocated since the first temporary was a temporary
+        if (tmpSize && memMgr.getAllocatedSize()==tmpBegin.allocatedSize+tmpSize)
+            memMgr.rollback(tmpBegin);
         tmpSize = 0u;
     }
 
@@ -137,10 +160,14 @@ public:
     template <typename NodeType, typename ...Args>
     NodeType* allocTmpNode(Args&& ...args)
     {
-        const uint32_t cursor = memMgr.getAllocatedSize();
+        // temporaries get created by backends compiling several roots at once
+        std::lock_guard<std::mutex> lock(tmpMutex);
+        const auto cursor = memMgr.getCursor();
+        if (!tmpSize)
+            tmpBegin = cursor;
         auto* node = allocNode_impl<NodeType>(std::forward<Args>(args)...);
         tmp.push_back(node);
-        tmpSize += (memMgr.getAllocatedSize() - cursor);
+        tmpSize += (memMgr.getAllocatedSize() - cursor.allocatedSize);
         return node;
     }
 
@@ -254,9 +281,9 @@ public:
                 switch (source)
                 {
                 case EPS_CONSTANT:
-                    return value.constant==value.constant;
+                    return value.constant==rhs.value.constant;
                 case EPS_TEXTURE:
-                    return value.texture==value.texture;
+                    return value.texture==rhs.value.texture;
                 default: return false;
                 }
             }
@@ -613,11 +640,290 @@ public:
         bool thin = false;
     };
 
+    //! Hash-consing of the DAG reachable from the roots, structurally identical subtrees end up as the same node.
+    //! The roots themselves are never replaced (so pointers to them held by frontends stay valid) only their descendants.
+    //! Sharing is only ever introduced between different roots, a node never appears twice in the tree of one root because of this,
+    //! because backends give out per-root instruction IDs by node.
+    //! Returns the number of nodes which were merged away.
+    uint32_t deduplicateSubtrees()
+    {
+        struct SNodeHash
+        {
+            inline size_t operator()(const INode* node) const { return hashNode(node); }
+        };
+        struct SNodeEqual
+        {
+            inline bool operator()(const INode* lhs, const INode* rhs) const { return nodesEqual(lhs,rhs); }
+        };
+        core::unordered_set<INode*,SNodeHash,SNodeEqual> canonical;
+        // original node -> canonical node, also serves as the visited set
+        core::unordered_map<const INode*,INode*> remap;
+
+        // post-order so that children are already canonical when their parent gets hashed (Merkle style)
+        auto canonicalize = [&](INode* _root) -> void
+        {
+            core::unordered_set<const INode*> usedInRoot;
+            // subtrees reached through a node canonicalized earlier (by another root) are already final, but still part of this root
+            auto markUsed = [&usedInRoot](const INode* _canonical) -> void
+            {
+                core::stack<const INode*> s;
+                s.push(_canonical);
+                while (!s.empty())
+                {
+                    const INode* node = s.top();
+                    s.pop();
+                    if (!usedInRoot.insert(node).second)
+                        continue;
+                    for (const auto* child : node->children)
+                        s.push(child);
+                }
+            };
+            core::stack<std::pair<INode*,bool>> s;
+            s.push({_root,false});
+            while (!s.empty())
+            {
+                auto [node,childrenDone] = s.top();
+                s.pop();
+                if (auto found=remap.find(node); found!=remap.end())
+                {
+                    markUsed(found->second);
+                    continue;
+                }
+                if (!childrenDone)
+                {
+                    s.push({node,true});
+                    for (auto* child : node->children)
+                    {
+                        if (auto found=remap.find(child); found!=remap.end())
+                            markUsed(found->second);
+                        else
+                            s.push({child,false});
+                    }
+                    continue;
+                }
+
+                for (auto& child : node->children)
+                    child = remap[child];
+                INode* replacement = node;
+                if (node!=_root)
+                {
+                    // children are already equal, so only the canonical node itself could be a repeat
+                    INode* found = *canonical.insert(node).first;
+                    if (usedInRoot.find(found)==usedInRoot.end())
+                        replacement = found;
+                }
+                remap[node] = replacement;
+                usedInRoot.insert(replacement);
+            }
+        };
+        for (auto* root : roots)
+            canonicalize(root);
+
+        uint32_t merged = 0u;
+        for (auto& entry : remap)
+        if (entry.first!=entry.second)
+        {
+            auto* duplicate = const_cast<INode*>(entry.first);
+            duplicate->~INode();
+            duplicate->deinited = true;
+            merged++;
+        }
+        return merged;
+    }
+
     SBackingMemManager memMgr;
     core::vector<INode*> roots;
 
     core::vector<INode*> tmp;
     uint32_t tmpSize = 0u;
+    SBackingMemManager::cursor_t tmpBegin = {};
+    std::mutex tmpMutex;
+
+private:
+    static inline void hashColor(size_t& seed, const INode::color_t& c)
+    {
+        for (uint32_t i=0u; i<3u; i++)
+            core::hash_combine(seed,c.pointer[i]);
+    }
+    static inline bool colorsEqual(const INode::color_t& lhs, const INode::color_t& rhs)
+    {
+        return lhs.x==rhs.x && lhs.y==rhs.y && lhs.z==rhs.z;
+    }
+    static inline void hashTexture(size_t& seed, const INode::STextureSource& t)
+    {
+        core::hash_combine(seed,t.image.get());
+        core::hash_combine(seed,t.sampler.get());
+        core::hash_combine(seed,t.scale);
+    }
+    template <typename type_of_const>
+    static inline void hashParam(size_t& seed, const INode::SParameter<type_of_const>& p)
+    {
+        core::hash_combine(seed,p.source);
+        if (p.source==INode::EPS_TEXTURE)
+            hashTexture(seed,p.value.texture);
+        else if constexpr (std::is_same_v<type_of_const,INode::color_t>)
+            hashColor(seed,p.value.constant);
+        else
+            core::hash_combine(seed,p.value.constant);
+    }
+    template <typename type_of_const>
+    static inline bool paramsEqual(const INode::SParameter<type_of_const>& lhs, const INode::SParameter<type_of_const>& rhs)
+    {
+        if (lhs.source!=rhs.source)
+            return false;
+        if (lhs.source==INode::EPS_TEXTURE)
+            return lhs.value.texture==rhs.value.texture;
+        if constexpr (std::is_same_v<type_of_const,INode::color_t>)
+            return colorsEqual(lhs.value.constant,rhs.value.constant);
+        else
+            return lhs.value.constant==rhs.value.constant;
+    }
+
+    static size_t hashNode(const INode* _node)
+    {
+        size_t seed = _node->symbol;
+        for (const auto* child : _node->children)
+            core::hash_combine(seed,child);
+        switch (_node->symbol)
+        {
+        case INode::ES_GEOM_MODIFIER:
+        {
+            auto* node = static_cast<const CGeomModifierNode*>(_node);
+            core::hash_combine(seed,node->type);
+            hashTexture(seed,node->texture);
+        }
+            break;
+        case INode::ES_EMISSION:
+            hashColor(seed,static_cast<const CEmissionNode*>(_node)->intensity);
+            break;
+        case INode::ES_OPACITY:
+            hashParam(seed,static_cast<const COpacityNode*>(_node)->opacity);
+            break;
+        case INode::ES_BSDF_COMBINER:
+        {
+            auto* node = static_cast<const CBSDFCombinerNode*>(_node);
+            core::hash_combine(seed,node->type);
+            if (node->type==CBSDFCombinerNode::ET_WEIGHT_BLEND)
+                hashParam(seed,static_cast<const CBSDFBlendNode*>(node)->weight);
+            else if (node->type==CBSDFCombinerNode::ET_MIX)
+            for (size_t i=0u; i<node->children.count; i++)
+                core::hash_combine(seed,static_cast<const CBSDFMixNode*>(node)->weights[i]);
+        }
+            break;
+        case INode::ES_BSDF:
+        {
+            auto* node = static_cast<const CBSDFNode*>(_node);
+            core::hash_combine(seed,node->type);
+            hashColor(seed,node->eta);
+            hashColor(seed,node->etaK);
+            switch (node->type)
+            {
+            case CBSDFNode::ET_MICROFACET_DIFFTRANS: [[fallthrough]];
+            case CBSDFNode::ET_MICROFACET_DIFFUSE:
+            {
+                auto* diffuse = static_cast<const CMicrofacetDiffuseBxDFBase*>(node);
+                hashParam(seed,diffuse->alpha_u);
+                hashParam(seed,diffuse->alpha_v);
+                if (node->type==CBSDFNode::ET_MICROFACET_DIFFUSE)
+                    hashParam(seed,static_cast<const CMicrofacetDiffuseBSDFNode*>(node)->reflectance);
+                else
+                    hashParam(seed,static_cast<const CMicrofacetDifftransBSDFNode*>(node)->transmittance);
+            }
+                break;
+            case CBSDFNode::ET_MICROFACET_SPECULAR: [[fallthrough]];
+            case CBSDFNode::ET_MICROFACET_COATING: [[fallthrough]];
+            case CBSDFNode::ET_MICROFACET_DIELECTRIC:
+            {
+                auto* specular = static_cast<const CMicrofacetSpecularBSDFNode*>(node);
+                core::hash_combine(seed,specular->ndf);
+                core::hash_combine(seed,specular->shadowing);
+                hashParam(seed,specular->alpha_u);
+                hashParam(seed,specular->alpha_v);
+                if (node->type==CBSDFNode::ET_MICROFACET_COATING)
+                    hashParam(seed,static_cast<const CMicrofacetCoatingBSDFNode*>(node)->thicknessSigmaA);
+                else if (node->type==CBSDFNode::ET_MICROFACET_DIELECTRIC)
+                    core::hash_combine(seed,static_cast<const CMicrofacetDielectricBSDFNode*>(node)->thin);
+            }
+                break;
+            default:
+                break;
+            }
+        }
+            break;
+        default:
+            break;
+        }
+        return seed;
+    }
+    static bool nodesEqual(const INode* _lhs, const INode* _rhs)
+    {
+        if (_lhs->symbol!=_rhs->symbol || _lhs->children!=_rhs->children)
+            return false;
+        switch (_lhs->symbol)
+        {
+        case INode::ES_GEOM_MODIFIER:
+        {
+            auto* lhs = static_cast<const CGeomModifierNode*>(_lhs);
+            auto* rhs = static_cast<const CGeomModifierNode*>(_rhs);
+            return lhs->type==rhs->type && lhs->texture==rhs->texture;
+        }
+        case INode::ES_EMISSION:
+            return colorsEqual(static_cast<const CEmissionNode*>(_lhs)->intensity,static_cast<const CEmissionNode*>(_rhs)->intensity);
+        case INode::ES_OPACITY:
+            return paramsEqual(static_cast<const COpacityNode*>(_lhs)->opacity,static_cast<const COpacityNode*>(_rhs)->opacity);
+        case INode::ES_BSDF_COMBINER:
+        {
+            auto* lhs = static_cast<const CBSDFCombinerNode*>(_lhs);
+            auto* rhs = static_cast<const CBSDFCombinerNode*>(_rhs);
+            if (lhs->type!=rhs->type)
+                return false;
+            if (lhs->type==CBSDFCombinerNode::ET_WEIGHT_BLEND)
+                return paramsEqual(static_cast<const CBSDFBlendNode*>(lhs)->weight,static_cast<const CBSDFBlendNode*>(rhs)->weight);
+            if (lhs->type==CBSDFCombinerNode::ET_MIX)
+                return std::equal(static_cast<const CBSDFMixNode*>(lhs)->weights,static_cast<const CBSDFMixNode*>(lhs)->weights+lhs->children.count,static_cast<const CBSDFMixNode*>(rhs)->weights);
+            return true;
+        }
+        case INode::ES_BSDF:
+        {
+            auto* lhs = static_cast<const CBSDFNode*>(_lhs);
+            auto* rhs = static_cast<const CBSDFNode*>(_rhs);
+            if (lhs->type!=rhs->type || !colorsEqual(lhs->eta,rhs->eta) || !colorsEqual(lhs->etaK,rhs->etaK))
+                return false;
+            switch (lhs->type)
+            {
+            case CBSDFNode::ET_MICROFACET_DIFFTRANS: [[fallthrough]];
+            case CBSDFNode::ET_MICROFACET_DIFFUSE:
+            {
+                auto* l = static_cast<const CMicrofacetDiffuseBxDFBase*>(lhs);
+                auto* r = static_cast<const CMicrofacetDiffuseBxDFBase*>(rhs);
+                if (!paramsEqual(l->alpha_u,r->alpha_u) || !paramsEqual(l->alpha_v,r->alpha_v))
+                    return false;
+                if (lhs->type==CBSDFNode::ET_MICROFACET_DIFFUSE)
+                    return paramsEqual(static_cast<const CMicrofacetDiffuseBSDFNode*>(lhs)->reflectance,static_cast<const CMicrofacetDiffuseBSDFNode*>(rhs)->reflectance);
+                return paramsEqual(static_cast<const CMicrofacetDifftransBSDFNode*>(lhs)->transmittance,static_cast<const CMicrofacetDifftransBSDFNode*>(rhs)->transmittance);
+            }
+            case CBSDFNode::ET_MICROFACET_SPECULAR: [[fallthrough]];
+            case CBSDFNode::ET_MICROFACET_COATING: [[fallthrough]];
+            case CBSDFNode::ET_MICROFACET_DIELECTRIC:
+            {
+                auto* l = static_cast<const CMicrofacetSpecularBSDFNode*>(lhs);
+                auto* r = static_cast<const CMicrofacetSpecularBSDFNode*>(rhs);
+                if (l->ndf!=r->ndf || l->shadowing!=r->shadowing || !paramsEqual(l->alpha_u,r->alpha_u) || !paramsEqual(l->alpha_v,r->alpha_v))
+                    return false;
+                if (lhs->type==CBSDFNode::ET_MICROFACET_COATING)
+                    return paramsEqual(static_cast<const CMicrofacetCoatingBSDFNode*>(lhs)->thicknessSigmaA,static_cast<const CMicrofacetCoatingBSDFNode*>(rhs)->thicknessSigmaA);
+                if (lhs->type==CBSDFNode::ET_MICROFACET_DIELECTRIC)
+                    return static_cast<const CMicrofacetDielectricBSDFNode*>(lhs)->thin==static_cast<const CMicrofacetDielectricBSDFNode*>(rhs)->thin;
+                return true;
+            }
+            default:
+                return true;
+            }
+        }
+        default:
+            return false;
+        }
+    }
 };
 
 }
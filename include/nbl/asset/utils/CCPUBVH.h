@@ -0,0 +1,154 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef __NBL_ASSET_C_CPU_BVH_H_INCLUDED__
+#define __NBL_ASSET_C_CPU_BVH_H_INCLUDED__
+
+#include "nbl/asset/ICPUAccelerationStructure.h"
+
+namespace nbl::asset
+{
+
+//! Host side ray tracing of the geometry described by an `ICPUAccelerationStructure`, for picking, baking and collision without an RT capable GPU
+/** The tree is built top-down with binned SAH, the upper levels bin in parallel and the subtrees below them get built in parallel.
+Nodes are 4-wide with the children bounds stored SoA, so a single ray tests all children at once with SSE.
+
+Bottom levels hold triangles (with the geometry's `transformData` baked in) and AABBs, as there are no intersection shaders
+on the CPU an AABB primitive reports a hit at the distance where the ray enters the box.
+
+Top levels hold `IAccelerationStructure::Instance`s, on the host `Instance::accelerationStructureReference` is an index
+into the range of bottom levels passed to `create`.
+*/
+class CCPUBVH final : public core::IReferenceCounted
+{
+	public:
+		_NBL_STATIC_INLINE_CONSTEXPR uint32_t BRANCHING_FACTOR = 4u;
+		_NBL_STATIC_INLINE_CONSTEXPR uint32_t MAX_LEAF_SIZE = 16u;
+		_NBL_STATIC_INLINE_CONSTEXPR uint32_t MAX_PACKET_SIZE = 64u;
+		_NBL_STATIC_INLINE_CONSTEXPR uint32_t INVALID_INDEX = 0xffffffffu;
+
+		struct alignas(16) SNode
+		{
+			_NBL_STATIC_INLINE_CONSTEXPR uint32_t LEAF_BIT = 0x80000000u;
+			_NBL_STATIC_INLINE_CONSTEXPR uint32_t LEAF_COUNT_SHIFT = 27u;
+			_NBL_STATIC_INLINE_CONSTEXPR uint32_t LEAF_FIRST_MASK = (0x1u<<LEAF_COUNT_SHIFT)-1u;
+
+			static inline uint32_t makeLeaf(const uint32_t first, const uint32_t count)
+			{
+				assert(count && count<=MAX_LEAF_SIZE && first<=LEAF_FIRST_MASK);
+				return LEAF_BIT|((count-1u)<<LEAF_COUNT_SHIFT)|first;
+			}
+			static inline bool isLeaf(const uint32_t child) { return child&LEAF_BIT; }
+			static inline uint32_t getLeafFirst(const uint32_t child) { return child&LEAF_FIRST_MASK; }
+			static inline uint32_t getLeafCount(const uint32_t child) { return ((child&~LEAF_BIT)>>LEAF_COUNT_SHIFT)+1u; }
+
+			// minX, maxX, minY, maxY, minZ, maxZ of every child, empty slots have inverted infinite bounds
+			float bounds[6][BRANCHING_FACTOR];
+			// inner node index, leaf or INVALID_INDEX
+			uint32_t children[BRANCHING_FACTOR];
+		};
+
+		struct SBuildParams
+		{
+			SBuildParams() : maxLeafSize(4u), binCount(16u), parallelSubtreeThreshold(0x1u<<14u) {}
+
+			//! must be <= MAX_LEAF_SIZE
+			uint32_t maxLeafSize;
+			uint32_t binCount;
+			//! subtrees smaller than this get built by a single thread each
+			uint32_t parallelSubtreeThreshold;
+		};
+
+		struct SRay
+		{
+			SRay() : origin(0.f), direction(0.f,0.f,1.f), tMin(0.f), tMax(FLT_MAX), mask(0xffu) {}
+
+			core::vectorSIMDf origin;
+			core::vectorSIMDf direction;
+			float tMin;
+			float tMax;
+			//! instances whose mask ANDed with this is 0 are skipped
+			uint32_t mask;
+		};
+
+		struct SHit
+		{
+			inline bool isValid() const { return primitiveIndex!=INVALID_INDEX; }
+
+			float t;
+			//! barycentrics of the 2nd and 3rd vertex, 0 for AABBs
+			float u, v;
+			uint32_t primitiveIndex;
+			uint32_t geometryIndex;
+			//! both are INVALID_INDEX when tracing a bottom level directly
+			uint32_t instanceIndex;
+			uint32_t instanceCustomIndex;
+		};
+
+		//! Builds from the first (only) build info of a bottom level acceleration structure
+		static core::smart_refctd_ptr<CCPUBVH> create(const ICPUAccelerationStructure* _as, const SBuildParams& _params = SBuildParams());
+		//! Builds a top level, `_bottomLevels` get indexed by `Instance::accelerationStructureReference`
+		static core::smart_refctd_ptr<CCPUBVH> create(const ICPUAccelerationStructure* _as, const core::SRange<const core::smart_refctd_ptr<const CCPUBVH>>& _bottomLevels, const SBuildParams& _params = SBuildParams());
+
+		inline IAccelerationStructure::E_TYPE getType() const { return m_type; }
+		inline const core::aabbox3df& getBoundingBox() const { return m_bounds; }
+		inline const core::vector<SNode>& getNodes() const { return m_nodes; }
+		inline uint32_t getPrimitiveCount() const { return m_type==IAccelerationStructure::ET_TOP_LEVEL ? m_instances.size():m_primitives.size(); }
+		inline size_t getByteSize() const { return m_nodes.size()*sizeof(SNode)+m_primitives.size()*sizeof(SPrimitive)+m_instances.size()*sizeof(SInstance); }
+
+		//! Closest hit, returns whether anything was hit
+		bool traceClosest(const SRay& _ray, SHit& _hit) const;
+		//! Any hit, for occlusion queries
+		bool traceAny(const SRay& _ray) const;
+		//! Closest hit of a packet of coherent rays, the nodes are visited once for the whole packet
+		void traceClosest(const SRay* _rays, SHit* _hits, const uint32_t _count) const;
+		//! Any hit of coherent rays, traced in packets of `MAX_PACKET_SIZE`
+		/** `_occluded` receives a bitmask per packet, so needs `(_count+63)/64` entries, ray `i` is occluded when bit `i%64` of `_occluded[i/64]` is set.
+		@returns the number of occluded rays
+		*/
+		uint32_t traceAny(const SRay* _rays, uint64_t* _occluded, const uint32_t _count) const;
+
+	protected:
+		~CCPUBVH() = default;
+
+	private:
+		struct SPrimitive
+		{
+			_NBL_STATIC_INLINE_CONSTEXPR uint32_t AABB_BIT = 0x80000000u;
+
+			// triangles store v0, v1-v0, v2-v0, AABBs store min, max and nothing
+			core::vectorSIMDf data[3];
+			uint32_t geometryIndex;
+			uint32_t primitiveIndex;
+		};
+		struct SInstance
+		{
+			core::matrix3x4SIMD worldToObject;
+			core::smart_refctd_ptr<const CCPUBVH> bottomLevel;
+			uint32_t index;
+			uint32_t customIndex;
+			uint32_t mask;
+		};
+		struct SRayInternal;
+		class CBuilder;
+
+		CCPUBVH(const IAccelerationStructure::E_TYPE _type) : m_type(_type) {}
+
+		template<bool AnyHit>
+		bool traverse(const SRayInternal& _ray, SHit& _hit) const;
+		template<bool AnyHit>
+		uint64_t traversePacket(const SRayInternal* _rays, SHit* _hits, const uint64_t _activeMask) const;
+		template<bool AnyHit>
+		bool intersectPrimitive(const SPrimitive& _primitive, const SRayInternal& _ray, SHit& _hit) const;
+
+		const IAccelerationStructure::E_TYPE m_type;
+		core::aabbox3df m_bounds;
+		core::vector<SNode> m_nodes;
+		core::vector<SPrimitive> m_primitives;
+		core::vector<SInstance> m_instances;
+};
+
+}
+
+#endif
@@ -41,17 +41,14 @@ class CCPUMeshPackerV2 final : public IMeshPackerV2<ICPUBuffer,ICPUDescriptorSet
         template <typename MeshBufferIterator>
         uint32_t commit(IMeshPackerBase::PackedMeshBufferData* pmbdOut, CombinedDataOffsetTable* cdotOut, core::aabbox3df* aabbs, ReservedAllocationMeshBuffers* rambIn, const MeshBufferIterator mbBegin, const MeshBufferIterator mbEnd);
 
-        inline std::pair<uint32_t,uint32_t> getDescriptorSetWritesForUTB(
-            ICPUDescriptorSet::SWriteDescriptorSet* outWrites, ICPUDescriptorSet::SDescriptorInfo* outInfo, ICPUDescriptorSet* dstSet,
-            const typename base_t::DSLayoutParamsUTB& params = {}
-        ) const
-        {
-            auto createBufferView = [&](core::smart_refctd_ptr<ICPUBuffer>&& buff, E_FORMAT format) -> core::smart_refctd_ptr<IDescriptor>
-            {
-                return core::make_smart_refctd_ptr<ICPUBufferView>(std::move(buff),format);
-            };
-            return base_t::getDescriptorSetWritesForUTB(outWrites,outInfo,dstSet,createBufferView,params);
-        }
+        /**
+        Alternative to `commit` which splits the mesh buffers into meshlets (see `CMeshletBuilder`) for cluster culling instead of MDI batches,
+        the local indices are 8 bit and get tightly packed into the index buffer allocation, no MDI structs get written.
+        Reserve with `allocMeshlets`, which only asks for half the index space `alloc` would (`alloc`'s reservations work too, but waste half of it).
+        \return number of meshlets created for mesh buffer range described by mbBegin .. mbEnd, 0 if commit failed or mbBegin == mbEnd
+        */
+        template <typename MeshBufferIterator>
+        uint32_t commitMeshlets(IMeshPackerBase::PackedMeshBufferData* pmbdOut, CombinedDataOffsetTable* cdotOut, IMeshPackerBase::MeshletDescriptor* meshletsOut, ReservedAllocationMeshBuffers* rambIn, const MeshBufferIterator mbBegin, const MeshBufferIterator mbEnd, const CMeshletBuilder::SParams& params = CMeshletBuilder::SParams());
 };
 
 template <typename MDIStructType>
@@ -158,7 +155,7 @@ uint32_t CCPUMeshPackerV2<MDIStructType>::commit(IMeshPackerBase::PackedMeshBuff
                 if (inputRate == EVIR_PER_INSTANCE)
                     vaOffset = ramb.attribAllocParams[location].offset / attribSize;
 
-                cdotOut->attribInfo[location] = base_t::VirtualAttribute(vaArrayElement,vaOffset);
+                cdotOut->attribInfo[location] = typename base_t::VirtualAttribute(vaArrayElement,vaOffset);
 
             }
 
@@ -188,6 +185,106 @@ uint32_t CCPUMeshPackerV2<MDIStructType>::commit(IMeshPackerBase::PackedMeshBuff
     return batchCntTotal;
 }
 
+/*
+    @param pmbdOut size of this array has to be >= std::distance(mbBegin, mbEnd), `mdiParameterOffset` and `mdiParameterCount` describe the range in `meshletsOut`
+    @param cdotOut size of this array has to be >= IMeshPackerV2::calcMeshletMaxCount(mbBegin, mbEnd, params)
+    @param meshletsOut size of this array has to be >= IMeshPackerV2::calcMeshletMaxCount(mbBegin, mbEnd, params)
+*/
+template <typename MDIStructType>
+template <typename MeshBufferIterator>
+uint32_t CCPUMeshPackerV2<MDIStructType>::commitMeshlets(IMeshPackerBase::PackedMeshBufferData* pmbdOut, CombinedDataOffsetTable* cdotOut, IMeshPackerBase::MeshletDescriptor* meshletsOut, ReservedAllocationMeshBuffers* rambIn, const MeshBufferIterator mbBegin, const MeshBufferIterator mbEnd, const CMeshletBuilder::SParams& params)
+{
+    size_t i = 0ull;
+    uint32_t meshletCntTotal = 0u;
+    for (auto it = mbBegin; it != mbEnd; it++)
+    {
+        const ReservedAllocationMeshBuffers& ramb = *(rambIn + i);
+        IMeshPackerBase::PackedMeshBufferData& pmbd = *(pmbdOut + i);
+
+        // the index allocator counts 16 bit units
+        const uint32_t idxBuffByteOffset = ramb.indexAllocationOffset * sizeof(uint16_t);
+        uint8_t* indexBuffPtr = static_cast<uint8_t*>(base_t::m_packerDataStore.indexBuffer->getPointer()) + idxBuffByteOffset;
+
+        const auto& mbVtxInputParams = (*it)->getPipeline()->getVertexInputParams();
+
+        IdxBufferParams idxBufferParams = base_t::createNewIdxBufferParamsForNonTriangleListTopologies(*it);
+        const core::vector<uint32_t> indices = base_t::getTriangleListIndices(*it, idxBufferParams);
+        const CMeshletBuilder::SMeshlets meshlets = CMeshletBuilder::build(*it, indices.data(), indices.size() / 3u, params);
+
+        std::copy(meshlets.localIndices.begin(), meshlets.localIndices.end(), indexBuffPtr);
+
+        std::array<bool, 16> perInsAttribFromThisLocationWasCopied;
+        std::fill(perInsAttribFromThisLocationWasCopied.begin(), perInsAttribFromThisLocationWasCopied.end(), false);
+
+        const uint32_t meshletCnt = meshlets.meshlets.size();
+        for (uint32_t j = 0u; j < meshletCnt; j++)
+        {
+            const CMeshletBuilder::SMeshlet& meshlet = meshlets.meshlets[j];
+
+            core::unordered_map<uint32_t, uint16_t> usedVertices;
+            for (uint32_t k = 0u; k < meshlet.vertexCount; k++)
+                usedVertices.insert(std::make_pair(meshlets.vertices[meshlet.vertexOffset + k], static_cast<uint16_t>(k)));
+
+            //copy deinterleaved vertices into unified vertex buffer
+            for (uint16_t attrBit = 0x0001, location = 0; location < SVertexInputParams::MAX_ATTR_BUF_BINDING_COUNT; attrBit <<= 1, location++)
+            {
+                if (!(mbVtxInputParams.enabledAttribFlags & attrBit))
+                    continue;
+
+                if (ramb.attribAllocParams[location].offset == base_t::INVALID_ADDRESS)
+                    return 0u;
+
+                const E_FORMAT attribFormat = static_cast<E_FORMAT>(mbVtxInputParams.attributes[location].format);
+                const uint32_t attribSize = asset::getTexelOrBlockBytesize(attribFormat);
+                const uint32_t binding = mbVtxInputParams.attributes[location].binding;
+                const E_VERTEX_INPUT_RATE inputRate = mbVtxInputParams.bindings[binding].inputRate;
+
+                uint8_t* dstAttrPtr = static_cast<uint8_t*>(base_t::m_packerDataStore.vertexBuffer->getPointer()) + ramb.attribAllocParams[location].offset;
+
+                if (inputRate == EVIR_PER_VERTEX)
+                    base_t::deinterleaveAndCopyAttribute(*it, location, usedVertices, dstAttrPtr + meshlet.vertexOffset * attribSize);
+                if (inputRate == EVIR_PER_INSTANCE)
+                {
+                    if (perInsAttribFromThisLocationWasCopied[location] == false)
+                    {
+                        base_t::deinterleaveAndCopyPerInstanceAttribute(*it, location, dstAttrPtr);
+                        perInsAttribFromThisLocationWasCopied[location] = true;
+                    }
+                }
+
+                auto& utb = base_t::m_virtualAttribConfig.utbs[base_t::VirtualAttribConfig::getUTBArrayTypeFromFormat(attribFormat)];
+                auto vtxFormatInfo = utb.find(attribFormat);
+                if (vtxFormatInfo==utb.end())
+                    return 0u;
+
+                uint32_t vaOffset = ramb.attribAllocParams[location].offset / attribSize;
+                if (inputRate == EVIR_PER_VERTEX)
+                    vaOffset += meshlet.vertexOffset;
+
+                cdotOut->attribInfo[location] = typename base_t::VirtualAttribute(vtxFormatInfo->second,vaOffset);
+            }
+            cdotOut++;
+
+            const CMeshletBuilder::SCullData& cullData = meshlets.cullData[j];
+            IMeshPackerBase::MeshletDescriptor& meshletOut = *(meshletsOut++);
+            std::copy_n(cullData.boundingSphere.pointer, 4u, meshletOut.boundingSphere);
+            std::copy_n(cullData.coneApex.pointer, 3u, meshletOut.coneApex);
+            meshletOut.indexByteOffset = idxBuffByteOffset + meshlet.triangleOffset * 3u;
+            std::copy_n(cullData.coneAxis.pointer, 3u, meshletOut.coneAxis);
+            meshletOut.coneCutoff = cullData.coneAxis.w;
+            meshletOut.vertexCount = meshlet.vertexCount;
+            meshletOut.triangleCount = meshlet.triangleCount;
+        }
+
+        pmbd = { meshletCntTotal, meshletCnt };
+        meshletCntTotal += meshletCnt;
+
+        i++;
+    }
+
+    return meshletCntTotal;
+}
+
 }
 }
 
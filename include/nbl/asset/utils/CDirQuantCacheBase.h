@@ -9,6 +9,7 @@
 #include <iostream>
 #include <limits>
 #include <cmath>
+#include <shared_mutex>
 
 #include "parallel-hashmap/parallel_hashmap/phmap_dump.h"
 
@@ -264,6 +265,7 @@ class CDirQuantCacheBase : public impl::CDirQuantCacheBase
 		template<E_FORMAT CacheFormat>
 		inline void insertIntoCache(const Key& key, const value_type_t<CacheFormat>& value)
 		{
+			std::unique_lock lock(cacheMutex);
 			std::get<cache_type_t<CacheFormat>>(cache).insert(std::make_pair(key,value));		
 		}
 
@@ -275,6 +277,7 @@ class CDirQuantCacheBase : public impl::CDirQuantCacheBase
 			if (!validateSerializedCache<CacheFormat>(buffer))
 				return false;
 
+			std::unique_lock lock(cacheMutex);
 			auto& particularCache = std::get<cache_type_t<CacheFormat>>(cache);
 			cache_type_t<CacheFormat> backup;
 
@@ -329,11 +332,13 @@ class CDirQuantCacheBase : public impl::CDirQuantCacheBase
 			const uint64_t bufferSize = buffer.buffer.get()->getSize();
 			const uint64_t offset = buffer.offset;
 
-			if (bufferSize+offset>getSerializedCacheSizeInBytes<CacheFormat>())
+			std::shared_lock lock(cacheMutex);
+			auto& particularCache = std::get<cache_type_t<CacheFormat>>(cache);
+			if (bufferSize+offset>getSerializedCacheSizeInBytes_impl<CacheFormat>(particularCache.capacity()))
 				return false;
 
 			CBufferPhmapOutputArchive buffWrap(buffer);
-			return std::get<cache_type_t<CacheFormat>>(cache).dump(buffWrap);
+			return particularCache.dump(buffWrap);
 		}
 
 		//!
@@ -370,11 +375,14 @@ class CDirQuantCacheBase : public impl::CDirQuantCacheBase
 		template<E_FORMAT CacheFormat>
 		inline size_t getSerializedCacheSizeInBytes()
 		{
+			std::shared_lock lock(cacheMutex);
 			return getSerializedCacheSizeInBytes_impl<CacheFormat>(std::get<cache_type_t<CacheFormat>>(cache).capacity());
 		}
 
 	protected:
 		std::tuple<cache_type_t<Formats>...> cache;
+		// loaders and geometry creators quantize concurrently, lookups vastly outnumber insertions
+		mutable std::shared_mutex cacheMutex;
 		
 		template<uint32_t dimensions, E_FORMAT CacheFormat>
 		value_type_t<CacheFormat> quantize(const core::vectorSIMDf& value)
@@ -386,19 +394,27 @@ class CDirQuantCacheBase : public impl::CDirQuantCacheBase
 
 			constexpr auto quantizationBits = quantization_bits_v<CacheFormat>;
 			value_type_t<CacheFormat> quantized;
+			bool cached = false;
 			{
-				auto& particularCache = std::get<cache_type_t<CacheFormat>>(cache);
+				std::shared_lock lock(cacheMutex);
+				const auto& particularCache = std::get<cache_type_t<CacheFormat>>(cache);
 				auto found = particularCache.find(key);
 				if (found != particularCache.end() && (found->first == key))
-					quantized = found->second;
-				else
 				{
-					const core::vectorSIMDf fit = findBestFit<dimensions,quantizationBits>(absValue);
-
-					quantized = core::vectorSIMDu32(core::abs(fit));
-					insertIntoCache<CacheFormat>(key,quantized);
+					quantized = found->second;
+					cached = true;
 				}
 			}
+			// Different directions can map onto the same key, so the fit is found for the key's own direction. Whichever call inserts a key first,
+			// on whichever thread, the cached value is the same and so quantization doesn't depend on the order or concurrency of calls.
+			if (!cached)
+			{
+				const core::vectorSIMDf direction = key.getDirection();
+				const core::vectorSIMDf fit = findBestFit<dimensions,quantizationBits>(direction.preciseDivision(length(direction)));
+
+				quantized = core::vectorSIMDu32(core::abs(fit));
+				insertIntoCache<CacheFormat>(key,quantized);
+			}
 
 			const core::vectorSIMDu32 xorflag((0x1u<<(quantizationBits+1u))-1u);
 			auto restoredAsVec = quantized.getValue()^core::mix(core::vectorSIMDu32(0u),xorflag,negativeMask);
@@ -0,0 +1,104 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_ASSET_C_ENVIRONMENT_MAP_BAKER_H_INCLUDED_
+#define _NBL_ASSET_C_ENVIRONMENT_MAP_BAKER_H_INCLUDED_
+
+#include "nbl/asset/ICPUImage.h"
+
+namespace nbl::asset
+{
+
+//! Offline image based lighting preprocess, turns an environment map into a GGX prefiltered specular cubemap and irradiance spherical harmonics
+/*
+	Directions are Y-up, an equirectangular map has `u=atan2(z,x)/(2*PI)+0.5` and `v=acos(y)/PI` (row 0 is the zenith),
+	cube faces follow the Vulkan `+X,-X,+Y,-Y,+Z,-Z` layer order and orientation.
+
+	Mip `i` of the prefiltered cubemap holds the split-sum prefiltered radiance for perceptual roughness `i/(mipCount-1)` (GGX `alpha=roughness^2`, `N=V=R`),
+	estimated with the same Sobol (optionally Owen scrambled) GGX half vectors for every texel, combined through the balance heuristic with samples drawn
+	from the environment's luminance distribution so that small bright sources don't turn into fireflies. The luminance CDF comes from a `CSummedAreaTableImageFilter`.
+*/
+class CEnvironmentMapBaker
+{
+	public:
+		CEnvironmentMapBaker() = delete;
+		~CEnvironmentMapBaker() = delete;
+
+		struct SParams
+		{
+			//! mip 0 of either a 2D equirectangular image (layer 0 is used) or a cube compatible image with at least 6 layers
+			const ICPUImage* environment = nullptr;
+			//! resolution of the prefiltered cubemap's mip 0 faces, needs to be a power of two
+			uint32_t faceSize = 256u;
+			//! 0 means a full chain down to 1x1 faces
+			uint32_t mipCount = 0u;
+			//! GGX and environment samples per texel (each), powers of two keep the Sobol sequence well stratified
+			uint32_t sampleCount = 1024u;
+			//! non zero switches from plain `core::SobolSampler` to an `core::OwenSampler` seeded with it, the scrambling tables take a fraction of a second to build
+			uint32_t scrambleSeed = 0u;
+			//! any non-integer, non block compressed format, alpha is written as 1
+			E_FORMAT prefilteredFormat = EF_R16G16B16A16_SFLOAT;
+		};
+		struct SResult
+		{
+			//! null if the bake failed
+			core::smart_refctd_ptr<ICPUImage> prefiltered;
+			//! RGB irradiance `E(n)=sum_i irradianceSH[i]*Y_i(n)` (radiance already convolved with the clamped cosine), divide by PI for Lambertian exitant radiance
+			core::vectorSIMDf irradianceSH[9];
+		};
+		static SResult bake(const SParams& params);
+
+		//! Real spherical harmonics basis for bands 0 to 2, ordered by band then `m=-l...l`
+		static inline void evaluateSH9Basis(const core::vectorSIMDf& dir, float (&out)[9])
+		{
+			out[0] = 0.282095f;
+			out[1] = 0.488603f*dir.y;
+			out[2] = 0.488603f*dir.z;
+			out[3] = 0.488603f*dir.x;
+			out[4] = 1.092548f*dir.x*dir.y;
+			out[5] = 1.092548f*dir.y*dir.z;
+			out[6] = 0.315392f*(3.f*dir.z*dir.z-1.f);
+			out[7] = 1.092548f*dir.x*dir.z;
+			out[8] = 0.546274f*(dir.x*dir.x-dir.y*dir.y);
+		}
+		static inline core::vectorSIMDf evaluateSH9(const core::vectorSIMDf (&coefficients)[9], const core::vectorSIMDf& dir)
+		{
+			float basis[9];
+			evaluateSH9Basis(dir,basis);
+			core::vectorSIMDf retval(0.f);
+			for (auto i=0u; i<9u; i++)
+				retval += coefficients[i]*basis[i];
+			return retval;
+		}
+
+		//! `sc` and `tc` in `[-1,1]` across the face, not normalized
+		static inline core::vectorSIMDf getCubeFaceDirection(const uint32_t face, const float sc, const float tc)
+		{
+			switch (face)
+			{
+				case 0u:
+					return core::vectorSIMDf(1.f,-tc,-sc);
+				case 1u:
+					return core::vectorSIMDf(-1.f,-tc,sc);
+				case 2u:
+					return core::vectorSIMDf(sc,1.f,tc);
+				case 3u:
+					return core::vectorSIMDf(sc,-1.f,-tc);
+				case 4u:
+					return core::vectorSIMDf(sc,-tc,1.f);
+				default:
+					return core::vectorSIMDf(-sc,-tc,-1.f);
+			}
+		}
+		static inline core::vectorSIMDf getEquirectDirection(const float u, const float v)
+		{
+			const float phi = (u-0.5f)*2.f*core::PI<float>();
+			const float theta = v*core::PI<float>();
+			return core::vectorSIMDf(std::sin(theta)*std::cos(phi),std::cos(theta),std::sin(theta)*std::sin(phi));
+		}
+};
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef __NBL_ASSET_C_MESHLET_BUILDER_H_INCLUDED__
+#define __NBL_ASSET_C_MESHLET_BUILDER_H_INCLUDED__
+
+#include "nbl/asset/ICPUMeshBuffer.h"
+
+namespace nbl::asset
+{
+
+// Greedy clustering of a triangle list into meshlets with bounds for cluster culling,
+// the cone construction follows zeux's meshoptimizer (https://github.com/zeux/meshoptimizer) available under MIT license
+class CMeshletBuilder
+{
+	public:
+		_NBL_STATIC_INLINE_CONSTEXPR uint32_t MAX_VERTICES_LIMIT = 255u;
+
+		struct SParams
+		{
+			SParams() : maxVertices(64u), maxTriangles(124u) {}
+
+			//! must be <= MAX_VERTICES_LIMIT so the local indices fit in 8 bits
+			uint32_t maxVertices;
+			uint32_t maxTriangles;
+		};
+
+		struct SMeshlet
+		{
+			//! offset into `SMeshlets::vertices`
+			uint32_t vertexOffset;
+			//! offset into `SMeshlets::localIndices` divided by 3
+			uint32_t triangleOffset;
+			uint32_t vertexCount;
+			uint32_t triangleCount;
+		};
+
+		//! Culling data of a cluster, the whole cluster is backfacing when `dot(normalize(coneApex-cameraPos),coneAxis)>=coneCutoff`
+		struct SCullData
+		{
+			core::vectorSIMDf boundingSphere; // xyz center, w radius
+			core::vectorSIMDf coneApex;
+			core::vectorSIMDf coneAxis; // w is the cutoff, which is 1 when the cone is too wide to ever cull
+		};
+
+		struct SMeshlets
+		{
+			core::vector<SMeshlet> meshlets;
+			core::vector<SCullData> cullData;
+			//! vertex IDs of the source mesh buffer referenced by each meshlet
+			core::vector<uint32_t> vertices;
+			//! 3 indices per triangle, relative to `SMeshlet::vertexOffset`
+			core::vector<uint8_t> localIndices;
+		};
+
+		//! Upper bound on the number of meshlets `build` can produce for `_triangleCount` triangles
+		static inline uint32_t calcMeshletCountBound(const uint32_t _triangleCount, const SParams& _params = SParams())
+		{
+			// a meshlet only gets cut short when the next triangle would overflow the vertex limit
+			const uint32_t minTrianglesPerMeshlet = std::min(_params.maxVertices/3u,_params.maxTriangles);
+			return _triangleCount/minTrianglesPerMeshlet+1u;
+		}
+
+		//! Clusters a triangle list, `_indices` hold 3*`_triangleCount` vertex IDs of `_meshbuffer`
+		/** Seeds are picked in Morton order of triangle centroids, then the meshlet greedily grows by the adjacent
+		triangle which adds the fewest new vertices, preferring triangles whose vertices have the fewest unclustered triangles left.
+		*/
+		static SMeshlets build(const ICPUMeshBuffer* _meshbuffer, const uint32_t* _indices, const uint32_t _triangleCount, const SParams& _params = SParams());
+
+		//! Bounding sphere and normal cone of an arbitrary triangle list
+		static SCullData computeCullData(const ICPUMeshBuffer* _meshbuffer, const uint32_t* _indices, const uint32_t _triangleCount);
+
+	private:
+		// private, undefined constructor
+		CMeshletBuilder() = delete;
+};
+
+}
+
+#endif
@@ -26,6 +26,12 @@ struct VectorUV
 		v = absNormal.z * rcpManhattanNorm;
 	}
 
+	//! The direction every normal mapping onto this key shares, it gets quantized instead of the normal so that the cached value only depends on the key
+	inline core::vectorSIMDf getDirection() const
+	{
+		return core::vectorSIMDf(u, core::max(1.f - u - v, 0.f), v, 0.f);
+	}
+
 	inline bool operator==(const VectorUV& other) const
 	{
 		return (u == other.u && v == other.v);
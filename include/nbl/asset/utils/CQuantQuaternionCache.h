@@ -27,6 +27,12 @@ struct Projection
 		z = absDir.z * rcpManhattanNorm;
 	}
 
+	//! The direction every quaternion mapping onto this key shares, it gets quantized instead of the quaternion so that the cached value only depends on the key
+	inline core::vectorSIMDf getDirection() const
+	{
+		return core::vectorSIMDf(x, y, z, core::max(1.f - x - y - z, 0.f));
+	}
+
 	inline bool operator==(const Projection& other) const
 	{
 		return (x == other.x && y == other.y && z == other.z);
@@ -0,0 +1,34 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef __NBL_ASSET_C_TIPSIFY_VERTEX_CACHE_OPTIMIZER_H_INCLUDED__
+#define __NBL_ASSET_C_TIPSIFY_VERTEX_CACHE_OPTIMIZER_H_INCLUDED__
+
+#include "nbl/core/decl/Types.h"
+
+namespace nbl::asset
+{
+
+//! Linear time post-transform vertex cache optimization from Sander, Nehab and Barczak "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+/** Unlike `CForsythVertexCacheOptimizer` there is no per-triangle scoring, triangles get emitted by fanning around a vertex
+and the next fanning vertex is picked among the ones just emitted, so the cost is independent of the cache size.
+The output has long runs of cache hits separated by "hard boundaries" which is what `COverdrawMeshOptimizer` expects its input to look like.
+*/
+class CTipsifyVertexCacheOptimizer
+{
+	public:
+		_NBL_STATIC_INLINE_CONSTEXPR uint32_t DEFAULT_CACHE_SIZE = 16u;
+
+		//! `_indices` and `_outIndices` can point to the same memory, `_numIndices` should be a multiple of 3
+		template<typename IdxT> // IdxT is uint16_t or uint32_t
+		static void optimizeTriangleOrdering(const size_t _numVerts, const size_t _numIndices, const IdxT* _indices, IdxT* _outIndices, const uint32_t _cacheSize=DEFAULT_CACHE_SIZE);
+
+	private:
+		// private, undefined constructor
+		CTipsifyVertexCacheOptimizer() = delete;
+};
+
+}
+
+#endif
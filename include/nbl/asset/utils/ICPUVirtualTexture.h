@@ -5,6 +5,8 @@
 #ifndef __NBL_ASSET_I_CPU_VIRTUAL_TEXTURE_H_INCLUDED__
 #define __NBL_ASSET_I_CPU_VIRTUAL_TEXTURE_H_INCLUDED__
 
+#include <mutex>
+
 #include <nbl/asset/utils/IVirtualTexture.h>
 #include <nbl/asset/ICPUImageView.h>
 #include <nbl/asset/ICPUDescriptorSet.h>
@@ -66,6 +68,7 @@ public:
             {
                 auto regions = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<IImage::SBufferCopy>>(1ull);
                 auto& region = regions->front();
+                region.imageSubresource.aspectMask = IImage::EAF_COLOR_BIT;
                 region.imageSubresource.mipLevel = 0u;
                 region.imageSubresource.baseArrayLayer = 0u;
                 region.imageSubresource.layerCount = _layers;
@@ -79,6 +82,9 @@ public:
             }
         }
 
+        //! guards `tileAlctr`, so that textures can be committed from many threads
+        std::mutex tileAlctrMutex;
+
     private:
         core::smart_refctd_ptr<ICPUImageView> createView_internal(ICPUImageView::SCreationParams&& _params) const override
         {
@@ -86,6 +92,16 @@ public:
         }
     };
 
+    struct SCommitRequest
+    {
+        SMasterTextureData addr;
+        const ICPUImage* image;
+        IImage::SSubresourceRange subresource;
+        ISampler::E_TEXTURE_CLAMP uwrap;
+        ISampler::E_TEXTURE_CLAMP vwrap;
+        ISampler::E_TEXTURE_BORDER_COLOR borderColor;
+    };
+
     //! If there's a need, creates an image upscaled to half page size
     //! Otherwise returns `_img`
     //! Always call this before alloc()
@@ -275,166 +291,93 @@ public:
 
     }
 
-    // TODO: thread safe commits?
+    //! Thread-safe, as long as no two threads allocate from a VT whose storages are not initialized yet
+    SMasterTextureData alloc(E_FORMAT _primaryFormat, const VkExtent3D& _mip0extent, const IImage::SSubresourceRange& _subres, ISampler::E_TEXTURE_CLAMP _wrapu, ISampler::E_TEXTURE_CLAMP _wrapv) override
+    {
+        std::lock_guard<std::mutex> lock(m_virtualSpaceMutex);
+        return base_t::alloc(_primaryFormat, _mip0extent, _subres, _wrapu, _wrapv);
+    }
+
+    //! Thread-safe, physical pages get allocated under a per-storage lock and the copies run without holding any
     bool commit(const SMasterTextureData& _addr, const ICPUImage* _img, const IImage::SSubresourceRange& _subres, ISampler::E_TEXTURE_CLAMP _uwrap, ISampler::E_TEXTURE_CLAMP _vwrap, ISampler::E_TEXTURE_BORDER_COLOR _borderColor) override 
     {
-        if (!validateCommit(_addr, _subres, _uwrap, _vwrap))
+        SCommitPlan plan;
+        if (!planCommit({_addr,_img,_subres,_uwrap,_vwrap,_borderColor}, plan))
             return false;
 
-        const page_tab_offset_t pgtOffset(_addr.pgTab_x, _addr.pgTab_y, _addr.pgTab_layer);
-
-        ICPUVTResidentStorage* storage = nullptr;
+        // pages of a single commit don't overlap
+        std::atomic_bool success = true;
+        core::for_each(core::execution::par_unseq, plan.pageCopies.begin(), plan.pageCopies.end(), [&success](CPaddedCopyImageFilter::state_type& copy) -> void
         {
-            uint32_t layer = pgtOffset.z;
-            E_FORMAT format = getFormatInLayer(pgtOffset.z);
-            E_FORMAT_CLASS fc = getFormatClass(format);
-            auto found = m_storage.find(fc);
-            if (found==m_storage.end())
-                return false;
-            storage = static_cast<ICPUVTResidentStorage*>(found->second.get());
-        }
-
-        const VkExtent3D extent = {static_cast<uint32_t>(_addr.origsize_x), static_cast<uint32_t>(_addr.origsize_y), 1u};
-
-        const uint32_t levelsTakingAtLeastOnePageCount = countLevelsTakingAtLeastOnePage(extent);
-        const uint32_t levelsToPack = std::min<uint32_t>(_subres.levelCount, m_pageTable->getCreationParameters().mipLevels+m_pgSzxy_log2);
-
-        uint32_t miptailPgAddr = SPhysPgOffset::invalid_addr;
-
-        using phys_pg_addr_alctr_t = ICPUVTResidentStorage::phys_pg_addr_alctr_t;
+            if (!CPaddedCopyImageFilter::execute(core::execution::seq,&copy))
+                success = false;
+        });
+        for (auto& copy : plan.miptailCopies)
+            if (!CPaddedCopyImageFilter::execute(core::execution::par_unseq,&copy))
+                success = false;
+        assert(success);
+        return success;
+    }
 
-        if (levelsTakingAtLeastOnePageCount < _subres.levelCount)
+    //! Allocates physical pages for all the requests first (in order), then does all the copies in parallel
+    //! @returns number of requests which failed validation, their `_outSuccess` entry is false (if `_outSuccess` is not null)
+    uint32_t commitMany(const SCommitRequest* _begin, const SCommitRequest* _end, bool* _outSuccess=nullptr)
+    {
+        const size_t count = std::distance(_begin, _end);
+        core::vector<SCommitPlan> plans(count);
+        uint32_t failed = 0u;
+        for (size_t i=0u; i<count; ++i)
         {
-            uint32_t miptailPgAddr_tmp = phys_pg_addr_alctr_t::invalid_address;
-            const uint32_t szAndAlignment = 1u;
-            core::address_allocator_traits<phys_pg_addr_alctr_t>::multi_alloc_addr(storage->tileAlctr, 1u, &miptailPgAddr_tmp, &szAndAlignment, &szAndAlignment, nullptr);
-            miptailPgAddr_tmp = (miptailPgAddr_tmp == phys_pg_addr_alctr_t::invalid_address) ? SPhysPgOffset::invalid_addr : storage->encodePageAddress(miptailPgAddr_tmp);
-
-            miptailPgAddr = miptailPgAddr_tmp;
+            const bool planned = planCommit(_begin[i], plans[i]);
+            if (_outSuccess)
+                _outSuccess[i] = planned;
+            if (!planned)
+                failed++;
         }
 
-        const bool wholeTexGoesToMiptailPage = (levelsTakingAtLeastOnePageCount == 0u);
-
-        //TODO up to this line, it's kinda common code for CPU and GPU, refactor later
-
-        // TODO: parallelize over all 3 for loops
-        for (uint32_t i = 0u; i < levelsToPack; ++i)
+        // every page copy is a job of its own, miptail copies of a single texture write into one page so they go together
+        struct SJob
         {
-            const uint32_t w = neededPageCountForSide(extent.width, i);
-            const uint32_t h = neededPageCountForSide(extent.height, i);
-
-            for (uint32_t y = 0u; y < h; ++y)
-                for (uint32_t x = 0u; x < w; ++x)
-                {
-                    uint32_t physPgAddr = phys_pg_addr_alctr_t::invalid_address;
-                    if (i>=levelsTakingAtLeastOnePageCount) // this `if` always executes in case of whole texture going into miptail page
-                        physPgAddr = miptailPgAddr;
-                    else
-                    {
-                        const uint32_t szAndAlignment = 1u;
-                        core::address_allocator_traits<phys_pg_addr_alctr_t>::multi_alloc_addr(storage->tileAlctr, 1u, &physPgAddr, &szAndAlignment, &szAndAlignment, nullptr);
-                        if (physPgAddr == phys_pg_addr_alctr_t::invalid_address)
-                            physPgAddr = SPhysPgOffset::invalid_addr;
-                        else
-                            physPgAddr = storage->encodePageAddress(physPgAddr);
-                    }
-
-                    if (i==(levelsTakingAtLeastOnePageCount-1u) && levelsTakingAtLeastOnePageCount<_subres.levelCount)
-                    {
-                        assert(w==1u && h==1u);
-     
-                        physPgAddr |= (miptailPgAddr<<SPhysPgOffset::PAGE_ADDR_BITLENGTH);
-                    }
-                    else  // this `else` always executes in case of whole texture going into miptail page
-                        physPgAddr |= (SPhysPgOffset::invalid_addr<<SPhysPgOffset::PAGE_ADDR_BITLENGTH);
-
-                    if (i < levelsTakingAtLeastOnePageCount)
-                    {
-                        // physical double-address to write into page table
-                        const uint32_t physAddrToWrite = physPgAddr;
-
-                        const auto texelPos = core::vectorSIMDu32(pgtOffset.x>>i, pgtOffset.y>>i, 0u, pgtOffset.z) + core::vectorSIMDu32(x, y, 0u, 0u);
-                        const auto* region = m_pageTable->getRegion(i, texelPos);
-                        const uint64_t byteoffset = region->getByteOffset(texelPos, region->getByteStrides(m_pageTable->getTexelBlockInfo()));
-                        uint8_t* bufptr = reinterpret_cast<uint8_t*>(m_pageTable->getBuffer()->getPointer()) + byteoffset;
-                        reinterpret_cast<uint32_t*>(bufptr)[0] = physAddrToWrite;
-                    }
-
-                    if (!SPhysPgOffset(physPgAddr).valid())
-                        continue;
-
-                    core::vector3du32_SIMD physPg = ICPUVTResidentStorage::pageCoords(physPgAddr, m_pgSzxy, m_tilePadding);
-                    physPg -= core::vector2du32_SIMD(m_tilePadding, m_tilePadding);
-
-                    const core::vector2du32_SIMD miptailOffset = (i>=levelsTakingAtLeastOnePageCount) ? core::vector2du32_SIMD(m_miptailOffsets[i-levelsTakingAtLeastOnePageCount].x,m_miptailOffsets[i-levelsTakingAtLeastOnePageCount].y) : core::vector2du32_SIMD(0u,0u);
-                    physPg += miptailOffset;
-
-                    CPaddedCopyImageFilter::state_type copy;
-                    copy.outOffsetBaseLayer = (physPg).xyzz();/*physPg.z is layer*/ copy.outOffset.z = 0u;
-                    copy.inOffsetBaseLayer = core::vector2du32_SIMD(x,y)*m_pgSzxy;
-                    copy.extentLayerCount = core::vectorSIMDu32(m_pgSzxy, m_pgSzxy, 1u, 1u);
-                    copy.relativeOffset = {0u,0u,0u};
-                    if (x == w-1u)
-                        copy.extentLayerCount.x = std::max<uint32_t>(extent.width>>i,1u)-copy.inOffsetBaseLayer.x;
-                    if (y == h-1u)
-                        copy.extentLayerCount.y = std::max<uint32_t>(extent.height>>i,1u)-copy.inOffsetBaseLayer.y;
-                    memcpy(&copy.paddedExtent.width,(copy.extentLayerCount+core::vectorSIMDu32(2u*m_tilePadding)).pointer, 2u*sizeof(uint32_t));
-                    copy.paddedExtent.depth = 1u;
-                    if (w>1u)
-                        copy.extentLayerCount.x += m_tilePadding;
-                    if (x>0u && x<w-1u)
-                        copy.extentLayerCount.x += m_tilePadding;
-                    if (h>1u)
-                        copy.extentLayerCount.y += m_tilePadding;
-                    if (y>0u && y<h-1u)
-                        copy.extentLayerCount.y += m_tilePadding;
-                    if (x == 0u)
-                        copy.relativeOffset.x = m_tilePadding;
-                    else
-                        copy.inOffsetBaseLayer.x -= m_tilePadding;
-                    if (y == 0u)
-                        copy.relativeOffset.y = m_tilePadding;
-                    else
-                        copy.inOffsetBaseLayer.y -= m_tilePadding;
-                    copy.inOffsetBaseLayer.w = _subres.baseArrayLayer;
-                    copy.inMipLevel = _subres.baseMipLevel + i;
-                    copy.outMipLevel = 0u;
-                    copy.inImage = _img;
-                    copy.outImage = storage->image.get();
-                    copy.axisWraps[0] = _uwrap;
-                    copy.axisWraps[1] = _vwrap;
-                    copy.axisWraps[2] = ISampler::ETC_CLAMP_TO_EDGE;
-                    copy.borderColor = _borderColor;
-                    if (!CPaddedCopyImageFilter::execute(core::execution::par_unseq,&copy))
-                        assert(false);
-                }
-        }
-
-        if (wholeTexGoesToMiptailPage)
+            CPaddedCopyImageFilter::state_type* pageCopy;
+            core::deque<CPaddedCopyImageFilter::state_type>* miptailCopies;
+        };
+        core::vector<SJob> jobs;
+        for (auto& plan : plans)
         {
-            // physical double-address to write into page table
-            uint32_t physAddrToWrite = SPhysPgOffset::invalid_addr | (miptailPgAddr << SPhysPgOffset::PAGE_ADDR_BITLENGTH);
-
-            const auto texelPos = core::vectorSIMDu32(pgtOffset.x, pgtOffset.y, 0u, pgtOffset.z);
-            const auto* region = m_pageTable->getRegion(0u, texelPos);
-            const uint64_t byteoffset = region->getByteOffset(texelPos, region->getByteStrides(m_pageTable->getTexelBlockInfo()));
-            uint8_t* bufptr = reinterpret_cast<uint8_t*>(m_pageTable->getBuffer()->getPointer()) + byteoffset;
-            reinterpret_cast<uint32_t*>(bufptr)[0] = physAddrToWrite;
+            for (auto& copy : plan.pageCopies)
+                jobs.push_back({&copy,nullptr});
+            if (!plan.miptailCopies.empty())
+                jobs.push_back({nullptr,&plan.miptailCopies});
         }
+        core::for_each(core::execution::par, jobs.begin(), jobs.end(), [](const SJob& job) -> void
+        {
+            if (job.pageCopy)
+            {
+                const bool copied = CPaddedCopyImageFilter::execute(core::execution::seq,job.pageCopy);
+                assert(copied);
+            }
+            else for (auto& copy : *job.miptailCopies)
+            {
+                const bool copied = CPaddedCopyImageFilter::execute(core::execution::seq,&copy);
+                assert(copied);
+            }
+        });
 
-        return true;
+        return failed;
     }
 
+    //! Thread-safe, but `_addr` must not be getting committed or freed at the same time since its page table texels get copied
     SViewAliasTextureData createAlias(const SMasterTextureData& _addr, E_FORMAT _viewingFormat, const IImage::SSubresourceRange& _subresRelativeToMaster) override
     {
+        std::lock_guard<std::mutex> lock(m_virtualSpaceMutex);
+
         if (!validateAliasCreation(_addr, _viewingFormat, _subresRelativeToMaster))
             return SViewAliasTextureData::invalid();
 
-        const VkExtent3D extent = {
-            static_cast<uint32_t>(_addr.origsize_x>>_subresRelativeToMaster.baseArrayLayer),
-            static_cast<uint32_t>(_addr.origsize_y>>_subresRelativeToMaster.baseArrayLayer),
-            1u};
-        SMasterTextureData aliasAddr = alloc(_viewingFormat, VkExtent3D{static_cast<uint32_t>(_addr.origsize_x), static_cast<uint32_t>(_addr.origsize_y), 1u}, _subresRelativeToMaster, ISampler::ETC_CLAMP_TO_BORDER, ISampler::ETC_CLAMP_TO_BORDER);
+        // `_subresRelativeToMaster` counts page table levels (like `maxMip`), while `alloc` takes the levels of the whole texture
+        IImage::SSubresourceRange aliasSubres = _subresRelativeToMaster;
+        aliasSubres.levelCount += m_pgSzxy_log2;
+        SMasterTextureData aliasAddr = base_t::alloc(_viewingFormat, VkExtent3D{static_cast<uint32_t>(_addr.origsize_x), static_cast<uint32_t>(_addr.origsize_y), 1u}, aliasSubres, ISampler::ETC_CLAMP_TO_BORDER, ISampler::ETC_CLAMP_TO_BORDER);
         if (SMasterTextureData::is_invalid(aliasAddr))
             return SViewAliasTextureData::invalid();
         aliasAddr.wrap_x = _addr.wrap_x;
@@ -450,7 +393,8 @@ public:
         {
             copy.inMipLevel = _subresRelativeToMaster.baseMipLevel+i;
             copy.outMipLevel = i;
-            copy.extent = {std::max<uint32_t>(extent.width>>i,1u), std::max<uint32_t>(extent.height>>i,1u), 1u};
+            // page table texels, not texture texels
+            copy.extent = {neededPageCountForSide(_addr.origsize_x,copy.inMipLevel), neededPageCountForSide(_addr.origsize_y,copy.inMipLevel), 1u};
             copy.inOffset = {static_cast<uint32_t>(_addr.pgTab_x>>(copy.inMipLevel)),static_cast<uint32_t>(_addr.pgTab_y>>(copy.inMipLevel)),0u};
             copy.outOffset = {static_cast<uint32_t>(aliasAddr.pgTab_x>>i), static_cast<uint32_t>(aliasAddr.pgTab_y>>i), 0u};
 
@@ -463,6 +407,8 @@ public:
 
     bool free(const SMasterTextureData& _addr) override
     {
+        std::lock_guard<std::mutex> lock(m_virtualSpaceMutex);
+
         const E_FORMAT format = getFormatInLayer(_addr.pgTab_layer);
         ICPUVTResidentStorage* storage = static_cast<ICPUVTResidentStorage*>(getStorageForFormatClass(getFormatClass(format)));
         if (!storage)
@@ -482,8 +428,8 @@ public:
 
         using phys_pg_addr_alctr_t = ICPUVTResidentStorage::phys_pg_addr_alctr_t;
 
-        uint32_t addrsOffset = 0u;
-        std::fill(m_addrsArray->begin(), m_addrsArray->end(), IVTResidentStorage::phys_pg_addr_alctr_t::invalid_address);
+        // not using the preallocated `m_addrsArray` because frees can happen concurrently with commits
+        core::vector<uint32_t> addrs;
 
         auto* const bufptr = reinterpret_cast<uint8_t*>(m_pageTable->getBuffer()->getPointer());
         auto levelCount = core::max(_addr.maxMip,1u);
@@ -501,15 +447,14 @@ public:
                     uint32_t* texelptr = reinterpret_cast<uint32_t*>(bufptr + region.getByteOffset(core::vector4du32_SIMD((_addr.pgTab_x>>i) + x, (_addr.pgTab_y>>i) + y, 0u, _addr.pgTab_layer), strides));
                     SPhysPgOffset physPgOffset = *texelptr;
 
-                    (*m_addrsArray)[addrsOffset + y*w + x] = physPgOffset.addr&SPhysPgOffset::PAGE_ADDR_MASK;
+                    addrs.push_back(physPgOffset.addr&SPhysPgOffset::PAGE_ADDR_MASK);
                     if (physPgOffset.hasMipTailAddr())
                     {
                         assert(i==levelCount-1u && w==1u && h==1u);
-                        (*m_addrsArray)[addrsOffset + y*w + x + 1u] = physPgOffset.mipTailAddr().addr;
+                        addrs.push_back(physPgOffset.mipTailAddr().addr);
                     }
                 }
 
-            addrsOffset += w*h;
 #ifdef _NBL_DEBUG
             fill.subresource.mipLevel = i;
             fill.outRange.offset = {static_cast<uint32_t>(_addr.pgTab_x>>i),static_cast<uint32_t>(_addr.pgTab_y>>i),0u};
@@ -518,7 +463,11 @@ public:
 #endif
         }
 
-        core::address_allocator_traits<phys_pg_addr_alctr_t>::multi_free_addr(storage->tileAlctr, m_addrsArray->size(), m_addrsArray->data(), m_addrsArray->data());
+        {
+            const core::vector<uint32_t> sizes(addrs.size(), 1u);
+            std::lock_guard<std::mutex> tileLock(storage->tileAlctrMutex);
+            core::address_allocator_traits<phys_pg_addr_alctr_t>::multi_free_addr(storage->tileAlctr, addrs.size(), addrs.data(), sizes.data());
+        }
 
         //free entries in page table
         if (!base_t::free(_addr))
@@ -572,6 +521,165 @@ public:
     }
 
 protected:
+    struct SCommitPlan
+    {
+        // filter states are not copyable, hence deques
+        // every one of these writes into a physical page of its own
+        core::deque<CPaddedCopyImageFilter::state_type> pageCopies;
+        // these all write into the same miptail page
+        core::deque<CPaddedCopyImageFilter::state_type> miptailCopies;
+    };
+    //! Allocates the physical pages and fills the page table, the texel copies are left for the caller
+    bool planCommit(const SCommitRequest& _request, SCommitPlan& _outPlan)
+    {
+        const auto& _addr = _request.addr;
+        const auto& _subres = _request.subresource;
+        const page_tab_offset_t pgtOffset(_addr.pgTab_x, _addr.pgTab_y, _addr.pgTab_layer);
+
+        ICPUVTResidentStorage* storage = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_virtualSpaceMutex);
+            if (!validateCommit(_addr, _subres, _request.uwrap, _request.vwrap))
+                return false;
+            E_FORMAT format = getFormatInLayer(pgtOffset.z);
+            E_FORMAT_CLASS fc = getFormatClass(format);
+            auto found = m_storage.find(fc);
+            if (found==m_storage.end())
+                return false;
+            storage = static_cast<ICPUVTResidentStorage*>(found->second.get());
+        }
+
+        const VkExtent3D extent = {static_cast<uint32_t>(_addr.origsize_x), static_cast<uint32_t>(_addr.origsize_y), 1u};
+
+        const uint32_t levelsTakingAtLeastOnePageCount = countLevelsTakingAtLeastOnePage(extent);
+        const uint32_t levelsToPack = std::min<uint32_t>(_subres.levelCount, m_pageTable->getCreationParameters().mipLevels+m_pgSzxy_log2);
+        const bool needsMiptailPage = levelsTakingAtLeastOnePageCount < _subres.levelCount;
+
+        using phys_pg_addr_alctr_t = ICPUVTResidentStorage::phys_pg_addr_alctr_t;
+
+        // grab all the physical pages in one go, to keep the lock short
+        core::vector<uint32_t> physPgAddrs;
+        {
+            uint32_t pageCount = needsMiptailPage ? 1u:0u;
+            for (uint32_t i = 0u; i < std::min(levelsToPack,levelsTakingAtLeastOnePageCount); ++i)
+                pageCount += neededPageCountForSide(extent.width, i)*neededPageCountForSide(extent.height, i);
+            physPgAddrs.resize(pageCount, phys_pg_addr_alctr_t::invalid_address);
+            const core::vector<uint32_t> szAndAlignment(pageCount, 1u);
+
+            std::lock_guard<std::mutex> lock(storage->tileAlctrMutex);
+            core::address_allocator_traits<phys_pg_addr_alctr_t>::multi_alloc_addr(storage->tileAlctr, pageCount, physPgAddrs.data(), szAndAlignment.data(), szAndAlignment.data(), nullptr);
+        }
+        auto nextPhysPgAddr = physPgAddrs.begin();
+        auto encodeAllocated = [storage](uint32_t addr) -> uint32_t
+        {
+            return (addr == phys_pg_addr_alctr_t::invalid_address) ? SPhysPgOffset::invalid_addr : storage->encodePageAddress(addr);
+        };
+
+        uint32_t miptailPgAddr = SPhysPgOffset::invalid_addr;
+        if (needsMiptailPage)
+            miptailPgAddr = encodeAllocated(*(nextPhysPgAddr++));
+
+        const bool wholeTexGoesToMiptailPage = (levelsTakingAtLeastOnePageCount == 0u);
+
+        for (uint32_t i = 0u; i < levelsToPack; ++i)
+        {
+            const uint32_t w = neededPageCountForSide(extent.width, i);
+            const uint32_t h = neededPageCountForSide(extent.height, i);
+
+            for (uint32_t y = 0u; y < h; ++y)
+                for (uint32_t x = 0u; x < w; ++x)
+                {
+                    uint32_t physPgAddr = phys_pg_addr_alctr_t::invalid_address;
+                    if (i>=levelsTakingAtLeastOnePageCount) // this `if` always executes in case of whole texture going into miptail page
+                        physPgAddr = miptailPgAddr;
+                    else
+                        physPgAddr = encodeAllocated(*(nextPhysPgAddr++));
+
+                    if (i==(levelsTakingAtLeastOnePageCount-1u) && needsMiptailPage)
+                    {
+                        assert(w==1u && h==1u);
+     
+                        physPgAddr |= (miptailPgAddr<<SPhysPgOffset::PAGE_ADDR_BITLENGTH);
+                    }
+                    else  // this `else` always executes in case of whole texture going into miptail page
+                        physPgAddr |= (SPhysPgOffset::invalid_addr<<SPhysPgOffset::PAGE_ADDR_BITLENGTH);
+
+                    // page table texels of different allocations never overlap, so no lock needed
+                    if (i < levelsTakingAtLeastOnePageCount)
+                    {
+                        // physical double-address to write into page table
+                        const uint32_t physAddrToWrite = physPgAddr;
+
+                        const auto texelPos = core::vectorSIMDu32(pgtOffset.x>>i, pgtOffset.y>>i, 0u, pgtOffset.z) + core::vectorSIMDu32(x, y, 0u, 0u);
+                        const auto* region = m_pageTable->getRegion(i, texelPos);
+                        const uint64_t byteoffset = region->getByteOffset(texelPos, region->getByteStrides(m_pageTable->getTexelBlockInfo()));
+                        uint8_t* bufptr = reinterpret_cast<uint8_t*>(m_pageTable->getBuffer()->getPointer()) + byteoffset;
+                        reinterpret_cast<uint32_t*>(bufptr)[0] = physAddrToWrite;
+                    }
+
+                    if (!SPhysPgOffset(physPgAddr).valid())
+                        continue;
+
+                    core::vector3du32_SIMD physPg = ICPUVTResidentStorage::pageCoords(physPgAddr, m_pgSzxy, m_tilePadding);
+                    physPg -= core::vector2du32_SIMD(m_tilePadding, m_tilePadding);
+
+                    const core::vector2du32_SIMD miptailOffset = (i>=levelsTakingAtLeastOnePageCount) ? core::vector2du32_SIMD(m_miptailOffsets[i-levelsTakingAtLeastOnePageCount].x,m_miptailOffsets[i-levelsTakingAtLeastOnePageCount].y) : core::vector2du32_SIMD(0u,0u);
+                    physPg += miptailOffset;
+
+                    auto& copy = (i>=levelsTakingAtLeastOnePageCount ? _outPlan.miptailCopies:_outPlan.pageCopies).emplace_back();
+                    copy.outOffsetBaseLayer = (physPg).xyzz();/*physPg.z is layer*/ copy.outOffset.z = 0u;
+                    copy.inOffsetBaseLayer = core::vector2du32_SIMD(x,y)*m_pgSzxy;
+                    copy.extentLayerCount = core::vectorSIMDu32(m_pgSzxy, m_pgSzxy, 1u, 1u);
+                    copy.relativeOffset = {0u,0u,0u};
+                    if (x == w-1u)
+                        copy.extentLayerCount.x = std::max<uint32_t>(extent.width>>i,1u)-copy.inOffsetBaseLayer.x;
+                    if (y == h-1u)
+                        copy.extentLayerCount.y = std::max<uint32_t>(extent.height>>i,1u)-copy.inOffsetBaseLayer.y;
+                    memcpy(&copy.paddedExtent.width,(copy.extentLayerCount+core::vectorSIMDu32(2u*m_tilePadding)).pointer, 2u*sizeof(uint32_t));
+                    copy.paddedExtent.depth = 1u;
+                    if (w>1u)
+                        copy.extentLayerCount.x += m_tilePadding;
+                    if (x>0u && x<w-1u)
+                        copy.extentLayerCount.x += m_tilePadding;
+                    if (h>1u)
+                        copy.extentLayerCount.y += m_tilePadding;
+                    if (y>0u && y<h-1u)
+                        copy.extentLayerCount.y += m_tilePadding;
+                    if (x == 0u)
+                        copy.relativeOffset.x = m_tilePadding;
+                    else
+                        copy.inOffsetBaseLayer.x -= m_tilePadding;
+                    if (y == 0u)
+                        copy.relativeOffset.y = m_tilePadding;
+                    else
+                        copy.inOffsetBaseLayer.y -= m_tilePadding;
+                    copy.inOffsetBaseLayer.w = _subres.baseArrayLayer;
+                    copy.inMipLevel = _subres.baseMipLevel + i;
+                    copy.outMipLevel = 0u;
+                    copy.inImage = _request.image;
+                    copy.outImage = storage->image.get();
+                    copy.axisWraps[0] = _request.uwrap;
+                    copy.axisWraps[1] = _request.vwrap;
+                    copy.axisWraps[2] = ISampler::ETC_CLAMP_TO_EDGE;
+                    copy.borderColor = _request.borderColor;
+                }
+        }
+
+        if (wholeTexGoesToMiptailPage)
+        {
+            // physical double-address to write into page table
+            uint32_t physAddrToWrite = SPhysPgOffset::invalid_addr | (miptailPgAddr << SPhysPgOffset::PAGE_ADDR_BITLENGTH);
+
+            const auto texelPos = core::vectorSIMDu32(pgtOffset.x, pgtOffset.y, 0u, pgtOffset.z);
+            const auto* region = m_pageTable->getRegion(0u, texelPos);
+            const uint64_t byteoffset = region->getByteOffset(texelPos, region->getByteStrides(m_pageTable->getTexelBlockInfo()));
+            uint8_t* bufptr = reinterpret_cast<uint8_t*>(m_pageTable->getBuffer()->getPointer()) + byteoffset;
+            reinterpret_cast<uint32_t*>(bufptr)[0] = physAddrToWrite;
+        }
+
+        return true;
+    }
+
     core::smart_refctd_ptr<ICPUImageView> createPageTableView() const override
     {
         return ICPUImageView::create(createPageTableViewCreationParams());
@@ -592,6 +700,9 @@ protected:
     {
         return core::make_smart_refctd_ptr<ICPUSampler>(_params);
     }
+
+    //! guards the page table allocators, the layer bookkeeping and `m_storage`
+    std::mutex m_virtualSpaceMutex;
 };
 
 }}
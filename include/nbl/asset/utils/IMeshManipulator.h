@@ -486,10 +486,21 @@ class NBL_API2 IMeshManipulator : public virtual core::IReferenceCounted
 		\return Mesh without redundant vertices. */
 		static core::smart_refctd_ptr<ICPUMeshBuffer> createMeshBufferWelded(ICPUMeshBuffer *inbuffer, const SErrorMetric* errMetrics, const bool& optimIndexType = true, const bool& makeNewMesh = false);
 
-		//! Throws meshbuffer into full optimizing pipeline consisting of: vertices welding, z-buffer optimization, vertex cache optimization (Forsyth's algorithm), fetch optimization and attributes requantization. A new meshbuffer is created unless given meshbuffer doesn't own (getMeshDataAndFormat()==NULL) a data format descriptor.
+		//! Throws meshbuffer into full optimizing pipeline consisting of: vertices welding, `optimizeForGPU` and attributes requantization. A new meshbuffer is created unless given meshbuffer doesn't own (getMeshDataAndFormat()==NULL) a data format descriptor.
 		/**@return A new meshbuffer or NULL if an error occured. */
 		static core::smart_refctd_ptr<ICPUMeshBuffer> createOptimizedMeshBuffer(const ICPUMeshBuffer* inbuffer, const SErrorMetric* _errMetric);
 
+		//! Reorders triangles for the post-transform vertex cache (Tipsify), then reorders the resulting clusters to reduce overdraw and finally reorders the vertices by first use.
+		/** Everything happens in place, the vertex and index buffers of `_meshbuffer` get modified so they must not be shared with meshbuffers that should stay as they are.
+		@param _overdrawThreshold How much the overdraw optimization can degrade vertex cache efficiency (1.05 = up to 5%).
+		@returns false and leaves the meshbuffer unchanged if it's not an indexed triangle list. */
+		static bool optimizeForGPU(ICPUMeshBuffer* _meshbuffer, const float _overdrawThreshold=1.05f);
+
+		//! Reorders the vertices in their buffers in the order they're first referenced by the index buffer, unreferenced vertices are moved to the end.
+		/** In place counterpart of `CMeshManipulator::createMeshBufferFetchOptimized`, per vertex bindings which interleave in the same buffer get reordered together.
+		@returns false and leaves the meshbuffer unchanged if it has no index buffer or a vertex binding is too small to hold all the indexed vertices. */
+		static bool optimizeVertexFetch(ICPUMeshBuffer* _meshbuffer);
+
 		//! Requantizes vertex attributes to the smallest possible types taking into account values of the attribute under consideration. A brand new vertex buffer is created and attributes are going to be interleaved in single buffer.
 		/**
 			The function tests type's range and precision loss after eventual requantization. The latter is performed in one of several possible methods specified
@@ -499,6 +510,47 @@ class NBL_API2 IMeshManipulator : public virtual core::IReferenceCounted
 		*/
 		static void requantizeMeshBuffer(ICPUMeshBuffer* _meshbuffer, const SErrorMetric* _errMetric);
 
+		//! Parameters for `createSimplifiedMeshBuffer`, the simplification stops at whichever limit gets hit first
+		struct SSimplificationParams
+		{
+			SSimplificationParams() : targetTriangleRatio(0.5f), maxError(FLT_MAX), errMetrics(nullptr), lockBorders(true) {}
+
+			//! fraction of the input triangles to simplify down to
+			float targetTriangleRatio;
+			//! object space distance the surface is allowed to move by
+			float maxError;
+			//! Array of size MAX_VERTEX_ATTRIB_COUNT, vertices sharing a position get welded if all their attributes are equal according to these,
+			//! otherwise they form an attribute seam which doesn't get simplified. Nullptr means the attributes need to be bitwise equal.
+			const SErrorMetric* errMetrics;
+			//! whether vertices on the open borders of the mesh can only stay where they are, or can slide along the border
+			bool lockBorders;
+		};
+		//! Reduces the triangle count by collapsing edges in the order of the smallest quadric error metric cost (Garland-Heckbert).
+		/**
+		Vertices never move, they only get collapsed onto their neighbours, so the new meshbuffer keeps sharing the vertex buffers with the input
+		and only gets a new 32bit triangle list index buffer. Vertices on attribute seams and non-manifold edges never get collapsed.
+		@param _inbuffer Input meshbuffer of any triangle primitive type.
+		@param _params Simplification limits.
+		@param _outError If not null, receives the object space distance the simplified surface deviates from the input by (estimated from the quadrics).
+		@returns New meshbuffer, or nullptr if the input had no triangles or positions.
+		*/
+		static core::smart_refctd_ptr<ICPUMeshBuffer> createSimplifiedMeshBuffer(const ICPUMeshBuffer* _inbuffer, const SSimplificationParams& _params, float* _outError=nullptr);
+
+		//!
+		struct SLoDLevel
+		{
+			core::smart_refctd_ptr<ICPUMeshBuffer> meshbuffer;
+			//! object space error w.r.t. the input, use `scene::ILevelOfDetailLibrary::DefaultLoDChoiceParams::fromGeometricError` to get the switch distance
+			float error;
+		};
+		//! Builds a LoD chain, level 0 is a shallow copy of the input and every next level has `_levelRatio` of the triangles of the previous one.
+		/**
+		All levels get simplified from the input in parallel (so their errors don't compound), and share its vertex buffers.
+		The chain ends early once a level couldn't be simplified to much fewer triangles than the previous one (`_params.maxError` or seams got in the way).
+		`_params.targetTriangleRatio` is ignored.
+		*/
+		static core::vector<SLoDLevel> createLoDChain(const ICPUMeshBuffer* _inbuffer, const uint32_t _maxLevelCount, const float _levelRatio, const SSimplificationParams& _params);
+
         //! Creates a 32bit index buffer for a mesh with primitive types changed to list types
         /**#
 		@param _newPrimitiveType
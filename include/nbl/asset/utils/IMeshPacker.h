@@ -6,6 +6,7 @@
 #define __NBL_ASSET_I_MESH_PACKER_H_INCLUDED__
 
 #include "nbl/asset/utils/IMeshManipulator.h"
+#include "nbl/asset/utils/CMeshletBuilder.h"
 #include "nbl/core/math/morton.h"
 
 namespace nbl
@@ -41,6 +42,20 @@ class IMeshPackerBase : public virtual core::IReferenceCounted
             }
         };
 
+        //! Cluster produced by `CCPUMeshPackerV2::commitMeshlets`, its vertices are fetched through the `CombinedDataOffsetTable` of the same index
+        struct MeshletDescriptor
+        {
+            float boundingSphere[4];
+            float coneApex[3];
+            // byte offset of the first 8 bit local index in the packer's index buffer
+            uint32_t indexByteOffset;
+            // cluster is backfacing when `dot(normalize(coneApex-cameraPos),coneAxis)>=coneCutoff`
+            float coneAxis[3];
+            float coneCutoff;
+            uint32_t vertexCount;
+            uint32_t triangleCount;
+        };
+
         inline uint16_t getMinTriangleCountPerMDI() const { return m_minTriangleCountPerMDIData; }
         inline uint16_t getMaxTriangleCountPerMDI() const { return m_maxTriangleCountPerMDIData; }
 
@@ -207,6 +222,17 @@ public:
         return acc;
     }
 
+    //! Returns maximum number of meshlets (and `CombinedDataOffsetTable`s) needed to pack range of mesh buffers described by range mbBegin .. mbEnd as meshlets
+    template <typename MeshBufferIterator>
+    uint32_t calcMeshletMaxCount(const MeshBufferIterator mbBegin, const MeshBufferIterator mbEnd, const CMeshletBuilder::SParams& params = CMeshletBuilder::SParams())
+    {
+        uint32_t acc = 0u;
+        for (auto mbIt = mbBegin; mbIt != mbEnd; mbIt++)
+            acc += CMeshletBuilder::calcMeshletCountBound(calcIdxCntAfterConversionToTriangleList(*mbIt)/3u, params);
+
+        return acc;
+    }
+
 protected:
     virtual ~IMeshPacker() {}
 
@@ -427,6 +453,29 @@ protected:
         return triangleBatches;
     }
 
+    static core::vector<uint32_t> getTriangleListIndices(const MeshBufferType* meshBuffer, const IdxBufferParams& idxBufferParams)
+    {
+        uint32_t triCnt;
+        const bool success = IMeshManipulator::getPolyCount(triCnt,meshBuffer);
+        assert(success);
+
+        core::vector<uint32_t> indices(triCnt*3u);
+        const uint8_t* idxPtr = idxBufferParams.idxBuffer.buffer ? static_cast<const uint8_t*>(idxBufferParams.idxBuffer.buffer->getPointer())+idxBufferParams.idxBuffer.offset:nullptr;
+        switch (idxPtr ? idxBufferParams.idxType:EIT_UNKNOWN)
+        {
+            case EIT_16BIT:
+                std::copy_n(reinterpret_cast<const uint16_t*>(idxPtr),indices.size(),indices.begin());
+                break;
+            case EIT_32BIT:
+                std::copy_n(reinterpret_cast<const uint32_t*>(idxPtr),indices.size(),indices.begin());
+                break;
+            default:
+                std::iota(indices.begin(),indices.end(),0u);
+                break;
+        }
+        return indices;
+    }
+
     static core::unordered_map<uint32_t, uint16_t> constructNewIndicesFromTriangleBatchAndUpdateUnifiedIndexBuffer(TriangleBatches& batches, uint32_t batchIdx, uint16_t*& indexBuffPtr)
     {
         core::unordered_map<uint32_t, uint16_t> usedVertices;
@@ -293,7 +293,7 @@ public:
     
     //TODO: REDESIGN
     //mdi allocation offset and index allocation offset should be shared
-    struct ReservedAllocationMeshBuffers : ReservedAllocationMeshBuffersBase
+    struct ReservedAllocationMeshBuffers : IMeshPackerBase::ReservedAllocationMeshBuffersBase
     {
         AttribAllocParams attribAllocParams[SVertexInputParams::MAX_VERTEX_ATTRIB_COUNT];
     };
@@ -379,7 +379,7 @@ public:
             {
                 bnd->binding = binding;
                 bnd->count = count;
-                bnd->stageFlags = asset::ISpecializedShader::ESS_ALL;
+                bnd->stageFlags = asset::IShader::ESS_ALL;
                 bnd->type = asset::IDescriptor::E_TYPE::ET_UNIFORM_TEXEL_BUFFER;
                 bnd->samplers = nullptr;
                 bnd++;
@@ -394,8 +394,10 @@ public:
         return bindingCount;
     }
 
+    // only descriptor sets of the GPU have writes, so the template stays uninstantiated for the CPU
+    template <class DS_t = DescriptorSetType>
     inline std::pair<uint32_t,uint32_t> getDescriptorSetWritesForUTB(
-        typename DescriptorSetType::SWriteDescriptorSet* outWrites, typename DescriptorSetType::SDescriptorInfo* outInfo, DescriptorSetType* dstSet,
+        typename DS_t::SWriteDescriptorSet* outWrites, typename DS_t::SDescriptorInfo* outInfo, DS_t* dstSet,
         std::function<core::smart_refctd_ptr<IDescriptor>(core::smart_refctd_ptr<BufferType>&&,E_FORMAT)> createBufferView, const DSLayoutParamsUTB& params = {}
     ) const
     {
@@ -516,7 +518,7 @@ public:
             {
                 bnd->binding = binding;
                 bnd->count = 1u;
-                bnd->stageFlags = asset::ISpecializedShader::ESS_ALL;
+                bnd->stageFlags = asset::IShader::ESS_ALL;
                 bnd->type = asset::IDescriptor::E_TYPE::ET_STORAGE_BUFFER;
                 bnd->samplers = nullptr;
                 bnd++;
@@ -536,8 +538,10 @@ public:
     }
 
     // info count is always 2
+    // only descriptor sets of the GPU have writes, so the template stays uninstantiated for the CPU
+    template <class DS_t = DescriptorSetType>
     inline uint32_t getDescriptorSetWritesForSSBO(
-        typename DescriptorSetType::SWriteDescriptorSet* outWrites, typename DescriptorSetType::SDescriptorInfo* outInfo, DescriptorSetType* dstSet,
+        typename DS_t::SWriteDescriptorSet* outWrites, typename DS_t::SDescriptorInfo* outInfo, DS_t* dstSet,
         const DSLayoutParamsSSBO& params = {}
     ) const
     {
@@ -580,14 +584,22 @@ public:
     }
 
 	template <typename MeshBufferIterator>
-	bool alloc(ReservedAllocationMeshBuffers* rambOut, const MeshBufferIterator mbBegin, const MeshBufferIterator mbEnd);
+	bool alloc(ReservedAllocationMeshBuffers* rambOut, const MeshBufferIterator mbBegin, const MeshBufferIterator mbEnd)
+    {
+        return alloc_impl(rambOut, mbBegin, mbEnd, false);
+    }
+
+    //! Reserves space for `CCPUMeshPackerV2::commitMeshlets`, the 8 bit local indices take half as many 16 bit index allocator units as `alloc` reserves and no MDI structs get reserved (`mdiAllocationOffset` stays invalid)
+	template <typename MeshBufferIterator>
+	bool allocMeshlets(ReservedAllocationMeshBuffers* rambOut, const MeshBufferIterator mbBegin, const MeshBufferIterator mbEnd)
+    {
+        return alloc_impl(rambOut, mbBegin, mbEnd, true);
+    }
 
     void free(const ReservedAllocationMeshBuffers* rambIn, uint32_t meshBuffersToFreeCnt)
     {
         for (uint32_t i = 0u; i < meshBuffersToFreeCnt; i++)
         {
-            const ReservedAllocationMeshBuffers& ramb = rambIn[i];
-
             const ReservedAllocationMeshBuffers* const ramb = rambIn + i;
 
             if (ramb->indexAllocationOffset != base_t::INVALID_ADDRESS)
@@ -631,7 +643,10 @@ protected:
     };
 
     template <typename MeshBufferIterator>
-    void freeAllocatedAddressesOnAllocFail(ReservedAllocationMeshBuffers* rambOut, const MeshBufferIterator mbBegin, const MeshBufferIterator mbEnd)
+    bool alloc_impl(ReservedAllocationMeshBuffers* rambOut, const MeshBufferIterator mbBegin, const MeshBufferIterator mbEnd, const bool meshlets);
+
+    template <typename MeshBufferIterator>
+    void freeAllocatedAddressesOnAllocFail(ReservedAllocationMeshBuffers* rambOut, const MeshBufferIterator mbBegin, const MeshBufferIterator mbEnd, const bool meshlets)
     {
         size_t i = 0ull;
         for (auto it = mbBegin; it != mbEnd; it++)
@@ -655,10 +670,13 @@ protected:
                 base_t::m_vtxBuffAlctr.free_addr(ramb.attribAllocParams[location].offset, ramb.attribAllocParams[location].size);
             }
 
-            if (ramb.mdiAllocationOffset == base_t::INVALID_ADDRESS)
-                return;
+            if (!meshlets)
+            {
+                if (ramb.mdiAllocationOffset == base_t::INVALID_ADDRESS)
+                    return;
 
-            base_t::m_MDIDataAlctr.free_addr(ramb.mdiAllocationOffset, ramb.mdiAllocationReservedCnt);
+                base_t::m_MDIDataAlctr.free_addr(ramb.mdiAllocationOffset, ramb.mdiAllocationReservedCnt);
+            }
 
             i++;
         }
@@ -670,24 +688,26 @@ protected:
 
 template <class BufferType, class DescriptorSetType, class MeshBufferType, typename MDIStructType>
 template <typename MeshBufferIterator>
-bool IMeshPackerV2<BufferType,DescriptorSetType,MeshBufferType,MDIStructType>::alloc(ReservedAllocationMeshBuffers* rambOut, const MeshBufferIterator mbBegin, const MeshBufferIterator mbEnd)
+bool IMeshPackerV2<BufferType,DescriptorSetType,MeshBufferType,MDIStructType>::alloc_impl(ReservedAllocationMeshBuffers* rambOut, const MeshBufferIterator mbBegin, const MeshBufferIterator mbEnd, const bool meshlets)
 {
     size_t i = 0ull;
     for (auto it = mbBegin; it != mbEnd; it++)
     {
         ReservedAllocationMeshBuffers& ramb = *(rambOut + i);
         const size_t idxCnt = base_t::calcIdxCntAfterConversionToTriangleList(*it);
+        // also bounds the vertices of meshlets, every triangle adds at most 3 vertices to its meshlet
         const size_t maxVtxCnt = base_t::calcVertexCountBoundWithBatchDuplication(*it);
         const uint32_t insCnt = (*it)->getInstanceCount();
 
-        //allocate indices
-        ramb.indexAllocationOffset = base_t::m_idxBuffAlctr.alloc_addr(idxCnt, 1u);
+        //allocate indices, the index allocator counts 16 bit indices, meshlets pack two 8 bit local indices into each
+        const size_t idxAllocCnt = meshlets ? (idxCnt + 1u) / 2u : idxCnt;
+        ramb.indexAllocationOffset = base_t::m_idxBuffAlctr.alloc_addr(idxAllocCnt, 1u);
         if (ramb.indexAllocationOffset == base_t::INVALID_ADDRESS)
         {
-            freeAllocatedAddressesOnAllocFail(rambOut, mbBegin, mbEnd);
+            freeAllocatedAddressesOnAllocFail(rambOut, mbBegin, mbEnd, meshlets);
             return false;
         }
-        ramb.indexAllocationReservedCnt = idxCnt;
+        ramb.indexAllocationReservedCnt = idxAllocCnt;
 
         //allocate vertices
         const auto& mbVtxInputParams = (*it)->getPipeline()->getVertexInputParams();
@@ -713,7 +733,7 @@ bool IMeshPackerV2<BufferType,DescriptorSetType,MeshBufferType,MDIStructType>::a
 
                 if(ramb.attribAllocParams[location].offset == base_t::INVALID_ADDRESS)
                 {
-                    freeAllocatedAddressesOnAllocFail(rambOut, mbBegin, mbEnd);
+                    freeAllocatedAddressesOnAllocFail(rambOut, mbBegin, mbEnd, meshlets);
                     return false;
                 }
             }
@@ -725,7 +745,7 @@ bool IMeshPackerV2<BufferType,DescriptorSetType,MeshBufferType,MDIStructType>::a
 
                 if (ramb.attribAllocParams[location].offset == base_t::INVALID_ADDRESS)
                 {
-                    freeAllocatedAddressesOnAllocFail(rambOut, mbBegin, mbEnd);
+                    freeAllocatedAddressesOnAllocFail(rambOut, mbBegin, mbEnd, meshlets);
                     return false;
                 }
             }
@@ -735,13 +755,20 @@ bool IMeshPackerV2<BufferType,DescriptorSetType,MeshBufferType,MDIStructType>::a
         }
 
         //allocate MDI structs
+        if (meshlets)
+        {
+            ramb.mdiAllocationOffset = base_t::INVALID_ADDRESS;
+            ramb.mdiAllocationReservedCnt = 0u;
+            i++;
+            continue;
+        }
         const uint32_t minIdxCntPerPatch = base_t::m_minTriangleCountPerMDIData * 3;
         size_t possibleMDIStructsNeededCnt = (idxCnt + minIdxCntPerPatch - 1) / minIdxCntPerPatch;
 
         ramb.mdiAllocationOffset = base_t::m_MDIDataAlctr.alloc_addr(possibleMDIStructsNeededCnt, 1u);
         if (ramb.mdiAllocationOffset == base_t::INVALID_ADDRESS)
         {
-            freeAllocatedAddressesOnAllocFail(rambOut, mbBegin, mbEnd);
+            freeAllocatedAddressesOnAllocFail(rambOut, mbBegin, mbEnd, meshlets);
             return false;
         }
         ramb.mdiAllocationReservedCnt = possibleMDIStructsNeededCnt;
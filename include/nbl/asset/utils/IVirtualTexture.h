@@ -328,7 +328,7 @@ protected:
     }
     bool isAllocatable(const VkExtent3D& _extent)
     {
-        return (core::vector2du32_SIMD(&_extent.width)<=getMaxAllocatableTextureSize()).xyxy().all();
+        return (core::vector2du32_SIMD(_extent.width,_extent.height)<=getMaxAllocatableTextureSize()).xyxy().all();
     }
 
     uint32_t countLevelsTakingAtLeastOnePage(const VkExtent3D& _extent, uint32_t _baseLevel = 0u) const
@@ -380,7 +380,7 @@ protected:
                 region.imageSubresource.baseArrayLayer = 0u;
                 region.imageSubresource.layerCount = _pgTabLayers;
                 region.imageSubresource.mipLevel = i;
-                region.imageSubresource.aspectMask = static_cast<IImage::E_ASPECT_FLAGS>(0);
+                region.imageSubresource.aspectMask = IImage::EAF_COLOR_BIT;
 
                 bufOffset += regionSz;
             }
@@ -856,7 +856,7 @@ public:
         }
     }
 
-    SMasterTextureData alloc(E_FORMAT _primaryFormat, const VkExtent3D& _mip0extent, const IImage::SSubresourceRange& _subres, ISampler::E_TEXTURE_CLAMP _wrapu, ISampler::E_TEXTURE_CLAMP _wrapv)
+    virtual SMasterTextureData alloc(E_FORMAT _primaryFormat, const VkExtent3D& _mip0extent, const IImage::SSubresourceRange& _subres, ISampler::E_TEXTURE_CLAMP _wrapu, ISampler::E_TEXTURE_CLAMP _wrapv)
     {
         if (_subres.layerCount != 1u)
             return SMasterTextureData::invalid();
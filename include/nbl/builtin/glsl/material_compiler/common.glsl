@@ -8,6 +8,9 @@
 	#ifdef TEX_PREFETCH_STREAM
 		#error "as well as 'mat2x3 nbl_glsl_perturbNormal_dPdSomething()', and 'mat2 nbl_glsl_perturbNormal_dUVdSomething()'"
 	#endif
+	#ifdef SHARED_STREAMS
+		#error "as well as 'uint nbl_glsl_MC_fetchParamBlockEntry(in uint ix)'"
+	#endif
 #endif
 #define _NBL_BUILTIN_GLSL_BUMP_MAPPING_DERIVATIVES_DECLARED_
 
@@ -123,9 +126,17 @@ nbl_glsl_MC_RegID_t nbl_glsl_MC_instr_decodeRegisters(in nbl_glsl_MC_instr_t ins
 
 // if we allowed for variable size (or very padded) instructions, we wouldnt need to fetch bsdf data from offset
 // https://github.com/Devsh-Graphics-Programming/Nabla/issues/287
+#ifdef SHARED_STREAMS
+// `CMaterialCompilerGLSLBackendCommon::result_t::shared` layout, the instructions hold slots of the material's parameter block instead of BSDF data indices,
+// needs to be set to the `material_ref_t::paramBlockOffset` of the material before executing any of its streams
+uint nbl_glsl_MC_paramBlockOffset;
+#endif
 nbl_glsl_MC_bsdf_data_t nbl_glsl_MC_fetchBSDFDataForInstr(in nbl_glsl_MC_instr_t instr)
 {
 	uint ix = nbl_glsl_MC_instr_getBSDFbufOffset(instr);
+#ifdef SHARED_STREAMS
+	ix = nbl_glsl_MC_fetchParamBlockEntry(nbl_glsl_MC_paramBlockOffset+ix);
+#endif
 	return nbl_glsl_MC_fetchBSDFData(ix);
 }
 
@@ -8,9 +8,13 @@
 #include <algorithm>
 #include <bitset>
 #include <cstdint>
+#include <cstdlib>
 #include <numeric>
+#include <thread>
+#include <vector>
 
 #include "nbl/macros.h"
+#include "nbl/core/execution.h"
 
 namespace nbl
 {
@@ -91,12 +95,79 @@ struct RadixSorter
 		alignas(sizeof(histogram_t)) histogram_t histogram[histogram_size];
 };
 
+//! Every pass splits the range into one block per thread, blocks get histogrammed and scattered in parallel, only the offsets are computed serially
+template<size_t key_bit_count>
+struct ParallelRadixSorter
+{
+		// smaller digits than the serial sorter, because the offset computation is `histogram_size*blockCount`
+		_NBL_STATIC_INLINE_CONSTEXPR uint8_t radix_bits = 8u;
+		_NBL_STATIC_INLINE_CONSTEXPR size_t histogram_size = 0x1ull<<radix_bits;
+		_NBL_STATIC_INLINE_CONSTEXPR size_t last_pass = (key_bit_count-1ull)/size_t(radix_bits);
+		_NBL_STATIC_INLINE_CONSTEXPR uint16_t radix_mask = (1u<<radix_bits)-1u;
+		// not worth waking a thread for less
+		_NBL_STATIC_INLINE_CONSTEXPR size_t min_block_size = 0x1ull<<14ull;
+
+		template<class RandomIt, class KeyAccessor>
+		inline RandomIt operator()(RandomIt input, RandomIt output, const size_t rangeSize, const KeyAccessor& comp)
+		{
+			const size_t maxBlocks = std::max<size_t>(std::thread::hardware_concurrency(),1ull);
+			const size_t blockCount = std::max<size_t>(std::min<size_t>(maxBlocks,rangeSize/min_block_size),1ull);
+			blockSize = (rangeSize+blockCount-1ull)/blockCount;
+			histograms.resize(blockCount*histogram_size);
+			blocks.resize(blockCount);
+			std::iota(blocks.begin(),blocks.end(),0u);
+			return pass<RandomIt,KeyAccessor,0ull>(input,output,rangeSize,comp);
+		}
+	private:
+		template<class RandomIt, class KeyAccessor, size_t pass_ix>
+		inline RandomIt pass(RandomIt input, RandomIt output, const size_t rangeSize, const KeyAccessor& comp)
+		{
+			constexpr size_t shift = size_t(radix_bits)*pass_ix;
+			// count
+			core::for_each(core::execution::par,blocks.begin(),blocks.end(),[&](const uint32_t blockIx) -> void
+			{
+				size_t* histogram = histograms.data()+blockIx*histogram_size;
+				std::fill_n(histogram,histogram_size,0ull);
+				const size_t end = std::min(size_t(blockIx+1u)*blockSize,rangeSize);
+				for (size_t i=blockIx*blockSize; i<end; i++)
+					++histogram[comp.template operator()<shift,radix_mask>(input[i])];
+			});
+			// exclusive prefix sum, digit major so that equal keys keep their block order (stability)
+			size_t sum = 0ull;
+			for (size_t digit=0ull; digit<histogram_size; digit++)
+			for (size_t blockIx=0ull; blockIx<blocks.size(); blockIx++)
+			{
+				auto& count = histograms[blockIx*histogram_size+digit];
+				const size_t tmp = count;
+				count = sum;
+				sum += tmp;
+			}
+			// scatter
+			core::for_each(core::execution::par,blocks.begin(),blocks.end(),[&](const uint32_t blockIx) -> void
+			{
+				size_t* histogram = histograms.data()+blockIx*histogram_size;
+				const size_t end = std::min(size_t(blockIx+1u)*blockSize,rangeSize);
+				for (size_t i=blockIx*blockSize; i<end; i++)
+					output[histogram[comp.template operator()<shift,radix_mask>(input[i])]++] = input[i];
+			});
+
+			if constexpr (pass_ix != last_pass)
+				return pass<RandomIt,KeyAccessor,pass_ix+1ull>(output,input,rangeSize,comp);
+			else
+				return output;
+		}
+
+		size_t blockSize = 0ull;
+		std::vector<size_t> histograms;
+		std::vector<uint32_t> blocks;
+};
+
 }
 
 template<class RandomIt, class KeyAccessor>
 inline RandomIt radix_sort(RandomIt input, RandomIt scratch, const size_t rangeSize, const KeyAccessor& comp)
 {
-	assert(std::abs(std::distance(input,scratch))>=rangeSize);
+	assert(size_t(std::abs(std::distance(input,scratch)))>=rangeSize);
 
 	if (rangeSize<static_cast<decltype(rangeSize)>(0x1ull<<16ull))
 		return impl::RadixSorter<KeyAccessor::key_bit_count,uint16_t>()(input,scratch,static_cast<uint16_t>(rangeSize),comp);
@@ -113,6 +184,19 @@ inline RandomIt radix_sort(RandomIt input, RandomIt scratch, const size_t rangeS
 	return radix_sort<RandomIt>(input,scratch,rangeSize,impl::KeyAdaptor<decltype(*input)>());
 }
 
+//! Multithreaded version of the above, same contract (stable, result in either `input` or `scratch`), worth it above a few ten thousand elements
+template<class RandomIt, class KeyAccessor>
+inline RandomIt parallel_radix_sort(RandomIt input, RandomIt scratch, const size_t rangeSize, const KeyAccessor& comp)
+{
+	assert(size_t(std::abs(std::distance(input,scratch)))>=rangeSize);
+	return impl::ParallelRadixSorter<KeyAccessor::key_bit_count>()(input,scratch,rangeSize,comp);
+}
+template<class RandomIt>
+inline RandomIt parallel_radix_sort(RandomIt input, RandomIt scratch, const size_t rangeSize)
+{
+	return parallel_radix_sort<RandomIt>(input,scratch,rangeSize,impl::KeyAdaptor<std::remove_cv_t<std::remove_reference_t<decltype(*input)>>>());
+}
+
 }
 }
 
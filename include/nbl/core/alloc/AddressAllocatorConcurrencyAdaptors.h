@@ -111,6 +111,14 @@ class AddressAllocatorBasicConcurrencyAdaptor : private AddressAllocator
         }
 };
 
+
+//! Picks the allocator itself if it's already thread-safe (`address_allocator_traits::supportsConcurrentOps`), so it doesn't get wrapped in a lock
+template<class AddressAllocator, class RecursiveLockable>
+using AddressAllocatorConcurrencyAdaptor = std::conditional_t<address_allocator_traits<AddressAllocator>::supportsConcurrentOps,
+    AddressAllocator,
+    AddressAllocatorBasicConcurrencyAdaptor<AddressAllocator,RecursiveLockable>
+>;
+
 }
 }
 
@@ -0,0 +1,137 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_CORE_C_ARENA_ALLOCATOR_H_INCLUDED_
+#define _NBL_CORE_C_ARENA_ALLOCATOR_H_INCLUDED_
+
+#include "nbl/core/memory/memory.h"
+#include "nbl/core/decl/BaseClasses.h"
+#include "nbl/core/alloc/AllocatorTrivialBases.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace nbl::core
+{
+
+//! Thread caching general purpose allocator, backs `_NBL_ALIGNED_MALLOC` (so `core::allocator`, `ICPUBuffer` etc.) when built with `NBL_ARENA_ALLOCATOR`
+/**
+	Small allocations (up to `MaxSmallSize`) come from size class pools carved out of `SpanSize` aligned spans,
+	every thread keeps a cache of free objects per size class and only takes a size class' lock to refill or flush a batch.
+	The size class of a pointer is found through a page map indexed by span, so `deallocate` doesn't need the size.
+	Spans of small objects are kept for reuse, not given back to the system.
+
+	Large allocations go straight to the system, the ones of at least `SpanSize` get aligned to it and advised to be backed by huge pages.
+
+	Can also be used directly when `NBL_ARENA_ALLOCATOR` is off.
+*/
+class NBL_API2 CArenaAllocator final
+{
+	public:
+		_NBL_STATIC_INLINE_CONSTEXPR size_t SpanShift = 21ull;
+		//! Also the size of a huge page on x86
+		_NBL_STATIC_INLINE_CONSTEXPR size_t SpanSize = 0x1ull<<SpanShift;
+		_NBL_STATIC_INLINE_CONSTEXPR size_t MaxSmallSize = 32ull<<10ull;
+		_NBL_STATIC_INLINE_CONSTEXPR uint32_t SizeClassCount = 22u;
+		//! Bookkeeping in front of every large allocation with at most 16 byte alignment, `SpanSize-LargeHeaderSize` bytes still fit in one span
+		_NBL_STATIC_INLINE_CONSTEXPR size_t LargeHeaderSize = sizeof(void*)+sizeof(size_t);
+
+		struct SStatistics
+		{
+			// small object pools
+			uint64_t spanCount;
+			uint64_t smallBytesHandedOut; // to thread caches or directly to users
+			uint64_t centralRefills;
+			uint64_t centralFlushes;
+			// system allocations
+			uint64_t largeAllocationCount;
+			uint64_t largeBytesInUse;
+			uint64_t hugePageBytesInUse;
+			uint64_t hugePageBytesCached; // freed, kept around for reuse
+		};
+
+		static void* allocate(size_t bytes, size_t alignment) noexcept;
+		static void deallocate(void* ptr) noexcept;
+
+		static SStatistics getStatistics();
+		//! Returns all the objects the calling thread has cached to the shared pools, happens automatically on thread exit
+		static void flushThreadCache();
+
+		//! Bump allocator for a loader's scratch memory, everything gets freed in one shot on `reset` or destruction
+		/**
+			`allocate` is thread-safe, so a loader can hand the arena to its worker threads.
+			Chunks come from `CArenaAllocator::allocate`, so chunks of at least `SpanSize-LargeHeaderSize` are huge page backed,
+			the default one occupies exactly one span.
+		*/
+		class NBL_API2 CLoadArena final : public Uncopyable
+		{
+			public:
+				CLoadArena(const size_t chunkSize=SpanSize-LargeHeaderSize) : m_chunkSize(chunkSize) {}
+				~CLoadArena() {reset();}
+
+				void* allocate(size_t bytes, size_t alignment) noexcept;
+				//! Frees all chunks, every pointer handed out gets invalidated
+				void reset() noexcept;
+
+				inline size_t getBytesAllocated() const {return m_bytesAllocated.load(std::memory_order_relaxed);}
+				inline size_t getBytesReserved() const {return m_bytesReserved.load(std::memory_order_relaxed);}
+
+			private:
+				struct SChunk
+				{
+					SChunk* prev;
+					size_t size;
+					std::atomic<size_t> offset;
+				};
+
+				void* allocateFromChunk(SChunk* chunk, size_t bytes, size_t alignment) noexcept;
+
+				const size_t m_chunkSize;
+				std::atomic<SChunk*> m_current = nullptr;
+				std::mutex m_chunkMutex;
+				std::atomic<size_t> m_bytesAllocated = 0ull;
+				std::atomic<size_t> m_bytesReserved = 0ull;
+		};
+
+	private:
+		CArenaAllocator() = delete;
+};
+
+//! STL allocator for scratch containers living in a `CArenaAllocator::CLoadArena`, `deallocate` does nothing
+template<typename T>
+class NBL_FORCE_EBO load_arena_allocator : public AllocatorTrivialBase<T>
+{
+	public:
+		typedef size_t	size_type;
+		typedef T*		pointer;
+
+		template<class U> struct rebind { typedef load_arena_allocator<U> other; };
+
+		load_arena_allocator(CArenaAllocator::CLoadArena* _arena) : arena(_arena) {}
+		template<typename U>
+		load_arena_allocator(const load_arena_allocator<U>& other) : arena(other.arena) {}
+
+		inline pointer	allocate(size_type n, size_type alignment, const void* hint=nullptr) noexcept
+		{
+			if (n==0)
+				return nullptr;
+			return reinterpret_cast<pointer>(arena->allocate(n*sizeof(T),alignment));
+		}
+		inline pointer	allocate(size_type n, const void* hint=nullptr) noexcept
+		{
+			return allocate(n,_NBL_DEFAULT_ALIGNMENT(T),hint);
+		}
+		inline void		deallocate(pointer p, size_type n=0) noexcept {}
+
+		template<typename U>
+		inline bool		operator==(const load_arena_allocator<U>& other) const noexcept {return arena==other.arena;}
+		template<typename U>
+		inline bool		operator!=(const load_arena_allocator<U>& other) const noexcept {return arena!=other.arena;}
+
+		CArenaAllocator::CLoadArena* arena;
+};
+
+}
+
+#endif
@@ -0,0 +1,334 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef __NBL_CORE_CONCURRENT_POOL_ADDRESS_ALLOCATOR_H_INCLUDED__
+#define __NBL_CORE_CONCURRENT_POOL_ADDRESS_ALLOCATOR_H_INCLUDED__
+
+#include "BuildConfigOptions.h"
+
+#include "nbl/core/alloc/AddressAllocatorBase.h"
+
+#include <atomic>
+
+namespace nbl
+{
+namespace core
+{
+
+
+//! Thread-safe counterpart of `PoolAddressAllocator`, `alloc_addr`, `free_addr` and their `multi_` versions can be called from any number of threads at once
+/**
+The free blocks form a lock-free (Treiber) stack linked through block indices stored in the reserved space,
+the head carries a tag that gets bumped on every change so that a block popped and pushed back in between can't corrupt the stack (ABA).
+A whole `multi_alloc_addr` or `multi_free_addr` batch is taken or given back with a single CAS.
+This makes it lock-free but not wait-free, some thread always gets through but a single one can keep losing the CAS and retrying for as long as others contend.
+
+Same as with `PoolAddressAllocator` it can only allocate up to the size of a single block, and can't hold more than 2^32-1 blocks.
+`reset`, `safe_shrink_size` and the resizing constructors need exclusive access, `get_free_size` and `get_allocated_size` are only exact when nothing else is in flight.
+*/
+template<typename _size_type>
+class ConcurrentPoolAddressAllocator : public AddressAllocatorBase<ConcurrentPoolAddressAllocator<_size_type>,_size_type>
+{
+    public:
+        _NBL_DECLARE_ADDRESS_ALLOCATOR_TYPEDEFS(_size_type);
+
+    private:
+        typedef AddressAllocatorBase<ConcurrentPoolAddressAllocator<_size_type>,_size_type> Base;
+
+        _NBL_STATIC_INLINE_CONSTEXPR uint32_t invalid_link = ~0u;
+
+        static inline uint64_t packHead(uint32_t blockID, uint64_t oldHead) {return ((oldHead>>32ull)+1ull)<<32ull|blockID;}
+        static inline uint32_t headBlockID(uint64_t head) {return static_cast<uint32_t>(head);}
+
+        static inline std::atomic_ref<uint32_t> getLink(void* reservedSpc, uint32_t blockID) {return std::atomic_ref<uint32_t>(reinterpret_cast<uint32_t*>(reservedSpc)[blockID]);}
+        inline std::atomic_ref<uint32_t> getLink(uint32_t blockID) const {return getLink(Base::reservedSpace,blockID);}
+
+        inline bool isValidRequest(size_type bytes, size_type alignment) const {return (blockSize%alignment)==0u && bytes!=0u && bytes<=blockSize;}
+        inline size_type blockIDToAddress(uint32_t blockID) const {return blockID*blockSize+Base::combinedOffset;}
+
+        // pops up to `count` blocks linked together, returns how many
+        inline uint32_t pop(uint32_t count, uint32_t& outFirst) noexcept
+        {
+            uint64_t head = m_head.load(std::memory_order_acquire);
+            uint32_t popped;
+            uint64_t newHead;
+            do
+            {
+                outFirst = headBlockID(head);
+                if (outFirst==invalid_link)
+                    return 0u;
+                // the links read here can be stale if someone else popped the blocks meanwhile, but then the tag changed and the CAS fails
+                uint32_t last = outFirst;
+                for (popped=1u; popped<count; popped++)
+                {
+                    const uint32_t next = getLink(last).load(std::memory_order_relaxed);
+                    if (next==invalid_link)
+                        break;
+                    last = next;
+                }
+                newHead = packHead(getLink(last).load(std::memory_order_relaxed),head);
+            } while (!m_head.compare_exchange_weak(head,newHead,std::memory_order_acquire,std::memory_order_acquire));
+            m_freeCount.fetch_sub(popped,std::memory_order_relaxed);
+            return popped;
+        }
+        // `first` to `last` need to be already linked together
+        inline void push(uint32_t first, uint32_t last, uint32_t count) noexcept
+        {
+            uint64_t head = m_head.load(std::memory_order_relaxed);
+            do
+            {
+                getLink(last).store(headBlockID(head),std::memory_order_relaxed);
+            } while (!m_head.compare_exchange_weak(head,packHead(first,head),std::memory_order_release,std::memory_order_relaxed));
+            m_freeCount.fetch_add(count,std::memory_order_relaxed);
+        }
+
+        // not thread-safe, blocks get popped in the order they're appended
+        inline void appendUnsynchronized(uint32_t blockID, uint32_t& tail)
+        {
+            getLink(blockID).store(invalid_link,std::memory_order_relaxed);
+            if (tail!=invalid_link)
+                getLink(tail).store(blockID,std::memory_order_relaxed);
+            else
+                m_head.store(packHead(blockID,m_head.load(std::memory_order_relaxed)),std::memory_order_relaxed);
+            tail = blockID;
+            m_freeCount.fetch_add(1u,std::memory_order_relaxed);
+        }
+
+        // `otherReservedSpc` because the base's move constructor takes the reserved space away from `other`
+        void copyState(const ConcurrentPoolAddressAllocator& other, void* otherReservedSpc, _size_type newBuffSz)
+        {
+            #ifdef _NBL_DEBUG
+                assert(Base::checkResize(newBuffSz,Base::alignOffset));
+                assert(blockCount<invalid_link);
+            #endif // _NBL_DEBUG
+
+            // same order as `PoolAddressAllocator`, the other allocator's free blocks first then the new ones
+            m_head.store(invalid_link,std::memory_order_relaxed);
+            m_freeCount.store(0u,std::memory_order_relaxed);
+            uint32_t tail = invalid_link;
+            for (uint32_t blockID=headBlockID(other.m_head.load(std::memory_order_acquire)); blockID!=invalid_link; blockID=getLink(otherReservedSpc,blockID).load(std::memory_order_relaxed))
+            if (blockID<blockCount) // check in case of shrink
+                appendUnsynchronized(blockID,tail);
+            for (size_type blockID=other.blockCount; blockID<blockCount; blockID++)
+                appendUnsynchronized(blockID,tail);
+        }
+
+        struct SMoveTag
+        {
+            void* otherReservedSpc;
+        };
+        template<typename... Args>
+        ConcurrentPoolAddressAllocator(SMoveTag tag, _size_type newBuffSz, ConcurrentPoolAddressAllocator&& other, Args&&... args) noexcept :
+                    Base(std::move(other),std::forward<Args>(args)...),
+                        blockCount((newBuffSz-Base::alignOffset)/other.blockSize), blockSize(other.blockSize), m_head(invalid_link), m_freeCount(0u)
+        {
+            copyState(other,tag.otherReservedSpc,newBuffSz);
+
+            other.blockCount = invalid_address;
+            other.blockSize = invalid_address;
+            other.m_head.store(invalid_link,std::memory_order_relaxed);
+            other.m_freeCount.store(0u,std::memory_order_relaxed);
+        }
+
+    public:
+        static constexpr bool supportsNullBuffer = true;
+        static constexpr bool supportsConcurrentOps = true;
+        // a batch gets walked before the CAS, so the bigger it is the more likely another thread gets in first
+        static constexpr uint32_t maxMultiOps = 64u;
+
+        ConcurrentPoolAddressAllocator() : blockCount(0u), blockSize(1u), m_head(invalid_link), m_freeCount(0u) {}
+
+        virtual ~ConcurrentPoolAddressAllocator() {}
+
+        ConcurrentPoolAddressAllocator(void* reservedSpc, _size_type addressOffsetToApply, _size_type alignOffsetNeeded, _size_type maxAllocatableAlignment, size_type bufSz, size_type blockSz) noexcept :
+                    Base(reservedSpc,addressOffsetToApply,alignOffsetNeeded,maxAllocatableAlignment),
+                        blockCount((bufSz-alignOffsetNeeded)/blockSz), blockSize(blockSz), m_head(invalid_link), m_freeCount(0u)
+        {
+            reset();
+        }
+
+        //! When resizing we require that the copying of data buffer has already been handled by the user of the address allocator, and that nobody uses `other`
+        template<typename... Args>
+        ConcurrentPoolAddressAllocator(_size_type newBuffSz, ConcurrentPoolAddressAllocator&& other, Args&&... args) noexcept :
+                    ConcurrentPoolAddressAllocator(SMoveTag{other.reservedSpace},newBuffSz,std::move(other),std::forward<Args>(args)...) {}
+        template<typename... Args>
+        ConcurrentPoolAddressAllocator(_size_type newBuffSz, const ConcurrentPoolAddressAllocator& other, Args&&... args) noexcept :
+            Base(other,std::forward<Args>(args)...),
+            blockCount((newBuffSz-Base::alignOffset)/other.blockSize), blockSize(other.blockSize), m_head(invalid_link), m_freeCount(0u)
+        {
+            copyState(other,other.reservedSpace,newBuffSz);
+        }
+
+        //! Not thread-safe
+        ConcurrentPoolAddressAllocator& operator=(ConcurrentPoolAddressAllocator&& other)
+        {
+            Base::operator=(std::move(other));
+            std::swap(blockCount,other.blockCount);
+            std::swap(blockSize,other.blockSize);
+            m_head.store(other.m_head.exchange(m_head.load(std::memory_order_relaxed),std::memory_order_relaxed),std::memory_order_relaxed);
+            m_freeCount.store(other.m_freeCount.exchange(m_freeCount.load(std::memory_order_relaxed),std::memory_order_relaxed),std::memory_order_relaxed);
+            return *this;
+        }
+
+
+        inline size_type        alloc_addr( size_type bytes, size_type alignment, size_type hint=0ull) noexcept
+        {
+            uint32_t blockID;
+            if (!isValidRequest(bytes,alignment) || pop(1u,blockID)==0u)
+                return invalid_address;
+            return blockIDToAddress(blockID);
+        }
+
+        inline void             free_addr(size_type addr, size_type bytes) noexcept
+        {
+            #ifdef _NBL_DEBUG
+                assert(addr>=Base::combinedOffset && (addr-Base::combinedOffset)%blockSize==0);
+            #endif // _NBL_DEBUG
+            const uint32_t blockID = addressToBlockID(addr);
+            push(blockID,blockID,1u);
+        }
+
+        //! Same semantics as the default `address_allocator_traits::multi_alloc_addr`, but takes all the blocks at once
+        inline void             multi_alloc_addr(uint32_t count, size_type* outAddresses, const size_type* bytes, const size_type* alignment, const size_type* hint=nullptr) noexcept
+        {
+            uint32_t needed = 0u;
+            for (uint32_t i=0u; i<count; i++)
+            if (outAddresses[i]==invalid_address && isValidRequest(bytes[i],alignment[i]))
+                needed++;
+            if (needed==0u)
+                return;
+
+            uint32_t blockID;
+            uint32_t popped = pop(needed,blockID);
+            for (uint32_t i=0u; popped && i<count; i++)
+            if (outAddresses[i]==invalid_address && isValidRequest(bytes[i],alignment[i]))
+            {
+                outAddresses[i] = blockIDToAddress(blockID);
+                // don't read past the last popped block, its link belongs to the stack
+                if (--popped)
+                    blockID = getLink(blockID).load(std::memory_order_relaxed);
+            }
+        }
+
+        //! Same semantics as the default `address_allocator_traits::multi_free_addr`, but gives all the blocks back at once
+        inline void             multi_free_addr(uint32_t count, const size_type* addr, const size_type* bytes) noexcept
+        {
+            uint32_t first = invalid_link;
+            uint32_t last = invalid_link;
+            uint32_t freed = 0u;
+            for (uint32_t i=0u; i<count; i++)
+            {
+                if (addr[i]==invalid_address)
+                    continue;
+                #ifdef _NBL_DEBUG
+                    assert(addr[i]>=Base::combinedOffset && (addr[i]-Base::combinedOffset)%blockSize==0);
+                #endif // _NBL_DEBUG
+                const uint32_t blockID = addressToBlockID(addr[i]);
+                if (last!=invalid_link)
+                    getLink(last).store(blockID,std::memory_order_relaxed);
+                else
+                    first = blockID;
+                last = blockID;
+                freed++;
+            }
+            if (freed)
+                push(first,last,freed);
+        }
+
+        //! Not thread-safe
+        inline void             reset()
+        {
+            #ifdef _NBL_DEBUG
+                assert(blockCount<invalid_link);
+            #endif // _NBL_DEBUG
+            m_head.store(invalid_link,std::memory_order_relaxed);
+            m_freeCount.store(0u,std::memory_order_relaxed);
+            uint32_t tail = invalid_link;
+            for (size_type blockID=0u; blockID<blockCount; blockID++)
+                appendUnsynchronized(blockID,tail);
+        }
+
+        //! conservative estimate, does not account for space lost to alignment
+        inline size_type        max_size() const noexcept
+        {
+            return blockSize;
+        }
+
+        //! Most allocators do not support e.g. 1-byte allocations
+        inline size_type        min_size() const noexcept
+        {
+            return blockSize;
+        }
+
+        //! Not thread-safe
+        inline size_type        safe_shrink_size(size_type sizeBound, size_type newBuffAlignmentWeCanGuarantee=1u) noexcept
+        {
+            const size_type capacity = get_total_size()-Base::alignOffset;
+            if (sizeBound>=capacity)
+                return Base::safe_shrink_size(sizeBound,newBuffAlignmentWeCanGuarantee);
+
+            if (m_freeCount.load(std::memory_order_relaxed)==0u)
+                sizeBound = capacity;
+            else
+            {
+                // second half of the reserved space is scratch, flag the free blocks and strip the free ones off the end
+                uint8_t* isFree = reinterpret_cast<uint8_t*>(reinterpret_cast<uint32_t*>(Base::reservedSpace)+blockCount);
+                std::fill_n(isFree,blockCount,0u);
+                for (uint32_t blockID=headBlockID(m_head.load(std::memory_order_acquire)); blockID!=invalid_link; blockID=getLink(blockID).load(std::memory_order_relaxed))
+                    isFree[blockID] = 1u;
+                size_type endBlock = blockCount;
+                while (endBlock && isFree[endBlock-1u] && (endBlock-1u)*blockSize>=sizeBound)
+                    endBlock--;
+                sizeBound = std::max<size_type>(sizeBound,endBlock*blockSize);
+            }
+            return Base::safe_shrink_size(sizeBound,newBuffAlignmentWeCanGuarantee);
+        }
+
+
+        static inline size_type reserved_size(size_type maxAlignment, size_type bufSz, size_type blockSz) noexcept
+        {
+            size_type maxBlockCount =  bufSz/blockSz;
+            return maxBlockCount*sizeof(uint32_t)*size_type(2u);
+        }
+        static inline size_type reserved_size(const ConcurrentPoolAddressAllocator<_size_type>& other, size_type bufSz) noexcept
+        {
+            return reserved_size(other.maxRequestableAlignment,bufSz,other.blockSize);
+        }
+
+        inline size_type        get_free_size() const noexcept
+        {
+            return m_freeCount.load(std::memory_order_relaxed)*blockSize;
+        }
+        inline size_type        get_allocated_size() const noexcept
+        {
+            return (blockCount-m_freeCount.load(std::memory_order_relaxed))*blockSize;
+        }
+        inline size_type        get_total_size() const noexcept
+        {
+            return blockCount*blockSize+Base::alignOffset;
+        }
+
+
+
+        inline size_type addressToBlockID(size_type addr) const noexcept
+        {
+            return (addr-Base::combinedOffset)/blockSize;
+        }
+    protected:
+        size_type   blockCount;
+        size_type   blockSize;
+        // low 32 bits are the top block, high 32 bits the ABA tag
+        std::atomic<uint64_t> m_head;
+        // every operation touches both, so they might as well share a cache line
+        std::atomic<size_type> m_freeCount;
+};
+
+
+}
+}
+
+#include "nbl/core/alloc/AddressAllocatorConcurrencyAdaptors.h"
+
+#endif
+
@@ -0,0 +1,250 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef __NBL_CORE_EPOCH_RING_ADDRESS_ALLOCATOR_LF_H_INCLUDED__
+#define __NBL_CORE_EPOCH_RING_ADDRESS_ALLOCATOR_LF_H_INCLUDED__
+
+#include "nbl/core/memory/memory.h"
+
+#include <atomic>
+#include <thread>
+
+namespace nbl
+{
+namespace core
+{
+
+
+//! Lock-free multi-producer ring allocator which never frees single allocations, only whole epochs
+/**
+A thread reserves a chunk of the ring with a single CAS on a monotonic head counter and then bump-allocates from it through a thread-local cursor.
+`retire` closes the open epoch and tags it with a value (e.g. the timeline semaphore value of the submission consuming it),
+`reclaim` frees every epoch whose value has been reached, any thread can do that and every epoch gets claimed with a single CAS.
+
+Every allocating thread pins the open epoch (on a counter per epoch parity), `retire` waits for the pins of the epoch it closes to go away
+before recording where that epoch ends, and chunks of the next epoch only get reserved after that. So an allocation made while the epoch was pinned
+is always freed together with that epoch and never sooner. A producer can keep the pin with `pin`/`unpin` across allocating, writing and handing
+the allocations over to the thread which submits them, which then needs to `retire` before gathering what was handed over.
+
+Only one thread may `retire` at a time, and a thread holding a pin must not wait for a `retire` (including waiting for space in the ring).
+A thread can hold a pin on only one allocator at a time.
+*/
+template<typename _size_type>
+class EpochRingAddressAllocatorLF
+{
+    public:
+        using size_type = _size_type;
+        static constexpr inline size_type invalid_address = ~static_cast<size_type>(0);
+        //! how many `retire`d epochs can be pending at once before `retire` fails
+        static constexpr inline uint32_t MaxEpochsInFlight = 64u;
+
+        //! `chunkSize` needs to be a power of two, the ring size gets rounded down to its multiple
+        EpochRingAddressAllocatorLF(const size_type addressOffset, const size_type bufSz, const size_type chunkSize) :
+            m_offset(addressOffset), m_size(core::alignDown(static_cast<uint64_t>(bufSz),static_cast<uint64_t>(chunkSize))), m_chunkSize(chunkSize), m_uid(s_nextUID++)
+        {
+            assert(m_size && core::isPoT(m_chunkSize));
+        }
+        // the thread-local state refers to the allocator by its UID, so it can't be copied or moved
+        EpochRingAddressAllocatorLF(const EpochRingAddressAllocatorLF&) = delete;
+        EpochRingAddressAllocatorLF& operator=(const EpochRingAddressAllocatorLF&) = delete;
+
+        //! Pins the open epoch for the calling thread, calls nest
+        inline void pin() noexcept
+        {
+            auto& pinned = t_pin;
+            assert(!pinned.depth || pinned.owner==m_uid);
+            if (pinned.depth++)
+                return;
+            pinned.owner = m_uid;
+            pinned.epoch = acquirePin();
+        }
+        inline void unpin() noexcept
+        {
+            auto& pinned = t_pin;
+            assert(pinned.depth && pinned.owner==m_uid);
+            if (--pinned.depth)
+                return;
+            releasePin(pinned.epoch);
+        }
+        inline bool is_pinned() const noexcept
+        {
+            return t_pin.depth && t_pin.owner==m_uid;
+        }
+
+        //! Returns `invalid_address` if the ring is full, pins the open epoch for the duration of the call unless the thread already holds a pin
+        inline size_type alloc_addr(const size_type bytes, const size_type alignment) noexcept
+        {
+            if (is_pinned())
+                return alloc_pinned(t_pin.epoch,bytes,alignment);
+            const uint64_t epoch = acquirePin();
+            const size_type retval = alloc_pinned(epoch,bytes,alignment);
+            releasePin(epoch);
+            return retval;
+        }
+
+        //! Frees every retired epoch whose value is not greater than `reachedValue`
+        inline void reclaim(const uint64_t reachedValue) noexcept
+        {
+            uint64_t reclaimed = m_reclaimedEpochs.load(std::memory_order_acquire);
+            while (reclaimed<m_retiredEpochs.load(std::memory_order_acquire))
+            {
+                const auto& record = m_epochs[reclaimed%MaxEpochsInFlight];
+                const uint64_t end = record.end.load(std::memory_order_relaxed);
+                if (record.value.load(std::memory_order_relaxed)>reachedValue)
+                    break;
+                if (!m_reclaimedEpochs.compare_exchange_weak(reclaimed,reclaimed+1ull,std::memory_order_acq_rel,std::memory_order_acquire))
+                    continue;
+                // reclaimers of consecutive epochs can race, tail only ever moves forward
+                uint64_t tail = m_tail.load(std::memory_order_relaxed);
+                while (tail<end && !m_tail.compare_exchange_weak(tail,end,std::memory_order_release,std::memory_order_relaxed)) {}
+                reclaimed++;
+            }
+        }
+
+        //! Closes the open epoch, everything allocated in it gets reused once `reclaim` is called with at least `value`
+        /** Values must not decrease between calls. Waits for the threads still pinning the epoch, fails without any effect if `MaxEpochsInFlight` epochs are pending. */
+        inline bool retire(const uint64_t value) noexcept
+        {
+            assert(!is_pinned());
+            const uint64_t epoch = m_openEpoch.load(std::memory_order_relaxed);
+            if (epoch-m_reclaimedEpochs.load(std::memory_order_acquire)>=MaxEpochsInFlight)
+                return false;
+            // new pins go to the next epoch, the ones of this epoch drain as their threads finish allocating
+            m_openEpoch.store(epoch+1ull,std::memory_order_seq_cst);
+            while (m_pins[epoch&0x1u].load(std::memory_order_seq_cst))
+                std::this_thread::yield();
+            // nobody can reserve a chunk of the next epoch until `m_retiredEpochs` gets bumped, so this is exactly where the epoch ends
+            auto& record = m_epochs[epoch%MaxEpochsInFlight];
+            record.end.store(m_head.load(std::memory_order_acquire),std::memory_order_relaxed);
+            record.value.store(value,std::memory_order_relaxed);
+            m_retiredEpochs.store(epoch+1ull,std::memory_order_release);
+            return true;
+        }
+
+        //! How many retired epochs did not get reclaimed yet
+        inline uint64_t pending_epochs() const noexcept
+        {
+            return m_retiredEpochs.load(std::memory_order_acquire)-m_reclaimedEpochs.load(std::memory_order_acquire);
+        }
+        //! Value the oldest pending epoch waits for, only meaningful if `pending_epochs()!=0`
+        inline uint64_t oldest_pending_value() const noexcept
+        {
+            return m_epochs[m_reclaimedEpochs.load(std::memory_order_acquire)%MaxEpochsInFlight].value.load(std::memory_order_relaxed);
+        }
+
+        //! Max possible currently allocatable single allocation size
+        inline size_type max_size() const noexcept
+        {
+            const uint64_t head = m_head.load(std::memory_order_acquire);
+            const uint64_t free = m_size-(head-m_tail.load(std::memory_order_acquire));
+            // a chunk never straddles the end of the ring
+            const uint64_t tillEnd = m_size-head%m_size;
+            const uint64_t contiguous = free<=tillEnd ? free:core::max(tillEnd,free-tillEnd);
+            return static_cast<size_type>(core::alignDown(contiguous,static_cast<uint64_t>(m_chunkSize)));
+        }
+        inline size_type get_total_size() const noexcept {return static_cast<size_type>(m_size);}
+
+    protected:
+        struct SEpoch
+        {
+            // atomics only so that a reclaimer racing with a `retire` reusing the slot is not UB, the CAS on `m_reclaimedEpochs` validates the read
+            std::atomic_uint64_t end = 0ull;
+            std::atomic_uint64_t value = 0ull;
+        };
+        // `owner` is a UID not `this` so a new allocator at the same address doesn't pick up stale state
+        // (zero initialized as thread locals, UIDs start at 1)
+        struct SThreadChunk
+        {
+            uint64_t owner;
+            uint64_t epoch;
+            uint64_t cursor;
+            uint64_t end;
+        };
+        struct SThreadPin
+        {
+            uint64_t owner;
+            uint64_t epoch;
+            uint32_t depth;
+        };
+
+        // the re-check pairs with the store in `retire`, either it sees our pin or we see the new epoch
+        inline uint64_t acquirePin() noexcept
+        {
+            uint64_t epoch = m_openEpoch.load(std::memory_order_seq_cst);
+            while (true)
+            {
+                m_pins[epoch&0x1u].fetch_add(1u,std::memory_order_seq_cst);
+                const uint64_t open = m_openEpoch.load(std::memory_order_seq_cst);
+                if (open==epoch)
+                    return epoch;
+                m_pins[epoch&0x1u].fetch_sub(1u,std::memory_order_release);
+                epoch = open;
+            }
+        }
+        inline void releasePin(const uint64_t epoch) noexcept
+        {
+            m_pins[epoch&0x1u].fetch_sub(1u,std::memory_order_release);
+        }
+
+        inline size_type alloc_pinned(const uint64_t epoch, const size_type bytes, const size_type alignment) noexcept
+        {
+            assert(core::isPoT(alignment) && alignment<=m_chunkSize);
+            // chunk is stale if this thread last used another allocator, or it belongs to an older epoch
+            auto& chunk = t_chunk;
+            if (chunk.owner!=m_uid || chunk.epoch!=epoch)
+                chunk = {m_uid,epoch,0ull,0ull};
+
+            uint64_t cursor = core::alignUp(chunk.cursor,static_cast<uint64_t>(alignment));
+            if (!chunk.end || cursor+bytes>chunk.end)
+            {
+                // big allocations get a chunk of their own size
+                const uint64_t chunkSize = core::alignUp(core::max<uint64_t>(bytes,1ull),static_cast<uint64_t>(m_chunkSize));
+                if (chunkSize>m_size)
+                    return invalid_address;
+                // the previous epoch's end must be recorded before its successor reserves anything, only takes as long as `retire` drains the pins
+                while (m_retiredEpochs.load(std::memory_order_acquire)<epoch)
+                    std::this_thread::yield();
+                uint64_t head = m_head.load(std::memory_order_relaxed);
+                uint64_t start;
+                do
+                {
+                    // skip the remainder of the ring if the chunk would straddle its end, the skipped space gets reclaimed with the current epoch
+                    start = head;
+                    const uint64_t ringOffset = start%m_size;
+                    if (ringOffset+chunkSize>m_size)
+                        start += m_size-ringOffset;
+                    if (start+chunkSize-m_tail.load(std::memory_order_acquire)>m_size)
+                        return invalid_address;
+                } while (!m_head.compare_exchange_weak(head,start+chunkSize,std::memory_order_acq_rel,std::memory_order_relaxed));
+                cursor = start;
+                chunk.end = start+chunkSize;
+            }
+            chunk.cursor = cursor+bytes;
+            return static_cast<size_type>(m_offset+cursor%m_size);
+        }
+
+        const uint64_t m_offset;
+        const uint64_t m_size;
+        const uint64_t m_chunkSize;
+        const uint64_t m_uid;
+        // monotonic byte counters, `m_head-m_tail<=m_size` always holds
+        alignas(64) std::atomic_uint64_t m_head = 0ull;
+        alignas(64) std::atomic_uint64_t m_tail = 0ull;
+        // `m_openEpoch` runs ahead of `m_retiredEpochs` only while a `retire` is draining the pins
+        alignas(64) std::atomic_uint64_t m_openEpoch = 0ull;
+        alignas(64) std::atomic_uint32_t m_pins[2] = {0u,0u};
+        alignas(64) std::atomic_uint64_t m_retiredEpochs = 0ull;
+        alignas(64) std::atomic_uint64_t m_reclaimedEpochs = 0ull;
+        SEpoch m_epochs[MaxEpochsInFlight];
+
+        static inline std::atomic_uint64_t s_nextUID = 1ull;
+        static inline thread_local SThreadChunk t_chunk;
+        static inline thread_local SThreadPin t_pin;
+};
+
+
+}
+}
+
+#endif
@@ -124,6 +124,7 @@ namespace nbl::core
 
             template<class U> using cstexpr_supportsArbitraryOrderFrees = decltype(std::declval<U&>().supportsArbitraryOrderFrees);
             template<class U> using cstexpr_maxMultiOps                 = decltype(std::declval<U&>().maxMultiOps);
+            template<class U> using cstexpr_supportsConcurrentOps       = decltype(std::declval<U&>().supportsConcurrentOps);
 
             template<class U> using func_multi_alloc_addr               = decltype(std::declval<U&>().multi_alloc_addr(0u,nullptr,nullptr,nullptr,nullptr));
             template<class U> using func_multi_free_addr                = decltype(std::declval<U&>().multi_free_addr(0u,nullptr,nullptr));
@@ -133,6 +134,7 @@ namespace nbl::core
         public:
             template<class,class=void> struct resolve_supportsArbitraryOrderFrees  : std::true_type {};
             template<class,class=void> struct resolve_maxMultiOps                           : std::integral_constant<uint32_t,256u> {};
+            template<class,class=void> struct resolve_supportsConcurrentOps              : std::false_type {};
 
             template<class,class=void> struct has_func_multi_alloc_addr                : std::false_type {};
             template<class,class=void> struct has_func_multi_free_addr                 : std::false_type {};
@@ -144,6 +146,8 @@ namespace nbl::core
                                                                             :  std::conditional<std::true_type/*std::is_same<cstexpr_supportsArbitraryOrderFrees<U>,bool>*/::value,nbl::bool_constant<U::supportsArbitraryOrderFrees>,resolve_supportsArbitraryOrderFrees<void,void> >::type {};
             template<class U> struct resolve_maxMultiOps<U,std::void_t<cstexpr_maxMultiOps<U> > >
                                                                             : std::conditional<std::true_type/*std::is_integral<cstexpr_maxMultiOps<U> >*/::value,std::integral_constant<uint32_t,U::maxMultiOps>, resolve_maxMultiOps<void, void> >::type {};
+            template<class U> struct resolve_supportsConcurrentOps<U,std::void_t<cstexpr_supportsConcurrentOps<U> > >
+                                                                            : nbl::bool_constant<U::supportsConcurrentOps> {};
 
             template<class U> struct has_func_multi_alloc_addr<U,std::void_t<func_multi_alloc_addr<U> > >
                                                                             : std::is_same<func_multi_alloc_addr<U>,void> {};
@@ -154,6 +158,8 @@ namespace nbl::core
 
             _NBL_STATIC_INLINE_CONSTEXPR bool         supportsArbitraryOrderFrees = resolve_supportsArbitraryOrderFrees<AddressAlloc>::value;
             _NBL_STATIC_INLINE_CONSTEXPR uint32_t     maxMultiOps                 = resolve_maxMultiOps<AddressAlloc>::value;
+            //! whether allocs and frees can be called from multiple threads at once without any external synchronization
+            _NBL_STATIC_INLINE_CONSTEXPR bool         supportsConcurrentOps       = resolve_supportsConcurrentOps<AddressAlloc>::value;
 
             static inline void          printDebugInfo()
             {
@@ -163,6 +169,7 @@ namespace nbl::core
 
                 printf("supportsArbitraryOrderFrees == %d\n", supportsArbitraryOrderFrees);
                 printf("maxMultiOps == %d\n",                           maxMultiOps);
+                printf("supportsConcurrentOps == %d\n",                 supportsConcurrentOps);
             }
 
 
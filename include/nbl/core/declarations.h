@@ -31,9 +31,12 @@
 #include "nbl/core/alloc/LinearAddressAllocator.h"
 #include "nbl/core/alloc/null_allocator.h"
 #include "nbl/core/alloc/PoolAddressAllocator.h"
+#include "nbl/core/alloc/ConcurrentPoolAddressAllocator.h"
+#include "nbl/core/alloc/EpochRingAddressAllocatorLF.h"
 #include "nbl/core/alloc/IteratablePoolAddressAllocator.h"
 #include "nbl/core/alloc/StackAddressAllocator.h"
 #include "nbl/core/alloc/SimpleBlockBasedAllocator.h"
+#include "nbl/core/alloc/CArenaAllocator.h"
 // algorithm
 #include "nbl/core/algorithm/radix_sort.h"
 #include "nbl/core/algorithm/utility.h"
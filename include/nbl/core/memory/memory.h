@@ -34,7 +34,20 @@
 
 
 //! You can swap these out for whatever you like, jemalloc, tcmalloc etc. but make them noexcept
-#ifdef _NBL_PLATFORM_WINDOWS_
+#if defined(_NBL_USE_ARENA_ALLOCATOR_)
+
+// `nbl::core::CArenaAllocator`, declared here so this header doesn't need to include it
+namespace nbl
+{
+namespace impl
+{
+    NBL_API2 void* arena_malloc(size_t size, size_t alignment) noexcept;
+    NBL_API2 void arena_free(void* addr) noexcept;
+}
+}
+    #define _NBL_ALIGNED_MALLOC(size,alignment)     nbl::impl::arena_malloc(size,alignment)
+    #define _NBL_ALIGNED_FREE(addr)                 nbl::impl::arena_free(addr)
+#elif defined(_NBL_PLATFORM_WINDOWS_)
     #define _NBL_ALIGNED_MALLOC(size,alignment)     ::_aligned_malloc(size,alignment)
     #define _NBL_ALIGNED_FREE(addr)                 ::_aligned_free(addr)
 #else
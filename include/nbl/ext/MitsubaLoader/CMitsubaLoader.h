@@ -72,6 +72,12 @@ class CMitsubaLoader : public asset::IRenderpassIndependentPipelineLoader
 		core::vector<SContext::shape_ass_type>	getMesh(SContext& ctx, uint32_t hierarchyLevel, CElementShape* shape, const system::logger_opt_ptr& logger);
 		core::vector<SContext::shape_ass_type>	loadShapeGroup(SContext& ctx, uint32_t hierarchyLevel, const CElementShape::ShapeGroup* shapegroup, const core::matrix3x4SIMD& relTform, const system::logger_opt_ptr& _logger);
 		SContext::shape_ass_type				loadBasicShape(SContext& ctx, uint32_t hierarchyLevel, CElementShape* shape, const core::matrix3x4SIMD& relTform, const system::logger_opt_ptr& logger);
+		// only reads `ctx` and `shape` so its safe to call concurrently
+		SContext::shape_ass_type				loadShapeGeometry(const SContext& ctx, uint32_t hierarchyLevel, const CElementShape* shape, const system::logger_opt_ptr& logger);
+		// sphere and cylinder geometry is created at unit size around the origin, this folds their placement into the shape's transform, needs to run exactly once per shape
+		static void								applyShapeGeometryTransform(CElementShape* shape);
+		// loads all referenced model files and processes all basic shapes concurrently, filling the `shapeCache` ahead of the serial scene assembly
+		void									prefetchShapes(SContext& ctx, uint32_t hierarchyLevel, const core::vector<std::pair<CElementShape*,std::string>>& shapes, const system::logger_opt_ptr& logger);
 		
 		void									cacheTexture(SContext& ctx, uint32_t hierarchyLevel, const CElementTexture* texture, const CMitsubaMaterialCompilerFrontend::E_IMAGE_VIEW_SEMANTIC semantic);
 
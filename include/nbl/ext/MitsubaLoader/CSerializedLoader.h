@@ -29,11 +29,10 @@ class CSerializedLoader final : public asset::IRenderpassIndependentPipelineLoad
 		{
 			FileHeader header;
 			
-			system::future<size_t> future;
-			_file->read(future, &header, 0u, sizeof(header));
-			future.get();
+			system::IFile::success_t success;
+			_file->read(success, &header, 0u, sizeof(header));
 
-			return header==FileHeader();
+			return success && header==FileHeader();
 		}
 
 		inline const char** getAssociatedFileExtensions() const override
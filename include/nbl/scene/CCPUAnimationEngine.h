@@ -0,0 +1,115 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_SCENE_C_CPU_ANIMATION_ENGINE_H_INCLUDED_
+#define _NBL_SCENE_C_CPU_ANIMATION_ENGINE_H_INCLUDED_
+
+#include "nbl/core/declarations.h"
+
+#include "nbl/asset/ICPUAnimationLibrary.h"
+#include "nbl/asset/ICPUSkeleton.h"
+#include "nbl/asset/ICPUMeshBuffer.h"
+
+namespace nbl::scene
+{
+
+//! Host counterpart of the animation and skinning pipeline, for server side hitboxes, baking and anything else without a GPU
+/** Samples the keyframes of an `asset::ICPUAnimationLibrary` for many skeleton instances in parallel, and composes the joint transforms over the parent IDs of an `asset::ICPUSkeleton`.
+The model space joint transforms can then be used to skin the positions and normals of an `asset::ICPUMeshBuffer` in place.
+
+Every joint of a skeleton is driven by its own animation (a keyframe range in the library), the keyframe decoding and the rules for
+constructing a matrix from a keyframe are the same as in `nbl/builtin/glsl/scene/keyframe.glsl`.
+*/
+class NBL_API2 CCPUAnimationEngine final : public core::IReferenceCounted
+{
+	public:
+		using animation_t = asset::ICPUAnimationLibrary::animation_t;
+		using timestamp_t = asset::ICPUAnimationLibrary::timestamp_t;
+		using joint_id_t = asset::ICPUSkeleton::joint_id_t;
+		using Keyframe = asset::ICPUAnimationLibrary::Keyframe;
+		using Animation = asset::ICPUAnimationLibrary::Animation;
+
+		static inline constexpr animation_t invalid_animation = 0xdeadbeefu;
+
+		enum E_ROTATION_INTERPOLATION : uint8_t
+		{
+			//! normalized linear interpolation, cheapest but doesn't keep a constant angular velocity
+			ERI_NLERP,
+			//! approximate slerp, same as `nbl_glsl_quaternion_t_flerp` used by the GPU path
+			ERI_FLERP,
+			//! exact spherical interpolation
+			ERI_SLERP
+		};
+
+		static inline core::smart_refctd_ptr<CCPUAnimationEngine> create(core::smart_refctd_ptr<const asset::ICPUAnimationLibrary>&& library, const E_ROTATION_INTERPOLATION rotationInterpolation=ERI_FLERP)
+		{
+			if (!library || !library->getKeyframeStorageBinding().buffer || !library->getTimestampStorageBinding().buffer || !library->getAnimationStorageRange().buffer)
+				return nullptr;
+			return core::smart_refctd_ptr<CCPUAnimationEngine>(new CCPUAnimationEngine(std::move(library),rotationInterpolation),core::dont_grab);
+		}
+
+		//
+		inline const asset::ICPUAnimationLibrary* getAnimationLibrary() const {return m_library.get();}
+		inline E_ROTATION_INTERPOLATION getRotationInterpolation() const {return m_rotationInterpolation;}
+
+		//! Decoded keyframe
+		struct SFatKeyframe
+		{
+			SFatKeyframe() = default;
+			SFatKeyframe(const Keyframe& keyframe) : scale(keyframe.getScale()), rotation(keyframe.getRotation()), translation(keyframe.getTranslation()) {}
+
+			inline core::matrix3x4SIMD constructMatrix() const
+			{
+				core::matrix3x4SIMD retval;
+				retval.setScaleRotationAndTranslation(scale,rotation,translation);
+				return retval;
+			}
+
+			core::vectorSIMDf scale = core::vectorSIMDf(1.f);
+			core::quaternion rotation;
+			core::vectorSIMDf translation = core::vectorSIMDf(0.f);
+		};
+		//! Samples a single animation, `keyframeCursor` is optional and works like `SInstance::keyframeCursors`
+		SFatKeyframe sample(const animation_t animation, const timestamp_t time, uint32_t* keyframeCursor=nullptr) const;
+
+		//
+		struct SInstance
+		{
+			const asset::ICPUSkeleton* skeleton = nullptr;
+			// one per skeleton joint, joints with `invalid_animation` (or all if nullptr) stay in their default transform
+			const animation_t* jointAnimations = nullptr;
+			timestamp_t time = 0u;
+			// Optional, one per skeleton joint, remembers which keyframes got sampled last time.
+			// When the `time` only moves forward a bit between calls this skips the binary search, zero initialize before first use.
+			uint32_t* keyframeCursors = nullptr;
+			// optional, one per skeleton joint, sampled transforms relative to the parent joints
+			core::matrix3x4SIMD* outRelativeTransforms = nullptr;
+			// one per skeleton joint, model space transforms of the joints (not premultiplied by the inverse bind poses)
+			core::matrix3x4SIMD* outJointTransforms = nullptr;
+		};
+		//! Instances are processed in parallel, so they can't share any output or cursor arrays
+		bool sample(const SInstance* begin, const SInstance* end) const;
+
+		//! Linear blend skinning of the position and normal attributes of `meshbuffer`, overwriting them.
+		/** Skinning matrices are `jointTransforms[translationTable[j]]*meshbuffer->getInverseBindPoses()[j]` where `j` is the vertex's joint ID,
+		`translationTable` is the same thing as `asset::CGLTFMetadata::Instance::skinTranslationTable` and nullptr means that the joint IDs are skeleton joint IDs.
+		The weights and joint IDs get interpreted like `IMeshManipulator::calculateBoundingBox` does.
+
+		Since the attributes get overwritten, you need to skin a copy of the bind pose meshbuffer (or restore the attributes) every time you want to pose it again.
+		Normals are optional, the position attribute is not.
+		*/
+		static bool skinMeshBuffer(asset::ICPUMeshBuffer* meshbuffer, const core::matrix3x4SIMD* jointTransforms, const joint_id_t* translationTable=nullptr);
+
+	protected:
+		CCPUAnimationEngine(core::smart_refctd_ptr<const asset::ICPUAnimationLibrary>&& library, const E_ROTATION_INTERPOLATION rotationInterpolation)
+			: m_library(std::move(library)), m_rotationInterpolation(rotationInterpolation) {}
+		~CCPUAnimationEngine() = default;
+
+		core::smart_refctd_ptr<const asset::ICPUAnimationLibrary> m_library;
+		const E_ROTATION_INTERPOLATION m_rotationInterpolation;
+};
+
+} // end namespace nbl::scene
+
+#endif
@@ -0,0 +1,136 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_SCENE_C_CPU_CULLING_LOD_SELECTION_SYSTEM_H_INCLUDED_
+#define _NBL_SCENE_C_CPU_CULLING_LOD_SELECTION_SYSTEM_H_INCLUDED_
+
+#include "nbl/scene/CLevelOfDetailLibrary.h"
+#include "nbl/scene/ICullingLoDSelectionSystem.h"
+
+namespace nbl::scene
+{
+
+//! Host counterpart of `ICullingLoDSelectionSystem`, for iGPUs too weak to spare the compute dispatches and for validating the GPU path
+/** Consumes host copies of the same buffers as the compute shaders (LoD library contents, `InstanceToCull` list, the indirect draw commands)
+and produces the same outputs: draw commands with their instance counts and base instances filled in, per view per instance data and the
+`uvec2(instanceGUID,perViewPerInstanceID)` redirects at `baseInstance+gl_InstanceIndex`.
+
+Like on the GPU, the order of the instances within a single drawcall is unspecified, everything else is deterministic.
+The system keeps scratch memory around between calls, so a single one shouldn't be used from multiple threads at once.
+*/
+class NBL_API2 CCPUCullingLoDSelectionSystem final : public core::IReferenceCounted
+{
+	public:
+		using InstanceToCull = ICullingLoDSelectionSystem::InstanceToCull;
+		using LoDChoiceParams = ILevelOfDetailLibrary::DefaultLoDChoiceParams;
+		using LoDTableInfo = ILevelOfDetailLibrary::LoDTableInfo;
+		using LoDInfo = CLevelOfDetailLibrary<LoDChoiceParams>::LoDInfo;
+
+		static inline constexpr uint32_t invalid_lod = 0xffffffffu;
+
+		static inline core::smart_refctd_ptr<CCPUCullingLoDSelectionSystem> create()
+		{
+			return core::smart_refctd_ptr<CCPUCullingLoDSelectionSystem>(new CCPUCullingLoDSelectionSystem(),core::dont_grab);
+		}
+
+		//! Conservative software occlusion test against a low resolution depth buffer (last frame's depth downsampled, or depth of a few big occluders)
+		class NBL_API2 HiZBuffer
+		{
+			public:
+				//! `depth` is `width*height` NDC depth values, row 0 being at NDC `y=-1` (same as a Vulkan framebuffer)
+				bool build(const float* depth, const uint32_t width, const uint32_t height, const bool reverseZ=false);
+
+				inline uint32_t getWidth() const {return m_mips.empty() ? 0u:m_mips.front().width;}
+				inline uint32_t getHeight() const {return m_mips.empty() ? 0u:m_mips.front().height;}
+				inline uint32_t getMipCount() const {return m_mips.size();}
+				inline bool isReverseZ() const {return m_reverseZ;}
+
+				//! True if the whole box is behind the depth buffer, boxes crossing the near plane or entirely off screen are never occluded
+				/** Boxes crossing the screen edges only get tested against the part of their projected rectangle which is on screen. */
+				bool isOccluded(const core::matrix4SIMD& mvp, const core::vectorSIMDf& aabbMin, const core::vectorSIMDf& aabbMax) const;
+
+			private:
+				// every texel holds the farthest depth of its footprint, negated for reverse Z so that larger is always farther
+				struct SMip
+				{
+					uint32_t width;
+					uint32_t height;
+					core::vector<float> texels;
+				};
+				core::vector<SMip> m_mips;
+				bool m_reverseZ = false;
+		};
+
+		//
+		struct Params
+		{
+			// Host copies of `ILevelOfDetailLibrary::getLodTableInfoBinding()` and `getLoDInfoBinding()` contents of a `CLevelOfDetailLibrary<DefaultLoDChoiceParams>`,
+			// `InstanceToCull::lodTableUvec4Offset` and the level offsets in the tables index into these in the same units as in GLSL.
+			const void* lodTables = nullptr;
+			const void* lodInfos = nullptr;
+			core::SRange<const InstanceToCull> instanceList = {nullptr,nullptr};
+			// indexed with `InstanceToCull::instanceGUID`, for example `CCPUTransformTree::getGlobalTransforms()` if the GUIDs are nodes
+			const core::matrix3x4SIMD* instanceTransforms = nullptr;
+			core::matrix4SIMD viewProj;
+			core::vectorSIMDf cameraPosition;
+			// `LoDChoiceParams::getFoVDilationFactor` of the projection, leave at 1 for non-perspective projections
+			float fovDilationFactor = 1.f;
+			// optional, without it only frustum culling and LoD selection happen
+			const HiZBuffer* occluders = nullptr;
+			// Same as the GPU's `drawcallsToScan`, DWORD offsets of every drawcall the LoD library can reference (MSB set for non-indexed draws).
+			// Their instance counts and base instances are the only DWORDs of `drawCommands` which get written.
+			core::SRange<const uint32_t> drawcallsToScan = {nullptr,nullptr};
+			// host copy of the `IDrawIndirectAllocator::getDrawCommandMemoryBlock()` contents
+			uint32_t* drawCommands = nullptr;
+			// one per instance which passes culling, at most `instanceList.size()`
+			core::matrix4SIMD* outPerViewPerInstanceMVPs = nullptr;
+			// optional, `uvec2(instanceGUID,lodInfoUvec2Offset)` per instance which passes culling, same as the GPU's `pvsInstances`
+			InstanceToCull* outPotentiallyVisibleInstances = nullptr;
+			// `uvec2(instanceGUID,perViewPerInstanceID)` per drawn instance
+			uint32_t (*outPerInstanceRedirectAttribs)[2] = nullptr;
+			uint32_t perInstanceRedirectAttribCapacity = 0u;
+		};
+		struct Counts
+		{
+			uint32_t potentiallyVisibleInstances = 0u;
+			uint32_t drawInstances = 0u;
+		};
+		//! Returns false if the params are invalid or the draw instances didn't fit in the redirect buffer, in which case the instance counts get zeroed.
+		/** The LoD levels of a table must be stored in the order `CLevelOfDetailLibrary::LoDInfo::isValid` demands, coarsest first.
+		The chosen level is the first one whose `distanceSqAtReferenceFoV` (times `fovDilationFactor`) the instance is at least as far as,
+		with the distance measured to the table's AABB center and divided by the transform's largest axis scale (so `DefaultLoDChoiceParams::fromGeometricError` works with object space errors).
+		If the instance is closer than the threshold of the last level, it's culled just like when the GPU's `chooseLoD` returns `0xffffffff`.
+		*/
+		bool processInstancesAndFillIndirectDraws(const Params& params, Counts& outCounts);
+
+	protected:
+		CCPUCullingLoDSelectionSystem() = default;
+		~CCPUCullingLoDSelectionSystem() = default;
+
+		struct SPotentiallyVisibleInstance
+		{
+			core::matrix4SIMD mvp;
+			uint32_t instanceGUID;
+			uint32_t lodInfoUvec2Offset;
+		};
+		struct SPotentiallyVisibleInstanceDraw
+		{
+			uint32_t perViewPerInstanceID;
+			uint32_t drawBaseInstanceDWORDOffset;
+			uint32_t instanceID;
+		};
+		struct SChunk
+		{
+			uint32_t begin;
+			uint32_t end;
+			uint32_t firstPerViewPerInstanceID;
+			core::vector<SPotentiallyVisibleInstance> instances;
+			core::vector<SPotentiallyVisibleInstanceDraw> draws;
+		};
+		core::vector<SChunk> m_chunks;
+};
+
+} // end namespace nbl::scene
+
+#endif
@@ -0,0 +1,120 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_SCENE_C_CPU_TRANSFORM_TREE_H_INCLUDED_
+#define _NBL_SCENE_C_CPU_TRANSFORM_TREE_H_INCLUDED_
+
+#include "nbl/scene/ITransformTree.h"
+
+namespace nbl::scene
+{
+
+//! Host counterpart of `ITransformTree` for headless simulation, the node properties live in SoA arrays in system memory instead of a `video::CPropertyPool`
+/** Node handles, timestamps and the meaning of every property are the same as in the GPU tree, use `CCPUTransformTreeManager` to update it.
+Like a non-contiguous property pool, nodes can be allocated and freed from multiple threads at once (but not `clearNodes`).
+*/
+class CCPUTransformTree final : public core::IReferenceCounted
+{
+	public:
+		using node_t = ITransformTree::node_t;
+		using timestamp_t = ITransformTree::timestamp_t;
+		using parent_t = ITransformTree::parent_t;
+		using relative_transform_t = ITransformTree::relative_transform_t;
+		using modified_stamp_t = ITransformTree::modified_stamp_t;
+		using global_transform_t = ITransformTree::global_transform_t;
+		using recomputed_stamp_t = ITransformTree::recomputed_stamp_t;
+		using normal_matrix_t = ITransformTreeWithNormalMatrices::normal_matrix_t;
+		using NodeAddressAllocator = video::IPropertyPool::PropertyAddressAllocator;
+
+		static inline constexpr node_t invalid_node = ITransformTree::invalid_node;
+
+		//
+		static inline core::smart_refctd_ptr<CCPUTransformTree> create(const uint32_t capacity, const bool normalMatrices=false)
+		{
+			if (capacity==0u || capacity==invalid_node)
+				return nullptr;
+			auto* ttRaw = new CCPUTransformTree(capacity,normalMatrices);
+			return core::smart_refctd_ptr<CCPUTransformTree>(ttRaw,core::dont_grab);
+		}
+
+		//
+		inline bool hasNormalMatrices() const {return !m_normalMatrices.empty();}
+
+		//
+		inline uint32_t getCapacity() const {return m_parents.size();}
+		inline uint32_t getAllocated() const {return m_nodeAllocator.get_allocated_size();}
+		inline uint32_t getFree() const {return m_nodeAllocator.get_free_size();}
+
+		// nodes array must be initialized with invalid_node, properties of the new nodes are left undefined (use `CCPUTransformTreeManager::addNodes` to initialize them)
+		[[nodiscard]] inline bool allocateNodes(const core::SRange<node_t>& outNodes)
+		{
+			// nodes which are already allocated don't need any space
+			if (std::count(outNodes.begin(),outNodes.end(),invalid_node)>getFree())
+				return false;
+
+			constexpr uint32_t unit = 1u;
+			for (auto& node : outNodes)
+			{
+				if (node!=invalid_node)
+					continue;
+				node = m_nodeAllocator.alloc_addr(unit,unit);
+				if (node==invalid_node)
+					return false;
+			}
+			return true;
+		}
+
+		// This removes all nodes in the hierarchy, if you want to remove individual nodes, use `CCPUTransformTreeManager::removeNodes`
+		inline void clearNodes()
+		{
+			m_nodeAllocator.reset();
+		}
+
+		// the property arrays are indexed with `node_t`
+		inline const parent_t* getParents() const {return m_parents.data();}
+		inline const relative_transform_t* getRelativeTransforms() const {return m_relativeTransforms.data();}
+		inline const modified_stamp_t* getModifiedTimestamps() const {return m_modifiedStamps.data();}
+		inline const global_transform_t* getGlobalTransforms() const {return m_globalTransforms.data();}
+		inline const recomputed_stamp_t* getRecomputedTimestamps() const {return m_recomputedStamps.data();}
+		//! nullptr if the tree was created without normal matrices
+		inline const normal_matrix_t* getNormalMatrices() const {return hasNormalMatrices() ? m_normalMatrices.data():nullptr;}
+
+		// Parents can be changed directly, unlike the GPU tree there's nothing to transfer.
+		// Don't forget to bump the node's modified timestamp (with an update request) so the global transform gets recomputed.
+		inline parent_t* getParents() {return m_parents.data();}
+
+	protected:
+		CCPUTransformTree(const uint32_t capacity, const bool normalMatrices) :
+			m_reserved(_NBL_ALIGNED_MALLOC(NodeAddressAllocator::reserved_size(1u,capacity,1u),_NBL_SIMD_ALIGNMENT)),
+			m_nodeAllocator(m_reserved,0u,0u,1u,capacity,1u),
+			m_parents(capacity,invalid_node), m_relativeTransforms(capacity), m_modifiedStamps(capacity,ITransformTree::initial_modified_timestamp),
+			m_globalTransforms(capacity), m_recomputedStamps(capacity,ITransformTree::initial_recomputed_timestamp),
+			m_normalMatrices(normalMatrices ? capacity:0u), m_recomputeClaims(std::make_unique<std::atomic<uint32_t>[]>(capacity))
+		{
+			for (uint32_t i=0u; i<capacity; i++)
+				m_recomputeClaims[i].store(0u,std::memory_order_relaxed);
+		}
+		~CCPUTransformTree()
+		{
+			_NBL_ALIGNED_FREE(m_reserved);
+		}
+
+		friend class CCPUTransformTreeManager;
+
+		void* const m_reserved;
+		NodeAddressAllocator m_nodeAllocator;
+		core::vector<parent_t> m_parents;
+		core::vector<relative_transform_t> m_relativeTransforms;
+		core::vector<modified_stamp_t> m_modifiedStamps;
+		core::vector<global_transform_t> m_globalTransforms;
+		core::vector<recomputed_stamp_t> m_recomputedStamps;
+		core::vector<normal_matrix_t> m_normalMatrices;
+		// scratch for the global transform recompute, so every stale node lands in exactly one batch
+		std::unique_ptr<std::atomic<uint32_t>[]> m_recomputeClaims;
+		uint32_t m_recomputeEpoch = 0u;
+};
+
+} // end namespace nbl::scene
+
+#endif
@@ -0,0 +1,90 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_SCENE_C_CPU_TRANSFORM_TREE_MANAGER_H_INCLUDED_
+#define _NBL_SCENE_C_CPU_TRANSFORM_TREE_MANAGER_H_INCLUDED_
+
+#include "nbl/scene/ITransformTreeManager.h"
+#include "nbl/scene/CCPUTransformTree.h"
+
+namespace nbl::scene
+{
+
+//! Host counterpart of `ITransformTreeManager`, takes the same modification requests and produces the same properties as the compute shaders
+/** Relative transform updates run in parallel over the request ranges.
+Global transforms get recomputed level by level, every stale node on the path from a requested node to its root is gathered into
+a batch for its depth, then all batches of a level are processed in parallel (so the parent's global transform is always final when read).
+
+The manager keeps scratch memory around between calls, so a single manager shouldn't be used from multiple threads at once.
+*/
+class NBL_API2 CCPUTransformTreeManager final : public core::IReferenceCounted
+{
+	public:
+		using node_t = CCPUTransformTree::node_t;
+		using RelativeTransformModificationRequest = ITransformTreeManager::RelativeTransformModificationRequest;
+		using ModificationRequestRange = ITransformTreeManager::ModificationRequestRange;
+
+		static inline core::smart_refctd_ptr<CCPUTransformTreeManager> create()
+		{
+			return core::smart_refctd_ptr<CCPUTransformTreeManager>(new CCPUTransformTreeManager(),core::dont_grab);
+		}
+
+		//
+		struct AdditionRequest
+		{
+			CCPUTransformTree* tree = nullptr;
+			// if the `outNodes` have values not equal to `invalid_node` then we treat them as already allocated
+			core::SRange<node_t> outNodes = {nullptr,nullptr};
+			// if nullptr we set these properties to defaults (no parent and identity transform), otherwise need to be same length as `outNodes`
+			const CCPUTransformTree::parent_t* parents = nullptr;
+			const CCPUTransformTree::relative_transform_t* relativeTransforms = nullptr;
+		};
+		bool addNodes(const AdditionRequest& request);
+
+		//
+		inline void removeNodes(CCPUTransformTree* tree, const node_t* begin, const node_t* end)
+		{
+			constexpr uint32_t unit = 1u;
+			for (auto it=begin; it!=end; it++)
+			if (*it!=CCPUTransformTree::invalid_node)
+				tree->m_nodeAllocator.free_addr(*it,unit);
+		}
+
+		// Same semantics as `ITransformTreeManager::updateLocalTransforms`, a node can only be the target of one range per call,
+		// `ModificationRequestRange::requestsBegin` and `requestsEnd` index into `requests`.
+		void updateLocalTransforms(CCPUTransformTree* tree, const ModificationRequestRange* rangesBegin, const ModificationRequestRange* rangesEnd, const RelativeTransformModificationRequest* requests);
+
+		// Same semantics as `ITransformTreeManager::recomputeGlobalTransforms`, the ancestors of the nodes get recomputed too if their timestamps are stale
+		void recomputeGlobalTransforms(CCPUTransformTree* tree, const node_t* nodesBegin, const node_t* nodesEnd);
+
+		//
+		inline void updateLocalAndRecomputeGlobalTransforms(
+			CCPUTransformTree* tree, const ModificationRequestRange* rangesBegin, const ModificationRequestRange* rangesEnd,
+			const RelativeTransformModificationRequest* requests, const node_t* nodesBegin, const node_t* nodesEnd
+		)
+		{
+			updateLocalTransforms(tree,rangesBegin,rangesEnd,requests);
+			recomputeGlobalTransforms(tree,nodesBegin,nodesEnd);
+		}
+
+		//! Same encoding as `nbl_glsl_CompressedNormalMatrix_t_encode` of the sub 3x3 transpose cofactors
+		static CCPUTransformTree::normal_matrix_t encodeNormalMatrix(const CCPUTransformTree::global_transform_t& globalTransform);
+
+	protected:
+		CCPUTransformTreeManager() = default;
+		~CCPUTransformTreeManager() = default;
+
+		// every batch gathers the stale nodes reachable from a slice of the requested nodes, grouped by their depth in the tree
+		struct SRecomputeBatch
+		{
+			const node_t* begin;
+			const node_t* end;
+			core::vector<core::vector<node_t>> levels;
+		};
+		core::vector<SRecomputeBatch> m_recomputeBatches;
+};
+
+} // end namespace nbl::scene
+
+#endif
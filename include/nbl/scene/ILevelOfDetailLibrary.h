@@ -26,6 +26,14 @@ class ILevelOfDetailLibrary : public virtual core::IReferenceCounted
 				return distanceSqAtReferenceFoV<other.distanceSqAtReferenceFoV;
 			}
 
+			//! Distance past which a LoD deviating from the full detail mesh by `objectSpaceError` (see `asset::IMeshManipulator::createLoDChain`)
+			//! projects to at most `maxProjectedError` NDC units, at the reference FoV (where `getFoVDilationFactor` is 1)
+			static inline DefaultLoDChoiceParams fromGeometricError(const float objectSpaceError, const float maxProjectedError)
+			{
+				const float distance = objectSpaceError/maxProjectedError;
+				return {distance*distance};
+			}
+
 			static inline float getFoVDilationFactor(const core::matrix4SIMD& proj)
 			{
 				if (proj.rows[3].w!=0.f)
@@ -108,6 +116,10 @@ class ILevelOfDetailLibrary : public virtual core::IReferenceCounted
 				DrawcallInfo(const uint32_t _drawcallDWORDOffset, const core::aabbox3df& _aabb)
 					: aabb(_aabb), drawcallDWORDOffset(_drawcallDWORDOffset) {}
 
+				inline const core::CompressedAABB& getAABB() const {return aabb;}
+				// MSB is set for non-indexed draws (the base instance is one DWORD earlier in the command)
+				inline uint32_t getDrawcallDWORDOffset() const {return drawcallDWORDOffset;}
+
 			private:
 				core::CompressedAABB aabb;
 				uint32_t drawcallDWORDOffset; // only really need 27 bits for this
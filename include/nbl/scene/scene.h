@@ -8,8 +8,11 @@
 //
 #include "nbl/scene/CLevelOfDetailLibrary.h"
 #include "nbl/scene/ITransformTreeManager.h"
+#include "nbl/scene/CCPUTransformTreeManager.h"
+#include "nbl/scene/CCPUAnimationEngine.h"
 
 #include "nbl/scene/ICullingLoDSelectionSystem.h"
+#include "nbl/scene/CCPUCullingLoDSelectionSystem.h"
 
 #if 0 // not buildable on criss/vulkan branch
 //
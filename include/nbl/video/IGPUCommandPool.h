@@ -308,7 +308,7 @@ private:
             {
                 auto nextSegment = segment->getNext();
                 segment->~CCommandSegment();
-                m_pool.deallocate(segment, COMMAND_SEGMENT_SIZE);
+                recycle(segment);
                 segment = nextSegment;
             }
         }
@@ -328,9 +328,25 @@ private:
         }
 
     private:
+        // Segments of deleted lists are kept for reuse instead of going back to `m_pool`, which would free a whole block as soon as it empties out
+        // (so on every pool reset) only to allocate it again on the next frame. The pool is externally synchronized, so the list needs no atomics.
+        inline void recycle(CCommandSegment* segment)
+        {
+            *reinterpret_cast<CCommandSegment**>(segment) = m_freeSegments;
+            m_freeSegments = segment;
+        }
+
         inline bool appendToList(SCommandSegmentList& list)
         {
-            auto segment = m_pool.emplace<CCommandSegment>(list.tail);
+            CCommandSegment* segment;
+            if (m_freeSegments)
+            {
+                void* mem = m_freeSegments;
+                m_freeSegments = *reinterpret_cast<CCommandSegment**>(mem);
+                segment = new (mem) CCommandSegment(list.tail);
+            }
+            else
+                segment = m_pool.emplace<CCommandSegment>(list.tail);
             if (!segment)
             {
                 assert(false);
@@ -351,6 +367,8 @@ private:
         }
 
         CCommandSegment* m_head = nullptr;
+        // destroyed segments, linked through their first bytes
+        CCommandSegment* m_freeSegments = nullptr;
         
         template <typename T>
         using pool_alignment = core::aligned_allocator<T,COMMAND_SEGMENT_ALIGNMENT>;
@@ -27,6 +27,9 @@ class IGPUQueue : public core::Interface, public core::Unmovable
             IGPUSemaphore*const * pSignalSemaphores = nullptr;
             uint32_t commandBufferCount = 0u;
             IGPUCommandBuffer*const * commandBuffers = nullptr;
+            // needed if any of the semaphores are timeline semaphores, one per semaphore (the value is ignored for binary ones)
+            const uint64_t* pWaitValues = nullptr;
+            const uint64_t* pSignalValues = nullptr;
 
             inline bool isValid() const
             {
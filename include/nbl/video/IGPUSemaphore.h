@@ -12,16 +12,191 @@ namespace nbl::video
 
 class IGPUSemaphore : public core::IReferenceCounted, public IBackendObject
 {
+    public:
+        enum E_TYPE : uint8_t
+        {
+            ET_BINARY,
+            // needs `SPhysicalDeviceFeatures::timelineSemaphore`
+            ET_TIMELINE
+        };
+        enum E_STATUS
+        {
+            ES_SUCCESS,
+            ES_TIMEOUT,
+            ES_ERROR
+        };
+
+        //! For timeline semaphores, a point on the timeline to wait for or signal
+        struct SWaitInfo
+        {
+            IGPUSemaphore* semaphore = nullptr;
+            uint64_t value = 0ull;
+        };
+
+        inline E_TYPE getType() const {return m_type;}
+
     protected:
-        IGPUSemaphore(core::smart_refctd_ptr<const ILogicalDevice>&& dev) : IBackendObject(std::move(dev)) {}
+        IGPUSemaphore(core::smart_refctd_ptr<const ILogicalDevice>&& dev, const E_TYPE type=ET_BINARY) : IBackendObject(std::move(dev)), m_type(type) {}
 
         virtual ~IGPUSemaphore() = default;
 
         // OpenGL: core::smart_refctd_ptr<COpenGLSync>*
         // Vulkan: const VkSemaphore*
         virtual void* getNativeHandle() = 0;
+
+        const E_TYPE m_type;
+};
+
+
+class NBL_API2 GPUTimelineEventHandlerBase
+{
+    protected:
+        // errors (device loss) report as success and the counter as ~0ull, same as `GPUEventWrapper` does, so everything gets retired
+        static IGPUSemaphore::E_STATUS waitForValue(IGPUSemaphore* semaphore, uint64_t value, uint64_t timeout);
+        static uint64_t getCounterValue(IGPUSemaphore* semaphore);
+};
+
+//! Equivalent of `GPUDeferredEventHandlerST` for events which are points on timeline semaphores
+/**
+Events are kept sorted by value per semaphore, so retiring any number of them costs a single counter query,
+and no fence objects need to be created or reset. The `Functor` needs the same interface as for `GPUDeferredEventHandlerST`.
+*/
+template<class Functor>
+class GPUTimelineDeferredEventHandlerST : protected GPUTimelineEventHandlerBase
+{
+    public:
+        using functor_t = Functor;
+
+        GPUTimelineDeferredEventHandlerST() = default;
+        GPUTimelineDeferredEventHandlerST(const GPUTimelineDeferredEventHandlerST&) = delete;
+        GPUTimelineDeferredEventHandlerST(GPUTimelineDeferredEventHandlerST&& other) : GPUTimelineDeferredEventHandlerST()
+        {
+            operator=(std::move(other));
+        }
+        ~GPUTimelineDeferredEventHandlerST()
+        {
+            for (auto& timeline : m_timelines)
+            if (!timeline.events.empty())
+            {
+                while (waitForValue(timeline.semaphore.get(),timeline.events.back().value,999999999ull)==IGPUSemaphore::ES_TIMEOUT) {}
+                for (auto& event : timeline.events)
+                    event.functor();
+            }
+        }
+
+        GPUTimelineDeferredEventHandlerST& operator=(const GPUTimelineDeferredEventHandlerST&) = delete;
+        inline GPUTimelineDeferredEventHandlerST& operator=(GPUTimelineDeferredEventHandlerST&& other)
+        {
+            std::swap(m_eventsCount,other.m_eventsCount);
+            std::swap(m_timelines,other.m_timelines);
+            return *this;
+        }
+
+        inline uint32_t getEventCount() const {return m_eventsCount;}
+
+        //! `_signal.semaphore` must be a timeline semaphore
+        inline void addEvent(const IGPUSemaphore::SWaitInfo& _signal, functor_t&& functor)
+        {
+            assert(_signal.semaphore && _signal.semaphore->getType()==IGPUSemaphore::ET_TIMELINE);
+            auto found = std::find_if(m_timelines.begin(),m_timelines.end(),[&_signal](const STimeline& timeline)->bool{return timeline.semaphore.get()==_signal.semaphore;});
+            if (found==m_timelines.end())
+            {
+                m_timelines.push_back({core::smart_refctd_ptr<IGPUSemaphore>(_signal.semaphore),{}});
+                found = std::prev(m_timelines.end());
+            }
+            auto& events = found->events;
+            // values usually only ever go up, so this is an append
+            auto where = events.end();
+            if (!events.empty() && events.back().value>_signal.value)
+                where = std::upper_bound(events.begin(),events.end(),_signal.value,[](const uint64_t value, const SEvent& event)->bool{return value<event.value;});
+            events.insert(where,SEvent{_signal.value,std::move(functor)});
+            m_eventsCount++;
+        }
+
+        template<typename... Args>
+        inline uint32_t pollForReadyEvents(Args&... args)
+        {
+            for (auto& timeline : m_timelines)
+            if (!timeline.events.empty() && retire(timeline,getCounterValue(timeline.semaphore.get()),args...))
+                break;
+            return m_eventsCount;
+        }
+
+        template<class Clock, class Duration=typename Clock::duration, typename... Args>
+        inline uint32_t waitUntilForReadyEvents(const std::chrono::time_point<Clock,Duration>& timeout_time, Args&... args)
+        {
+            while (m_eventsCount)
+            {
+                for (auto& timeline : m_timelines)
+                {
+                    if (timeline.events.empty())
+                        continue;
+                    // the oldest event is the most likely to signal first, no point waiting for more
+                    const auto currentTime = Clock::now();
+                    uint64_t nanosecondsLeft = 0ull;
+                    if (currentTime<timeout_time)
+                        nanosecondsLeft = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout_time-currentTime).count();
+                    waitForValue(timeline.semaphore.get(),timeline.events.front().value,nanosecondsLeft/m_timelines.size());
+                    if (retire(timeline,getCounterValue(timeline.semaphore.get()),args...))
+                        return m_eventsCount;
+                }
+                if (Clock::now()>=timeout_time)
+                    break;
+            }
+            return m_eventsCount;
+        }
+
+        //! Will try to retire enough events so that the number of events left is less or equal to maxEventCount
+        inline uint32_t cullEvents(uint32_t maxEventCount)
+        {
+            for (auto& timeline : m_timelines)
+            {
+                if (m_eventsCount<=maxEventCount)
+                    break;
+                if (timeline.events.empty())
+                    continue;
+                const uint64_t counter = getCounterValue(timeline.semaphore.get());
+                while (m_eventsCount>maxEventCount && !timeline.events.empty() && timeline.events.front().value<=counter)
+                    popFront(timeline).functor();
+            }
+            return m_eventsCount;
+        }
+
+    private:
+        struct SEvent
+        {
+            uint64_t value;
+            functor_t functor;
+        };
+        struct STimeline
+        {
+            core::smart_refctd_ptr<IGPUSemaphore> semaphore;
+            core::deque<SEvent> events;
+        };
+
+        inline SEvent popFront(STimeline& timeline)
+        {
+            SEvent retval = std::move(timeline.events.front());
+            timeline.events.pop_front();
+            m_eventsCount--;
+            return retval;
+        }
+
+        // returns whether the functor asked to quit early
+        template<typename... Args>
+        inline bool retire(STimeline& timeline, const uint64_t counter, Args&... args)
+        {
+            while (!timeline.events.empty() && timeline.events.front().value<=counter)
+            if (popFront(timeline).functor(args...))
+                return true;
+            return false;
+        }
+
+        uint32_t m_eventsCount = 0u;
+        // there's rarely more than one timeline per queue in use, deque because `STimeline` is move-only
+        core::deque<STimeline> m_timelines;
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -106,6 +106,35 @@ class NBL_API2 ILogicalDevice : public core::IReferenceCounted, public IDeviceMe
 
         virtual core::smart_refctd_ptr<IGPUSemaphore> createSemaphore() = 0;
 
+        //! Needs `SPhysicalDeviceFeatures::timelineSemaphore` enabled
+        inline core::smart_refctd_ptr<IGPUSemaphore> createTimelineSemaphore(const uint64_t initialValue=0ull)
+        {
+            if (!m_enabledFeatures.timelineSemaphore)
+                return nullptr;
+            return createTimelineSemaphore_impl(initialValue);
+        }
+        //! All the semaphores here must be timeline semaphores
+        inline bool getSemaphoreCounterValue(const IGPUSemaphore* _semaphore, uint64_t& _outValue)
+        {
+            if (!_semaphore || _semaphore->getType()!=IGPUSemaphore::ET_TIMELINE || !_semaphore->wasCreatedBy(this))
+                return false;
+            return getSemaphoreCounterValue_impl(_semaphore,_outValue);
+        }
+        inline IGPUSemaphore::E_STATUS waitSemaphores(uint32_t _count, const IGPUSemaphore::SWaitInfo* _infos, bool _waitAll, uint64_t _timeout)
+        {
+            for (uint32_t i=0u; i<_count; i++)
+            if (!_infos[i].semaphore || _infos[i].semaphore->getType()!=IGPUSemaphore::ET_TIMELINE || !_infos[i].semaphore->wasCreatedBy(this))
+                return IGPUSemaphore::ES_ERROR;
+            return waitSemaphores_impl(_count,_infos,_waitAll,_timeout);
+        }
+        //! Host side signal, `_signal.value` must be larger than the current counter value and any pending signal operation
+        inline bool signalSemaphore(const IGPUSemaphore::SWaitInfo& _signal)
+        {
+            if (!_signal.semaphore || _signal.semaphore->getType()!=IGPUSemaphore::ET_TIMELINE || !_signal.semaphore->wasCreatedBy(this))
+                return false;
+            return signalSemaphore_impl(_signal);
+        }
+
         virtual core::smart_refctd_ptr<IGPUEvent> createEvent(IGPUEvent::E_CREATE_FLAGS flags) = 0;
         virtual IGPUEvent::E_STATUS getEventStatus(const IGPUEvent* _event) = 0;
         virtual IGPUEvent::E_STATUS resetEvent(IGPUEvent* _event) = 0;
@@ -515,6 +544,10 @@ class NBL_API2 ILogicalDevice : public core::IReferenceCounted, public IDeviceMe
             post_mapMemory(memory, nullptr, { 0,0 }, IDeviceMemoryAllocation::EMCAF_NO_MAPPING_ACCESS);
         }
 
+        virtual core::smart_refctd_ptr<IGPUSemaphore> createTimelineSemaphore_impl(const uint64_t initialValue) = 0;
+        virtual bool getSemaphoreCounterValue_impl(const IGPUSemaphore* _semaphore, uint64_t& _outValue) = 0;
+        virtual IGPUSemaphore::E_STATUS waitSemaphores_impl(uint32_t _count, const IGPUSemaphore::SWaitInfo* _infos, bool _waitAll, uint64_t _timeout) = 0;
+        virtual bool signalSemaphore_impl(const IGPUSemaphore::SWaitInfo& _signal) = 0;
         virtual bool createCommandBuffers_impl(IGPUCommandPool* _cmdPool, IGPUCommandBuffer::E_LEVEL _level, uint32_t _count, core::smart_refctd_ptr<IGPUCommandBuffer>* _outCmdBufs) = 0;
         virtual bool freeCommandBuffers_impl(IGPUCommandBuffer** _cmdbufs, uint32_t _count) = 0;
         virtual core::smart_refctd_ptr<IGPUFramebuffer> createFramebuffer_impl(IGPUFramebuffer::SCreationParams&& params) = 0;
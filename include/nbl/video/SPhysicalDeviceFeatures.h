@@ -180,7 +180,7 @@ struct SPhysicalDeviceFeatures
     
     bool separateDepthStencilLayouts = false;   // or VK_KHR_separate_depth_stencil_layouts
     
-    //bool           timelineSemaphore;             // or VK_KHR_timeline_semaphore // [FUTURE TODO] won't expose for a long time
+    bool timelineSemaphore = false;             // or VK_KHR_timeline_semaphore
     
     // or VK_KHR_buffer_device_address:
     bool bufferDeviceAddress = false;
@@ -1079,6 +1079,7 @@ struct SPhysicalDeviceFeatures
         if (uniformBufferStandardLayout && !_rhs.uniformBufferStandardLayout) return false;
         if (shaderSubgroupExtendedTypes && !_rhs.shaderSubgroupExtendedTypes) return false;
         if (separateDepthStencilLayouts && !_rhs.separateDepthStencilLayouts) return false;
+        if (timelineSemaphore && !_rhs.timelineSemaphore) return false;
         if (bufferDeviceAddress && !_rhs.bufferDeviceAddress) return false;
         if (bufferDeviceAddressMultiDevice && !_rhs.bufferDeviceAddressMultiDevice) return false;
         if (vulkanMemoryModel && !_rhs.vulkanMemoryModel) return false;
@@ -216,6 +216,9 @@ struct SPhysicalDeviceLimits
     bool filterMinmaxSingleComponentFormats = false;
     bool filterMinmaxImageComponentMapping = false;
 
+    //      or VK_KHR_timeline_semaphore:
+    uint64_t maxTimelineSemaphoreValueDifference = 0ull;
+
     /* Vulkan 1.3 Core  */
     
     //      or VK_EXT_subgroup_size_control:
@@ -407,7 +410,6 @@ struct SPhysicalDeviceLimits
     //int64_t            renderMajor;
     //int64_t            renderMinor;
 
-    // [DO NOT EXPOSE] we don't expose or want timeline semaphore currently
     /* TimelineSemaphorePropertiesKHR *//* VK_KHR_timeline_semaphore *//* MOVED TO Vulkan 1.2 Core  */
 
     // [DO NOT EXPOSE] we will never expose provoking vertex control, we will always set the provoking vertex to the LAST (vulkan default) convention also because of never exposing Xform Feedback, we'll never expose this as well
@@ -783,6 +785,7 @@ struct SPhysicalDeviceLimits
         if (maxDescriptorSetUpdateAfterBindInputAttachments > _rhs.maxDescriptorSetUpdateAfterBindInputAttachments) return false;
         if (filterMinmaxSingleComponentFormats && !_rhs.filterMinmaxSingleComponentFormats) return false;
         if (filterMinmaxImageComponentMapping && !_rhs.filterMinmaxImageComponentMapping) return false;
+        if (maxTimelineSemaphoreValueDifference > _rhs.maxTimelineSemaphoreValueDifference) return false;
         
         if (minSubgroupSize < _rhs.minSubgroupSize || maxSubgroupSize > _rhs.maxSubgroupSize) return false;
 
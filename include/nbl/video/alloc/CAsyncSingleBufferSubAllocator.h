@@ -10,6 +10,7 @@
 
 #include "nbl/video/alloc/CSingleBufferSubAllocator.h"
 #include "nbl/video/IGPUFence.h"
+#include "nbl/video/IGPUSemaphore.h"
 
 namespace nbl::video
 {
@@ -141,6 +142,7 @@ class CAsyncSingleBufferSubAllocator
             assert(tLock.owns_lock());
             #endif // _NBL_DEBUG
             deferredFrees.cullEvents(0u);
+            timelineDeferredFrees.cullEvents(0u);
         }
 
         //! Returns max possible currently allocatable single allocation size, without having to wait for GPU more
@@ -152,7 +154,10 @@ class CAsyncSingleBufferSubAllocator
             #endif // _NBL_DEBUG
             size_type valueToStopAt = getAddressAllocator().min_size()*3u; // padding, allocation, more padding = 3u
             // we don't actually want or need to poll all possible blocks to free, only first few
-            deferredFrees.pollForReadyEvents(valueToStopAt);
+            // timeline frees first, because they retire in batches off a single counter query
+            timelineDeferredFrees.pollForReadyEvents(valueToStopAt);
+            if (valueToStopAt)
+                deferredFrees.pollForReadyEvents(valueToStopAt);
             return getAddressAllocator().max_size();
         }
 
@@ -161,7 +166,7 @@ class CAsyncSingleBufferSubAllocator
         template<typename... Args>
         inline size_type multi_allocate(uint32_t count, Args&&... args) noexcept
         {
-            return multi_alloc(GPUEventWrapper::default_wait(),count,std::forward<Args>(args)...);
+            return multi_allocate(GPUEventWrapper::default_wait(),count,std::forward<Args>(args)...);
         }
         //! attempt to allocate, if fail (presumably because of fragmentation), then keep trying till timeout is reached
         template<class Clock=typename std::chrono::steady_clock, typename... Args>
@@ -180,7 +185,9 @@ class CAsyncSingleBufferSubAllocator
             // then try to wait at least once and allocate
             do
             {
-                deferredFrees.waitUntilForReadyEvents(maxWaitPoint,unallocatedSize);
+                timelineDeferredFrees.waitUntilForReadyEvents(maxWaitPoint,unallocatedSize);
+                if (unallocatedSize)
+                    deferredFrees.waitUntilForReadyEvents(maxWaitPoint,unallocatedSize);
 
                 unallocatedSize = try_multi_alloc(args...);
                 if (!unallocatedSize)
@@ -216,10 +223,28 @@ class CAsyncSingleBufferSubAllocator
             else
                 multi_deallocate(count,addr,bytes);
         }
+        //! Frees once `signal.semaphore` (a timeline semaphore) reaches `signal.value`, without needing a fence per submit
+        inline void multi_deallocate(const IGPUSemaphore::SWaitInfo& signal, DeferredFreeFunctor&& functor) noexcept
+        {
+            #ifdef _NBL_DEBUG
+            std::unique_lock<std::recursive_mutex> tLock(stAccessVerfier,std::try_to_lock_t());
+            assert(tLock.owns_lock());
+            #endif // _NBL_DEBUG
+            timelineDeferredFrees.addEvent(signal,std::move(functor));
+        }
+        template<typename T=core::IReferenceCounted>
+        inline void multi_deallocate(uint32_t count, const value_type* addr, const size_type* bytes, const IGPUSemaphore::SWaitInfo& signal, const T*const *const objectsToDrop=nullptr) noexcept
+        {
+            if (signal.semaphore)
+                multi_deallocate(signal,DeferredFreeFunctor(&m_composed,count,addr,bytes,objectsToDrop));
+            else
+                multi_deallocate(count,addr,bytes);
+        }
 
     protected:
         Composed m_composed;
         GPUDeferredEventHandlerST<DeferredFreeFunctor> deferredFrees;
+        GPUTimelineDeferredEventHandlerST<DeferredFreeFunctor> timelineDeferredFrees;
 
         template<typename... Args>
         inline value_type try_multi_alloc(uint32_t count, value_type* outAddresses, const size_type* byteSizes, const Args&... args) noexcept
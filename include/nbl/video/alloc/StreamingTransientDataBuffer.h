@@ -8,6 +8,7 @@
 #include "nbl/core/declarations.h"
 
 #include <cstring>
+#include <atomic>
 
 #include "nbl/video/alloc/CAsyncSingleBufferSubAllocator.h"
 
@@ -207,6 +208,169 @@ class StreamingTransientDataBufferMT : public core::IReferenceCounted
 };
 
 
+//! Lock-free alternative to `StreamingTransientDataBufferMT` for many threads staging data at once
+/**
+The buffer is a ring managed by a `core::EpochRingAddressAllocatorLF`, threads reserve chunks of it with a single CAS and then bump-allocate from their chunk without any atomics.
+There's no per-allocation free, instead allocations get reclaimed in batches (epochs) tied to submissions:
+every allocation of the epoch closed by `retire(value)` gets reused once the timeline semaphore passed at creation reaches `value`.
+
+Rules of use:
+- `retire` must be externally synchronized (call it from the thread which submits)
+- producers running concurrently with `retire` must hold a `pin` from before allocating until they've handed the allocations over to the submitting thread,
+  the submitting thread first calls `retire(value)` (which waits for the pins) and only then gathers what was handed over and submits it signalling `value`
+- a pinned thread can't wait for space (a `multi_allocate` while pinned doesn't wait, it's up to you to `unpin` and retry)
+- a thread's unused remainder of a chunk gets reclaimed together with the epoch the chunk was reserved in
+- an allocation can't be bigger than the ring and alignments can't exceed the chunk size
+*/
+class StreamingTransientDataBufferLF : public core::IReferenceCounted, protected GPUTimelineEventHandlerBase
+{
+        using Composed = core::EpochRingAddressAllocatorLF<uint32_t>;
+
+    public:
+        using size_type = uint32_t;
+        using value_type = uint32_t;
+        static constexpr inline size_type invalid_value = Composed::invalid_address;
+        //! how many `retire`d epochs can be pending at once before `retire` has to block
+        static constexpr inline uint32_t MaxEpochsInFlight = Composed::MaxEpochsInFlight;
+
+        //! `_chunkSize` needs to be a power of two, the ring size gets rounded down to its multiple
+        StreamingTransientDataBufferLF(asset::SBufferRange<IGPUBuffer>&& _bufferRange, core::smart_refctd_ptr<IGPUSemaphore>&& _timeline, const size_type _chunkSize=0x10000u) :
+            m_buffer(std::move(_bufferRange.buffer)), m_timeline(std::move(_timeline)), m_composed(_bufferRange.offset,_bufferRange.size,_chunkSize)
+        {
+            assert(m_buffer && (_bufferRange.offset+_bufferRange.size)<=m_buffer->getSize());
+            assert((_bufferRange.offset&(_chunkSize-1u))==0ull);
+            assert(m_timeline && m_timeline->getType()==IGPUSemaphore::ET_TIMELINE);
+            assert(m_buffer->getBoundMemory()->isMappable());
+            assert(m_buffer->getBoundMemory()->getMappedPointer());
+        }
+
+        //
+        inline bool needsManualFlushOrInvalidate() const {return getBuffer()->getBoundMemory()->haveToMakeVisible();}
+
+        // getters
+        inline IGPUBuffer* getBuffer() noexcept {return m_buffer.get();}
+        inline const IGPUBuffer* getBuffer() const noexcept {return m_buffer.get();}
+        inline IGPUSemaphore* getTimelineSemaphore() noexcept {return m_timeline.get();}
+
+        //
+        inline void* getBufferPointer() noexcept {return getBuffer()->getBoundMemory()->getMappedPointer();}
+
+        //! Keeps the open epoch from being retired until `unpin`, calls nest
+        inline void pin() noexcept {m_composed.pin();}
+        inline void unpin() noexcept {m_composed.unpin();}
+
+        //! reclaims all epochs whose submissions completed
+        inline void cull_frees() noexcept
+        {
+            m_composed.reclaim(getCounterValue(m_timeline.get()));
+        }
+
+        //! Returns max possible currently allocatable single allocation size, without having to wait for GPU more
+        inline size_type max_size() noexcept
+        {
+            cull_frees();
+            return m_composed.max_size();
+        }
+
+        //! allocate with default timeout
+        inline size_type multi_allocate(uint32_t count, value_type* outAddresses, const size_type* byteSizes, const size_type* alignments) noexcept
+        {
+            return multi_allocate(GPUEventWrapper::default_wait(),count,outAddresses,byteSizes,alignments);
+        }
+        //! Same contract as `StreamingTransientDataBufferMT`, only `outAddresses` elements equal to `invalid_value` get allocated, returns the number of bytes which could not be
+        template<class Clock=typename std::chrono::steady_clock>
+        inline size_type multi_allocate(const std::chrono::time_point<Clock>& maxWaitPoint, uint32_t count, value_type* outAddresses, const size_type* byteSizes, const size_type* alignments) noexcept
+        {
+            size_type unallocatedSize = try_multi_alloc(count,outAddresses,byteSizes,alignments);
+            // a pinned thread would deadlock with the `retire` it waits for
+            while (unallocatedSize && !m_composed.is_pinned())
+            {
+                // only the oldest pending epoch can free up space
+                if (!m_composed.pending_epochs())
+                    break;
+                const auto currentTime = Clock::now();
+                if (currentTime>=maxWaitPoint)
+                    break;
+                waitForValue(m_timeline.get(),m_composed.oldest_pending_value(),std::chrono::duration_cast<std::chrono::nanoseconds>(maxWaitPoint-currentTime).count());
+                cull_frees();
+                unallocatedSize = try_multi_alloc(count,outAddresses,byteSizes,alignments);
+            }
+            return unallocatedSize;
+        }
+
+        //! Not needed, only here so the class can stand in for `StreamingTransientDataBufferMT` in generic code, memory gets reclaimed on `retire`
+        template<typename... Args>
+        inline void multi_deallocate(Args&&... args) noexcept {}
+
+        // allocate and copy data into the allocations, specifying a timeout for the the allocation
+        template<class Clock=std::chrono::steady_clock>
+        inline size_type multi_place(
+            const std::chrono::time_point<Clock>& maxWaitPoint,
+            uint32_t count, const void* const* dataToPlace,
+            value_type* outAddresses, const size_type* byteSizes, const size_type* alignments
+        ) noexcept
+        {
+            auto retval = multi_allocate(maxWaitPoint,count,outAddresses,byteSizes,alignments);
+            for (uint32_t i=0; i<count; i++)
+            {
+                if (outAddresses[i]!=invalid_value)
+                    memcpy(reinterpret_cast<uint8_t*>(getBufferPointer())+outAddresses[i],dataToPlace[i],byteSizes[i]);
+            }
+            return retval;
+        }
+        // overload with default timeout
+        inline size_type multi_place(uint32_t count, const void* const* dataToPlace, value_type* outAddresses, const size_type* byteSizes, const size_type* alignments) noexcept
+        {
+            return multi_place(GPUEventWrapper::default_wait(),count,dataToPlace,outAddresses,byteSizes,alignments);
+        }
+
+        //! Closes the open epoch, everything allocated in it gets reused once the timeline semaphore reaches `signalValue`
+        /** Values must not decrease between calls. Waits for pinned threads to `unpin`, and for the GPU if `MaxEpochsInFlight` epochs are already pending. */
+        inline void retire(const uint64_t signalValue) noexcept
+        {
+            while (!m_composed.retire(signalValue))
+            {
+                waitForValue(m_timeline.get(),m_composed.oldest_pending_value(),999999999ull);
+                cull_frees();
+            }
+        }
+
+    protected:
+        virtual ~StreamingTransientDataBufferLF()
+        {
+            // the GPU could still be reading
+            while (m_composed.pending_epochs())
+            {
+                waitForValue(m_timeline.get(),m_composed.oldest_pending_value(),999999999ull);
+                cull_frees();
+            }
+        }
+
+        inline size_type try_multi_alloc(uint32_t count, value_type* outAddresses, const size_type* byteSizes, const size_type* alignments) noexcept
+        {
+            size_type unallocatedSize = 0u;
+            for (uint32_t i=0u; i<count; i++)
+            {
+                if (outAddresses[i]!=invalid_value)
+                    continue;
+                outAddresses[i] = m_composed.alloc_addr(byteSizes[i],alignments[i]);
+                // the ring may only be full of finished epochs
+                if (outAddresses[i]==invalid_value)
+                {
+                    cull_frees();
+                    outAddresses[i] = m_composed.alloc_addr(byteSizes[i],alignments[i]);
+                }
+                if (outAddresses[i]==invalid_value)
+                    unallocatedSize += byteSizes[i];
+            }
+            return unallocatedSize;
+        }
+
+        core::smart_refctd_ptr<IGPUBuffer> m_buffer;
+        core::smart_refctd_ptr<IGPUSemaphore> m_timeline;
+        Composed m_composed;
+};
+
 }
 
 #endif
@@ -31,6 +31,7 @@
 // utilities
 #include "nbl/video/utilities/CDumbPresentationOracle.h"
 #include "nbl/video/utilities/ICommandPoolCache.h"
+#include "nbl/video/utilities/CPerThreadCommandPoolRing.h"
 #include "nbl/video/utilities/CPropertyPool.h"
 #include "nbl/video/utilities/CDrawIndirectAllocator.h"
 #include "nbl/video/utilities/CSubpassKiln.h"
@@ -0,0 +1,132 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_VIDEO_C_PER_THREAD_COMMAND_POOL_RING_H_INCLUDED_
+#define _NBL_VIDEO_C_PER_THREAD_COMMAND_POOL_RING_H_INCLUDED_
+
+
+#include "nbl/video/ILogicalDevice.h"
+#include "nbl/video/utilities/ICommandPoolCache.h"
+
+
+namespace nbl::video
+{
+
+//! Gives every recording thread its own command pool for the current frame, so command buffers can be recorded in parallel without any locking
+/**
+	The pools come from an `ICommandPoolCache` holding `threadCount*framesInFlight` of them, and get reset (not recreated) once the fence passed to `endFrame` signals.
+	Command buffers allocated from a pool are kept and handed out again in later frames the pool gets used in, and so are the pool's command segments.
+
+	`beginFrame` and `endFrame` need to be called from a single thread, `getPool` and `acquireCommandBuffer` can be called in between them
+	from any number of threads, as long as no two threads use the same `threadIx` at once.
+*/
+class CPerThreadCommandPoolRing : public core::IReferenceCounted
+{
+	public:
+		CPerThreadCommandPoolRing(ILogicalDevice* device, const uint32_t queueFamilyIx, const IGPUCommandPool::E_CREATE_FLAGS flags, const uint32_t threadCount, const uint32_t framesInFlight)
+			: m_device(device), m_poolCache(core::make_smart_refctd_ptr<ICommandPoolCache>(device,queueFamilyIx,flags,threadCount*framesInFlight)),
+			m_poolStates(std::make_unique<SPoolState[]>(threadCount*framesInFlight)), m_framePools(std::make_unique<uint32_t[]>(threadCount)), m_threadCount(threadCount)
+		{
+			std::fill_n(m_framePools.get(),m_threadCount,ICommandPoolCache::invalid_index);
+		}
+
+		//
+		inline uint32_t getThreadCount() const {return m_threadCount;}
+		inline ICommandPoolCache* getPoolCache() {return m_poolCache.get();}
+
+		//! Acquires a pool for every thread, blocks until the pools of the oldest frame get reset if all are in flight
+		inline bool beginFrame()
+		{
+			if (m_inFrame)
+				return false;
+
+			for (uint32_t i=0u; i<m_threadCount; i++)
+			{
+				uint32_t poolIx;
+				while ((poolIx=m_poolCache->acquirePool())==ICommandPoolCache::invalid_index)
+					m_poolCache->wait_until(GPUEventWrapper::default_wait());
+				m_framePools[i] = poolIx;
+				auto& state = m_poolStates[poolIx];
+				// the cache recreates a pool it failed to reset, the command buffers allocated from the old one can't be handed out anymore
+				const IGPUCommandPool* pool = m_poolCache->getPool(poolIx);
+				if (state.pool!=pool)
+				{
+					for (auto& cmdbufs : state.cmdbufs)
+						cmdbufs.clear();
+					state.pool = pool;
+				}
+				std::fill_n(state.used,2u,0u);
+			}
+			m_inFrame = true;
+			return true;
+		}
+
+		//! Only valid between `beginFrame` and `endFrame`
+		inline IGPUCommandPool* getPool(const uint32_t threadIx)
+		{
+			assert(m_inFrame && threadIx<m_threadCount);
+			return m_poolCache->getPool(m_framePools[threadIx]);
+		}
+
+		//! Returns a command buffer from the thread's pool, only allocates new ones once all previously allocated ones got handed out this frame
+		inline IGPUCommandBuffer* acquireCommandBuffer(const uint32_t threadIx, const IGPUCommandBuffer::E_LEVEL level)
+		{
+			assert(m_inFrame && threadIx<m_threadCount);
+			const uint32_t poolIx = m_framePools[threadIx];
+			auto& state = m_poolStates[poolIx];
+			auto& cmdbufs = state.cmdbufs[level];
+			auto& used = state.used[level];
+			if (used==cmdbufs.size())
+			{
+				// grow geometrically, so a thread recording lots of small command buffers doesn't call into the driver for every one
+				const uint32_t count = core::max<uint32_t>(cmdbufs.size(),1u);
+				cmdbufs.resize(used+count);
+				if (!m_device->createCommandBuffers(m_poolCache->getPool(poolIx),level,count,cmdbufs.data()+used))
+				{
+					cmdbufs.resize(used);
+					return nullptr;
+				}
+			}
+			return cmdbufs[used++].get();
+		}
+
+		//! All command buffers handed out this frame must have been submitted before `fence` gets signalled, pass nullptr to reset the pools right away
+		inline void endFrame(core::smart_refctd_ptr<IGPUFence>&& fence)
+		{
+			if (!m_inFrame)
+				return;
+
+			for (uint32_t i=0u; i<m_threadCount; i++)
+			{
+				m_poolCache->releaseSet(m_device,core::smart_refctd_ptr(fence),m_framePools[i]);
+				m_framePools[i] = ICommandPoolCache::invalid_index;
+			}
+			m_inFrame = false;
+		}
+
+	protected:
+		virtual ~CPerThreadCommandPoolRing() = default;
+
+		struct SPoolState
+		{
+			// indexed by `IGPUCommandBuffer::E_LEVEL`
+			core::vector<core::smart_refctd_ptr<IGPUCommandBuffer>> cmdbufs[2];
+			uint32_t used[2] = {0u,0u};
+			// the pool `cmdbufs` got allocated from, they hold a reference to it so the address can't get reused while they're around
+			const IGPUCommandPool* pool = nullptr;
+		};
+
+		ILogicalDevice* m_device;
+		core::smart_refctd_ptr<ICommandPoolCache> m_poolCache;
+		// one per pool in the cache, command buffers stay valid across pool resets
+		std::unique_ptr<SPoolState[]> m_poolStates;
+		// pool indices acquired for the current frame, one per thread
+		std::unique_ptr<uint32_t[]> m_framePools;
+		const uint32_t m_threadCount;
+		bool m_inFrame = false;
+};
+
+}
+
+#endif
@@ -6,6 +6,9 @@
 #define _NBL_VIDEO_C_SUBPASS_KILN_H_INCLUDED_
 
 
+#include "nbl/core/execution.h"
+#include "nbl/core/algorithm/radix_sort.h"
+
 #include "nbl/video/IGPUMeshBuffer.h"
 #include "nbl/video/utilities/IDrawIndirectAllocator.h"
 
@@ -176,6 +179,14 @@ class CSubpassKiln
                     return Cmp<const void*>()(lhs.pipeline->getRenderpass(),rhs.pipeline->getRenderpass());
                 }
         };
+        // Sorts a packed 64bit key per drawcall with a parallel radix sort instead of `std::sort`-ing the drawcalls themselves.
+        // The key is the renderpass and subpass (exact) followed by hashes of the pipeline, descriptor sets and buffers,
+        // so drawcalls with the same state end up next to each other but state changes aren't as minimal as with `DefaultOrder`.
+        // Drawcalls never get moved, so `modifyDrawcall` indices stay valid and only the modified drawcalls get re-sorted.
+        struct RadixOrder
+        {
+            static inline constexpr uint64_t typeID = 2ull;
+        };
 
         //
         inline auto& getDrawcallMetadataVector()
@@ -185,6 +196,20 @@ class CSubpassKiln
         }
         inline const auto& getDrawcallMetadataVector() const {return m_drawCallMetadataStorage;}
 
+        //! Modify or add a drawcall without invalidating the whole order, `bake<RadixOrder>` then only re-sorts these (if there's few of them)
+        inline DrawcallInfo& modifyDrawcall(const uint32_t ix)
+        {
+            if (m_needsSorting!=RadixOrder::typeID)
+                m_needsSorting = DefaultOrder::invalidTypeID;
+            m_dirtyDrawcalls.push_back(ix);
+            return m_drawCallMetadataStorage[ix];
+        }
+        inline DrawcallInfo& appendDrawcall()
+        {
+            m_drawCallMetadataStorage.emplace_back();
+            return modifyDrawcall(m_drawCallMetadataStorage.size()-1u);
+        }
+
         // commandbuffer must have the subpass already begun
         // by setting `drawCountBuffer=nullptr` you disable the use of count buffers
         // (commands are still sorted as if it was used, if you want to ignore draw counts, set `DrawcallInfo::drawCountOffset` on all elements to invalid)
@@ -192,18 +217,184 @@ class CSubpassKiln
         void bake(IGPUCommandBuffer* cmdbuf, const IGPURenderpass* renderpass, const uint32_t subpassIndex, const IGPUBuffer* drawIndirectBuffer, const IGPUBuffer* drawCountBuffer)
         {
             assert(cmdbuf&&renderpass&&subpassIndex<renderpass->getSubpasses().size()&&drawIndirectBuffer);
-            if (m_needsSorting!=draw_call_order_t::typeID)
+            if constexpr (std::is_same_v<draw_call_order_t,RadixOrder>)
             {
-                std::sort(m_drawCallMetadataStorage.begin(),m_drawCallMetadataStorage.end(), typename draw_call_order_t::less());
-                m_needsSorting = draw_call_order_t::typeID;
+                if (m_needsSorting!=RadixOrder::typeID || !m_dirtyDrawcalls.empty() && !radixResortDirty())
+                    radixSort();
+                m_needsSorting = RadixOrder::typeID;
+
+                const auto rank = std::lower_bound(m_radixRenderpasses.begin(),m_radixRenderpasses.end(),renderpass);
+                if (rank==m_radixRenderpasses.end() || *rank!=renderpass || subpassIndex>=(0x1u<<m_radixSubpassBits))
+                    return;
+                const uint64_t prefix = (uint64_t(rank-m_radixRenderpasses.begin())<<m_radixSubpassBits)|subpassIndex;
+                const auto begin = std::partition_point(m_sortedDrawcalls.begin(),m_sortedDrawcalls.end(),[&](const SSortKey& k)->bool{return radixPrefix(k.key)<prefix;});
+                const auto end = std::partition_point(begin,m_sortedDrawcalls.end(),[&](const SSortKey& k)->bool{return radixPrefix(k.key)==prefix;});
+                if (begin==end)
+                    return;
+
+                bake_dispatch(cmdbuf,sorted_iterator{m_drawCallMetadataStorage.data(),&*begin},sorted_iterator{m_drawCallMetadataStorage.data(),&*begin+(end-begin)},drawIndirectBuffer,drawCountBuffer);
             }
+            else
+            {
+                if (m_needsSorting!=draw_call_order_t::typeID)
+                {
+                    std::sort(m_drawCallMetadataStorage.begin(),m_drawCallMetadataStorage.end(), typename draw_call_order_t::less());
+                    m_needsSorting = draw_call_order_t::typeID;
+                    // indices got shuffled
+                    m_dirtyDrawcalls.clear();
+                }
+
+                const SearchObject searchObj = {renderpass,subpassIndex};
+                const auto begin = std::lower_bound(m_drawCallMetadataStorage.begin(),m_drawCallMetadataStorage.end(),searchObj, typename draw_call_order_t::renderpass_subpass_comp());
+                const auto end = std::upper_bound(m_drawCallMetadataStorage.begin(),m_drawCallMetadataStorage.end(),searchObj, typename draw_call_order_t::renderpass_subpass_comp());
+                if (begin==end)
+                    return;
 
-            const SearchObject searchObj = {renderpass,subpassIndex};
-            const auto begin = std::lower_bound(m_drawCallMetadataStorage.begin(),m_drawCallMetadataStorage.end(),searchObj, typename draw_call_order_t::renderpass_subpass_comp());
-            const auto end = std::upper_bound(m_drawCallMetadataStorage.begin(),m_drawCallMetadataStorage.end(),searchObj, typename draw_call_order_t::renderpass_subpass_comp());
-            if (begin==end)
-                return;
+                bake_dispatch(cmdbuf,begin,end,drawIndirectBuffer,drawCountBuffer);
+            }
+        }
+
+    protected:
+        struct SSortKey
+        {
+            uint64_t key;
+            uint32_t drawcallIx;
+
+            struct key_accessor
+            {
+                _NBL_STATIC_INLINE_CONSTEXPR size_t key_bit_count = 64ull;
+
+                template<auto bit_offset, auto radix_mask>
+                inline decltype(radix_mask) operator()(const SSortKey& item) const
+                {
+                    return static_cast<decltype(radix_mask)>(item.key>>static_cast<uint64_t>(bit_offset))&radix_mask;
+                }
+            };
+            inline bool operator<(const SSortKey& other) const
+            {
+                return key<other.key || key==other.key && drawcallIx<other.drawcallIx;
+            }
+        };
+        // walks `RadixOrder` sorted keys, but dereferences to the drawcalls
+        struct sorted_iterator
+        {
+            const DrawcallInfo* drawcalls;
+            const SSortKey* key;
 
+            inline const DrawcallInfo* operator->() const {return drawcalls+key->drawcallIx;}
+            inline sorted_iterator& operator++() {key++; return *this;}
+            inline sorted_iterator operator++(int) {auto retval = *this; key++; return retval;}
+            inline bool operator==(const sorted_iterator& other) const {return key==other.key;}
+            inline bool operator!=(const sorted_iterator& other) const {return key!=other.key;}
+        };
+
+        static inline uint32_t bitsToStore(const uint32_t valueCount)
+        {
+            return valueCount>1u ? core::findMSB(valueCount-1u)+1u:0u;
+        }
+        inline uint64_t radixPrefix(const uint64_t key) const
+        {
+            const uint32_t prefixBits = m_radixRenderpassBits+m_radixSubpassBits;
+            return prefixBits ? (key>>(64u-prefixBits)):0ull;
+        }
+        // returns false if the drawcall's renderpass or subpass doesn't fit the current key layout
+        inline bool radixKey(const DrawcallInfo& drawcall, uint64_t& outKey) const
+        {
+            const auto renderpass = drawcall.pipeline->getRenderpass();
+            const auto rank = std::lower_bound(m_radixRenderpasses.begin(),m_radixRenderpasses.end(),renderpass);
+            const uint32_t subpassIndex = drawcall.pipeline->getSubpassIndex();
+            if (rank==m_radixRenderpasses.end() || *rank!=renderpass || subpassIndex>=(0x1u<<m_radixSubpassBits))
+                return false;
+
+            uint64_t key = (uint64_t(rank-m_radixRenderpasses.begin())<<m_radixSubpassBits)|subpassIndex;
+            uint32_t bitsLeft = 64u-m_radixRenderpassBits-m_radixSubpassBits;
+            // fibonacci hash of the pointer, top bits are the best mixed
+            auto append = [&](const void* object, uint32_t bits) -> void
+            {
+                bits = core::min(bits,bitsLeft);
+                if (!bits)
+                    return;
+                bitsLeft -= bits;
+                key = (key<<bits)|((reinterpret_cast<uintptr_t>(object)*0x9E3779B97F4A7C15ull)>>(64u-bits));
+            };
+            // in order of how expensive a state change is
+            append(drawcall.pipeline.get(),16u);
+            constexpr uint32_t dsBits[IGPUPipelineLayout::DESCRIPTOR_SET_COUNT] = {8u,8u,6u,6u};
+            for (auto i=0u; i<IGPUPipelineLayout::DESCRIPTOR_SET_COUNT; i++)
+                append(drawcall.descriptorSets[i].get(),dsBits[i]);
+            append(drawcall.vertexBufferBindings[0].buffer.get(),8u);
+            append(drawcall.indexBufferBinding.get(),8u);
+            outKey = key<<bitsLeft;
+            return true;
+        }
+
+        inline void radixSort()
+        {
+            const uint32_t drawcallCount = m_drawCallMetadataStorage.size();
+            // drawcalls tend to come grouped by renderpass, so only changes need to get recorded
+            m_radixRenderpasses.clear();
+            uint32_t subpassCount = 1u;
+            for (const auto& drawcall : m_drawCallMetadataStorage)
+            {
+                const auto renderpass = drawcall.pipeline->getRenderpass();
+                if (m_radixRenderpasses.empty() || m_radixRenderpasses.back()!=renderpass)
+                    m_radixRenderpasses.push_back(renderpass);
+                subpassCount = core::max(drawcall.pipeline->getSubpassIndex()+1u,subpassCount);
+            }
+            std::sort(m_radixRenderpasses.begin(),m_radixRenderpasses.end());
+            m_radixRenderpasses.erase(std::unique(m_radixRenderpasses.begin(),m_radixRenderpasses.end()),m_radixRenderpasses.end());
+            m_radixRenderpassBits = bitsToStore(m_radixRenderpasses.size());
+            m_radixSubpassBits = bitsToStore(subpassCount);
+            assert(m_radixRenderpassBits+m_radixSubpassBits<=32u);
+
+            m_sortedDrawcalls.resize(drawcallCount);
+            m_sortScratch.resize(drawcallCount);
+            core::for_each(core::execution::par,m_sortedDrawcalls.begin(),m_sortedDrawcalls.end(),[&](SSortKey& out) -> void
+            {
+                out.drawcallIx = &out-m_sortedDrawcalls.data();
+                [[maybe_unused]] const bool fits = radixKey(m_drawCallMetadataStorage[out.drawcallIx],out.key);
+                assert(fits);
+            });
+            if (core::parallel_radix_sort(m_sortedDrawcalls.data(),m_sortScratch.data(),drawcallCount,typename SSortKey::key_accessor())!=m_sortedDrawcalls.data())
+                std::swap(m_sortedDrawcalls,m_sortScratch);
+            m_dirtyDrawcalls.clear();
+        }
+
+        // merges re-keyed drawcalls into the existing order, returns false if a full sort is needed
+        inline bool radixResortDirty()
+        {
+            // past this a full parallel sort is faster than the serial merge
+            if (m_dirtyDrawcalls.size()*16u>m_drawCallMetadataStorage.size())
+                return false;
+
+            std::sort(m_dirtyDrawcalls.begin(),m_dirtyDrawcalls.end());
+            m_dirtyDrawcalls.erase(std::unique(m_dirtyDrawcalls.begin(),m_dirtyDrawcalls.end()),m_dirtyDrawcalls.end());
+            core::vector<SSortKey> dirtyKeys(m_dirtyDrawcalls.size());
+            for (auto i=0u; i<dirtyKeys.size(); i++)
+            {
+                dirtyKeys[i].drawcallIx = m_dirtyDrawcalls[i];
+                if (dirtyKeys[i].drawcallIx>=m_drawCallMetadataStorage.size() || !radixKey(m_drawCallMetadataStorage[dirtyKeys[i].drawcallIx],dirtyKeys[i].key))
+                    return false;
+            }
+            std::sort(dirtyKeys.begin(),dirtyKeys.end());
+
+            // drop the stale keys, appended drawcalls don't have any
+            m_sortedDrawcalls.erase(std::remove_if(m_sortedDrawcalls.begin(),m_sortedDrawcalls.end(),[&](const SSortKey& k)->bool
+            {
+                return std::binary_search(m_dirtyDrawcalls.begin(),m_dirtyDrawcalls.end(),k.drawcallIx);
+            }),m_sortedDrawcalls.end());
+            if (m_sortedDrawcalls.size()+dirtyKeys.size()!=m_drawCallMetadataStorage.size())
+                return false;
+            m_sortScratch.resize(m_drawCallMetadataStorage.size());
+            std::merge(m_sortedDrawcalls.begin(),m_sortedDrawcalls.end(),dirtyKeys.begin(),dirtyKeys.end(),m_sortScratch.begin());
+            std::swap(m_sortedDrawcalls,m_sortScratch);
+            m_dirtyDrawcalls.clear();
+            return true;
+        }
+
+        template<typename iterator_t>
+        inline void bake_dispatch(IGPUCommandBuffer* cmdbuf, const iterator_t begin, const iterator_t end, const IGPUBuffer* drawIndirectBuffer, const IGPUBuffer* drawCountBuffer)
+        {
             const auto& features = cmdbuf->getOriginDevice()->getEnabledFeatures();
             const bool drawCountEnabled = features.drawIndirectCount;
 
@@ -213,11 +404,16 @@ class CSubpassKiln
                 bake_impl<false>(drawCountEnabled,drawIndirectBuffer,drawCountBuffer)(cmdbuf,begin,end);
         }
 
-    protected:
         core::vector<DrawcallInfo> m_drawCallMetadataStorage;
         uint64_t m_needsSorting = DefaultOrder::invalidTypeID;
+        // `RadixOrder` state
+        core::vector<SSortKey> m_sortedDrawcalls, m_sortScratch;
+        core::vector<uint32_t> m_dirtyDrawcalls;
+        // sorted, a drawcall's renderpass gets keyed by its position in here
+        core::vector<const IGPURenderpass*> m_radixRenderpasses;
+        uint32_t m_radixRenderpassBits = 0u;
+        uint32_t m_radixSubpassBits = 0u;
 
-        using call_iterator = typename decltype(m_drawCallMetadataStorage)::const_iterator;
         template<bool multiDrawEnabled>
         struct bake_impl
         {
@@ -225,6 +421,7 @@ class CSubpassKiln
                 bake_impl(const bool _drawCountEnabled, const IGPUBuffer* _drawIndirectBuffer, const IGPUBuffer* _drawCountBuffer)
                     : drawCountEnabled(_drawCountEnabled), drawIndirectBuffer(_drawIndirectBuffer), drawCountBuffer(_drawCountBuffer) {}
 
+                template<typename call_iterator>
                 inline void operator()(IGPUCommandBuffer* cmdbuf, const call_iterator begin, const call_iterator end)
                 {
                     for (auto it=begin; it!=end;)
@@ -48,6 +48,13 @@ class ICommandPoolCache : public core::IReferenceCounted
 			m_deferredResets.pollForReadyEvents(DeferredCommandPoolResetter::exhaustive_poll);
 		}
 
+		// blocks until at least one pool gets released or the timeout is hit
+		template<class Clock=std::chrono::steady_clock, class Duration=typename Clock::duration>
+		inline void wait_until(const std::chrono::time_point<Clock,Duration>& timeout_time)
+		{
+			m_deferredResets.waitUntilForReadyEvents(timeout_time,DeferredCommandPoolResetter::single_poll);
+		}
+
 		//
 		inline void releaseSet(ILogicalDevice* device, core::smart_refctd_ptr<IGPUFence>&& fence, const uint32_t poolIx)
 		{
@@ -124,7 +131,6 @@ class ICommandPoolCache : public core::IReferenceCounted
 		void* m_reserved;
 		CommandPoolAllocator m_cmdPoolAllocator;
 		GPUDeferredEventHandlerST<DeferredCommandPoolResetter> m_deferredResets;
-		// TODO: after CommandPool resetting, get rid of these 
 		const uint32_t m_queueFamilyIx;
 		const IGPUCommandPool::E_CREATE_FLAGS m_flags;
 };
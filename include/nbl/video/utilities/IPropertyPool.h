@@ -15,11 +15,12 @@ namespace nbl::video
 {
 
 
-// property pool is inherently single threaded
+// contiguous property pools are inherently single threaded,
+// the others can allocate and free properties from multiple threads at once (but not `freeAllProperties`)
 class NBL_API2 IPropertyPool : public core::IReferenceCounted
 {
 	public:
-		using PropertyAddressAllocator = core::PoolAddressAllocatorST<uint32_t>;
+		using PropertyAddressAllocator = core::ConcurrentPoolAddressAllocator<uint32_t>;
 
         static inline constexpr auto invalid = PropertyAddressAllocator::invalid_address;
 
@@ -483,6 +483,7 @@ class NBL_API2 IUtilities : public core::IReferenceCounted
                     IGPUQueue::SSubmitInfo submit = intendedNextSubmit;
                     submit.signalSemaphoreCount = 0u;
                     submit.pSignalSemaphores = nullptr;
+                    submit.pSignalValues = nullptr;
                     assert(submit.isValid());
                     submissionQueue->submit(1u, &submit, submissionFence);
                     m_device->blockForFences(1u, &submissionFence);
@@ -491,6 +492,7 @@ class NBL_API2 IUtilities : public core::IReferenceCounted
                     intendedNextSubmit.waitSemaphoreCount = 0u;
                     intendedNextSubmit.pWaitSemaphores = nullptr;
                     intendedNextSubmit.pWaitDstStageMask = nullptr;
+                    intendedNextSubmit.pWaitValues = nullptr;
                     // before resetting we need poll all events in the allocator's deferred free list
                     m_defaultUploadBuffer->cull_frees();
                     // we can reset the fence and commandbuffer because we fully wait for the GPU to finish here
@@ -693,6 +695,7 @@ class NBL_API2 IUtilities : public core::IReferenceCounted
                     IGPUQueue::SSubmitInfo submit = intendedNextSubmit;
                     submit.signalSemaphoreCount = 0u;
                     submit.pSignalSemaphores = nullptr;
+                    submit.pSignalValues = nullptr;
                     assert(submit.isValid());
                     submissionQueue->submit(1u, &submit, submissionFence);
                     m_device->blockForFences(1u, &submissionFence);
@@ -702,6 +705,7 @@ class NBL_API2 IUtilities : public core::IReferenceCounted
                     intendedNextSubmit.waitSemaphoreCount = 0u;
                     intendedNextSubmit.pWaitSemaphores = nullptr;
                     intendedNextSubmit.pWaitDstStageMask = nullptr;
+                    intendedNextSubmit.pWaitValues = nullptr;
 
                     // before resetting we need poll all events in the allocator's deferred free list
                     m_defaultDownloadBuffer->cull_frees();
@@ -1010,6 +1014,9 @@ class NBL_API2 IUtilities : public core::IReferenceCounted
         core::smart_refctd_ptr<ILogicalDevice> m_device;
 
         core::smart_refctd_ptr<StreamingTransientDataBufferMT<> > m_defaultDownloadBuffer;
+        // Not a `StreamingTransientDataBufferLF`, `updateBufferRangeViaStagingBuffer` frees every allocation against the caller's fence and leaves
+        // the final submit to the caller, so there's no point at which it could `retire` an epoch or a timeline value to retire it with.
+        // Threads wanting lock-free staging should own an LF buffer and retire it from their submitting thread.
         core::smart_refctd_ptr<StreamingTransientDataBufferMT<> > m_defaultUploadBuffer;
 
         core::smart_refctd_ptr<CPropertyPoolHandler> m_propertyPoolHandler;
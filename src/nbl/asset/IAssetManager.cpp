@@ -28,7 +28,7 @@
 #endif
 
 #ifdef _NBL_COMPILE_WITH_BAW_LOADER_
-//#include "nbl/asset/bawformat/CBAWMeshFileLoader.h"
+#include "nbl/asset/bawformat/CBAWLoader.h"
 #endif
 
 #ifdef _NBL_COMPILE_WITH_GLTF_LOADER_
@@ -64,7 +64,7 @@
 #endif
 
 #ifdef _NBL_COMPILE_WITH_BAW_WRITER_
-//#include "nbl/asset/bawformat/CBAWMeshWriter.h"
+#include "nbl/asset/bawformat/CBAWWriter.h"
 #endif
 
 #ifdef _NBL_COMPILE_WITH_GLTF_WRITER_
@@ -154,7 +154,7 @@ void IAssetManager::addLoadersAndWriters()
 	addAssetLoader(core::make_smart_refctd_ptr<asset::COBJMeshFileLoader>(this));
 #endif
 #ifdef _NBL_COMPILE_WITH_BAW_LOADER_
-	//addAssetLoader(core::make_smart_refctd_ptr<asset::CBAWMeshFileLoader>(this));
+	addAssetLoader(core::make_smart_refctd_ptr<asset::CBAWLoader>());
 #endif
 #ifdef _NBL_COMPILE_WITH_GLTF_LOADER_
     addAssetLoader(core::make_smart_refctd_ptr<asset::CGLTFLoader>(this));
@@ -180,7 +180,7 @@ void IAssetManager::addLoadersAndWriters()
 	addAssetLoader(core::make_smart_refctd_ptr<asset::CSPVLoader>());
 
 #ifdef _NBL_COMPILE_WITH_BAW_WRITER_
-	//addAssetWriter(core::make_smart_refctd_ptr<asset::CBAWMeshWriter>(getFileSystem()));
+	addAssetWriter(core::make_smart_refctd_ptr<asset::CBAWWriter>());
 #endif
 #ifdef _NBL_COMPILE_WITH_GLTF_WRITER_
     addAssetWriter(core::make_smart_refctd_ptr<asset::CGLTFWriter>());
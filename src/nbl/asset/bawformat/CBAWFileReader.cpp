@@ -0,0 +1,288 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/asset/bawformat/CBAWFileReader.h"
+
+#include <limits>
+#include <numeric>
+
+#include "nbl/core/execution.h"
+
+#include "lz4/lib/lz4.h"
+#undef Bool
+#include "lzma/C/LzmaDec.h"
+#ifdef _NBL_COMPILE_WITH_ZSTD_
+#include "zstd.h"
+#endif
+
+namespace nbl::asset
+{
+
+namespace
+{
+struct LzmaMemMngmnt
+{
+		static void *alloc(ISzAllocPtr, size_t _size) { return _NBL_ALIGNED_MALLOC(_size,_NBL_SIMD_ALIGNMENT); }
+		static void release(ISzAllocPtr, void* _addr) { _NBL_ALIGNED_FREE(_addr); }
+	private:
+		LzmaMemMngmnt() {}
+};
+
+// The decompressed size comes from the (hash-validated, but not trusted) table, so it can't be allowed to make us allocate arbitrary amounts of memory.
+// LZ4 can't expand more than 255 times, LZMA and zstd can only beat that by a lot on degenerate (e.g. constant) data.
+bool isPlausibleDecompressedSize(const uint8_t _comprType, const uint64_t _srcSize, const uint64_t _dstSize)
+{
+	constexpr uint64_t MaxLZ4Ratio = 255ull;
+	constexpr uint64_t MaxEntropyCoderRatio = 0x1ull<<15u;
+	switch (_comprType)
+	{
+		case Blob::EBCT_RAW:
+			return _dstSize==_srcSize;
+		case Blob::EBCT_LZ4:
+			return _dstSize<=_srcSize*MaxLZ4Ratio;
+		case Blob::EBCT_LZMA: [[fallthrough]];
+		case Blob::EBCT_ZSTD:
+			return _dstSize<=_srcSize*MaxEntropyCoderRatio;
+		default:
+			break;
+	}
+	return false;
+}
+}
+
+bool CBAWFileReader::isBAWv4File(system::IFile* _file)
+{
+	if (!_file || _file->getSize()<sizeof(BAWFileHeaderV4))
+		return false;
+
+	BAWFileHeaderV4 header;
+	system::IFile::success_t success;
+	_file->read(success, &header, 0u, sizeof(header));
+	return success && header.isValid();
+}
+
+core::smart_refctd_ptr<CBAWFileReader> CBAWFileReader::create(core::smart_refctd_ptr<system::IFile>&& _file, system::logger_opt_ptr _logger)
+{
+	if (!isBAWv4File(_file.get()))
+		return nullptr;
+
+	auto* reader = new CBAWFileReader(std::move(_file),_logger);
+	auto retval = core::smart_refctd_ptr<CBAWFileReader>(reader,core::dont_grab);
+	if (!reader->readBlobTable())
+		return nullptr;
+	return retval;
+}
+
+bool CBAWFileReader::readBlobTable()
+{
+	const size_t fileSize = m_file->getSize();
+	{
+		system::IFile::success_t success;
+		m_file->read(success, &m_header, 0u, sizeof(m_header));
+		if (!success)
+			return false;
+	}
+
+	const size_t tableSize = size_t(m_header.blobCount)*sizeof(BlobTableEntryV4);
+	// subtracting from the file size, so that neither a huge offset nor a huge blob count can wrap around
+	if (m_header.blobTableOffset<sizeof(BAWFileHeaderV4) || tableSize>fileSize || m_header.blobTableOffset>fileSize-tableSize)
+	{
+		m_logger.log("BAW file %s has its blob table out of bounds.", system::ILogger::ELL_ERROR, m_file->getFileName().string().c_str());
+		return false;
+	}
+
+	// use the table in-place if we can
+	if (const auto* mapped = reinterpret_cast<const uint8_t*>(static_cast<const system::IFile*>(m_file.get())->getMappedPointer()))
+		m_table = reinterpret_cast<const BlobTableEntryV4*>(mapped+m_header.blobTableOffset);
+	else
+	{
+		m_tableStorage.resize(m_header.blobCount);
+		system::IFile::success_t success;
+		m_file->read(success, m_tableStorage.data(), m_header.blobTableOffset, tableSize);
+		if (!success)
+			return false;
+		m_table = m_tableStorage.data();
+	}
+
+	uint64_t tableHash[4];
+	core::XXHash_256(m_table, tableSize, tableHash);
+	if (memcmp(tableHash, m_header.blobTableHash, sizeof(tableHash))!=0)
+	{
+		m_logger.log("BAW file %s has a corrupted blob table.", system::ILogger::ELL_ERROR, m_file->getFileName().string().c_str());
+		return false;
+	}
+
+	m_handleToIx.reserve(m_header.blobCount);
+	for (uint32_t i=0u; i<m_header.blobCount; i++)
+	{
+		const auto& entry = m_table[i];
+		if (entry.offset<sizeof(BAWFileHeaderV4) || entry.blobSize>fileSize || entry.offset>fileSize-entry.blobSize)
+		{
+			m_logger.log("BAW file %s has blob %u out of bounds.", system::ILogger::ELL_ERROR, m_file->getFileName().string().c_str(), i);
+			return false;
+		}
+		m_handleToIx.insert({entry.handle,i});
+	}
+	m_blobs = std::make_unique<SBlobState[]>(m_header.blobCount);
+
+	return true;
+}
+
+uint32_t CBAWFileReader::validateAll() const
+{
+	const auto* mapped = reinterpret_cast<const uint8_t*>(static_cast<const system::IFile*>(m_file.get())->getMappedPointer());
+
+	core::vector<uint32_t> ixs(m_header.blobCount);
+	std::iota(ixs.begin(), ixs.end(), 0u);
+	std::atomic_uint32_t corrupted = 0u;
+	core::for_each(core::execution::par, ixs.begin(), ixs.end(), [&](const uint32_t ix) -> void
+	{
+		const auto& entry = m_table[ix];
+		bool valid;
+		if (mapped)
+			valid = entry.validate(mapped+entry.offset);
+		else
+		{
+			core::vector<uint8_t> tmp(entry.blobSize);
+			system::IFile::success_t success;
+			m_file->read(success, tmp.data(), entry.offset, entry.blobSize);
+			valid = success && entry.validate(tmp.data());
+		}
+		if (!valid)
+			corrupted++;
+	});
+	return corrupted;
+}
+
+core::smart_refctd_ptr<ICPUBuffer> CBAWFileReader::getBlobData(uint32_t _ix)
+{
+	if (_ix>=m_header.blobCount)
+		return nullptr;
+
+	auto& blob = m_blobs[_ix];
+	std::lock_guard<std::mutex> lock(blob.mutex);
+	if (!blob.data && !blob.failed)
+	{
+		blob.data = materialize(_ix);
+		blob.failed = !blob.data;
+	}
+	return blob.data;
+}
+
+void CBAWFileReader::prefetch(const uint32_t* _ixBegin, const uint32_t* _ixEnd)
+{
+	// blobs are independent, so this only contends on the file reads
+	core::for_each(core::execution::par, _ixBegin, _ixEnd, [this](const uint32_t ix) -> void
+	{
+		getBlobData(ix);
+	});
+}
+
+void CBAWFileReader::prefetchAll()
+{
+	core::vector<uint32_t> ixs(m_header.blobCount);
+	std::iota(ixs.begin(), ixs.end(), 0u);
+	prefetch(ixs.data(), ixs.data()+ixs.size());
+}
+
+void CBAWFileReader::release(uint32_t _ix)
+{
+	if (_ix>=m_header.blobCount)
+		return;
+
+	auto& blob = m_blobs[_ix];
+	std::lock_guard<std::mutex> lock(blob.mutex);
+	blob.data = nullptr;
+	blob.failed = false;
+}
+
+core::smart_refctd_ptr<ICPUBuffer> CBAWFileReader::materialize(uint32_t _ix) const
+{
+	const auto& entry = m_table[_ix];
+	if (entry.compressionType&Blob::EBCT_AES128_GCM)
+	{
+		m_logger.log("BAW blob %u is encrypted, encryption is not supported by the v4 reader.", system::ILogger::ELL_ERROR, _ix);
+		return nullptr;
+	}
+
+	// mapped files get decompressed straight from the mapping
+	const uint8_t* src = reinterpret_cast<const uint8_t*>(static_cast<const system::IFile*>(m_file.get())->getMappedPointer());
+	core::vector<uint8_t> tmp;
+	if (src)
+		src += entry.offset;
+	else
+	{
+		tmp.resize(entry.blobSize);
+		system::IFile::success_t success;
+		m_file->read(success, tmp.data(), entry.offset, entry.blobSize);
+		if (!success)
+		{
+			m_logger.log("Failed to read BAW blob %u.", system::ILogger::ELL_ERROR, _ix);
+			return nullptr;
+		}
+		src = tmp.data();
+	}
+
+	if (!entry.validate(src))
+	{
+		m_logger.log("BAW blob %u failed hash validation.", system::ILogger::ELL_ERROR, _ix);
+		return nullptr;
+	}
+
+	if (!isPlausibleDecompressedSize(entry.compressionType, entry.blobSize, entry.blobSizeDecompr))
+	{
+		m_logger.log("BAW blob %u claims an implausible decompressed size of %llu bytes from %llu.", system::ILogger::ELL_ERROR, _ix, static_cast<unsigned long long>(entry.blobSizeDecompr), static_cast<unsigned long long>(entry.blobSize));
+		return nullptr;
+	}
+	auto retval = core::make_smart_refctd_ptr<ICPUBuffer>(entry.blobSizeDecompr);
+	if (!decompress(entry.compressionType, retval->getPointer(), entry.blobSizeDecompr, src, entry.blobSize))
+	{
+		m_logger.log("Failed to decompress BAW blob %u.", system::ILogger::ELL_ERROR, _ix);
+		return nullptr;
+	}
+	return retval;
+}
+
+bool CBAWFileReader::decompress(uint8_t _comprType, void* _dst, size_t _dstSize, const void* _src, size_t _srcSize) const
+{
+	switch (_comprType)
+	{
+		case Blob::EBCT_RAW:
+			if (_srcSize!=_dstSize)
+				return false;
+			memcpy(_dst, _src, _dstSize);
+			return true;
+		case Blob::EBCT_LZ4:
+			// the LZ4 API takes sizes as `int`, larger blobs can only come from a corrupted or hostile table
+			if (_srcSize>size_t(std::numeric_limits<int>::max()) || _dstSize>size_t(std::numeric_limits<int>::max()))
+				return false;
+			return LZ4_decompress_safe(reinterpret_cast<const char*>(_src), reinterpret_cast<char*>(_dst), _srcSize, _dstSize)==static_cast<int>(_dstSize);
+		case Blob::EBCT_LZMA:
+		{
+			if (_srcSize<LZMA_PROPS_SIZE)
+				return false;
+			SizeT dstSize = _dstSize;
+			SizeT srcSize = _srcSize-LZMA_PROPS_SIZE;
+			ELzmaStatus status;
+			ISzAlloc alloc{&LzmaMemMngmnt::alloc, &LzmaMemMngmnt::release};
+			const SRes res = LzmaDecode(reinterpret_cast<Byte*>(_dst), &dstSize, reinterpret_cast<const Byte*>(_src)+LZMA_PROPS_SIZE, &srcSize, reinterpret_cast<const Byte*>(_src), LZMA_PROPS_SIZE, LZMA_FINISH_ANY, &status, &alloc);
+			return res==SZ_OK && dstSize==_dstSize;
+		}
+		case Blob::EBCT_ZSTD:
+#ifdef _NBL_COMPILE_WITH_ZSTD_
+		{
+			const size_t res = ZSTD_decompress(_dst, _dstSize, _src, _srcSize);
+			return !ZSTD_isError(res) && res==_dstSize;
+		}
+#else
+			m_logger.log("BAW blob is zstd compressed, but Nabla was built without zstd.", system::ILogger::ELL_ERROR);
+			return false;
+#endif
+		default:
+			break;
+	}
+	return false;
+}
+
+}
@@ -0,0 +1,191 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/asset/bawformat/CBAWFileWriter.h"
+
+#include "nbl/core/execution.h"
+
+#include "lz4/lib/lz4.h"
+#undef Bool
+#include "lzma/C/LzmaEnc.h"
+#ifdef _NBL_COMPILE_WITH_ZSTD_
+#include "zstd.h"
+#endif
+
+namespace nbl::asset
+{
+
+namespace
+{
+struct LzmaMemMngmnt
+{
+		static void *alloc(ISzAllocPtr, size_t _size) { return _NBL_ALIGNED_MALLOC(_size,_NBL_SIMD_ALIGNMENT); }
+		static void release(ISzAllocPtr, void* _addr) { _NBL_ALIGNED_FREE(_addr); }
+	private:
+		LzmaMemMngmnt() {}
+};
+
+// all return false if the output would not be smaller than the input
+bool compressLz4(core::vector<uint8_t>& _out, const void* _input, size_t _inputSize)
+{
+	if (_inputSize>LZ4_MAX_INPUT_SIZE)
+		return false;
+	_out.resize(LZ4_compressBound(_inputSize));
+	const int compressedSize = LZ4_compress_default(reinterpret_cast<const char*>(_input), reinterpret_cast<char*>(_out.data()), _inputSize, _out.size());
+	if (compressedSize<=0 || size_t(compressedSize)>=_inputSize)
+		return false;
+	_out.resize(compressedSize);
+	return true;
+}
+
+bool compressLzma(core::vector<uint8_t>& _out, const void* _input, size_t _inputSize)
+{
+	ISzAlloc alloc{&LzmaMemMngmnt::alloc, &LzmaMemMngmnt::release};
+	SizeT propsSize = LZMA_PROPS_SIZE;
+
+	// next power of two above input size, times two
+	UInt32 dictSize = core::roundUpToPoT<uint32_t>(core::min<size_t>(_inputSize,1u<<30u))<<1u;
+
+	// Lzma props: https://stackoverflow.com/a/21384797/5538150
+	CLzmaEncProps props;
+	LzmaEncProps_Init(&props);
+	props.dictSize = dictSize;
+	props.level = 5; // compression level [0;9]
+	props.algo = 0; // fast algo: a little worse compression, a little less loading time
+	props.lp = 2; // 2^2==sizeof(float)
+
+	_out.resize(_inputSize+LZMA_PROPS_SIZE);
+	SizeT destSize = _inputSize;
+	const SRes res = LzmaEncode(_out.data()+LZMA_PROPS_SIZE, &destSize, reinterpret_cast<const Byte*>(_input), _inputSize, &props, _out.data(), &propsSize, props.writeEndMark, nullptr, &alloc, &alloc);
+	if (res!=SZ_OK || destSize+LZMA_PROPS_SIZE>=_inputSize)
+		return false;
+	_out.resize(destSize+LZMA_PROPS_SIZE);
+	return true;
+}
+
+bool compressZstd(core::vector<uint8_t>& _out, const void* _input, size_t _inputSize)
+{
+#ifdef _NBL_COMPILE_WITH_ZSTD_
+	_out.resize(ZSTD_compressBound(_inputSize));
+	const size_t compressedSize = ZSTD_compress(_out.data(), _out.size(), _input, _inputSize, ZSTD_CLEVEL_DEFAULT);
+	if (ZSTD_isError(compressedSize) || compressedSize>=_inputSize)
+		return false;
+	_out.resize(compressedSize);
+	return true;
+#else
+	return false;
+#endif
+}
+}
+
+bool CBAWFileWriter::isCodingSupported(Blob::E_BLOB_CODING_TYPE _coding)
+{
+	switch (_coding)
+	{
+		case Blob::EBCT_RAW: [[fallthrough]];
+		case Blob::EBCT_LZ4: [[fallthrough]];
+		case Blob::EBCT_LZMA:
+			return true;
+#ifdef _NBL_COMPILE_WITH_ZSTD_
+		case Blob::EBCT_ZSTD:
+			return true;
+#endif
+		default:
+			break;
+	}
+	return false;
+}
+
+bool CBAWFileWriter::addBlob(Blob::E_BLOB_TYPE _type, uint64_t _handle, core::smart_refctd_ptr<const ICPUBuffer>&& _data, Blob::E_BLOB_CODING_TYPE _coding)
+{
+	if (!_data || !isCodingSupported(_coding) || !m_handles.insert(_handle).second)
+		return false;
+
+	m_blobs.push_back({std::move(_data),_handle,_type,_coding});
+	return true;
+}
+
+bool CBAWFileWriter::write(system::IFile* _file, system::logger_opt_ptr _logger) const
+{
+	if (!_file)
+		return false;
+
+	struct SEncodedBlob
+	{
+		core::vector<uint8_t> compressed;
+		BlobTableEntryV4 entry;
+	};
+	core::vector<SEncodedBlob> encoded(m_blobs.size());
+	core::for_each(core::execution::par, encoded.begin(), encoded.end(), [&](SEncodedBlob& out) -> void
+	{
+		const auto& blob = m_blobs[&out-encoded.data()];
+		const void* data = blob.data->getPointer();
+		const size_t size = blob.data->getSize();
+
+		bool compressed = false;
+		switch (blob.coding)
+		{
+			case Blob::EBCT_LZ4:
+				compressed = compressLz4(out.compressed, data, size);
+				break;
+			case Blob::EBCT_LZMA:
+				compressed = compressLzma(out.compressed, data, size);
+				break;
+			case Blob::EBCT_ZSTD:
+				compressed = compressZstd(out.compressed, data, size);
+				break;
+			default:
+				break;
+		}
+
+		memset(&out.entry, 0, sizeof(out.entry));
+		out.entry.handle = blob.handle;
+		out.entry.blobType = blob.type;
+		if (compressed)
+			out.entry.finalize(out.compressed.data(), size, out.compressed.size(), blob.coding);
+		else
+		{
+			out.compressed.clear();
+			out.entry.finalize(data, size, size, Blob::EBCT_RAW);
+		}
+	});
+
+	// lay the blobs out
+	constexpr size_t BlobAlignment = 16ull;
+	size_t offset = core::alignUp(sizeof(BAWFileHeaderV4), BlobAlignment);
+	core::vector<BlobTableEntryV4> table(encoded.size());
+	for (size_t i=0u; i<encoded.size(); i++)
+	{
+		encoded[i].entry.offset = offset;
+		table[i] = encoded[i].entry;
+		offset = core::alignUp(offset+encoded[i].entry.blobSize, BlobAlignment);
+	}
+
+	BAWFileHeaderV4 header;
+	header.init();
+	header.blobCount = table.size();
+	header.blobTableOffset = offset;
+	core::XXHash_256(table.data(), table.size()*sizeof(BlobTableEntryV4), header.blobTableHash);
+
+	auto writeChunk = [&](const void* data, size_t chunkOffset, size_t size) -> bool
+	{
+		system::IFile::success_t success;
+		_file->write(success, data, chunkOffset, size);
+		if (!success)
+			_logger.log("Failed to write %zu bytes at offset %zu to BAW file %s.", system::ILogger::ELL_ERROR, size, chunkOffset, _file->getFileName().string().c_str());
+		return bool(success);
+	};
+	if (!writeChunk(&header, 0u, sizeof(header)))
+		return false;
+	for (size_t i=0u; i<encoded.size(); i++)
+	{
+		const auto& entry = encoded[i].entry;
+		const void* data = encoded[i].compressed.empty() ? m_blobs[i].data->getPointer():encoded[i].compressed.data();
+		if (entry.blobSize && !writeChunk(data, entry.offset, entry.blobSize))
+			return false;
+	}
+	return table.empty() || writeChunk(table.data(), header.blobTableOffset, table.size()*sizeof(BlobTableEntryV4));
+}
+
+}
@@ -0,0 +1,47 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/asset/bawformat/CBAWLoader.h"
+
+namespace nbl::asset
+{
+
+bool CBAWLoader::isALoadableFileFormat(system::IFile* _file, const system::logger_opt_ptr logger) const
+{
+	return CBAWFileReader::isBAWv4File(_file);
+}
+
+SAssetBundle CBAWLoader::loadAsset(system::IFile* _file, const IAssetLoader::SAssetLoadParams& _params, IAssetLoader::IAssetLoaderOverride* _override, uint32_t _hierarchyLevel)
+{
+	auto reader = CBAWFileReader::create(core::smart_refctd_ptr<system::IFile>(_file),_params.logger);
+	if (!reader)
+	{
+		_params.logger.log("LOAD BAW: %s is not a valid BAW v4 file.", system::ILogger::ELL_ERROR, _file ? _file->getFileName().string().c_str():"");
+		return {};
+	}
+
+	core::vector<uint32_t> bufferBlobs;
+	bufferBlobs.reserve(reader->getBlobCount());
+	for (uint32_t i=0u; i<reader->getBlobCount(); i++)
+	{
+		if (reader->getBlobEntry(i).blobType==Blob::EBT_RAW_DATA_BUFFER)
+			bufferBlobs.push_back(i);
+		else
+			_params.logger.log("LOAD BAW: skipping blob %u of unsupported type %u.", system::ILogger::ELL_WARNING, i, reader->getBlobEntry(i).blobType);
+	}
+	reader->prefetch(bufferBlobs.data(),bufferBlobs.data()+bufferBlobs.size());
+
+	core::vector<core::smart_refctd_ptr<IAsset>> buffers;
+	buffers.reserve(bufferBlobs.size());
+	for (const uint32_t ix : bufferBlobs)
+	{
+		auto buffer = reader->getBlobData(ix);
+		if (!buffer)
+			return {};
+		buffers.push_back(std::move(buffer));
+	}
+	return SAssetBundle(nullptr,std::move(buffers));
+}
+
+}
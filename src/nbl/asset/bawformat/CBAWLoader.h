@@ -0,0 +1,43 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_ASSET_C_BAW_LOADER_H_INCLUDED_
+#define _NBL_ASSET_C_BAW_LOADER_H_INCLUDED_
+
+#include "nbl/asset/interchange/IAssetLoader.h"
+#include "nbl/asset/bawformat/CBAWFileReader.h"
+
+namespace nbl::asset
+{
+
+//! Loader for .baw v4 files
+/**
+	Every raw data blob becomes an ICPUBuffer in the returned bundle (in blob table order), they get decompressed
+	and validated in parallel. For lazy access to individual blobs use CBAWFileReader directly.
+	Older .baw versions hold meshes of the long removed mesh API and are not loaded.
+*/
+class CBAWLoader final : public IAssetLoader
+{
+	protected:
+		~CBAWLoader() = default;
+
+	public:
+		CBAWLoader() = default;
+
+		bool isALoadableFileFormat(system::IFile* _file, const system::logger_opt_ptr logger) const override;
+
+		const char** getAssociatedFileExtensions() const override
+		{
+			static const char* extensions[]{ "baw", nullptr };
+			return extensions;
+		}
+
+		uint64_t getSupportedAssetTypesBitfield() const override { return IAsset::ET_BUFFER; }
+
+		SAssetBundle loadAsset(system::IFile* _file, const IAssetLoader::SAssetLoadParams& _params, IAssetLoader::IAssetLoaderOverride* _override = nullptr, uint32_t _hierarchyLevel = 0u) override;
+};
+
+}
+
+#endif
@@ -0,0 +1,43 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/asset/bawformat/CBAWWriter.h"
+
+namespace nbl::asset
+{
+
+bool CBAWWriter::writeAsset(system::IFile* _file, const SAssetWriteParams& _params, IAssetWriterOverride* _override)
+{
+	if (!_override)
+		getDefaultOverride(_override);
+
+	SAssetWriteContext ctx{ _params, _file };
+
+	const auto* buffer = IAsset::castDown<const ICPUBuffer>(_params.rootAsset);
+	if (!buffer)
+		return false;
+
+	system::IFile* file = _override->getOutputFile(_file, ctx, {buffer, 0u});
+	if (!file)
+		return false;
+
+	// the more compression is asked for, the slower the codec
+	Blob::E_BLOB_CODING_TYPE coding = Blob::EBCT_RAW;
+	if (_override->getAssetWritingFlags(ctx, buffer, 0u)&EWF_COMPRESSED)
+	{
+		const float level = _override->getAssetCompressionLevel(ctx, buffer, 0u);
+		if (level>0.5f)
+			coding = Blob::EBCT_LZMA;
+		else if (CBAWFileWriter::isCodingSupported(Blob::EBCT_ZSTD))
+			coding = Blob::EBCT_ZSTD;
+		else
+			coding = Blob::EBCT_LZ4;
+	}
+
+	CBAWFileWriter writer;
+	writer.addBlob(Blob::EBT_RAW_DATA_BUFFER, 0ull, core::smart_refctd_ptr<const ICPUBuffer>(buffer), coding);
+	return writer.write(file, _params.logger);
+}
+
+}
@@ -0,0 +1,40 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_ASSET_C_BAW_WRITER_H_INCLUDED_
+#define _NBL_ASSET_C_BAW_WRITER_H_INCLUDED_
+
+#include "nbl/asset/interchange/IAssetWriter.h"
+#include "nbl/asset/bawformat/CBAWFileWriter.h"
+
+namespace nbl::asset
+{
+
+//! Writes an ICPUBuffer as a single blob .baw v4 file, use CBAWFileWriter directly to pack many blobs into one file
+class CBAWWriter final : public IAssetWriter
+{
+	protected:
+		~CBAWWriter() = default;
+
+	public:
+		CBAWWriter() = default;
+
+		const char** getAssociatedFileExtensions() const override
+		{
+			static const char* ext[]{ "baw", nullptr };
+			return ext;
+		}
+
+		uint64_t getSupportedAssetTypesBitfield() const override { return IAsset::ET_BUFFER; }
+
+		uint32_t getSupportedFlags() override { return EWF_COMPRESSED|EWF_BINARY; }
+
+		uint32_t getForcedFlags() override { return EWF_BINARY; }
+
+		bool writeAsset(system::IFile* _file, const SAssetWriteParams& _params, IAssetWriterOverride* _override = nullptr) override;
+};
+
+}
+
+#endif
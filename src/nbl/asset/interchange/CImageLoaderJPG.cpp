@@ -175,11 +175,10 @@ asset::SAssetBundle CImageLoaderJPG::loadAsset(system::IFile* _file, const asset
 
 	const std::filesystem::path& Filename = _file->getFileName();
 
-	uint8_t* input = new uint8_t[_file->getSize()];
-
-	system::IFile::success_t success;
-	_file->read(success, input, 0, _file->getSize());
-	if (!success)
+	// decode straight out of the mapping if there is one, otherwise read the file in one go
+	core::vector<uint8_t> fileContents;
+	const uint8_t* const input = IImageAssetHandlerBase::getWholeFileSpan(_file,fileContents);
+	if (!input)
 		return {};
 
 	// allocate and initialize JPEG decompression object
@@ -201,7 +200,6 @@ asset::SAssetBundle CImageLoaderJPG::loadAsset(system::IFile* _file, const asset
 
 	auto exitRoutine = [&] {
 		jpeg_destroy_decompress(&cinfo);
-		delete[] input;
 	};
 	auto exiter = core::makeRAIIExiter(exitRoutine);
 	// compatibility fudge:
@@ -311,16 +309,15 @@ asset::SAssetBundle CImageLoaderJPG::loadAsset(system::IFile* _file, const asset
 
 	// Here we use the library's state variable cinfo.output_scanline as the
 	// loop counter, so that we don't have to keep track ourselves.
-	// Create array of row pointers for lib
-	constexpr uint32_t MaxJPEGResolution = 65535u;
-	uint8_t* rowPtr[MaxJPEGResolution];
+	// Create array of row pointers for lib, rows get decoded directly into the final buffer
+	core::vector<uint8_t*> rowPtr(height);
 	for (uint32_t i = 0; i < height; ++i)
 		rowPtr[i] = &reinterpret_cast<uint8_t*>(buffer->getPointer())[i*rowspan];
 
-	// Read rows from bottom order to match OpenGL coords
-	uint32_t rowsRead = 0;
+	// Ask for all the remaining rows at once, libjpeg will hand back as many as it can
+	// decode in one go (up to `rec_outbuf_height`) instead of a single scanline per call
 	while (cinfo.output_scanline < cinfo.output_height)
-		rowsRead += jpeg_read_scanlines(&cinfo, &rowPtr[rowsRead], 1);
+		jpeg_read_scanlines(&cinfo, rowPtr.data()+cinfo.output_scanline, cinfo.output_height-cinfo.output_scanline);
 	
 	// Finish decompression
 	jpeg_finish_decompress(&cinfo);
@@ -31,12 +31,6 @@ namespace asset
 #ifdef _NBL_COMPILE_WITH_LIBPNG_
 // PNG function for error handling
 
-void updateFilePos(png_structp png_pt, size_t new_file_pos)
-{
-	auto ptr = (CImageLoaderPng::SContext*)png_get_user_chunk_ptr(png_pt);
-	ptr->file_pos = new_file_pos;
-	png_set_read_user_chunk_fn(png_pt, ptr, nullptr);
-}
 static void png_cpexcept_error(png_structp png_ptr, png_const_charp msg)
 {
 	auto ctx = (CImageLoaderPng::SContext*)png_get_user_chunk_ptr(png_ptr);
@@ -51,24 +45,15 @@ static void png_cpexcept_warn(png_structp png_ptr, png_const_charp msg)
 	ctx->logger.log("PNG warning", system::ILogger::ELL_WARNING); // png loader prints stuff that android fails to process 
 }
 
-// PNG function for file reading
+// PNG function for file reading, the whole file is already in memory so this is just a bounds checked memcpy
 void PNGAPI user_read_data_fcn(png_structp png_pt, png_bytep data, png_size_t length)
 {
-	png_size_t check;
-
-	auto* userData = (CImageLoaderPng::SContext*)png_get_user_chunk_ptr(png_pt);
-	size_t file_pos = userData->file_pos;
-
-	system::IFile* file=(system::IFile*)png_get_io_ptr(png_pt);
-
-	system::IFile::success_t success;
-	file->read(success, data, file_pos, length);
-	check = success.getBytesProcessed();
-	file_pos += length;
-	updateFilePos(png_pt, file_pos);
-
-	if (check != length)
+	auto* userData = (CImageLoaderPng::SContext*)png_get_io_ptr(png_pt);
+	if (userData->file_pos+length>userData->size)
 		png_error(png_pt, "Read Error");
+
+	memcpy(data,userData->data+userData->file_pos,length);
+	userData->file_pos += length;
 }
 #endif // _NBL_COMPILE_WITH_LIBPNG_
 
@@ -110,19 +95,17 @@ asset::SAssetBundle CImageLoaderPng::loadAsset(system::IFile* _file, const asset
 	//Used to point to image rows
 	uint8_t** RowPointers = 0;
 
-	png_byte buffer[8];
-	// Read the first few bytes of the PNG _file
-
-	system::IFile::success_t success;
-	_file->read(success, buffer, 0, sizeof(buffer));
-	if (!success)
+	// Get the whole file in one go (no copy at all if its mapped), instead of going through `IFile::read` for every libpng request
+	core::vector<uint8_t> fileContents;
+	const uint8_t* const fileData = IImageAssetHandlerBase::getWholeFileSpan(_file,fileContents);
+	if (!fileData || _file->getSize()<8ull)
 	{
 		_params.logger.log("LOAD PNG: can't read _file\n", system::ILogger::ELL_ERROR, _file->getFileName().string());
         return {};
 	}
 
 	// Check if it really is a PNG _file
-	if( png_sig_cmp(buffer, 0, 8) )
+	if( png_sig_cmp(fileData, 0, 8) )
 	{
 		_params.logger.log("LOAD PNG: not really a png\n", system::ILogger::ELL_ERROR, _file->getFileName().string().c_str());
         return {};
@@ -154,10 +137,10 @@ asset::SAssetBundle CImageLoaderPng::loadAsset(system::IFile* _file, const asset
 			_NBL_DELETE_ARRAY(RowPointers, Height);
         return {};
 	}
-	SContext usrData(_params.logger);
+	SContext usrData(_params.logger,fileData,_file->getSize());
 	png_set_read_user_chunk_fn(png_ptr, &usrData, nullptr);
 
-	png_set_read_fn(png_ptr, _file, user_read_data_fcn);
+	png_set_read_fn(png_ptr, &usrData, user_read_data_fcn);
 
 	png_set_sig_bytes(png_ptr, 8); // Tell png that we read the signature
 
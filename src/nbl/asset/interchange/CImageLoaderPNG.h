@@ -26,11 +26,13 @@ class CImageLoaderPng : public asset::IAssetLoader
 public:
     struct SContext
     {
-        SContext(const system::logger_opt_ptr _logger) :  logger(_logger) {}
-        // Made file_pos initial value 8 cause it's first set to 8 in CImageLoaderPng::loadAsset
-        // and set to 8 but you cannot access this struct from there
-        size_t file_pos = 8;
+        SContext(const system::logger_opt_ptr _logger, const uint8_t* _data, const size_t _size) : logger(_logger), data(_data), size(_size) {}
         system::logger_opt_ptr logger;
+        // whole file contents, libpng gets fed straight from this span
+        const uint8_t* data;
+        size_t size;
+        // starts past the signature which we check ourselves in CImageLoaderPng::loadAsset
+        size_t file_pos = 8;
     };
     explicit CImageLoaderPng() {}
     virtual bool isALoadableFileFormat(system::IFile* _file, const system::logger_opt_ptr logger) const override;
@@ -19,6 +19,7 @@ SOFTWARE.
 */
 #include <algorithm>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -35,6 +36,7 @@ SOFTWARE.
 #include "openexr/OpenEXR/IlmImf/ImfStringAttribute.h"
 #include "openexr/OpenEXR/IlmImf/ImfMatrixAttribute.h"
 #include "openexr/OpenEXR/IlmImf/ImfArray.h"
+#include "openexr/OpenEXR/IlmImf/ImfThreading.h"
 
 #include "openexr/OpenEXR/IlmImf/ImfNamespace.h"
 namespace IMF = Imf;
@@ -48,6 +50,7 @@ using namespace IMATH;
 
 namespace nbl::asset::impl
 {
+	//! Gathers everything OpenEXR outputs in memory (it seeks back to patch the line offset table) and hands it to the file in one write
 	class nblOStream : public IMF::OStream
 	{
 		public:
@@ -65,9 +68,10 @@ namespace nbl::asset::impl
 
 			virtual void write(const char c[/*n*/], int n) override
 			{
-				system::IFile::success_t success;
-				nblFile->write(success, c, fileOffset, n);
-				fileOffset += success.getBytesProcessed();
+				if (fileOffset+n>encoded.size())
+					encoded.resize(fileOffset+n);
+				memcpy(encoded.data()+fileOffset,c,n);
+				fileOffset += n;
 			}
 
 			//---------------------------------------------------------
@@ -97,6 +101,14 @@ namespace nbl::asset::impl
 				fileOffset = 0u;
 			}
 
+			//! call after the `OutputFile` has been destroyed
+			bool flush()
+			{
+				system::IFile::success_t success;
+				nblFile->write(success, encoded.data(), 0ull, encoded.size());
+				return bool(success);
+			}
+
 		private:
 			const std::string getFileName(system::IFile* _nblFile)
 			{
@@ -106,6 +118,7 @@ namespace nbl::asset::impl
 			}
 
 			system::IFile* nblFile;
+			core::vector<char> encoded;
 			size_t fileOffset = {};
 	};
 }
@@ -113,7 +126,7 @@ namespace nbl::asset::impl
 constexpr uint8_t availableChannels = 4;
 
 template<typename ilmType>
-bool createAndWriteImage(std::array<ilmType*,availableChannels>& pixelsArrayIlm, const asset::ICPUImage* image, system::IFile* _file)
+bool createAndWriteImage(std::array<ilmType*,availableChannels>& pixelsArrayIlm, const asset::ICPUImage* image, system::IFile* _file, const IImageWriter::SEncoderParams& encoderParams)
 {
 	const auto& creationParams = image->getCreationParameters();
 	auto getIlmType = [&creationParams]()
@@ -131,6 +144,7 @@ bool createAndWriteImage(std::array<ilmType*,availableChannels>& pixelsArrayIlm,
 	const auto width = creationParams.extent.width;
 	const auto height = creationParams.extent.height;
 	Header header(width, height);
+	header.compression() = static_cast<Compression>(encoderParams.exrCompression);
 	const PixelType pixelType = getIlmType();
 	FrameBuffer frameBuffer;
 
@@ -183,18 +197,29 @@ bool createAndWriteImage(std::array<ilmType*,availableChannels>& pixelsArrayIlm,
 		);
 	}
 
-	IMF::OStream* nblOStream = _NBL_NEW(asset::impl::nblOStream, _file);
+	// the thread count an `OutputFile` gets only decides how many line buffers it keeps in flight, the compression runs on OpenEXR's global pool (which starts out with no threads)
+	const int threadCount = encoderParams.exrThreadCount ? encoderParams.exrThreadCount:globalThreadCount();
+	if (threadCount>globalThreadCount())
+	{
+		static std::mutex poolMutex;
+		std::lock_guard lock(poolMutex);
+		if (threadCount>globalThreadCount())
+			setGlobalThreadCount(threadCount);
+	}
+
+	auto* nblOStream = _NBL_NEW(asset::impl::nblOStream, _file);
 	{ // brackets are needed because of OutputFile's destructor
-		OutputFile file(*nblOStream, header);
+		OutputFile file(*nblOStream, header, threadCount);
 		file.setFrameBuffer(frameBuffer);
 		file.writePixels(height);
 	}
+	const bool success = nblOStream->flush();
 
 	for (auto channelPixelsPtr : pixelsArrayIlm)
 		_NBL_DELETE_ARRAY(channelPixelsPtr, width * height);
 	_NBL_DELETE(nblOStream);
 
-	return true;
+	return success;
 }
 
 bool CImageWriterOpenEXR::writeAsset(system::IFile* _file, const SAssetWriteParams& _params, IAssetWriterOverride* _override)
@@ -215,10 +240,17 @@ bool CImageWriterOpenEXR::writeAsset(system::IFile* _file, const SAssetWritePara
 	if (!file)
 		return false;
 
-	return writeImageBinary(file, image);
+	auto encoderParams = getEncoderParams(_override,ctx,image);
+	if (encoderParams.exrCompression==SEncoderParams::EEC_DERIVE)
+	{
+		const bool smallest = (_override->getAssetWritingFlags(ctx,image,0u)&EWF_COMPRESSED) && _override->getAssetCompressionLevel(ctx,image,0u)>0.5f;
+		encoderParams.exrCompression = smallest ? SEncoderParams::EEC_PIZ:SEncoderParams::EEC_ZIP;
+	}
+
+	return writeImageBinary(file, image, encoderParams);
 }
 
-bool CImageWriterOpenEXR::writeImageBinary(system::IFile* file, const asset::ICPUImage* image)
+bool CImageWriterOpenEXR::writeImageBinary(system::IFile* file, const asset::ICPUImage* image, const SEncoderParams& encoderParams)
 {
 	const auto& params = image->getCreationParameters();
 			
@@ -227,11 +259,11 @@ bool CImageWriterOpenEXR::writeImageBinary(system::IFile* file, const asset::ICP
 	std::array<uint32_t*, availableChannels> uint32_tPixelMapArray = { nullptr, nullptr, nullptr, nullptr };
 
 	if (params.format == EF_R16G16B16A16_SFLOAT)
-		createAndWriteImage(halfPixelMapArray, image, file);
+		return createAndWriteImage(halfPixelMapArray, image, file, encoderParams);
 	else if (params.format == EF_R32G32B32A32_SFLOAT)
-		createAndWriteImage(fullFloatPixelMapArray, image, file);
+		return createAndWriteImage(fullFloatPixelMapArray, image, file, encoderParams);
 	else if (params.format == EF_R32G32B32A32_UINT)
-		createAndWriteImage(uint32_tPixelMapArray, image, file);
+		return createAndWriteImage(uint32_tPixelMapArray, image, file, encoderParams);
 
 	return true;
 }
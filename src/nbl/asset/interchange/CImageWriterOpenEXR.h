@@ -33,7 +33,7 @@ class CImageWriterOpenEXR final : public IImageWriter
 
 		uint64_t getSupportedAssetTypesBitfield() const override { return asset::IAsset::ET_IMAGE_VIEW; }
 
-		uint32_t getSupportedFlags() override { return asset::EWF_BINARY; }
+		uint32_t getSupportedFlags() override { return asset::EWF_BINARY|asset::EWF_COMPRESSED; }
 
 		uint32_t getForcedFlags() { return asset::EWF_BINARY; }
 
@@ -41,7 +41,7 @@ class CImageWriterOpenEXR final : public IImageWriter
 
 	private:
 
-		bool writeImageBinary(system::IFile* file, const asset::ICPUImage* image);
+		bool writeImageBinary(system::IFile* file, const asset::ICPUImage* image, const SEncoderParams& encoderParams);
 };
 
 }
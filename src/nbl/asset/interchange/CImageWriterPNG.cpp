@@ -43,23 +43,15 @@ static void png_cpexcept_warning(png_structp png_ptr, png_const_charp msg)
 	getLogger(png_ptr).log("PNG warning %s", system::ILogger::ELL_WARNING, msg);
 }
 
-// PNG function for file writing
+// PNG function for file writing, we only append to memory and issue one big write at the end
 void PNGAPI user_write_data_fcn(png_structp png_ptr, png_bytep data, png_size_t length)
 {
-	png_size_t check;
-
-	system::IFile* file=(system::IFile*)png_get_io_ptr(png_ptr);
-	//check=(png_size_t) file->write((const void*)data,(uint32_t)length);
-	auto usrData = (CImageWriterPNG::SContext*)png_get_user_chunk_ptr(png_ptr);
-	
-	system::IFile::success_t success;
-	file->write(success, data, usrData->file_pos, length);
-	if (!success)
-		png_error(png_ptr, "Write Error");
-
-	usrData->file_pos += success.getBytesToProcess();
-	png_set_read_user_chunk_fn(png_ptr, usrData, nullptr);
+	auto usrData = (CImageWriterPNG::SContext*)png_get_io_ptr(png_ptr);
+	usrData->encoded.insert(usrData->encoded.end(),data,data+length);
 }
+
+// keep in sync with libpng and zlib
+static_assert(IImageWriter::SEncoderParams::EPF_NONE==PNG_FILTER_NONE && IImageWriter::SEncoderParams::EPF_PAETH==PNG_FILTER_PAETH && IImageWriter::SEncoderParams::EPF_ALL==PNG_ALL_FILTERS);
 #endif // _NBL_COMPILE_WITH_LIBPNG_
 
 CImageWriterPNG::CImageWriterPNG(core::smart_refctd_ptr<system::ISystem>&& sys) : m_system(std::move(sys))
@@ -85,6 +77,11 @@ bool CImageWriterPNG::writeAsset(system::IFile* _file, const SAssetWriteParams&
 	if (!file || !imageView)
 		return false;
 
+	const auto encoderParams = IImageWriter::getEncoderParams(_override,ctx,imageView);
+	int32_t compressionLevel = encoderParams.pngCompressionLevel;
+	if (compressionLevel<0 && (_override->getAssetWritingFlags(ctx,imageView,0u)&asset::EWF_COMPRESSED))
+		compressionLevel = static_cast<int32_t>(core::round(core::clamp(_override->getAssetCompressionLevel(ctx,imageView,0u),0.f,1.f)*9.f));
+
 	// Allocate the png write struct
 	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING,
 		nullptr, (png_error_ptr)png_cpexcept_error, (png_error_ptr)png_cpexcept_warning);
@@ -128,7 +125,17 @@ bool CImageWriterPNG::writeAsset(system::IFile* _file, const SAssetWriteParams&
 	assert(convertedRegion->bufferRowLength && convertedRegion->bufferImageHeight); //Detected changes in createImageDataForCommonWriting!
 	auto trueExtent = core::vector3du32_SIMD(convertedRegion->bufferRowLength, convertedRegion->bufferImageHeight, convertedRegion->imageExtent.depth);
 	
-	png_set_write_fn(png_ptr, file, user_write_data_fcn, nullptr);
+	SContext usrData(m_system.get(), _params.logger);
+	png_set_read_user_chunk_fn(png_ptr, &usrData, nullptr);
+	png_set_write_fn(png_ptr, &usrData, user_write_data_fcn, nullptr);
+
+	// speed vs. ratio knobs, anything not set stays at libpng's defaults
+	if (compressionLevel>=0)
+		png_set_compression_level(png_ptr, core::min(compressionLevel,9));
+	if (encoderParams.pngStrategy!=IImageWriter::SEncoderParams::EPS_DEFAULT)
+		png_set_compression_strategy(png_ptr, encoderParams.pngStrategy);
+	if (encoderParams.pngFilter!=IImageWriter::SEncoderParams::EPF_DEFAULT)
+		png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, encoderParams.pngFilter);
 	
 	// Set info
 	switch (convertedFormat)
@@ -178,17 +185,9 @@ bool CImageWriterPNG::writeAsset(system::IFile* _file, const SAssetWriteParams&
 	}
 	
 	uint8_t* data = (uint8_t*)convertedImage->getBuffer()->getPointer();
-
-	constexpr uint32_t maxPNGFileHeight = 16u * 1024u; // arbitrary limit
-	if (trueExtent.Y>maxPNGFileHeight)
-	{
-		_params.logger.log("PNGWriter: Image dimensions too big!\n %s", system::ILogger::ELL_ERROR, file->getFileName().string().c_str());
-		png_destroy_write_struct(&png_ptr, &info_ptr);
-		return false;
-	}
 	
 	// Create array of pointers to rows in image data
-	png_bytep RowPointers[maxPNGFileHeight];
+	core::vector<png_bytep> RowPointers(trueExtent.Y);
 
 	// Fill array of pointers to rows in image data
 	for (uint32_t i = 0; i < trueExtent.Y; ++i)
@@ -204,12 +203,18 @@ bool CImageWriterPNG::writeAsset(system::IFile* _file, const SAssetWriteParams&
 		return false;
 	}
 
-	SContext usrData(m_system.get(), _params.logger);
-	png_set_read_user_chunk_fn(png_ptr, &usrData, nullptr);
-	png_set_rows(png_ptr, info_ptr, RowPointers);
+	png_set_rows(png_ptr, info_ptr, RowPointers.data());
 	png_write_png(png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, nullptr);
 
 	png_destroy_write_struct(&png_ptr, &info_ptr);
+
+	system::IFile::success_t success;
+	file->write(success, usrData.encoded.data(), 0ull, usrData.encoded.size());
+	if (!success)
+	{
+		_params.logger.log("PNGWriter: Failed to write %s", system::ILogger::ELL_ERROR, file->getFileName().string().c_str());
+		return false;
+	}
 	return true;
 #else
 	_NBL_DEBUG_BREAK_IF(true);
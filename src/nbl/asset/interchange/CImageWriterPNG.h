@@ -10,7 +10,7 @@
 
 #ifdef _NBL_COMPILE_WITH_PNG_WRITER_
 
-#include "nbl/asset/interchange/IAssetWriter.h"
+#include "nbl/asset/interchange/IImageWriter.h"
 
 namespace nbl
 {
@@ -25,8 +25,9 @@ public:
     {
         SContext(system::ISystem* sys, const system::logger_opt_ptr log) : system(sys), logger(log) {}
         system::ISystem* system;
-        size_t file_pos = 0;
         system::logger_opt_ptr logger;
+        // libpng output gets gathered here and handed to the file in a single write
+        core::vector<uint8_t> encoded;
     };
     //! constructor
     explicit CImageWriterPNG(core::smart_refctd_ptr<system::ISystem>&& sys);
@@ -39,7 +40,7 @@ public:
     
     virtual uint64_t getSupportedAssetTypesBitfield() const override { return asset::IAsset::ET_IMAGE_VIEW; }
     
-    virtual uint32_t getSupportedFlags() override { return 0u; }
+    virtual uint32_t getSupportedFlags() override { return asset::EWF_COMPRESSED; }
     
     virtual uint32_t getForcedFlags() { return asset::EWF_BINARY; }
     
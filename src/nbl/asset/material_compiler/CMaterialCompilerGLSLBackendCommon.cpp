@@ -5,7 +5,8 @@
 #include <nbl/asset/material_compiler/CMaterialCompilerGLSLBackendCommon.h>
 
 #include <iostream>
-#include <nbl/asset/material_compiler/CMaterialCompilerGLSLBackendCommon.h>
+
+#include "nbl/core/execution.h"
 
 namespace nbl
 {
@@ -62,6 +63,133 @@ class CInterpreter
 };
 
 
+// intermediate BSDF data of a single material, only merged into the global buffer once the material's prefetch registers are known
+struct SBSDFDataStorage
+{
+	core::vector<instr_stream::intermediate::SBSDFUnion> bsdfData;
+	core::unordered_map<const IR::INode*, size_t> bsdfDataIndexMap;
+	// opcode and node every entry of `bsdfData` was made for
+	core::vector<std::pair<instr_stream::E_OPCODE,const IR::INode*>> bsdfDataSources;
+	// when set the generators only record `bsdfDataSources`, `bsdfData` gets filled in later so that textures get packed in a fixed order
+	bool deferred = false;
+};
+
+// the only place deciding which textures an instruction needs packed into the virtual texture
+template<typename PackTextureFunc>
+static void setBSDFData(instr_stream::intermediate::SBSDFUnion& _dst, instr_stream::E_OPCODE _op, const IR::INode* _node, PackTextureFunc&& packTexture)
+{
+	// the parameters an opcode doesn't use get copied into the final BSDF data all the same
+	memset(&_dst, 0, sizeof(_dst));
+	switch (_op)
+	{
+	case instr_stream::OP_DIFFUSE:
+	{
+		auto* node = static_cast<const IR::CMicrofacetDiffuseBSDFNode*>(_node);
+		if (node->alpha_u.source == IR::INode::EPS_TEXTURE)
+			_dst.diffuse.alpha.setTexture(packTexture(node->alpha_u.value.texture), node->alpha_u.value.texture.scale);
+		else
+			_dst.diffuse.alpha.setConst(node->alpha_u.value.constant);
+		if (node->reflectance.source == IR::INode::EPS_TEXTURE)
+			_dst.diffuse.reflectance.setTexture(packTexture(node->reflectance.value.texture), node->reflectance.value.texture.scale);
+		else
+			_dst.diffuse.reflectance.setConst(node->reflectance.value.constant.pointer);
+	}
+	break;
+	case instr_stream::OP_DIELECTRIC: [[fallthrough]];
+	case instr_stream::OP_THINDIELECTRIC:
+	{
+		auto* node = static_cast<const IR::CMicrofacetDielectricBSDFNode*>(_node);
+
+		if (node->alpha_u.source == IR::INode::EPS_TEXTURE)
+			_dst.dielectric.alpha_u.setTexture(packTexture(node->alpha_u.value.texture), node->alpha_u.value.texture.scale);
+		else
+			_dst.dielectric.alpha_u.setConst(node->alpha_u.value.constant);
+		if (node->alpha_v.source == IR::INode::EPS_TEXTURE)
+			_dst.dielectric.alpha_v.setTexture(packTexture(node->alpha_v.value.texture), node->alpha_v.value.texture.scale);
+		else
+			_dst.dielectric.alpha_v.setConst(node->alpha_v.value.constant);
+		_dst.dielectric.eta = core::rgb32f_to_rgb19e7(node->eta.pointer);
+	}
+	break;
+	case instr_stream::OP_CONDUCTOR:
+	{
+		auto* node = static_cast<const IR::CMicrofacetSpecularBSDFNode*>(_node);
+		
+		if (node->alpha_u.source == IR::INode::EPS_TEXTURE)
+			_dst.conductor.alpha_u.setTexture(packTexture(node->alpha_u.value.texture), node->alpha_u.value.texture.scale);
+		else
+			_dst.conductor.alpha_u.setConst(node->alpha_u.value.constant);
+		if (node->alpha_v.source == IR::INode::EPS_TEXTURE)
+			_dst.conductor.alpha_v.setTexture(packTexture(node->alpha_v.value.texture), node->alpha_v.value.texture.scale);
+		else
+			_dst.conductor.alpha_v.setConst(node->alpha_v.value.constant);
+		_dst.conductor.eta[0] = core::rgb32f_to_rgb19e7(node->eta.pointer);
+		_dst.conductor.eta[1] = core::rgb32f_to_rgb19e7(node->etaK.pointer);
+	}
+	break;
+	case instr_stream::OP_COATING:
+	{
+		auto* coat = static_cast<const IR::CMicrofacetCoatingBSDFNode*>(_node);
+
+		/*
+		if (coat->alpha_u.source == IR::INode::EPS_TEXTURE)
+			_dst.coating.alpha_u.setTexture(packTexture(coat->alpha_u.value.texture), coat->alpha_u.value.texture.scale);
+		else
+			_dst.coating.alpha_u.setConst(coat->alpha_u.value.constant);
+		if (coat->alpha_v.source == IR::INode::EPS_TEXTURE)
+			_dst.coating.alpha_v.setTexture(packTexture(coat->alpha_v.value.texture), coat->alpha_v.value.texture.scale);
+		else
+			_dst.coating.alpha_v.setConst(coat->alpha_v.value.constant);
+		*/
+		if (coat->thicknessSigmaA.source == IR::INode::EPS_TEXTURE)
+			_dst.coating.sigmaA.setTexture(packTexture(coat->thicknessSigmaA.value.texture), coat->thicknessSigmaA.value.texture.scale);
+		else
+			_dst.coating.sigmaA.setConst(coat->thicknessSigmaA.value.constant.pointer);
+
+		_dst.coating.eta = core::rgb32f_to_rgb19e7(coat->eta.pointer);
+		//_dst.coating.thickness = coat->thickness;
+	}
+	break;
+	case instr_stream::OP_BLEND:
+	{
+		auto* b = static_cast<const IR::CBSDFCombinerNode*>(_node);
+		assert(b->type == IR::CBSDFCombinerNode::ET_WEIGHT_BLEND);
+		auto* blend = static_cast<const IR::CBSDFBlendNode*>(b);
+
+		if (blend->weight.source == IR::INode::EPS_TEXTURE)
+			_dst.blend.weight.setTexture(packTexture(blend->weight.value.texture), blend->weight.value.texture.scale);
+		else
+			_dst.blend.weight.setConst(blend->weight.value.constant.pointer);
+	}
+	break;
+	case instr_stream::OP_DIFFTRANS:
+	{
+		auto* difftrans = static_cast<const IR::CMicrofacetDifftransBSDFNode*>(_node);
+
+		if (difftrans->alpha_u.source == IR::INode::EPS_TEXTURE)
+			_dst.difftrans.alpha.setTexture(packTexture(difftrans->alpha_u.value.texture), difftrans->alpha_u.value.texture.scale);
+		else
+			_dst.difftrans.alpha.setConst(difftrans->alpha_u.value.constant);
+		if (difftrans->transmittance.source == IR::INode::EPS_TEXTURE)
+			_dst.difftrans.transmittance.setTexture(packTexture(difftrans->transmittance.value.texture), difftrans->transmittance.value.texture.scale);
+		else
+			_dst.difftrans.transmittance.setConst(difftrans->transmittance.value.constant.pointer);
+	}
+	break;
+	case instr_stream::OP_BUMPMAP:
+	{
+		const IR::CGeomModifierNode* bm = static_cast<const IR::CGeomModifierNode*>(_node);
+
+		assert(bm->type == IR::CGeomModifierNode::ET_DERIVATIVE);
+
+		_dst.bumpmap.derivmap.vtid = bm ? packTexture(bm->texture) : instr_stream::VTID::invalid();
+		core::uintBitsToFloat(_dst.bumpmap.derivmap.scale) = bm ? bm->texture.scale : 0.f;
+	}
+	break;
+	}
+}
+
+
 // TODO: more extreme deduplication?
 class CIdGenerator
 {
@@ -102,6 +230,7 @@ class ITraversalGenerator
 		using SContext = CMaterialCompilerGLSLBackendCommon::SContext;
 
 		SContext* m_ctx;
+		SBSDFDataStorage* m_bsdfStorage;
 		IR* m_ir;
 		CIdGenerator* m_id_gen;
 		tmp_bxdf_translation_cache_t* m_translationCache;
@@ -148,117 +277,6 @@ class ITraversalGenerator
 			return CInterpreter::processSubtree(m_ir, tree, next, m_translationCache);
 		}
 
-		void setBSDFData(instr_stream::intermediate::SBSDFUnion& _dst, instr_stream::E_OPCODE _op, const IR::INode* _node)
-		{
-			switch (_op)
-			{
-			case instr_stream::OP_DIFFUSE:
-			{
-				auto* node = static_cast<const IR::CMicrofacetDiffuseBSDFNode*>(_node);
-				if (node->alpha_u.source == IR::INode::EPS_TEXTURE)
-					_dst.diffuse.alpha.setTexture(packTexture(node->alpha_u.value.texture), node->alpha_u.value.texture.scale);
-				else
-					_dst.diffuse.alpha.setConst(node->alpha_u.value.constant);
-				if (node->reflectance.source == IR::INode::EPS_TEXTURE)
-					_dst.diffuse.reflectance.setTexture(packTexture(node->reflectance.value.texture), node->reflectance.value.texture.scale);
-				else
-					_dst.diffuse.reflectance.setConst(node->reflectance.value.constant.pointer);
-			}
-			break;
-			case instr_stream::OP_DIELECTRIC: [[fallthrough]];
-			case instr_stream::OP_THINDIELECTRIC:
-			{
-				auto* node = static_cast<const IR::CMicrofacetDielectricBSDFNode*>(_node);
-
-				if (node->alpha_u.source == IR::INode::EPS_TEXTURE)
-					_dst.dielectric.alpha_u.setTexture(packTexture(node->alpha_u.value.texture), node->alpha_u.value.texture.scale);
-				else
-					_dst.dielectric.alpha_u.setConst(node->alpha_u.value.constant);
-				if (node->alpha_v.source == IR::INode::EPS_TEXTURE)
-					_dst.dielectric.alpha_v.setTexture(packTexture(node->alpha_v.value.texture), node->alpha_v.value.texture.scale);
-				else
-					_dst.dielectric.alpha_v.setConst(node->alpha_v.value.constant);
-				_dst.dielectric.eta = core::rgb32f_to_rgb19e7(node->eta.pointer);
-			}
-			break;
-			case instr_stream::OP_CONDUCTOR:
-			{
-				auto* node = static_cast<const IR::CMicrofacetSpecularBSDFNode*>(_node);
-				
-				if (node->alpha_u.source == IR::INode::EPS_TEXTURE)
-					_dst.conductor.alpha_u.setTexture(packTexture(node->alpha_u.value.texture), node->alpha_u.value.texture.scale);
-				else
-					_dst.conductor.alpha_u.setConst(node->alpha_u.value.constant);
-				if (node->alpha_v.source == IR::INode::EPS_TEXTURE)
-					_dst.conductor.alpha_v.setTexture(packTexture(node->alpha_v.value.texture), node->alpha_v.value.texture.scale);
-				else
-					_dst.conductor.alpha_v.setConst(node->alpha_v.value.constant);
-				_dst.conductor.eta[0] = core::rgb32f_to_rgb19e7(node->eta.pointer);
-				_dst.conductor.eta[1] = core::rgb32f_to_rgb19e7(node->etaK.pointer);
-			}
-			break;
-			case instr_stream::OP_COATING:
-			{
-				auto* coat = static_cast<const IR::CMicrofacetCoatingBSDFNode*>(_node);
-
-				/*
-				if (coat->alpha_u.source == IR::INode::EPS_TEXTURE)
-					_dst.coating.alpha_u.setTexture(packTexture(coat->alpha_u.value.texture), coat->alpha_u.value.texture.scale);
-				else
-					_dst.coating.alpha_u.setConst(coat->alpha_u.value.constant);
-				if (coat->alpha_v.source == IR::INode::EPS_TEXTURE)
-					_dst.coating.alpha_v.setTexture(packTexture(coat->alpha_v.value.texture), coat->alpha_v.value.texture.scale);
-				else
-					_dst.coating.alpha_v.setConst(coat->alpha_v.value.constant);
-				*/
-				if (coat->thicknessSigmaA.source == IR::INode::EPS_TEXTURE)
-					_dst.coating.sigmaA.setTexture(packTexture(coat->thicknessSigmaA.value.texture), coat->thicknessSigmaA.value.texture.scale);
-				else
-					_dst.coating.sigmaA.setConst(coat->thicknessSigmaA.value.constant.pointer);
-
-				_dst.coating.eta = core::rgb32f_to_rgb19e7(coat->eta.pointer);
-				//_dst.coating.thickness = coat->thickness;
-			}
-			break;
-			case instr_stream::OP_BLEND:
-			{
-				auto* b = static_cast<const IR::CBSDFCombinerNode*>(_node);
-				assert(b->type == IR::CBSDFCombinerNode::ET_WEIGHT_BLEND);
-				auto* blend = static_cast<const IR::CBSDFBlendNode*>(b);
-
-				if (blend->weight.source == IR::INode::EPS_TEXTURE)
-					_dst.blend.weight.setTexture(packTexture(blend->weight.value.texture), blend->weight.value.texture.scale);
-				else
-					_dst.blend.weight.setConst(blend->weight.value.constant.pointer);
-			}
-			break;
-			case instr_stream::OP_DIFFTRANS:
-			{
-				auto* difftrans = static_cast<const IR::CMicrofacetDifftransBSDFNode*>(_node);
-
-				if (difftrans->alpha_u.source == IR::INode::EPS_TEXTURE)
-					_dst.difftrans.alpha.setTexture(packTexture(difftrans->alpha_u.value.texture), difftrans->alpha_u.value.texture.scale);
-				else
-					_dst.difftrans.alpha.setConst(difftrans->alpha_u.value.constant);
-				if (difftrans->transmittance.source == IR::INode::EPS_TEXTURE)
-					_dst.difftrans.transmittance.setTexture(packTexture(difftrans->transmittance.value.texture), difftrans->transmittance.value.texture.scale);
-				else
-					_dst.difftrans.transmittance.setConst(difftrans->transmittance.value.constant.pointer);
-			}
-			break;
-			case instr_stream::OP_BUMPMAP:
-			{
-				const IR::CGeomModifierNode* bm = static_cast<const IR::CGeomModifierNode*>(_node);
-
-				assert(bm->type == IR::CGeomModifierNode::ET_DERIVATIVE);
-
-				_dst.bumpmap.derivmap.vtid = bm ? packTexture(bm->texture) : instr_stream::VTID::invalid();
-				core::uintBitsToFloat(_dst.bumpmap.derivmap.scale) = bm ? bm->texture.scale : 0.f;
-			}
-			break;
-			}
-		}
-
 		size_t getBSDFDataIndex(instr_stream::E_OPCODE _op, const IR::INode* _node)
 		{
 			switch (_op)
@@ -270,57 +288,21 @@ class ITraversalGenerator
 			}
 
 			// TODO: better deduplication
-			auto found = m_ctx->bsdfDataIndexMap.find(_node);
-			if (found != m_ctx->bsdfDataIndexMap.end())
+			auto found = m_bsdfStorage->bsdfDataIndexMap.find(_node);
+			if (found != m_bsdfStorage->bsdfDataIndexMap.end())
 				return found->second;
 
 			instr_stream::intermediate::SBSDFUnion data;
-			setBSDFData(data, _op, _node);
-			size_t ix = m_ctx->bsdfData.size();
-			m_ctx->bsdfDataIndexMap.insert({_node,ix});
-			m_ctx->bsdfData.push_back(data);
+			if (!m_bsdfStorage->deferred)
+				setBSDFData(data, _op, _node, [this](const IR::INode::STextureSource& tex) -> instr_stream::VTID {return m_ctx->packTexture(tex);});
+			size_t ix = m_bsdfStorage->bsdfData.size();
+			m_bsdfStorage->bsdfDataIndexMap.insert({_node,ix});
+			m_bsdfStorage->bsdfData.push_back(data);
+			m_bsdfStorage->bsdfDataSources.emplace_back(_op,_node);
 
 			return ix;
 		}
 
-		instr_stream::VTID packTexture(const IR::INode::STextureSource& tex)
-		{
-			// cache, obviously
-			if (auto found = m_ctx->VTallocMap.find({ tex.image.get(),tex.sampler.get() }); found != m_ctx->VTallocMap.end())
-				return found->second;
-
-			auto img = tex.image->getCreationParameters().image;
-			img = m_ctx->vt.vt->createUpscaledImage(img.get());
-			auto* sampler = tex.sampler.get();
-
-			const auto& extent = img->getCreationParameters().extent;
-			const auto uwrap = static_cast<asset::ISampler::E_TEXTURE_CLAMP>(sampler->getParams().TextureWrapU);
-			const auto vwrap = static_cast<asset::ISampler::E_TEXTURE_CLAMP>(sampler->getParams().TextureWrapV);
-			const auto border = static_cast<asset::ISampler::E_TEXTURE_BORDER_COLOR>(sampler->getParams().BorderColor);
-
-			asset::IImage::SSubresourceRange subres;
-			subres.baseArrayLayer = 0u;
-			subres.layerCount = 1u;
-			subres.baseMipLevel = 0u;
-			const uint32_t mx = std::max(extent.width, extent.height);
-			const uint32_t round = core::roundUpToPoT<uint32_t>(mx);
-			const int32_t lsb = core::findLSB(round);
-			subres.levelCount = static_cast<uint32_t>(lsb + 1);
-
-			SContext::VT::alloc_t alloc;
-			alloc.format = img->getCreationParameters().format;
-			alloc.extent = img->getCreationParameters().extent;
-			alloc.subresource = subres;
-			alloc.uwrap = uwrap;
-			alloc.vwrap = vwrap;
-			auto addr = m_ctx->vt.alloc(alloc, std::move(img), border);
-
-			std::pair<SContext::VTallocKey, instr_stream::VTID> item{{tex.image.get(),tex.sampler.get()}, addr};
-			m_ctx->VTallocMap.insert(item);
-
-			return addr;
-		}
-
 		// returns if the instruction actually got pushed
 		template <typename ...Params>
 		bool push(const instr_t _instr, const IR::INode* _node, const IR::INode::children_array_t& _children, instr_t _parent, Params&& ...args)
@@ -410,6 +392,7 @@ class ITraversalGenerator
 				if (static_cast<const IR::CBSDFBlendNode*>(_node)->weight.source == IR::INode::EPS_TEXTURE)
 					_instr = core::bitfieldInsert<instr_t>(_instr, 1u, instr_stream::BITFIELDS_SHIFT_WEIGHT_TEX, 1);
 			}
+			break;
 			case instr_stream::OP_DIFFTRANS:
 			{
 				auto* difftrans = static_cast<const IR::CMicrofacetDifftransBSDFNode*>(_node);
@@ -428,8 +411,8 @@ class ITraversalGenerator
 		}
 
 	public:
-		ITraversalGenerator(SContext* _ctx, IR* _ir, CIdGenerator* _id_gen, tmp_bxdf_translation_cache_t* _cache, uint32_t _registerBudget) : 
-			m_ctx(_ctx), m_ir(_ir), m_id_gen(_id_gen), m_translationCache(_cache), m_registerBudget(_registerBudget) {}
+		ITraversalGenerator(SContext* _ctx, SBSDFDataStorage* _bsdfStorage, IR* _ir, CIdGenerator* _id_gen, tmp_bxdf_translation_cache_t* _cache, uint32_t _registerBudget) : 
+			m_ctx(_ctx), m_bsdfStorage(_bsdfStorage), m_ir(_ir), m_id_gen(_id_gen), m_translationCache(_cache), m_registerBudget(_registerBudget) {}
 
 		virtual traversal_t genTraversal(const IR::INode* _root, uint32_t& _out_usedRegs) = 0;
 };
@@ -554,8 +537,8 @@ class CTraversalGenerator : public ITraversalGenerator<stack_el>
 		CTraversalManipulator::id2pos_map_t m_id2pos;
 
 	public:
-		CTraversalGenerator(SContext* _ctx, IR* _ir, CIdGenerator* _id_gen, tmp_bxdf_translation_cache_t* _cache, uint32_t _regCount, uint32_t _regsPerResult) :
-			base_t(_ctx, _ir, _id_gen, _cache, _regCount), m_regsPerRes(_regsPerResult)
+		CTraversalGenerator(SContext* _ctx, SBSDFDataStorage* _bsdfStorage, IR* _ir, CIdGenerator* _id_gen, tmp_bxdf_translation_cache_t* _cache, uint32_t _regCount, uint32_t _regsPerResult) :
+			base_t(_ctx, _bsdfStorage, _ir, _id_gen, _cache, _regCount), m_regsPerRes(_regsPerResult)
 		{}
 
 		const auto& getId2PosMapping() const { return m_id2pos; }
@@ -1199,7 +1182,65 @@ std::string CMaterialCompilerGLSLBackendCommon::genPreprocDefinitions(const resu
 	return defs;
 }
 
-auto CMaterialCompilerGLSLBackendCommon::compile(SContext* _ctx, IR* _ir, E_GENERATOR_STREAM_TYPE _generatorChoiceStream) -> result_t
+auto CMaterialCompilerGLSLBackendCommon::SContext::packTexture(const IR::INode::STextureSource& tex) -> instr_stream::VTID
+{
+	// materials get compiled in parallel, but all of them allocate from the same virtual texture
+	std::lock_guard<std::mutex> lock(VTallocMutex);
+
+	// cache, obviously
+	if (auto found = VTallocMap.find({ tex.image.get(),tex.sampler.get() }); found != VTallocMap.end())
+		return found->second;
+
+	auto img = tex.image->getCreationParameters().image;
+	img = vt.vt->createUpscaledImage(img.get());
+	auto* sampler = tex.sampler.get();
+
+	const auto& extent = img->getCreationParameters().extent;
+	const auto uwrap = static_cast<asset::ISampler::E_TEXTURE_CLAMP>(sampler->getParams().TextureWrapU);
+	const auto vwrap = static_cast<asset::ISampler::E_TEXTURE_CLAMP>(sampler->getParams().TextureWrapV);
+	const auto border = static_cast<asset::ISampler::E_TEXTURE_BORDER_COLOR>(sampler->getParams().BorderColor);
+
+	asset::IImage::SSubresourceRange subres;
+	subres.baseArrayLayer = 0u;
+	subres.layerCount = 1u;
+	subres.baseMipLevel = 0u;
+	const uint32_t mx = std::max(extent.width, extent.height);
+	const uint32_t round = core::roundUpToPoT<uint32_t>(mx);
+	const int32_t lsb = core::findLSB(round);
+	subres.levelCount = static_cast<uint32_t>(lsb + 1);
+
+	VT::alloc_t alloc;
+	alloc.format = img->getCreationParameters().format;
+	alloc.extent = img->getCreationParameters().extent;
+	alloc.subresource = subres;
+	alloc.uwrap = uwrap;
+	alloc.vwrap = vwrap;
+	auto addr = vt.alloc(alloc, std::move(img), border);
+
+	std::pair<VTallocKey, instr_stream::VTID> item{{tex.image.get(),tex.sampler.get()}, addr};
+	VTallocMap.insert(item);
+
+	return addr;
+}
+
+// everything a single material root compiles to, before its BSDF data gets merged with everyone else's
+struct SRootCompileOutput
+{
+	// only used when compiling in parallel
+	SBSDFDataStorage bsdfStorage;
+	core::unordered_map<instr_stream::STextureData, uint32_t, instr_stream::STextureData::hash> tex2reg;
+
+	traversal_t rem_pdf_stream;
+	traversal_t gen_choice_stream;
+	traversal_t normal_precomp_stream;
+	instr_stream::tex_prefetch::prefetch_stream_t tex_prefetch_stream;
+
+	uint32_t remainingRegisters = instr_stream::MAX_REGISTER_COUNT;
+	uint32_t usedRegisterCount = 0u;
+	uint32_t prefetchRegCountFlags = 0u;
+};
+
+auto CMaterialCompilerGLSLBackendCommon::compile(SContext* _ctx, IR* _ir, E_GENERATOR_STREAM_TYPE _generatorChoiceStream, const bool _parallel) -> result_t
 {
 	result_t res;
 	res.noNormPrecompStream = true;
@@ -1207,63 +1248,58 @@ auto CMaterialCompilerGLSLBackendCommon::compile(SContext* _ctx, IR* _ir, E_GENE
 	res.usedRegisterCount = 0u;
 	res.globalPrefetchRegCountFlags = 0u;
 
-	for (const IR::INode* root : _ir->roots)
+	// TODO: investigate compression of return value registers from 11 to 5 DWORDs
+	const uint32_t regsPerRes = [_generatorChoiceStream]() -> auto
 	{
-		uint32_t remainingRegisters = instr_stream::MAX_REGISTER_COUNT;
-
-		const size_t interm_bsdf_data_begin_ix = _ctx->bsdfData.size();
+		// In case of presence of generator choice stream, remainder_and_pdf stream has 2 roles in raster backend:
+		// * eval stream
+		// * remainder-and-pdf stream (for use in multiple importance sampling, as an example); in which case instructions need to write their PDF as well
+		// In raytracing backend _computeGenChoiceStream is always present
+		switch (_generatorChoiceStream)
+		{
+			case EGST_PRESENT:
+				return 4u;
+				break;
+			// When desiring Albedo and Normal Extraction, one needs to use extra registers for albedo, normal and throughput scale
+			case EGST_PRESENT_WITH_AOV_EXTRACTION:
+				// TODO: investigate whether using 10-16bit storage (fixed point or half float) makes execution faster, because 
+				// albedo could fit in 1.5 DWORDs as 16bit (or 1 DWORDs as 10 bit), normal+throughput scale in 2 DWORDs as half floats or 16 bit snorm
+				// and value/pdf is a low dynamic range so half float could be feasible! Giving us a total register count of 5 DWORDs.
+				return 11u;
+				break;
+			default:
+				break;
+		}
+		// only colour contribution
+		return 3u; 
+	}();
 
+	// instruction streams of a root, BSDF data gets appended to `storage` for the nodes it has no entry for yet
+	auto generateStreams = [&](const IR::INode* root, SBSDFDataStorage& storage, SRootCompileOutput& out) -> void
+	{
 		CIdGenerator id_gen;
 
 		remainder_and_pdf::CTraversalManipulator::id2pos_map_t id2pos;
 		tmp_bxdf_translation_cache_t translationCache;
 
 		uint32_t usedRegs{};
-		traversal_t rem_pdf_stream;
 		{
-			// TODO: investigate compression of return value registers from 11 to 5 DWORDs
-			const uint32_t regsPerRes = [_generatorChoiceStream]() -> auto
-			{
-				// In case of presence of generator choice stream, remainder_and_pdf stream has 2 roles in raster backend:
-				// * eval stream
-				// * remainder-and-pdf stream (for use in multiple importance sampling, as an example); in which case instructions need to write their PDF as well
-				// In raytracing backend _computeGenChoiceStream is always present
-				switch (_generatorChoiceStream)
-				{
-					case EGST_PRESENT:
-						return 4u;
-						break;
-					// When desiring Albedo and Normal Extraction, one needs to use extra registers for albedo, normal and throughput scale
-					case EGST_PRESENT_WITH_AOV_EXTRACTION:
-						// TODO: investigate whether using 10-16bit storage (fixed point or half float) makes execution faster, because 
-						// albedo could fit in 1.5 DWORDs as 16bit (or 1 DWORDs as 10 bit), normal+throughput scale in 2 DWORDs as half floats or 16 bit snorm
-						// and value/pdf is a low dynamic range so half float could be feasible! Giving us a total register count of 5 DWORDs.
-						return 11u;
-						break;
-					default:
-						break;
-				}
-				// only colour contribution
-				return 3u; 
-			}();
-
-			remainder_and_pdf::CTraversalGenerator gen(_ctx, _ir, &id_gen, &translationCache, remainingRegisters, regsPerRes);
-			rem_pdf_stream = gen.genTraversal(root, usedRegs);
-			assert(usedRegs <= remainingRegisters);
-			remainingRegisters -= usedRegs;
+			remainder_and_pdf::CTraversalGenerator gen(_ctx, &storage, _ir, &id_gen, &translationCache, out.remainingRegisters, regsPerRes);
+			out.rem_pdf_stream = gen.genTraversal(root, usedRegs);
+			assert(usedRegs <= out.remainingRegisters);
+			out.remainingRegisters -= usedRegs;
 			id2pos = gen.getId2PosMapping();
 		}
-		traversal_t gen_choice_stream;
 		if (_generatorChoiceStream!=EGST_ABSENT)
 		{
-			gen_choice::CTraversalGenerator gen(_ctx, _ir, &id_gen, &translationCache, 0u);
+			gen_choice::CTraversalGenerator gen(_ctx, &storage, _ir, &id_gen, &translationCache, 0u);
 			// generator stream does not consume any registers
 			uint32_t dummyUsedRegs;
-			gen_choice_stream = gen.genTraversal(root,dummyUsedRegs);
+			out.gen_choice_stream = gen.genTraversal(root,dummyUsedRegs);
 			assert(dummyUsedRegs==0u);
 
 			// final instructions in generator choice need to know which instruction in the remainder&pdf stream corresponds to the same BxDF
-			for (auto& instr : gen_choice_stream)
+			for (auto& instr : out.gen_choice_stream)
 			{
 				const instr_stream::instr_id_t id = instr_stream::getInstrId(instr);
 				uint32_t rnp_pos = static_cast<uint32_t>(-1);
@@ -1272,24 +1308,27 @@ auto CMaterialCompilerGLSLBackendCommon::compile(SContext* _ctx, IR* _ir, E_GENE
 				instr_stream::gen_choice::setOffsetIntoRemAndPdfStream(instr, rnp_pos);
 			}
 		}
-
+	};
+	// needs the BSDF data of every instruction of the root filled in
+	auto allocatePrefetchAndNormalRegisters = [this](const SBSDFDataStorage& storage, SRootCompileOutput& out) -> void
+	{
+		uint32_t& remainingRegisters = out.remainingRegisters;
 		// Texture Prefetch and Normal Precompute dont allocate their registers first because we count on 
-		instr_stream::tex_prefetch::prefetch_stream_t tex_prefetch_stream;
-		core::unordered_map<instr_stream::STextureData, uint32_t, instr_stream::STextureData::hash> tex2reg;
 		{
-			tex_prefetch_stream = tex_prefetch::genTraversal(rem_pdf_stream, _ctx->bsdfData, tex2reg, instr_stream::MAX_REGISTER_COUNT-remainingRegisters, usedRegs, res.globalPrefetchRegCountFlags);
+			uint32_t usedRegs{};
+			out.tex_prefetch_stream = tex_prefetch::genTraversal(out.rem_pdf_stream, storage.bsdfData, out.tex2reg, instr_stream::MAX_REGISTER_COUNT-remainingRegisters, usedRegs, out.prefetchRegCountFlags);
 			assert(usedRegs <= remainingRegisters);
 			remainingRegisters -= usedRegs;
 		}
 
-		traversal_t normal_precomp_stream;
+		traversal_t& normal_precomp_stream = out.normal_precomp_stream;
 		// register allocation for bumpmaps is a nice linear affair
 		// TODO: investigate performance impact of quantizing normals to 16 or 21bit SNORM
 		const uint32_t firstRegForBumpmaps = instr_stream::MAX_REGISTER_COUNT-remainingRegisters;
 		{
-			normal_precomp_stream.reserve(std::count_if(rem_pdf_stream.begin(), rem_pdf_stream.end(), [](instr_t i) {return instr_stream::getOpcode(i)==instr_stream::OP_BUMPMAP;}));
+			normal_precomp_stream.reserve(std::count_if(out.rem_pdf_stream.begin(), out.rem_pdf_stream.end(), [](instr_t i) {return instr_stream::getOpcode(i)==instr_stream::OP_BUMPMAP;}));
 			assert(firstRegForBumpmaps+3u*normal_precomp_stream.capacity() <= instr_stream::MAX_REGISTER_COUNT);
-			for (instr_t instr : rem_pdf_stream)
+			for (instr_t instr : out.rem_pdf_stream)
 			{
 				if (instr_stream::getOpcode(instr)==instr_stream::OP_BUMPMAP)
 				{
@@ -1304,51 +1343,127 @@ auto CMaterialCompilerGLSLBackendCommon::compile(SContext* _ctx, IR* _ir, E_GENE
 		}
 
 		//src1 reg for OP_BUMPMAPs is set to dst reg of corresponding instruction in normal precomp stream
-		setSourceRegForBumpmaps(rem_pdf_stream, firstRegForBumpmaps);
-		setSourceRegForBumpmaps(gen_choice_stream, firstRegForBumpmaps);
+		setSourceRegForBumpmaps(out.rem_pdf_stream, firstRegForBumpmaps);
+		setSourceRegForBumpmaps(out.gen_choice_stream, firstRegForBumpmaps);
 
-		for (auto it = _ctx->bsdfData.begin()+interm_bsdf_data_begin_ix; it != _ctx->bsdfData.end(); ++it)
+		out.usedRegisterCount = instr_stream::MAX_REGISTER_COUNT-remainingRegisters;
+	};
+	// final BSDF data refers to the prefetch registers of the root which made it
+	auto resolveBSDFData = [&res](const instr_stream::intermediate::SBSDFUnion& interm_bsdf_data, const SRootCompileOutput& out) -> void
+	{
+		instr_stream::SBSDFUnion bsdf_data;
+		// not every opcode uses the whole union, zero it so the output does not depend on stack garbage
+		memset(&bsdf_data, 0, sizeof(bsdf_data));
+		for (uint32_t i = 0u; i < instr_stream::SBSDFUnion::MAX_TEXTURES; ++i)
 		{
-			const auto& interm_bsdf_data = *it;
-
-			instr_stream::SBSDFUnion bsdf_data;
-			for (uint32_t i = 0u; i < instr_stream::SBSDFUnion::MAX_TEXTURES; ++i)
-			{
-				auto found = tex2reg.find(interm_bsdf_data.common.param[i].tex);
-				if (found != tex2reg.end())
-					bsdf_data.common.param[i].setPrefetchReg(found->second);
-				else
-					bsdf_data.common.param[i].setConst(interm_bsdf_data.common.param[i].getConst());
-			}
-			bsdf_data.common.extras[0] = interm_bsdf_data.common.extras[0];
-			bsdf_data.common.extras[1] = interm_bsdf_data.common.extras[1];
-
-			res.bsdfData.push_back(bsdf_data);
+			auto found = out.tex2reg.find(interm_bsdf_data.common.param[i].tex);
+			if (found != out.tex2reg.end())
+				bsdf_data.common.param[i].setPrefetchReg(found->second);
+			else
+				bsdf_data.common.param[i].setConst(interm_bsdf_data.common.param[i].getConst());
 		}
+		bsdf_data.common.extras[0] = interm_bsdf_data.common.extras[0];
+		bsdf_data.common.extras[1] = interm_bsdf_data.common.extras[1];
 
+		res.bsdfData.push_back(bsdf_data);
+	};
+	auto appendStreams = [&res](const IR::INode* root, const SRootCompileOutput& out) -> void
+	{
 		result_t::instr_streams_t streams;
 		{
 			streams.offset = res.instructions.size();
 
-			streams.rem_and_pdf_count = rem_pdf_stream.size();
-			res.instructions.insert(res.instructions.end(), rem_pdf_stream.begin(), rem_pdf_stream.end());
+			streams.rem_and_pdf_count = out.rem_pdf_stream.size();
+			res.instructions.insert(res.instructions.end(), out.rem_pdf_stream.begin(), out.rem_pdf_stream.end());
 
-			streams.gen_choice_count = gen_choice_stream.size();
-			res.instructions.insert(res.instructions.end(), gen_choice_stream.begin(), gen_choice_stream.end());
+			streams.gen_choice_count = out.gen_choice_stream.size();
+			res.instructions.insert(res.instructions.end(), out.gen_choice_stream.begin(), out.gen_choice_stream.end());
 
-			streams.norm_precomp_count = normal_precomp_stream.size();
-			res.instructions.insert(res.instructions.end(), normal_precomp_stream.begin(), normal_precomp_stream.end());
+			streams.norm_precomp_count = out.normal_precomp_stream.size();
+			res.instructions.insert(res.instructions.end(), out.normal_precomp_stream.begin(), out.normal_precomp_stream.end());
 
 			streams.prefetch_offset = res.prefetch_stream.size();
-			streams.tex_prefetch_count = tex_prefetch_stream.size();
-			res.prefetch_stream.insert(res.prefetch_stream.end(), tex_prefetch_stream.begin(), tex_prefetch_stream.end());
+			streams.tex_prefetch_count = out.tex_prefetch_stream.size();
+			res.prefetch_stream.insert(res.prefetch_stream.end(), out.tex_prefetch_stream.begin(), out.tex_prefetch_stream.end());
 		}
 
 		res.streams.insert({root,streams});
 
 		res.noNormPrecompStream = res.noNormPrecompStream && (streams.norm_precomp_count==0u);
 		res.noPrefetchStream = res.noPrefetchStream && (streams.tex_prefetch_count==0u);
-		res.usedRegisterCount = std::max(res.usedRegisterCount, instr_stream::MAX_REGISTER_COUNT-remainingRegisters);
+		res.usedRegisterCount = std::max(res.usedRegisterCount, out.usedRegisterCount);
+		res.globalPrefetchRegCountFlags |= out.prefetchRegCountFlags;
+	};
+
+	if (!_parallel)
+	{
+		// nodes shared between roots keep the BSDF data made (and resolved against the prefetch registers of) the first root using them
+		SBSDFDataStorage bsdfStorage;
+		for (const IR::INode* root : _ir->roots)
+		{
+			SRootCompileOutput out;
+			const size_t interm_bsdf_data_begin_ix = bsdfStorage.bsdfData.size();
+			generateStreams(root, bsdfStorage, out);
+			allocatePrefetchAndNormalRegisters(bsdfStorage, out);
+			for (auto it = bsdfStorage.bsdfData.begin()+interm_bsdf_data_begin_ix; it != bsdfStorage.bsdfData.end(); ++it)
+				resolveBSDFData(*it, out);
+			appendStreams(root, out);
+		}
+	}
+	else
+	{
+		core::vector<SRootCompileOutput> perRoot(_ir->roots.size());
+		auto rootOf = [&](const SRootCompileOutput& out) -> const IR::INode* {return _ir->roots[&out-perRoot.data()];};
+
+		// every root only reads the IR and writes its own output (temporary IR nodes are synchronized),
+		// BSDF data is only recorded because the order of the virtual texture allocations must not depend on the scheduling
+		core::for_each(core::execution::par,perRoot.begin(),perRoot.end(),[&](SRootCompileOutput& out) -> void
+		{
+			out.bsdfStorage.deferred = true;
+			generateStreams(rootOf(out),out.bsdfStorage,out);
+		});
+		// same allocation order as the serial compile, nodes an earlier root already had only hit the `packTexture` cache
+		for (auto& out : perRoot)
+		{
+			auto& storage = out.bsdfStorage;
+			for (size_t j=0u; j<storage.bsdfData.size(); j++)
+				setBSDFData(storage.bsdfData[j],storage.bsdfDataSources[j].first,storage.bsdfDataSources[j].second,[_ctx](const IR::INode::STextureSource& tex) -> instr_stream::VTID {return _ctx->packTexture(tex);});
+		}
+		core::for_each(core::execution::par,perRoot.begin(),perRoot.end(),[&](SRootCompileOutput& out) -> void
+		{
+			allocatePrefetchAndNormalRegisters(out.bsdfStorage,out);
+		});
+
+		// merge in root order, a node gets the BSDF data index the first root using it gave it, exactly like in the serial compile
+		core::unordered_map<const IR::INode*,uint32_t> bsdfDataIndexMap;
+		for (auto& out : perRoot)
+		{
+			const auto& storage = out.bsdfStorage;
+			core::vector<uint32_t> localToGlobalBSDFDataIx(storage.bsdfData.size());
+			for (size_t j=0u; j<storage.bsdfData.size(); j++)
+			{
+				auto inserted = bsdfDataIndexMap.emplace(storage.bsdfDataSources[j].second,static_cast<uint32_t>(res.bsdfData.size()));
+				if (inserted.second)
+					resolveBSDFData(storage.bsdfData[j], out);
+				localToGlobalBSDFDataIx[j] = inserted.first->second;
+			}
+			auto remapBSDFDataIx = [&localToGlobalBSDFDataIx](traversal_t& stream) -> void
+			{
+				for (instr_t& instr : stream)
+				{
+					if (!instr_stream::opHasBSDFData(instr_stream::getOpcode(instr)))
+						continue;
+					const uint32_t ix = instr_stream::getBSDFDataIx(instr);
+					assert(ix<localToGlobalBSDFDataIx.size());
+					instr_stream::setBSDFDataIx(instr, localToGlobalBSDFDataIx[ix]);
+				}
+			};
+			remapBSDFDataIx(out.rem_pdf_stream);
+			remapBSDFDataIx(out.gen_choice_stream);
+			remapBSDFDataIx(out.normal_precomp_stream);
+
+			appendStreams(rootOf(out), out);
+		}
 	}
 
 	_ir->deinitTmpNodes();
@@ -1428,6 +1543,21 @@ auto CMaterialCompilerGLSLBackendCommon::compile(SContext* _ctx, IR* _ir, E_GENE
 		}
 	}
 
+	{
+		auto& stats = res.statistics;
+		for (const auto& e : res.streams)
+		{
+			stats.remAndPdfInstrCount += e.second.rem_and_pdf_count;
+			stats.genChoiceInstrCount += e.second.gen_choice_count;
+			stats.normPrecompInstrCount += e.second.norm_precomp_count;
+			stats.texPrefetchInstrCount += e.second.tex_prefetch_count;
+		}
+		stats.bsdfDataCount = res.bsdfData.size();
+		stats.instructionsSize = res.instructions.size()*sizeof(instr_t);
+		stats.prefetchStreamSize = res.prefetch_stream.size()*sizeof(instr_stream::tex_prefetch::prefetch_instr_t);
+		stats.bsdfDataSize = res.bsdfData.size()*sizeof(instr_stream::SBSDFUnion);
+	}
+
 	res.fragmentShaderSource_declarations =
 		genPreprocDefinitions(res, _generatorChoiceStream) +
 R"(
@@ -1437,6 +1567,111 @@ R"(
 	return res;
 }
 
+void CMaterialCompilerGLSLBackendCommon::canonicalizeStreams(result_t& _res, E_INSTR_ENCODING _encoding)
+{
+	auto& shared = _res.shared;
+	shared = {};
+
+	// `streams` is unordered, go through the materials in the order their streams were laid out for deterministic output
+	core::vector<std::pair<const IR::INode*,result_t::instr_streams_t>> materials(_res.streams.begin(), _res.streams.end());
+	std::sort(materials.begin(), materials.end(), [](const auto& lhs, const auto& rhs) { return lhs.second.offset<rhs.second.offset; });
+
+	// canonical traversal (all 3 streams back to back) -> its offset in `shared.instructions`
+	core::unordered_map<std::string, uint32_t> traversalDedup;
+	traversal_t canonical;
+	core::vector<uint32_t> paramBlock;
+	for (const auto& material : materials)
+	{
+		const auto& streams = material.second;
+		const uint32_t count = streams.rem_and_pdf_count+streams.gen_choice_count+streams.norm_precomp_count;
+
+		// BSDF data indices get replaced with slots numbered in order of first use
+		canonical.assign(_res.instructions.begin()+streams.offset, _res.instructions.begin()+streams.offset+count);
+		paramBlock.clear();
+		for (instr_t& instr : canonical)
+		{
+			if (!instr_stream::opHasBSDFData(instr_stream::getOpcode(instr)))
+				continue;
+			const uint32_t ix = instr_stream::getBSDFDataIx(instr);
+			auto slot = std::find(paramBlock.begin(), paramBlock.end(), ix);
+			if (slot==paramBlock.end())
+				slot = paramBlock.insert(slot, ix);
+			instr_stream::setBSDFDataIx(instr, static_cast<uint32_t>(std::distance(paramBlock.begin(), slot)));
+		}
+
+		// the split between the streams is part of the key as well
+		const uint32_t counts[3] = { streams.rem_and_pdf_count,streams.gen_choice_count,streams.norm_precomp_count };
+		std::string key(reinterpret_cast<const char*>(counts), sizeof(counts));
+		key.append(reinterpret_cast<const char*>(canonical.data()), canonical.size()*sizeof(instr_t));
+		auto found = traversalDedup.emplace(std::move(key), static_cast<uint32_t>(shared.instructions.size()));
+		if (found.second)
+			shared.instructions.insert(shared.instructions.end(), canonical.begin(), canonical.end());
+
+		result_t::shared_streams_t::material_ref_t ref;
+		ref.streams = streams;
+		ref.streams.offset = found.first->second;
+		ref.paramBlockOffset = shared.paramBlocks.size();
+		ref.paramBlockSize = paramBlock.size();
+		shared.paramBlocks.insert(shared.paramBlocks.end(), paramBlock.begin(), paramBlock.end());
+		shared.materials.insert({material.first,ref});
+	}
+
+	if (_encoding==EIE_VARIABLE_LENGTH)
+		shared.encodedInstructions = encodeVariableLength(shared.instructions);
+
+	auto& stats = _res.statistics;
+	stats.uniqueTraversalCount = traversalDedup.size();
+	stats.sharedInstructionsSize = shared.instructions.size()*sizeof(instr_t);
+	stats.paramBlocksSize = shared.paramBlocks.size()*sizeof(uint32_t);
+	stats.encodedInstructionsSize = shared.encodedInstructions.size();
+}
+
+core::vector<uint8_t> CMaterialCompilerGLSLBackendCommon::encodeVariableLength(const instr_stream::traversal_t& _stream)
+{
+	core::vector<uint8_t> out;
+	out.reserve(_stream.size()*sizeof(instr_t)/2u);
+
+	// neighbouring instructions usually differ only in a few low bits, the XOR keeps the varints short
+	instr_t prev = 0ull;
+	for (const instr_t instr : _stream)
+	{
+		instr_t delta = instr^prev;
+		prev = instr;
+		do
+		{
+			uint8_t byte = delta&0x7full;
+			delta >>= 7u;
+			if (delta)
+				byte |= 0x80u;
+			out.push_back(byte);
+		} while (delta);
+	}
+	return out;
+}
+
+bool CMaterialCompilerGLSLBackendCommon::decodeVariableLength(const uint8_t* _data, size_t _size, instr_stream::traversal_t& _outStream)
+{
+	_outStream.clear();
+
+	instr_t prev = 0ull;
+	for (size_t i=0u; i<_size;)
+	{
+		instr_t delta = 0ull;
+		for (uint32_t shift=0u; ; shift+=7u)
+		{
+			if (i>=_size || shift>=64u)
+				return false;
+			const uint8_t byte = _data[i++];
+			delta |= static_cast<instr_t>(byte&0x7fu)<<shift;
+			if (!(byte&0x80u))
+				break;
+		}
+		prev ^= delta;
+		_outStream.push_back(prev);
+	}
+	return true;
+}
+
 }
 void material_compiler::CMaterialCompilerGLSLBackendCommon::debugPrint(std::ostream& _out, const result_t::instr_streams_t& _streams, const result_t& _res, const SContext* _ctx) const
 {
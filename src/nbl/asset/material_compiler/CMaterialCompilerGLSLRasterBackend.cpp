@@ -7,9 +7,9 @@
 namespace nbl::asset::material_compiler
 {
 
-auto CMaterialCompilerGLSLRasterBackend::compile(SContext* _ctx, IR* _ir, E_GENERATOR_STREAM_TYPE _generatorChoiceStream) -> result_t
+auto CMaterialCompilerGLSLRasterBackend::compile(SContext* _ctx, IR* _ir, E_GENERATOR_STREAM_TYPE _generatorChoiceStream, const bool _parallel) -> result_t
 {
-    result_t res = base_t::compile(_ctx, _ir, _generatorChoiceStream);
+    result_t res = base_t::compile(_ctx, _ir, _generatorChoiceStream, _parallel);
 
     res.fragmentShaderSource = 
     R"(
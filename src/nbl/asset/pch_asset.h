@@ -47,6 +47,7 @@
 #include "nbl/asset/interchange/CSTLMeshWriter.h"
 // manipulation
 #include "nbl/asset/utils/CForsythVertexCacheOptimizer.h"
+#include "nbl/asset/utils/CTipsifyVertexCacheOptimizer.h"
 #include "nbl/asset/utils/CSmoothNormalGenerator.h"
 #include "nbl/asset/utils/COverdrawMeshOptimizer.h"
 #include "nbl/asset/utils/CMeshManipulator.h"
@@ -0,0 +1,881 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/core/declarations.h"
+#include "nbl/core/execution.h"
+
+#include "nbl/asset/ICPUMeshBuffer.h"
+#include "nbl/asset/utils/CCPUBVH.h"
+
+#include <numeric>
+
+namespace nbl::asset
+{
+
+namespace
+{
+
+// past this depth the builder switches to median splits, which bounds the traversal stack
+constexpr uint32_t MaxSAHDepth = 96u;
+constexpr uint32_t TraversalStackSize = 512u;
+constexpr uint32_t ParallelChunkSize = 0x1u<<12u;
+constexpr uint32_t MaxParallelChunks = 256u;
+
+inline float halfArea(const core::vectorSIMDf& minEdge, const core::vectorSIMDf& maxEdge)
+{
+	const core::vectorSIMDf extent = maxEdge-minEdge;
+	return extent.x*extent.y+extent.x*extent.z+extent.y*extent.z;
+}
+
+// runs `f(chunkBegin,chunkEnd,chunkIx)` over chunks of [begin,end) in parallel, returns the chunk count
+template<typename F>
+uint32_t parallelChunks(const uint32_t begin, const uint32_t end, F&& f)
+{
+	const uint32_t chunkCount = std::clamp<uint32_t>((end-begin)/ParallelChunkSize,1u,MaxParallelChunks);
+	core::vector<uint32_t> chunks(chunkCount);
+	std::iota(chunks.begin(),chunks.end(),0u);
+	core::for_each(core::execution::par,chunks.begin(),chunks.end(),[&](const uint32_t chunk) -> void
+	{
+		const uint64_t count = end-begin;
+		f(begin+uint32_t(count*chunk/chunkCount),begin+uint32_t(count*(chunk+1u)/chunkCount),chunk);
+	});
+	return chunkCount;
+}
+
+}
+
+struct CCPUBVH::SRayInternal
+{
+	SRayInternal() = default;
+	SRayInternal(const SRay& ray)
+	{
+		origin = ray.origin;
+		origin.w = 0.f;
+		direction = ray.direction;
+		direction.w = 0.f;
+		for (uint32_t i=0u; i<3u; i++)
+		{
+			// avoid 0*inf in the slab test
+			float d = direction.pointer[i];
+			if (std::abs(d)<1e-30f)
+				d = std::copysign(1e-30f,d);
+			invDirection.pointer[i] = 1.f/d;
+			nearRow[i] = i*2u+(d<0.f ? 1u:0u);
+		}
+		invDirection.w = 0.f;
+		ox = _mm_set1_ps(origin.x);
+		oy = _mm_set1_ps(origin.y);
+		oz = _mm_set1_ps(origin.z);
+		idx = _mm_set1_ps(invDirection.x);
+		idy = _mm_set1_ps(invDirection.y);
+		idz = _mm_set1_ps(invDirection.z);
+		tMin = ray.tMin;
+		mask = ray.mask;
+	}
+
+	//! returns the bitmask of children hit before `tMax`
+	inline uint32_t intersect(const SNode& node, const float tMax, __m128& outNear) const
+	{
+		const __m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearRow[0]]),ox),idx);
+		const __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearRow[0]^1u]),ox),idx);
+		const __m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearRow[1]]),oy),idy);
+		const __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearRow[1]^1u]),oy),idy);
+		const __m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearRow[2]]),oz),idz);
+		const __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearRow[2]^1u]),oz),idz);
+		outNear = _mm_max_ps(_mm_max_ps(tx0,ty0),_mm_max_ps(tz0,_mm_set1_ps(tMin)));
+		const __m128 tFar = _mm_min_ps(_mm_min_ps(tx1,ty1),_mm_min_ps(tz1,_mm_set1_ps(tMax)));
+		return _mm_movemask_ps(_mm_cmple_ps(outNear,tFar));
+	}
+
+	core::vectorSIMDf origin;
+	core::vectorSIMDf direction;
+	core::vectorSIMDf invDirection;
+	__m128 ox, oy, oz;
+	__m128 idx, idy, idz;
+	uint32_t nearRow[3];
+	float tMin;
+	uint32_t mask;
+};
+
+class CCPUBVH::CBuilder
+{
+	public:
+		struct SPrimRef
+		{
+			core::vectorSIMDf minEdge;
+			core::vectorSIMDf maxEdge;
+			uint32_t index;
+		};
+
+		CBuilder(const SBuildParams& params, core::vector<SPrimRef>& refs) : m_params(params), m_refs(refs)
+		{
+			assert(m_params.maxLeafSize && m_params.maxLeafSize<=MAX_LEAF_SIZE);
+			assert(m_params.binCount>=2u);
+		}
+
+		inline void build(core::vector<SNode>& nodes)
+		{
+			nodes.clear();
+			const uint32_t count = m_refs.size();
+			if (count==0u)
+				return;
+
+			// the upper levels bin in parallel and defer the subtrees
+			core::vector<STask> tasks;
+			buildNode(0u,count,0u,nodes,count>=m_params.parallelSubtreeThreshold ? &tasks:nullptr);
+
+			core::vector<core::vector<SNode>> subtrees(tasks.size());
+			core::for_each(core::execution::par,tasks.begin(),tasks.end(),[&](const STask& task) -> void
+			{
+				buildNode(task.begin,task.end,task.depth,subtrees[&task-tasks.data()],nullptr);
+			});
+
+			for (uint32_t i=0u; i<tasks.size(); i++)
+			{
+				const uint32_t base = nodes.size();
+				for (auto node : subtrees[i])
+				{
+					for (auto& child : node.children)
+					if (child!=INVALID_INDEX && !SNode::isLeaf(child))
+						child += base;
+					nodes.push_back(node);
+				}
+				nodes[tasks[i].parent].children[tasks[i].slot] = base;
+			}
+		}
+
+	private:
+		struct STask
+		{
+			uint32_t begin, end;
+			uint32_t depth;
+			uint32_t parent;
+			uint32_t slot;
+		};
+		struct SBounds
+		{
+			SBounds() : minEdge(FLT_MAX), maxEdge(-FLT_MAX), centroidMin(FLT_MAX), centroidMax(-FLT_MAX) {}
+
+			inline void extend(const SPrimRef& ref)
+			{
+				minEdge = core::min(minEdge,ref.minEdge);
+				maxEdge = core::max(maxEdge,ref.maxEdge);
+				const core::vectorSIMDf centroid = (ref.minEdge+ref.maxEdge)*0.5f;
+				centroidMin = core::min(centroidMin,centroid);
+				centroidMax = core::max(centroidMax,centroid);
+			}
+			inline void extend(const SBounds& other)
+			{
+				minEdge = core::min(minEdge,other.minEdge);
+				maxEdge = core::max(maxEdge,other.maxEdge);
+				centroidMin = core::min(centroidMin,other.centroidMin);
+				centroidMax = core::max(centroidMax,other.centroidMax);
+			}
+
+			core::vectorSIMDf minEdge, maxEdge;
+			core::vectorSIMDf centroidMin, centroidMax;
+		};
+		struct SBin
+		{
+			SBin() : minEdge(FLT_MAX), maxEdge(-FLT_MAX), count(0u) {}
+
+			core::vectorSIMDf minEdge, maxEdge;
+			uint32_t count;
+		};
+
+		inline SBounds computeBounds(const uint32_t begin, const uint32_t end, const bool parallel) const
+		{
+			SBounds retval;
+			if (parallel && end-begin>ParallelChunkSize)
+			{
+				core::vector<SBounds> partial(MaxParallelChunks);
+				const uint32_t chunkCount = parallelChunks(begin,end,[&](const uint32_t chunkBegin, const uint32_t chunkEnd, const uint32_t chunk) -> void
+				{
+					for (uint32_t i=chunkBegin; i<chunkEnd; i++)
+						partial[chunk].extend(m_refs[i]);
+				});
+				for (uint32_t i=0u; i<chunkCount; i++)
+					retval.extend(partial[i]);
+			}
+			else
+			for (uint32_t i=begin; i<end; i++)
+				retval.extend(m_refs[i]);
+			return retval;
+		}
+
+		inline uint32_t medianSplit(const uint32_t begin, const uint32_t end, const SBounds& bounds) const
+		{
+			const core::vectorSIMDf extent = bounds.centroidMax-bounds.centroidMin;
+			const uint32_t axis = extent.x>=extent.y ? (extent.x>=extent.z ? 0u:2u):(extent.y>=extent.z ? 1u:2u);
+			const uint32_t mid = begin+(end-begin)/2u;
+			std::nth_element(m_refs.begin()+begin,m_refs.begin()+mid,m_refs.begin()+end,[axis](const SPrimRef& a, const SPrimRef& b) -> bool
+			{
+				return a.minEdge.pointer[axis]+a.maxEdge.pointer[axis]<b.minEdge.pointer[axis]+b.maxEdge.pointer[axis];
+			});
+			return mid;
+		}
+
+		//! binned SAH split of a range with more than one primitive, returns the first primitive of the right half
+		inline uint32_t split(const uint32_t begin, const uint32_t end, const uint32_t depth, const bool parallel) const
+		{
+			const SBounds bounds = computeBounds(begin,end,parallel);
+			if (depth>=MaxSAHDepth)
+				return medianSplit(begin,end,bounds);
+
+			const uint32_t binCount = m_params.binCount;
+			const core::vectorSIMDf extent = bounds.centroidMax-bounds.centroidMin;
+			core::vectorSIMDf scale;
+			for (uint32_t axis=0u; axis<3u; axis++)
+				scale.pointer[axis] = extent.pointer[axis]>0.f ? float(binCount)*0.99999f/extent.pointer[axis]:0.f;
+			auto getBin = [&](const SPrimRef& ref, const uint32_t axis) -> uint32_t
+			{
+				const float centroid = (ref.minEdge.pointer[axis]+ref.maxEdge.pointer[axis])*0.5f;
+				return std::min<uint32_t>((centroid-bounds.centroidMin.pointer[axis])*scale.pointer[axis],binCount-1u);
+			};
+
+			// bins for all 3 axes
+			core::vector<SBin> bins(binCount*3u);
+			auto binRange = [&](const uint32_t rangeBegin, const uint32_t rangeEnd, SBin* outBins) -> void
+			{
+				for (uint32_t i=rangeBegin; i<rangeEnd; i++)
+				for (uint32_t axis=0u; axis<3u; axis++)
+				{
+					SBin& bin = outBins[axis*binCount+getBin(m_refs[i],axis)];
+					bin.minEdge = core::min(bin.minEdge,m_refs[i].minEdge);
+					bin.maxEdge = core::max(bin.maxEdge,m_refs[i].maxEdge);
+					bin.count++;
+				}
+			};
+			if (parallel && end-begin>ParallelChunkSize)
+			{
+				core::vector<SBin> partial(MaxParallelChunks*bins.size());
+				const uint32_t chunkCount = parallelChunks(begin,end,[&](const uint32_t chunkBegin, const uint32_t chunkEnd, const uint32_t chunk) -> void
+				{
+					binRange(chunkBegin,chunkEnd,partial.data()+chunk*bins.size());
+				});
+				for (uint32_t i=0u; i<chunkCount; i++)
+				for (uint32_t j=0u; j<bins.size(); j++)
+				{
+					const SBin& other = partial[i*bins.size()+j];
+					bins[j].minEdge = core::min(bins[j].minEdge,other.minEdge);
+					bins[j].maxEdge = core::max(bins[j].maxEdge,other.maxEdge);
+					bins[j].count += other.count;
+				}
+			}
+			else
+				binRange(begin,end,bins.data());
+
+			// sweep, split `i` puts bins [0,i] on the left
+			float bestCost = FLT_MAX;
+			uint32_t bestAxis = ~0u;
+			uint32_t bestSplit = 0u;
+			core::vector<float> rightCost(binCount);
+			for (uint32_t axis=0u; axis<3u; axis++)
+			{
+				if (scale.pointer[axis]==0.f)
+					continue;
+				const SBin* axisBins = bins.data()+axis*binCount;
+				SBin accumulator;
+				for (uint32_t i=binCount-1u; i>0u; i--)
+				{
+					accumulator.minEdge = core::min(accumulator.minEdge,axisBins[i].minEdge);
+					accumulator.maxEdge = core::max(accumulator.maxEdge,axisBins[i].maxEdge);
+					accumulator.count += axisBins[i].count;
+					rightCost[i-1u] = accumulator.count ? halfArea(accumulator.minEdge,accumulator.maxEdge)*float(accumulator.count):0.f;
+				}
+				accumulator = SBin();
+				for (uint32_t i=0u; i<binCount-1u; i++)
+				{
+					accumulator.minEdge = core::min(accumulator.minEdge,axisBins[i].minEdge);
+					accumulator.maxEdge = core::max(accumulator.maxEdge,axisBins[i].maxEdge);
+					accumulator.count += axisBins[i].count;
+					if (accumulator.count==0u || accumulator.count==end-begin)
+						continue;
+					const float cost = halfArea(accumulator.minEdge,accumulator.maxEdge)*float(accumulator.count)+rightCost[i];
+					if (cost<bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = i;
+					}
+				}
+			}
+			if (bestAxis==~0u)
+				return medianSplit(begin,end,bounds);
+
+			const auto mid = std::partition(m_refs.begin()+begin,m_refs.begin()+end,[&](const SPrimRef& ref) -> bool {return getBin(ref,bestAxis)<=bestSplit;});
+			return std::distance(m_refs.begin(),mid);
+		}
+
+		uint32_t buildNode(const uint32_t begin, const uint32_t end, const uint32_t depth, core::vector<SNode>& nodes, core::vector<STask>* tasks) const
+		{
+			const uint32_t nodeIx = nodes.size();
+			{
+				SNode& node = nodes.emplace_back();
+				for (uint32_t i=0u; i<BRANCHING_FACTOR; i++)
+				{
+					for (uint32_t axis=0u; axis<3u; axis++)
+					{
+						node.bounds[axis*2u][i] = FLT_MAX;
+						node.bounds[axis*2u+1u][i] = -FLT_MAX;
+					}
+					node.children[i] = INVALID_INDEX;
+				}
+			}
+
+			// two levels of binary splits make up the 4 children
+			struct SRange
+			{
+				uint32_t begin, end;
+			};
+			SRange ranges[BRANCHING_FACTOR] = {{begin,end}};
+			uint32_t rangeCount = 1u;
+			while (rangeCount<BRANCHING_FACTOR)
+			{
+				uint32_t largest = ~0u;
+				for (uint32_t i=0u; i<rangeCount; i++)
+				if (ranges[i].end-ranges[i].begin>m_params.maxLeafSize && (largest==~0u || ranges[i].end-ranges[i].begin>ranges[largest].end-ranges[largest].begin))
+					largest = i;
+				if (largest==~0u)
+					break;
+				const SRange range = ranges[largest];
+				const uint32_t mid = split(range.begin,range.end,depth,tasks);
+				ranges[largest] = {range.begin,mid};
+				ranges[rangeCount++] = {mid,range.end};
+			}
+
+			for (uint32_t i=0u; i<rangeCount; i++)
+			{
+				const SBounds bounds = computeBounds(ranges[i].begin,ranges[i].end,tasks);
+				for (uint32_t axis=0u; axis<3u; axis++)
+				{
+					nodes[nodeIx].bounds[axis*2u][i] = bounds.minEdge.pointer[axis];
+					nodes[nodeIx].bounds[axis*2u+1u][i] = bounds.maxEdge.pointer[axis];
+				}
+
+				const uint32_t count = ranges[i].end-ranges[i].begin;
+				if (count<=m_params.maxLeafSize)
+					nodes[nodeIx].children[i] = SNode::makeLeaf(ranges[i].begin,count);
+				else if (tasks && count<m_params.parallelSubtreeThreshold)
+					tasks->push_back({ranges[i].begin,ranges[i].end,depth+1u,nodeIx,i});
+				else
+				{
+					const uint32_t child = buildNode(ranges[i].begin,ranges[i].end,depth+1u,nodes,tasks);
+					nodes[nodeIx].children[i] = child;
+				}
+			}
+			return nodeIx;
+		}
+
+		const SBuildParams m_params;
+		core::vector<SPrimRef>& m_refs;
+};
+
+core::smart_refctd_ptr<CCPUBVH> CCPUBVH::create(const ICPUAccelerationStructure* _as, const SBuildParams& _params)
+{
+	const auto* buildInfo = _as ? _as->getBuildInfo():nullptr;
+	if (!buildInfo || buildInfo->type!=IAccelerationStructure::ET_BOTTOM_LEVEL)
+		return nullptr;
+
+	const auto geometries = buildInfo->getGeometries();
+	const auto ranges = _as->getBuildRanges();
+	core::vector<uint32_t> primitiveOffsets(geometries.size()+1u,0u);
+	for (uint32_t i=0u; i<geometries.size(); i++)
+	{
+		if (geometries.begin()[i].type==IAccelerationStructure::EGT_INSTANCES)
+			return nullptr;
+		primitiveOffsets[i+1u] = primitiveOffsets[i]+ranges.begin()[i].primitiveCount;
+	}
+
+	auto* bvh = new CCPUBVH(IAccelerationStructure::ET_BOTTOM_LEVEL);
+	core::vector<SPrimitive> primitives(primitiveOffsets.back());
+	core::vector<CBuilder::SPrimRef> refs(primitives.size());
+	core::for_each(core::execution::par,primitives.begin(),primitives.end(),[&](SPrimitive& primitive) -> void
+	{
+		const uint32_t globalIx = &primitive-primitives.data();
+		const uint32_t geometryIx = std::distance(primitiveOffsets.begin(),std::upper_bound(primitiveOffsets.begin(),primitiveOffsets.end(),globalIx))-1u;
+		const auto& geometry = geometries.begin()[geometryIx];
+		const auto& range = ranges.begin()[geometryIx];
+		primitive.geometryIndex = geometryIx;
+		primitive.primitiveIndex = globalIx-primitiveOffsets[geometryIx];
+
+		auto& ref = refs[globalIx];
+		ref.index = INVALID_INDEX;
+		if (geometry.type==IAccelerationStructure::EGT_TRIANGLES)
+		{
+			const auto& triangles = geometry.data.triangles;
+			const uint8_t* vertexData = static_cast<const uint8_t*>(triangles.vertexData.buffer->getPointer())+triangles.vertexData.offset;
+			uint32_t indices[3];
+			if (triangles.indexType==EIT_UNKNOWN || !triangles.indexData.buffer)
+			{
+				vertexData += range.primitiveOffset;
+				for (uint32_t i=0u; i<3u; i++)
+					indices[i] = primitive.primitiveIndex*3u+i;
+			}
+			else
+			{
+				const uint8_t* indexData = static_cast<const uint8_t*>(triangles.indexData.buffer->getPointer())+triangles.indexData.offset+range.primitiveOffset;
+				for (uint32_t i=0u; i<3u; i++)
+					indices[i] = triangles.indexType==EIT_16BIT ? reinterpret_cast<const uint16_t*>(indexData)[primitive.primitiveIndex*3u+i]:reinterpret_cast<const uint32_t*>(indexData)[primitive.primitiveIndex*3u+i];
+			}
+
+			core::vectorSIMDf vertices[3];
+			for (uint32_t i=0u; i<3u; i++)
+			{
+				vertices[i].set(0.f,0.f,0.f,1.f);
+				ICPUMeshBuffer::getAttribute(vertices[i],vertexData+(range.firstVertex+indices[i])*triangles.vertexStride,triangles.vertexFormat);
+				// inactive triangle
+				if (std::isnan(vertices[i].x))
+					return;
+			}
+			if (triangles.transformData.buffer)
+			{
+				const float* rows = reinterpret_cast<const float*>(static_cast<const uint8_t*>(triangles.transformData.buffer->getPointer())+triangles.transformData.offset+range.transformOffset);
+				core::matrix3x4SIMD transform;
+				for (uint32_t r=0u; r<3u; r++)
+					transform.rows[r].set(rows[r*4u],rows[r*4u+1u],rows[r*4u+2u],rows[r*4u+3u]);
+				for (auto& vertex : vertices)
+				{
+					vertex.w = 1.f;
+					transform.transformVect(vertex);
+				}
+			}
+			for (auto& vertex : vertices)
+				vertex.w = 0.f;
+
+			primitive.data[0] = vertices[0];
+			primitive.data[1] = vertices[1]-vertices[0];
+			primitive.data[2] = vertices[2]-vertices[0];
+			ref.minEdge = core::min(core::min(vertices[0],vertices[1]),vertices[2]);
+			ref.maxEdge = core::max(core::max(vertices[0],vertices[1]),vertices[2]);
+		}
+		else
+		{
+			const auto& aabbs = geometry.data.aabbs;
+			const auto& aabb = *reinterpret_cast<const IAccelerationStructure::AABB_Position*>(static_cast<const uint8_t*>(aabbs.data.buffer->getPointer())+aabbs.data.offset+range.primitiveOffset+primitive.primitiveIndex*aabbs.stride);
+			// inactive AABB
+			if (std::isnan(aabb.MinEdge.X))
+				return;
+			primitive.geometryIndex |= SPrimitive::AABB_BIT;
+			primitive.data[0].set(aabb.MinEdge.X,aabb.MinEdge.Y,aabb.MinEdge.Z,0.f);
+			primitive.data[1].set(aabb.MaxEdge.X,aabb.MaxEdge.Y,aabb.MaxEdge.Z,0.f);
+			primitive.data[2].set(0.f,0.f,0.f,0.f);
+			ref.minEdge = primitive.data[0];
+			ref.maxEdge = primitive.data[1];
+		}
+		ref.index = globalIx;
+	});
+	refs.erase(std::remove_if(refs.begin(),refs.end(),[](const CBuilder::SPrimRef& ref) -> bool {return ref.index==INVALID_INDEX;}),refs.end());
+
+	CBuilder(_params,refs).build(bvh->m_nodes);
+
+	bvh->m_bounds = core::aabbox3df();
+	bvh->m_primitives.resize(refs.size());
+	for (uint32_t i=0u; i<refs.size(); i++)
+	{
+		bvh->m_primitives[i] = primitives[refs[i].index];
+		const auto& ref = refs[i];
+		if (i)
+			bvh->m_bounds.addInternalBox(core::aabbox3df(ref.minEdge.x,ref.minEdge.y,ref.minEdge.z,ref.maxEdge.x,ref.maxEdge.y,ref.maxEdge.z));
+		else
+			bvh->m_bounds = core::aabbox3df(ref.minEdge.x,ref.minEdge.y,ref.minEdge.z,ref.maxEdge.x,ref.maxEdge.y,ref.maxEdge.z);
+	}
+	return core::smart_refctd_ptr<CCPUBVH>(bvh,core::dont_grab);
+}
+
+core::smart_refctd_ptr<CCPUBVH> CCPUBVH::create(const ICPUAccelerationStructure* _as, const core::SRange<const core::smart_refctd_ptr<const CCPUBVH>>& _bottomLevels, const SBuildParams& _params)
+{
+	const auto* buildInfo = _as ? _as->getBuildInfo():nullptr;
+	if (!buildInfo || buildInfo->type!=IAccelerationStructure::ET_TOP_LEVEL)
+		return nullptr;
+
+	auto* bvh = new CCPUBVH(IAccelerationStructure::ET_TOP_LEVEL);
+	core::vector<CBuilder::SPrimRef> refs;
+	const auto geometries = buildInfo->getGeometries();
+	const auto ranges = _as->getBuildRanges();
+	uint32_t instanceIx = 0u;
+	for (uint32_t g=0u; g<geometries.size(); g++)
+	{
+		const auto& geometry = geometries.begin()[g];
+		if (geometry.type!=IAccelerationStructure::EGT_INSTANCES)
+			continue;
+		const auto& range = ranges.begin()[g];
+		const uint8_t* instanceData = static_cast<const uint8_t*>(geometry.data.instances.data.buffer->getPointer())+geometry.data.instances.data.offset+range.primitiveOffset;
+		for (uint32_t i=0u; i<range.primitiveCount; i++)
+		{
+			const auto& instance = reinterpret_cast<const IAccelerationStructure::Instance*>(instanceData)[i];
+			const uint32_t index = instanceIx++;
+			if (instance.accelerationStructureReference>=_bottomLevels.size())
+				continue;
+			const auto& bottomLevel = _bottomLevels.begin()[instance.accelerationStructureReference];
+			if (!bottomLevel || bottomLevel->getPrimitiveCount()==0u)
+				continue;
+
+			SInstance& outInstance = bvh->m_instances.emplace_back();
+			if (!instance.mat.getInverse(outInstance.worldToObject))
+			{
+				bvh->m_instances.pop_back();
+				continue;
+			}
+			outInstance.bottomLevel = bottomLevel;
+			outInstance.index = index;
+			outInstance.customIndex = instance.instanceCustomIndex;
+			outInstance.mask = instance.mask;
+
+			auto& ref = refs.emplace_back();
+			ref.minEdge = core::vectorSIMDf(FLT_MAX);
+			ref.maxEdge = core::vectorSIMDf(-FLT_MAX);
+			const auto& localBounds = bottomLevel->getBoundingBox();
+			for (uint32_t corner=0u; corner<8u; corner++)
+			{
+				core::vectorSIMDf pos(
+					corner&0x1u ? localBounds.MaxEdge.X:localBounds.MinEdge.X,
+					corner&0x2u ? localBounds.MaxEdge.Y:localBounds.MinEdge.Y,
+					corner&0x4u ? localBounds.MaxEdge.Z:localBounds.MinEdge.Z,
+					1.f
+				);
+				instance.mat.transformVect(pos);
+				pos.w = 0.f;
+				ref.minEdge = core::min(ref.minEdge,pos);
+				ref.maxEdge = core::max(ref.maxEdge,pos);
+			}
+			ref.index = bvh->m_instances.size()-1u;
+		}
+	}
+
+	CBuilder(_params,refs).build(bvh->m_nodes);
+
+	core::vector<SInstance> instances(refs.size());
+	for (uint32_t i=0u; i<refs.size(); i++)
+	{
+		instances[i] = std::move(bvh->m_instances[refs[i].index]);
+		const auto& ref = refs[i];
+		if (i)
+			bvh->m_bounds.addInternalBox(core::aabbox3df(ref.minEdge.x,ref.minEdge.y,ref.minEdge.z,ref.maxEdge.x,ref.maxEdge.y,ref.maxEdge.z));
+		else
+			bvh->m_bounds = core::aabbox3df(ref.minEdge.x,ref.minEdge.y,ref.minEdge.z,ref.maxEdge.x,ref.maxEdge.y,ref.maxEdge.z);
+	}
+	bvh->m_instances = std::move(instances);
+	return core::smart_refctd_ptr<CCPUBVH>(bvh,core::dont_grab);
+}
+
+template<bool AnyHit>
+bool CCPUBVH::intersectPrimitive(const SPrimitive& _primitive, const SRayInternal& _ray, SHit& _hit) const
+{
+	float t, u, v;
+	if (_primitive.geometryIndex&SPrimitive::AABB_BIT)
+	{
+		const core::vectorSIMDf t0 = (_primitive.data[0]-_ray.origin)*_ray.invDirection;
+		const core::vectorSIMDf t1 = (_primitive.data[1]-_ray.origin)*_ray.invDirection;
+		const core::vectorSIMDf tNear = core::min(t0,t1);
+		const core::vectorSIMDf tFar = core::max(t0,t1);
+		t = std::max(std::max(tNear.x,tNear.y),std::max(tNear.z,_ray.tMin));
+		if (t>std::min(std::min(tFar.x,tFar.y),tFar.z) || t>=_hit.t)
+			return false;
+		u = v = 0.f;
+	}
+	else
+	{
+		// Moller-Trumbore without culling
+		const core::vectorSIMDf& edge1 = _primitive.data[1];
+		const core::vectorSIMDf& edge2 = _primitive.data[2];
+		const core::vectorSIMDf pvec = core::cross(_ray.direction,edge2);
+		const float det = core::dot(edge1,pvec).x;
+		if (det==0.f)
+			return false;
+		const float invDet = 1.f/det;
+		const core::vectorSIMDf tvec = _ray.origin-_primitive.data[0];
+		u = core::dot(tvec,pvec).x*invDet;
+		if (u<0.f || u>1.f)
+			return false;
+		const core::vectorSIMDf qvec = core::cross(tvec,edge1);
+		v = core::dot(_ray.direction,qvec).x*invDet;
+		if (v<0.f || u+v>1.f)
+			return false;
+		t = core::dot(edge2,qvec).x*invDet;
+		if (t<_ray.tMin || t>=_hit.t)
+			return false;
+	}
+
+	_hit.t = t;
+	_hit.u = u;
+	_hit.v = v;
+	_hit.primitiveIndex = _primitive.primitiveIndex;
+	_hit.geometryIndex = _primitive.geometryIndex&~SPrimitive::AABB_BIT;
+	_hit.instanceIndex = INVALID_INDEX;
+	_hit.instanceCustomIndex = INVALID_INDEX;
+	return true;
+}
+
+template<bool AnyHit>
+bool CCPUBVH::traverse(const SRayInternal& _ray, SHit& _hit) const
+{
+	if (m_nodes.empty())
+		return false;
+
+	auto intersectLeaf = [&](const uint32_t leaf) -> bool
+	{
+		bool found = false;
+		const uint32_t first = SNode::getLeafFirst(leaf);
+		const uint32_t end = first+SNode::getLeafCount(leaf);
+		if (m_type==IAccelerationStructure::ET_TOP_LEVEL)
+		for (uint32_t i=first; i<end; i++)
+		{
+			const SInstance& instance = m_instances[i];
+			if (!(instance.mask&_ray.mask))
+				continue;
+			SRay localRay;
+			instance.worldToObject.transformVect(localRay.origin,core::vectorSIMDf(_ray.origin.x,_ray.origin.y,_ray.origin.z,1.f));
+			instance.worldToObject.mulSub3x3WithNx1(localRay.direction,_ray.direction);
+			localRay.tMin = _ray.tMin;
+			localRay.mask = _ray.mask;
+			if (instance.bottomLevel->traverse<AnyHit>(SRayInternal(localRay),_hit))
+			{
+				_hit.instanceIndex = instance.index;
+				_hit.instanceCustomIndex = instance.customIndex;
+				found = true;
+				if constexpr (AnyHit)
+					return true;
+			}
+		}
+		else
+		for (uint32_t i=first; i<end; i++)
+		if (intersectPrimitive<AnyHit>(m_primitives[i],_ray,_hit))
+		{
+			found = true;
+			if constexpr (AnyHit)
+				return true;
+		}
+		return found;
+	};
+
+	struct SEntry
+	{
+		uint32_t node;
+		float tNear;
+	};
+	SEntry stack[TraversalStackSize];
+	uint32_t stackSize = 0u;
+	stack[stackSize++] = {0u,_ray.tMin};
+
+	bool found = false;
+	while (stackSize)
+	{
+		const SEntry entry = stack[--stackSize];
+		if (entry.tNear>_hit.t)
+			continue;
+
+		const SNode& node = m_nodes[entry.node];
+		__m128 tNearRegister;
+		uint32_t hitMask = _ray.intersect(node,_hit.t,tNearRegister);
+		alignas(16) float tNear[BRANCHING_FACTOR];
+		_mm_store_ps(tNear,tNearRegister);
+
+		// leaves right away, so the hit distance shrinks before the inner children get pushed
+		SEntry inner[BRANCHING_FACTOR];
+		uint32_t innerCount = 0u;
+		for (; hitMask; hitMask&=hitMask-1u)
+		{
+			const uint32_t i = core::findLSB(hitMask);
+			const uint32_t child = node.children[i];
+			if (SNode::isLeaf(child))
+			{
+				if (intersectLeaf(child))
+				{
+					found = true;
+					if constexpr (AnyHit)
+						return true;
+				}
+			}
+			else
+			{
+				// insertion sort, farthest first
+				uint32_t j = innerCount++;
+				for (; j && inner[j-1u].tNear<tNear[i]; j--)
+					inner[j] = inner[j-1u];
+				inner[j] = {child,tNear[i]};
+			}
+		}
+		assert(stackSize+innerCount<=TraversalStackSize);
+		for (uint32_t i=0u; i<innerCount; i++)
+		if (inner[i].tNear<=_hit.t)
+			stack[stackSize++] = inner[i];
+	}
+	return found;
+}
+
+template<bool AnyHit>
+uint64_t CCPUBVH::traversePacket(const SRayInternal* _rays, SHit* _hits, const uint64_t _activeMask) const
+{
+	uint64_t hitRays = 0u;
+	if (m_nodes.empty() || !_activeMask)
+		return hitRays;
+
+	auto intersectLeaf = [&](const uint32_t leaf, const uint64_t rayMask) -> void
+	{
+		const uint32_t first = SNode::getLeafFirst(leaf);
+		const uint32_t end = first+SNode::getLeafCount(leaf);
+		if (m_type==IAccelerationStructure::ET_TOP_LEVEL)
+		for (uint32_t i=first; i<end; i++)
+		{
+			const SInstance& instance = m_instances[i];
+			uint64_t instanceMask = 0u;
+			SRayInternal localRays[MAX_PACKET_SIZE];
+			for (uint64_t m=rayMask&~(AnyHit ? hitRays:0ull); m; m&=m-1ull)
+			{
+				const uint32_t r = core::findLSB(m);
+				if (!(instance.mask&_rays[r].mask))
+					continue;
+				SRay localRay;
+				instance.worldToObject.transformVect(localRay.origin,core::vectorSIMDf(_rays[r].origin.x,_rays[r].origin.y,_rays[r].origin.z,1.f));
+				instance.worldToObject.mulSub3x3WithNx1(localRay.direction,_rays[r].direction);
+				localRay.tMin = _rays[r].tMin;
+				localRay.mask = _rays[r].mask;
+				localRays[r] = SRayInternal(localRay);
+				instanceMask |= 0x1ull<<r;
+			}
+			for (uint64_t m=instance.bottomLevel->traversePacket<AnyHit>(localRays,_hits,instanceMask); m; m&=m-1ull)
+			{
+				const uint32_t r = core::findLSB(m);
+				_hits[r].instanceIndex = instance.index;
+				_hits[r].instanceCustomIndex = instance.customIndex;
+				hitRays |= 0x1ull<<r;
+			}
+		}
+		else
+		for (uint32_t i=first; i<end; i++)
+		for (uint64_t m=rayMask&~(AnyHit ? hitRays:0ull); m; m&=m-1ull)
+		{
+			const uint32_t r = core::findLSB(m);
+			if (intersectPrimitive<AnyHit>(m_primitives[i],_rays[r],_hits[r]))
+				hitRays |= 0x1ull<<r;
+		}
+	};
+
+	struct SEntry
+	{
+		uint32_t node;
+		uint64_t rayMask;
+	};
+	SEntry stack[TraversalStackSize];
+	uint32_t stackSize = 0u;
+	stack[stackSize++] = {0u,_activeMask};
+	while (stackSize)
+	{
+		const SEntry entry = stack[--stackSize];
+		const uint64_t rayMask = AnyHit ? (entry.rayMask&~hitRays):entry.rayMask;
+		if (!rayMask)
+			continue;
+
+		const SNode& node = m_nodes[entry.node];
+		uint64_t childRays[BRANCHING_FACTOR] = {0u,0u,0u,0u};
+		float childNear[BRANCHING_FACTOR] = {FLT_MAX,FLT_MAX,FLT_MAX,FLT_MAX};
+		for (uint64_t m=rayMask; m; m&=m-1ull)
+		{
+			const uint32_t r = core::findLSB(m);
+			__m128 tNearRegister;
+			uint32_t hitMask = _rays[r].intersect(node,_hits[r].t,tNearRegister);
+			alignas(16) float tNear[BRANCHING_FACTOR];
+			_mm_store_ps(tNear,tNearRegister);
+			for (; hitMask; hitMask&=hitMask-1u)
+			{
+				const uint32_t i = core::findLSB(hitMask);
+				childRays[i] |= 0x1ull<<r;
+				childNear[i] = std::min(childNear[i],tNear[i]);
+			}
+		}
+
+		SEntry inner[BRANCHING_FACTOR];
+		float innerNear[BRANCHING_FACTOR];
+		uint32_t innerCount = 0u;
+		for (uint32_t i=0u; i<BRANCHING_FACTOR; i++)
+		{
+			if (!childRays[i])
+				continue;
+			const uint32_t child = node.children[i];
+			if (SNode::isLeaf(child))
+				intersectLeaf(child,childRays[i]);
+			else
+			{
+				uint32_t j = innerCount++;
+				for (; j && innerNear[j-1u]<childNear[i]; j--)
+				{
+					inner[j] = inner[j-1u];
+					innerNear[j] = innerNear[j-1u];
+				}
+				inner[j] = {child,childRays[i]};
+				innerNear[j] = childNear[i];
+			}
+		}
+		assert(stackSize+innerCount<=TraversalStackSize);
+		for (uint32_t i=0u; i<innerCount; i++)
+			stack[stackSize++] = inner[i];
+	}
+	return hitRays;
+}
+
+namespace
+{
+inline CCPUBVH::SHit makeMissHit(const CCPUBVH::SRay& ray)
+{
+	CCPUBVH::SHit retval;
+	retval.t = ray.tMax;
+	retval.u = retval.v = 0.f;
+	retval.primitiveIndex = CCPUBVH::INVALID_INDEX;
+	retval.geometryIndex = CCPUBVH::INVALID_INDEX;
+	retval.instanceIndex = CCPUBVH::INVALID_INDEX;
+	retval.instanceCustomIndex = CCPUBVH::INVALID_INDEX;
+	return retval;
+}
+}
+
+bool CCPUBVH::traceClosest(const SRay& _ray, SHit& _hit) const
+{
+	_hit = makeMissHit(_ray);
+	return traverse<false>(SRayInternal(_ray),_hit);
+}
+
+bool CCPUBVH::traceAny(const SRay& _ray) const
+{
+	SHit hit = makeMissHit(_ray);
+	return traverse<true>(SRayInternal(_ray),hit);
+}
+
+void CCPUBVH::traceClosest(const SRay* _rays, SHit* _hits, const uint32_t _count) const
+{
+	SRayInternal rays[MAX_PACKET_SIZE];
+	for (uint32_t packet=0u; packet<_count; packet+=MAX_PACKET_SIZE)
+	{
+		const uint32_t packetSize = std::min(_count-packet,MAX_PACKET_SIZE);
+		for (uint32_t i=0u; i<packetSize; i++)
+		{
+			rays[i] = SRayInternal(_rays[packet+i]);
+			_hits[packet+i] = makeMissHit(_rays[packet+i]);
+		}
+		traversePacket<false>(rays,_hits+packet,packetSize<64u ? (0x1ull<<packetSize)-1ull:~0ull);
+	}
+}
+
+uint32_t CCPUBVH::traceAny(const SRay* _rays, uint64_t* _occluded, const uint32_t _count) const
+{
+	static_assert(MAX_PACKET_SIZE==64u,"one bitmask word per packet");
+	uint32_t occludedCount = 0u;
+	SRayInternal rays[MAX_PACKET_SIZE];
+	SHit hits[MAX_PACKET_SIZE];
+	for (uint32_t packet=0u; packet<_count; packet+=MAX_PACKET_SIZE)
+	{
+		const uint32_t packetSize = std::min(_count-packet,MAX_PACKET_SIZE);
+		for (uint32_t i=0u; i<packetSize; i++)
+		{
+			rays[i] = SRayInternal(_rays[packet+i]);
+			hits[i] = makeMissHit(_rays[packet+i]);
+		}
+		const uint64_t occluded = traversePacket<true>(rays,hits,packetSize<64u ? (0x1ull<<packetSize)-1ull:~0ull);
+		_occluded[packet/MAX_PACKET_SIZE] = occluded;
+		occludedCount += core::bitCount(occluded);
+	}
+	return occludedCount;
+}
+
+}
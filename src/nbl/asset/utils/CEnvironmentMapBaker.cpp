@@ -0,0 +1,549 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/asset/utils/CEnvironmentMapBaker.h"
+
+#include "nbl/asset/format/decodePixels.h"
+#include "nbl/asset/format/encodePixels.h"
+#include "nbl/asset/filters/CSummedAreaTableImageFilter.h"
+#include "nbl/core/sampling/OwenSampler.h"
+
+#include <numeric>
+
+using namespace nbl;
+using namespace nbl::asset;
+
+namespace
+{
+
+// one tightly packed region per mip level, layers stacked after each other
+core::smart_refctd_ptr<ICPUImage> createImage(const E_FORMAT format, const uint32_t width, const uint32_t height, const uint32_t layers, const uint32_t mipLevels, const bool cube)
+{
+	IImage::SCreationParams params = {};
+	params.type = IImage::ET_2D;
+	params.samples = IImage::ESCF_1_BIT;
+	params.format = format;
+	params.extent = {width,height,1u};
+	params.mipLevels = mipLevels;
+	params.arrayLayers = layers;
+	params.flags = cube ? IImage::ECF_CUBE_COMPATIBLE_BIT:IImage::ECF_NONE;
+	auto image = ICPUImage::create(std::move(params));
+	if (!image)
+		return nullptr;
+
+	auto regions = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<IImage::SBufferCopy>>(mipLevels);
+	size_t bufferSize = 0ull;
+	for (auto mip=0u; mip<mipLevels; mip++)
+	{
+		auto& region = regions->operator[](mip);
+		region.bufferOffset = bufferSize;
+		region.bufferRowLength = 0u;
+		region.bufferImageHeight = 0u;
+		region.imageSubresource.aspectMask = IImage::EAF_COLOR_BIT;
+		region.imageSubresource.mipLevel = mip;
+		region.imageSubresource.baseArrayLayer = 0u;
+		region.imageSubresource.layerCount = layers;
+		region.imageOffset = {0u,0u,0u};
+		region.imageExtent = {core::max(width>>mip,1u),core::max(height>>mip,1u),1u};
+		bufferSize += size_t(region.imageExtent.width)*region.imageExtent.height*layers*getTexelOrBlockBytesize(format);
+	}
+	if (!image->setBufferAndRegions(core::make_smart_refctd_ptr<ICPUBuffer>(bufferSize),regions))
+		return nullptr;
+	return image;
+}
+
+inline float getLuminance(const core::vectorSIMDf& color)
+{
+	return core::max(0.2126f*color.x+0.7152f*color.y+0.0722f*color.z,0.f);
+}
+
+// RGBA32F equirectangular radiance with bilinear lookups
+struct SEquirect
+{
+	inline core::vectorSIMDf fetch(const uint32_t x, const uint32_t y) const
+	{
+		return core::vectorSIMDf(texels+(size_t(y)*width+x)*4ull);
+	}
+	inline void getUV(const core::vectorSIMDf& dir, float& u, float& v) const
+	{
+		u = std::atan2(dir.z,dir.x)*(0.5f/core::PI<float>())+0.5f;
+		v = std::acos(core::clamp(dir.y,-1.f,1.f))/core::PI<float>();
+	}
+	// the texel `(u,v)` falls in, the radiance model the luminance distribution and the SH projection use
+	inline core::vectorSIMDf fetch(const float u, const float v) const
+	{
+		return fetch(core::min(uint32_t(u*float(width)),width-1u),core::min(uint32_t(v*float(height)),height-1u));
+	}
+	inline core::vectorSIMDf sample(const float u, const float v) const
+	{
+		const float px = u*float(width)-0.5f;
+		const float py = v*float(height)-0.5f;
+		const float fx = std::floor(px);
+		const float fy = std::floor(py);
+		const float tx = px-fx;
+		const float ty = py-fy;
+		// longitude wraps, latitude clamps
+		const uint32_t x0 = uint32_t(int32_t(fx)+int32_t(width))%width;
+		const uint32_t x1 = (x0+1u)%width;
+		const uint32_t y0 = uint32_t(core::clamp<int32_t>(int32_t(fy),0,int32_t(height)-1));
+		const uint32_t y1 = uint32_t(core::clamp<int32_t>(int32_t(fy)+1,0,int32_t(height)-1));
+		const auto top = fetch(x0,y0)*(1.f-tx)+fetch(x1,y0)*tx;
+		const auto bottom = fetch(x0,y1)*(1.f-tx)+fetch(x1,y1)*tx;
+		return top*(1.f-ty)+bottom*ty;
+	}
+	// solid angle of a texel in row `y`
+	inline float getTexelSolidAngle(const uint32_t y) const
+	{
+		const float dPhi = 2.f*core::PI<float>()/float(width);
+		return dPhi*(std::cos(core::PI<float>()*float(y)/float(height))-std::cos(core::PI<float>()*float(y+1u)/float(height)));
+	}
+
+	const float* texels;
+	uint32_t width;
+	uint32_t height;
+};
+
+// Piecewise constant (per texel, uniform in solid angle) distribution proportional to luminance, sampled through the summed area table of `luminance*texelSolidAngle`
+struct SLuminanceDistribution
+{
+	inline double getRowSum(const uint32_t x, const uint32_t y) const
+	{
+		return sat[size_t(y)*width+x]-(y ? sat[size_t(y-1u)*width+x]:0.0);
+	}
+	inline double getCumulativeRows(const int32_t y) const
+	{
+		return y<0 ? 0.0:sat[size_t(y)*width+width-1u];
+	}
+
+	// solid angle pdf
+	inline float pdf(const float u, const float v) const
+	{
+		const uint32_t x = core::min(uint32_t(u*float(width)),width-1u);
+		const uint32_t y = core::min(uint32_t(v*float(height)),height-1u);
+		return luminance[size_t(y)*width+x]*invTotal;
+	}
+
+	inline core::vectorSIMDf sample(const float xi0, const float xi1, float& outU, float& outV) const
+	{
+		// marginal over rows, then conditional within the row, the remainders of both searches get reused as the position inside the texel
+		const double rowTarget = double(xi0)*total;
+		uint32_t y = 0u;
+		for (uint32_t count=height; count;)
+		{
+			const uint32_t step = count/2u;
+			if (getCumulativeRows(y+step)<=rowTarget)
+			{
+				y += step+1u;
+				count -= step+1u;
+			}
+			else
+				count = step;
+		}
+		y = core::min(y,height-1u);
+		const double rowBegin = getCumulativeRows(int32_t(y)-1);
+		const double rowWeight = getCumulativeRows(y)-rowBegin;
+		const float yRemainder = rowWeight>0.0 ? core::clamp(float((rowTarget-rowBegin)/rowWeight),0.f,1.f):0.5f;
+
+		const double columnTarget = double(xi1)*rowWeight;
+		uint32_t x = 0u;
+		for (uint32_t count=width; count;)
+		{
+			const uint32_t step = count/2u;
+			if (getRowSum(x+step,y)<=columnTarget)
+			{
+				x += step+1u;
+				count -= step+1u;
+			}
+			else
+				count = step;
+		}
+		x = core::min(x,width-1u);
+		const double columnBegin = x ? getRowSum(x-1u,y):0.0;
+		const double columnWeight = getRowSum(x,y)-columnBegin;
+		const float xRemainder = columnWeight>0.0 ? core::clamp(float((columnTarget-columnBegin)/columnWeight),0.f,1.f):0.5f;
+
+		// uniform in `cos(theta)` across the row is uniform in solid angle
+		const float cosTop = std::cos(core::PI<float>()*float(y)/float(height));
+		const float cosBottom = std::cos(core::PI<float>()*float(y+1u)/float(height));
+		const float cosTheta = core::mix(cosTop,cosBottom,yRemainder);
+		const float sinTheta = std::sqrt(core::max(1.f-cosTheta*cosTheta,0.f));
+		outU = (float(x)+xRemainder)/float(width);
+		const float phi = (outU-0.5f)*2.f*core::PI<float>();
+		outV = std::acos(cosTheta)/core::PI<float>();
+		return core::vectorSIMDf(sinTheta*std::cos(phi),cosTheta,sinTheta*std::sin(phi));
+	}
+
+	const double* sat;
+	const float* luminance;
+	uint32_t width;
+	uint32_t height;
+	double total;
+	float invTotal;
+};
+
+inline float ggxD(const float NdotH, const float alpha2)
+{
+	const float denom = NdotH*NdotH*(alpha2-1.f)+1.f;
+	return alpha2/(core::PI<float>()*denom*denom);
+}
+
+// Building an orthonormal basis, revisited (Duff et al. 2017)
+inline void getTangentFrame(const core::vectorSIMDf& n, core::vectorSIMDf& t, core::vectorSIMDf& b)
+{
+	const float sign = std::copysign(1.f,n.z);
+	const float a = -1.f/(sign+n.z);
+	const float c = n.x*n.y*a;
+	t = core::vectorSIMDf(1.f+sign*n.x*n.x*a,sign*c,-sign*n.x);
+	b = core::vectorSIMDf(c,sign+n.y*n.y*a,-n.y);
+}
+
+// cube face lookup with bilinear filtering clamped to the face
+core::vectorSIMDf sampleCube(const float* faces, const uint32_t size, const core::vectorSIMDf& dir)
+{
+	const core::vectorSIMDf absDir = core::abs(dir);
+	uint32_t face;
+	float sc, tc, ma;
+	if (absDir.x>=absDir.y && absDir.x>=absDir.z)
+	{
+		ma = absDir.x;
+		face = dir.x>0.f ? 0u:1u;
+		sc = dir.x>0.f ? -dir.z:dir.z;
+		tc = -dir.y;
+	}
+	else if (absDir.y>=absDir.z)
+	{
+		ma = absDir.y;
+		face = dir.y>0.f ? 2u:3u;
+		sc = dir.x;
+		tc = dir.y>0.f ? dir.z:-dir.z;
+	}
+	else
+	{
+		ma = absDir.z;
+		face = dir.z>0.f ? 4u:5u;
+		sc = dir.z>0.f ? dir.x:-dir.x;
+		tc = -dir.y;
+	}
+	const float px = (sc/ma*0.5f+0.5f)*float(size)-0.5f;
+	const float py = (tc/ma*0.5f+0.5f)*float(size)-0.5f;
+	const float fx = std::floor(px);
+	const float fy = std::floor(py);
+	const float tx = px-fx;
+	const float ty = py-fy;
+	const int32_t last = int32_t(size)-1;
+	const uint32_t x0 = core::clamp<int32_t>(int32_t(fx),0,last), x1 = core::clamp<int32_t>(int32_t(fx)+1,0,last);
+	const uint32_t y0 = core::clamp<int32_t>(int32_t(fy),0,last), y1 = core::clamp<int32_t>(int32_t(fy)+1,0,last);
+	auto fetch = [&](const uint32_t x, const uint32_t y) -> core::vectorSIMDf
+	{
+		return core::vectorSIMDf(faces+((size_t(face)*size+y)*size+x)*4ull);
+	};
+	const auto top = fetch(x0,y0)*(1.f-tx)+fetch(x1,y0)*tx;
+	const auto bottom = fetch(x0,y1)*(1.f-tx)+fetch(x1,y1)*tx;
+	return top*(1.f-ty)+bottom*ty;
+}
+
+template<typename F>
+void parallelFor(const uint32_t count, F&& f)
+{
+	core::vector<uint32_t> indices(count);
+	std::iota(indices.begin(),indices.end(),0u);
+	core::for_each(core::execution::par,indices.begin(),indices.end(),f);
+}
+
+}
+
+CEnvironmentMapBaker::SResult CEnvironmentMapBaker::bake(const SParams& params)
+{
+	SResult result = {};
+	for (auto& coefficient : result.irradianceSH)
+		coefficient = core::vectorSIMDf(0.f);
+
+	if (!params.environment || !core::isPoT(params.faceSize) || !params.sampleCount)
+		return result;
+	if (isIntegerFormat(params.prefilteredFormat) || isBlockCompressionFormat(params.prefilteredFormat))
+		return result;
+	const auto& envParams = params.environment->getCreationParameters();
+	if (envParams.type!=IImage::ET_2D || isIntegerFormat(envParams.format))
+		return result;
+	const bool cube = envParams.flags.hasFlags(IImage::ECF_CUBE_COMPATIBLE_BIT) && envParams.arrayLayers>=6u;
+	const uint32_t fullMipCount = core::findMSB(params.faceSize)+1u;
+	const uint32_t mipCount = params.mipCount ? core::min(params.mipCount,fullMipCount):fullMipCount;
+
+	// decode the source to RGBA32F
+	const uint32_t sourceLayers = cube ? 6u:1u;
+	const uint32_t sourceWidth = envParams.extent.width;
+	const uint32_t sourceHeight = envParams.extent.height;
+	core::vector<float> sourceTexels(size_t(sourceWidth)*sourceHeight*sourceLayers*4ull,0.f);
+	{
+		const auto format = envParams.format;
+		const auto blockDims = getBlockDimensions(format);
+		const uint8_t* inData = reinterpret_cast<const uint8_t*>(params.environment->getBuffer()->getPointer());
+		auto decode = [&](uint32_t readBlockArrayOffset, core::vectorSIMDu32 readBlockPos) -> void
+		{
+			const void* srcPix[4] = {inData+readBlockArrayOffset,nullptr,nullptr,nullptr};
+			for (auto blockY=0u; blockY<blockDims.y; blockY++)
+			for (auto blockX=0u; blockX<blockDims.x; blockX++)
+			{
+				const uint32_t x = readBlockPos.x*blockDims.x+blockX;
+				const uint32_t y = readBlockPos.y*blockDims.y+blockY;
+				if (x>=sourceWidth || y>=sourceHeight)
+					continue;
+				double decodeBuffer[4] = {};
+				decodePixelsRuntime(format,srcPix,decodeBuffer,blockX,blockY);
+				float* out = sourceTexels.data()+((size_t(readBlockPos.w)*sourceHeight+y)*sourceWidth+x)*4ull;
+				std::copy_n(decodeBuffer,4u,out);
+			}
+		};
+		IImage::SSubresourceLayers subresource = {static_cast<IImage::E_ASPECT_FLAGS>(0u),0u,0u,sourceLayers};
+		CMatchedSizeInOutImageFilterCommon::state_type::TexelRange range = {{0u,0u,0u},envParams.extent};
+		CBasicImageFilterCommon::clip_region_functor_t clipFunctor(subresource,range,format);
+		const auto& regions = params.environment->getRegions(0u);
+		CBasicImageFilterCommon::executePerRegion(core::execution::par_unseq,params.environment,decode,regions.begin(),regions.end(),clipFunctor);
+	}
+
+	// cubemaps get resampled to an equirect with roughly the same texel density, so that importance sampling only ever deals with one parametrization
+	SEquirect equirect = {sourceTexels.data(),sourceWidth,sourceHeight};
+	core::vector<float> resampledTexels;
+	if (cube)
+	{
+		equirect.width = sourceWidth*4u;
+		equirect.height = sourceWidth*2u;
+		resampledTexels.resize(size_t(equirect.width)*equirect.height*4ull);
+		parallelFor(equirect.height,[&](const uint32_t y) -> void
+		{
+			for (auto x=0u; x<equirect.width; x++)
+			{
+				const auto dir = getEquirectDirection((float(x)+0.5f)/float(equirect.width),(float(y)+0.5f)/float(equirect.height));
+				sampleCube(sourceTexels.data(),sourceWidth,dir).storeTo4Floats(resampledTexels.data()+(size_t(y)*equirect.width+x)*4ull);
+			}
+		});
+		equirect.texels = resampledTexels.data();
+	}
+
+	// project the radiance onto SH, then convolve with the clamped cosine (Ramamoorthi & Hanrahan 2001)
+	{
+		core::vector<std::array<core::vectorSIMDf,9u>> rowSums(equirect.height);
+		parallelFor(equirect.height,[&](const uint32_t y) -> void
+		{
+			auto& sums = rowSums[y];
+			std::fill(sums.begin(),sums.end(),core::vectorSIMDf(0.f));
+			const float solidAngle = equirect.getTexelSolidAngle(y);
+			for (auto x=0u; x<equirect.width; x++)
+			{
+				float basis[9];
+				evaluateSH9Basis(getEquirectDirection((float(x)+0.5f)/float(equirect.width),(float(y)+0.5f)/float(equirect.height)),basis);
+				const auto radiance = equirect.fetch(x,y)*solidAngle;
+				for (auto i=0u; i<9u; i++)
+					sums[i] += radiance*basis[i];
+			}
+		});
+		for (const auto& sums : rowSums)
+		for (auto i=0u; i<9u; i++)
+			result.irradianceSH[i] += sums[i];
+		const float bandFactors[3] = {core::PI<float>(),core::PI<float>()*2.f/3.f,core::PI<float>()*0.25f};
+		for (auto i=0u; i<9u; i++)
+		{
+			result.irradianceSH[i] *= bandFactors[i ? (i<4u ? 1u:2u):0u];
+			result.irradianceSH[i].w = 0.f;
+		}
+	}
+
+	// luminance CDF
+	auto luminance = createImage(EF_R32_SFLOAT,equirect.width,equirect.height,1u,1u,false);
+	auto luminanceSAT = createImage(EF_R64_SFLOAT,equirect.width,equirect.height,1u,1u,false);
+	if (!luminance || !luminanceSAT)
+		return result;
+	core::vector<float> texelLuminance(size_t(equirect.width)*equirect.height);
+	{
+		float* weights = reinterpret_cast<float*>(luminance->getBuffer()->getPointer());
+		parallelFor(equirect.height,[&](const uint32_t y) -> void
+		{
+			const float solidAngle = equirect.getTexelSolidAngle(y);
+			for (auto x=0u; x<equirect.width; x++)
+			{
+				const size_t i = size_t(y)*equirect.width+x;
+				texelLuminance[i] = getLuminance(equirect.fetch(x,y));
+				weights[i] = texelLuminance[i]*solidAngle;
+			}
+		});
+
+		using sat_filter_t = CSummedAreaTableImageFilter<false>;
+		sat_filter_t::state_type state;
+		state.inImage = luminance.get();
+		state.outImage = luminanceSAT.get();
+		state.inOffset = {0u,0u,0u};
+		state.inBaseLayer = 0u;
+		state.outOffset = {0u,0u,0u};
+		state.outBaseLayer = 0u;
+		state.extent = {equirect.width,equirect.height,1u};
+		state.layerCount = 1u;
+		state.inMipLevel = 0u;
+		state.outMipLevel = 0u;
+		state.axesToSum = 0b011u;
+		state.scratchMemoryByteSize = sat_filter_t::state_type::getRequiredScratchByteSize(state.inImage,state.extent);
+		state.scratchMemory = reinterpret_cast<uint8_t*>(_NBL_ALIGNED_MALLOC(state.scratchMemoryByteSize,_NBL_SIMD_ALIGNMENT));
+		const bool satResult = sat_filter_t::execute(core::execution::par_unseq,&state);
+		_NBL_ALIGNED_FREE(state.scratchMemory);
+		if (!satResult)
+			return result;
+	}
+	SLuminanceDistribution distribution;
+	distribution.sat = reinterpret_cast<const double*>(luminanceSAT->getBuffer()->getPointer());
+	distribution.luminance = texelLuminance.data();
+	distribution.width = equirect.width;
+	distribution.height = equirect.height;
+	distribution.total = distribution.getCumulativeRows(int32_t(equirect.height)-1);
+	distribution.invTotal = distribution.total>0.0 ? float(1.0/distribution.total):0.f;
+
+	// dimensions 0 and 1 drive the GGX half vectors, 2 and 3 the environment samples
+	const uint32_t sampleCount = params.sampleCount;
+	core::vector<float> sequence(sampleCount*4u);
+	{
+		auto generate = [&](auto& sampler) -> void
+		{
+			for (auto dim=0u; dim<4u; dim++)
+			for (auto i=0u; i<sampleCount; i++)
+				sequence[dim*sampleCount+i] = float(sampler.sample(dim,i)>>8u)/16777216.f;
+		};
+		if (params.scrambleSeed)
+		{
+			core::OwenSampler<> sampler(4u,params.scrambleSeed);
+			generate(sampler);
+		}
+		else
+		{
+			core::SobolSampler sampler(4u);
+			generate(sampler);
+		}
+	}
+
+	// environment samples don't depend on the output texel
+	struct SEnvironmentSample
+	{
+		core::vectorSIMDf direction;
+		core::vectorSIMDf radiance;
+		float pdf;
+	};
+	core::vector<SEnvironmentSample> environmentSamples;
+	if (distribution.total>0.0)
+	{
+		environmentSamples.resize(sampleCount);
+		parallelFor(sampleCount,[&](const uint32_t i) -> void
+		{
+			auto& envSample = environmentSamples[i];
+			float u, v;
+			envSample.direction = distribution.sample(sequence[sampleCount*2u+i],sequence[sampleCount*3u+i],u,v);
+			envSample.radiance = equirect.fetch(u,v);
+			envSample.pdf = distribution.pdf(u,v);
+		});
+	}
+
+	// GGX samples in tangent space, with `N=V` the light direction and its pdf only depend on the half vector
+	struct SGGXSample
+	{
+		float x, y, NdotL;
+		float pdf;
+	};
+	core::vector<core::vector<SGGXSample>> ggxSamples(mipCount);
+	for (auto mip=1u; mip<mipCount; mip++)
+	{
+		const float roughness = float(mip)/float(mipCount-1u);
+		const float alpha2 = roughness*roughness*roughness*roughness;
+		auto& samples = ggxSamples[mip];
+		samples.reserve(sampleCount);
+		for (auto i=0u; i<sampleCount; i++)
+		{
+			const float phi = 2.f*core::PI<float>()*sequence[i];
+			const float xi = sequence[sampleCount+i];
+			const float NdotH = std::sqrt((1.f-xi)/(1.f+(alpha2-1.f)*xi));
+			const float sinTheta = std::sqrt(core::max(1.f-NdotH*NdotH,0.f));
+			const float NdotL = 2.f*NdotH*NdotH-1.f;
+			// samples below the horizon still count towards the sample count
+			if (NdotL<=0.f)
+				continue;
+			const float toL = 2.f*NdotH*sinTheta;
+			samples.push_back({toL*std::cos(phi),toL*std::sin(phi),NdotL,ggxD(NdotH,alpha2)*0.25f});
+		}
+	}
+
+	result.prefiltered = createImage(params.prefilteredFormat,params.faceSize,params.faceSize,6u,mipCount,true);
+	if (!result.prefiltered)
+		return result;
+
+	// every row of every face of every mip is a task
+	struct STask
+	{
+		uint32_t mip;
+		uint32_t face;
+		uint32_t row;
+	};
+	core::vector<STask> tasks;
+	for (auto mip=0u; mip<mipCount; mip++)
+	{
+		const uint32_t size = core::max(params.faceSize>>mip,1u);
+		for (auto face=0u; face<6u; face++)
+		for (auto row=0u; row<size; row++)
+			tasks.push_back({mip,face,row});
+	}
+	const auto& regions = result.prefiltered->getRegions();
+	uint8_t* outData = reinterpret_cast<uint8_t*>(result.prefiltered->getBuffer()->getPointer());
+	const uint32_t texelByteSize = getTexelOrBlockBytesize(params.prefilteredFormat);
+	core::for_each(core::execution::par,tasks.begin(),tasks.end(),[&](const STask& task) -> void
+	{
+		const uint32_t size = core::max(params.faceSize>>task.mip,1u);
+		const float roughness = float(task.mip)/float(core::max(mipCount-1u,1u));
+		const float alpha2 = roughness*roughness*roughness*roughness;
+		uint8_t* rowData = outData+regions.begin()[task.mip].bufferOffset+(size_t(task.face)*size+task.row)*size*texelByteSize;
+		for (auto x=0u; x<size; x++)
+		{
+			const float sc = (float(x)+0.5f)/float(size)*2.f-1.f;
+			const float tc = (float(task.row)+0.5f)/float(size)*2.f-1.f;
+			const auto N = core::normalize(getCubeFaceDirection(task.face,sc,tc));
+
+			core::vectorSIMDf prefiltered;
+			if (task.mip)
+			{
+				// balance heuristic over both strategies with equal sample counts, normalized by the same estimate of the lobe's cosine weighted integral
+				// (so a constant environment comes out exactly constant), radiance is looked up per texel because that's what the environment pdf
+				// is proportional to, bilinear lookups would smear a bright texel onto neighbours only the GGX samples can find (fireflies)
+				core::vectorSIMDf T, B;
+				getTangentFrame(N,T,B);
+				core::vectorSIMDf radiance(0.f);
+				float weight = 0.f;
+				for (const auto& ggxSample : ggxSamples[task.mip])
+				{
+					const auto L = T*ggxSample.x+B*ggxSample.y+N*ggxSample.NdotL;
+					float u, v;
+					equirect.getUV(L,u,v);
+					const float envPdf = environmentSamples.empty() ? 0.f:distribution.pdf(u,v);
+					const float misWeight = ggxSample.NdotL*ggxSample.pdf/(ggxSample.pdf+envPdf);
+					radiance += equirect.fetch(u,v)*misWeight;
+					weight += misWeight;
+				}
+				for (const auto& envSample : environmentSamples)
+				{
+					const float NdotL = core::dot(N,envSample.direction).x;
+					if (NdotL<=0.f)
+						continue;
+					const float NdotH = std::sqrt((1.f+NdotL)*0.5f);
+					const float ggxPdf = ggxD(NdotH,alpha2)*0.25f;
+					const float misWeight = NdotL*ggxPdf/(ggxPdf+envSample.pdf);
+					radiance += envSample.radiance*misWeight;
+					weight += misWeight;
+				}
+				prefiltered = weight>0.f ? radiance/weight:core::vectorSIMDf(0.f);
+			}
+			else
+			{
+				float u, v;
+				equirect.getUV(N,u,v);
+				prefiltered = equirect.sample(u,v);
+			}
+
+			const double encodeBuffer[4] = {prefiltered.x,prefiltered.y,prefiltered.z,1.0};
+			encodePixelsRuntime(params.prefilteredFormat,rowData+x*texelByteSize,encodeBuffer);
+		}
+	});
+	return result;
+}
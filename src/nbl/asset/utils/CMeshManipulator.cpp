@@ -3,6 +3,7 @@
 // For conditions of distribution and use, see copyright notice in nabla.h
 
 #include <vector>
+#include <atomic>
 #include <numeric>
 #include <functional>
 #include <algorithm>
@@ -15,7 +16,11 @@
 #include "nbl/asset/utils/CMeshManipulator.h"
 #include "nbl/asset/utils/CSmoothNormalGenerator.h"
 #include "nbl/asset/utils/CForsythVertexCacheOptimizer.h"
+#include "nbl/asset/utils/CTipsifyVertexCacheOptimizer.h"
 #include "nbl/asset/utils/COverdrawMeshOptimizer.h"
+#include "nbl/asset/utils/CQuadricMeshSimplifier.h"
+
+#include "nbl/core/execution.h"
 
 namespace nbl::asset
 {
@@ -651,21 +656,10 @@ core::smart_refctd_ptr<ICPUMeshBuffer> IMeshManipulator::createOptimizedMeshBuff
     if (!_inbuffer->isSkinned())
         filterInvalidTriangles(outbuffer.get());
 
-	// STEP: overdraw optimization
-	COverdrawMeshOptimizer::createOptimized(outbuffer.get(),outbuffer.get());
-
-	// STEP: Forsyth
-	{
-		uint32_t* indices = reinterpret_cast<uint32_t*>(outbuffer->getIndices());
-		CForsythVertexCacheOptimizer forsyth;
-        const uint32_t vertexCount = IMeshManipulator::upperBoundVertexID(_inbuffer);
-		forsyth.optimizeTriangleOrdering(vertexCount, outbuffer->getIndexCount(), indices, indices);
-	}
-
-	// STEP: prefetch optimization
-	outbuffer = CMeshManipulator::createMeshBufferFetchOptimized(outbuffer.get()); // here we also get interleaved attributes (single vertex buffer)
+	// STEP: vertex cache, overdraw and prefetch optimization, buffers are already deep copies so this can happen in place
+	optimizeForGPU(outbuffer.get());
 	
-	// STEP: requantization
+	// STEP: requantization (here we also get interleaved attributes in a single vertex buffer)
 	requantizeMeshBuffer(outbuffer.get(), _errMetric);
 
 	// STEP: reduce index buffer to 16bit or completely get rid of it
@@ -769,6 +763,204 @@ core::smart_refctd_ptr<ICPUMeshBuffer> IMeshManipulator::createOptimizedMeshBuff
 	return outbuffer;
 }
 
+bool IMeshManipulator::optimizeForGPU(ICPUMeshBuffer* _meshbuffer, const float _overdrawThreshold)
+{
+	if (!_meshbuffer || !_meshbuffer->getPipeline() || _meshbuffer->getPipeline()->getPrimitiveAssemblyParams().primitiveType!=EPT_TRIANGLE_LIST)
+		return false;
+
+	void* const indices = _meshbuffer->getIndices();
+	const E_INDEX_TYPE indexType = _meshbuffer->getIndexType();
+	if (!indices || indexType==EIT_UNKNOWN)
+		return false;
+
+	// the overdraw optimizer relies on the hard boundaries between the triangle fans of Tipsify
+	const uint32_t vertexCount = upperBoundVertexID(_meshbuffer);
+	if (indexType==EIT_16BIT)
+		CTipsifyVertexCacheOptimizer::optimizeTriangleOrdering(vertexCount,_meshbuffer->getIndexCount(),reinterpret_cast<const uint16_t*>(indices),reinterpret_cast<uint16_t*>(indices));
+	else
+		CTipsifyVertexCacheOptimizer::optimizeTriangleOrdering(vertexCount,_meshbuffer->getIndexCount(),reinterpret_cast<const uint32_t*>(indices),reinterpret_cast<uint32_t*>(indices));
+
+	COverdrawMeshOptimizer::createOptimized(_meshbuffer,_meshbuffer,_overdrawThreshold);
+
+	optimizeVertexFetch(_meshbuffer);
+	return true;
+}
+
+bool IMeshManipulator::optimizeVertexFetch(ICPUMeshBuffer* _meshbuffer)
+{
+	if (!_meshbuffer || !_meshbuffer->getPipeline())
+		return false;
+
+	void* const indices = _meshbuffer->getIndices();
+	const E_INDEX_TYPE indexType = _meshbuffer->getIndexType();
+	if (!indices || indexType==EIT_UNKNOWN)
+		return false;
+
+	const uint32_t indexCount = _meshbuffer->getIndexCount();
+	const uint32_t vertexCount = upperBoundVertexID(_meshbuffer);
+	auto getIndex = [&](const uint32_t i) -> uint32_t
+	{
+		return indexType==EIT_16BIT ? reinterpret_cast<const uint16_t*>(indices)[i]:reinterpret_cast<const uint32_t*>(indices)[i];
+	};
+
+	// bindings which interleave within the same vertex records get moved together
+	struct SRegion
+	{
+		ICPUBuffer* buffer;
+		int64_t offset;
+		uint32_t stride;
+	};
+	core::vector<SRegion> regions;
+	{
+		const auto& vtxParams = _meshbuffer->getPipeline()->getVertexInputParams();
+		for (uint32_t binding=0u; binding<ICPUMeshBuffer::MAX_ATTR_BUF_BINDING_COUNT; binding++)
+		{
+			bool used = false;
+			for (uint32_t attr=0u; attr<ICPUMeshBuffer::MAX_VERTEX_ATTRIB_COUNT; attr++)
+				used = used || (_meshbuffer->isAttributeEnabled(attr) && _meshbuffer->getBindingNumForAttribute(attr)==binding);
+			const auto& bufferBinding = _meshbuffer->getVertexBufferBindings()[binding];
+			const uint32_t stride = vtxParams.bindings[binding].stride;
+			if (!used || !bufferBinding.buffer || vtxParams.bindings[binding].inputRate!=EVIR_PER_VERTEX || stride==0u)
+				continue;
+
+			const int64_t offset = int64_t(bufferBinding.offset)+int64_t(_meshbuffer->getBaseVertex())*stride;
+			if (offset<0 || offset+uint64_t(vertexCount)*stride>bufferBinding.buffer->getSize())
+				return false;
+			regions.push_back({bufferBinding.buffer.get(),offset,stride});
+		}
+		std::sort(regions.begin(),regions.end(),[](const SRegion& a, const SRegion& b) -> bool
+		{
+			if (a.buffer!=b.buffer)
+				return a.buffer<b.buffer;
+			if (a.stride!=b.stride)
+				return a.stride<b.stride;
+			return a.offset<b.offset;
+		});
+		regions.erase(std::unique(regions.begin(),regions.end(),[](const SRegion& a, const SRegion& b) -> bool
+		{
+			return a.buffer==b.buffer && a.stride==b.stride && b.offset<a.offset+a.stride;
+		}),regions.end());
+	}
+
+	core::vector<uint32_t> remap(vertexCount,~0u);
+	uint32_t nextVertex = 0u;
+	for (uint32_t i=0u; i<indexCount; i++)
+	{
+		uint32_t& newIndex = remap[getIndex(i)];
+		if (newIndex==~0u)
+			newIndex = nextVertex++;
+	}
+	for (auto& newIndex : remap)
+	if (newIndex==~0u)
+		newIndex = nextVertex++;
+
+	core::vector<uint8_t> scratch;
+	for (const auto& region : regions)
+	{
+		uint8_t* const data = reinterpret_cast<uint8_t*>(region.buffer->getPointer())+region.offset;
+		scratch.assign(data,data+size_t(vertexCount)*region.stride);
+		core::for_each(core::execution::par_unseq,remap.begin(),remap.end(),[&](const uint32_t& newIndex) -> void
+		{
+			const size_t oldIndex = &newIndex-remap.data();
+			memcpy(data+size_t(newIndex)*region.stride,scratch.data()+oldIndex*region.stride,region.stride);
+		});
+	}
+
+	for (uint32_t i=0u; i<indexCount; i++)
+	{
+		const uint32_t newIndex = remap[getIndex(i)];
+		if (indexType==EIT_16BIT)
+			reinterpret_cast<uint16_t*>(indices)[i] = newIndex;
+		else
+			reinterpret_cast<uint32_t*>(indices)[i] = newIndex;
+	}
+	return true;
+}
+
+core::smart_refctd_ptr<ICPUMeshBuffer> IMeshManipulator::createSimplifiedMeshBuffer(const ICPUMeshBuffer* _inbuffer, const SSimplificationParams& _params, float* _outError)
+{
+	if (_outError)
+		*_outError = 0.f;
+	if (!_inbuffer || !_inbuffer->getPipeline() || !_inbuffer->isAttributeEnabled(_inbuffer->getPositionAttributeIx()))
+		return nullptr;
+
+	const auto primitiveType = _inbuffer->getPipeline()->getPrimitiveAssemblyParams().primitiveType;
+	switch (primitiveType)
+	{
+		case EPT_TRIANGLE_LIST: [[fallthrough]];
+		case EPT_TRIANGLE_STRIP: [[fallthrough]];
+		case EPT_TRIANGLE_FAN:
+			break;
+		default:
+			return nullptr;
+	}
+	uint32_t triangleCount = 0u;
+	if (!getPolyCount(triangleCount,_inbuffer) || triangleCount==0u)
+		return nullptr;
+
+	core::vector<uint32_t> indices(triangleCount*3u);
+	for (uint32_t i=0u; i<triangleCount; i++)
+	{
+		const auto triangle = getTriangleIndices(_inbuffer,i);
+		std::copy(triangle.begin(),triangle.end(),indices.data()+i*3u);
+	}
+	const uint32_t targetTriangleCount = static_cast<uint32_t>(triangleCount*core::clamp(_params.targetTriangleRatio,0.f,1.f));
+
+	float error;
+	indices = CQuadricMeshSimplifier::simplify(_inbuffer,std::move(indices),upperBoundVertexID(_inbuffer),targetTriangleCount,_params,error);
+	if (_outError)
+		*_outError = error;
+
+	// share everything but the index buffer
+	auto outbuffer = core::move_and_static_cast<ICPUMeshBuffer>(_inbuffer->clone(0u));
+	if (primitiveType!=EPT_TRIANGLE_LIST)
+	{
+		auto pipeline = core::move_and_static_cast<ICPURenderpassIndependentPipeline>(_inbuffer->getPipeline()->clone(0u));
+		pipeline->getPrimitiveAssemblyParams().primitiveType = EPT_TRIANGLE_LIST;
+		outbuffer->setPipeline(std::move(pipeline));
+	}
+	auto indexBuffer = core::make_smart_refctd_ptr<ICPUBuffer>(indices.size()*sizeof(uint32_t));
+	memcpy(indexBuffer->getPointer(),indices.data(),indexBuffer->getSize());
+	outbuffer->setIndexBufferBinding({0ull,std::move(indexBuffer)});
+	outbuffer->setIndexType(EIT_32BIT);
+	outbuffer->setIndexCount(indices.size());
+	recalculateBoundingBox(outbuffer.get());
+
+	return outbuffer;
+}
+
+core::vector<IMeshManipulator::SLoDLevel> IMeshManipulator::createLoDChain(const ICPUMeshBuffer* _inbuffer, const uint32_t _maxLevelCount, const float _levelRatio, const SSimplificationParams& _params)
+{
+	core::vector<SLoDLevel> levels;
+	uint32_t triangleCount = 0u;
+	if (!_inbuffer || _maxLevelCount==0u || !getPolyCount(triangleCount,_inbuffer))
+		return levels;
+
+	levels.resize(_maxLevelCount);
+	levels[0].meshbuffer = core::move_and_static_cast<ICPUMeshBuffer>(_inbuffer->clone(0u));
+	levels[0].error = 0.f;
+	core::for_each(core::execution::par,levels.begin()+1u,levels.end(),[&](SLoDLevel& level) -> void
+	{
+		auto params = _params;
+		params.targetTriangleRatio = std::pow(_levelRatio,static_cast<float>(&level-levels.data()));
+		level.meshbuffer = createSimplifiedMeshBuffer(_inbuffer,params,&level.error);
+	});
+
+	// cut the chain at the first level which didn't get at least halfway to its target
+	for (uint32_t i=1u; i<levels.size(); i++)
+	{
+		uint32_t levelTriangleCount = 0u;
+		if (!levels[i].meshbuffer || !getPolyCount(levelTriangleCount,levels[i].meshbuffer.get()) || levelTriangleCount>triangleCount*(1.f+_levelRatio)*0.5f)
+		{
+			levels.resize(i);
+			break;
+		}
+		levels[i].error = core::max(levels[i].error,levels[i-1u].error);
+		triangleCount = levelTriangleCount;
+	}
+	return levels;
+}
+
 void IMeshManipulator::requantizeMeshBuffer(ICPUMeshBuffer* _meshbuffer, const SErrorMetric* _errMetric)
 {
     constexpr uint32_t MAX_ATTRIBS = ICPUMeshBuffer::MAX_VERTEX_ATTRIB_COUNT;
@@ -777,25 +969,42 @@ void IMeshManipulator::requantizeMeshBuffer(ICPUMeshBuffer* _meshbuffer, const S
 	for (size_t i = 0u; i < MAX_ATTRIBS; ++i)
 		newAttribs[i].vaid = i;
 
-    CQuantNormalCache quantizationCache;
+	// every attribute gets analysed by its own task (which then also splits the vertices into chunks)
+	core::vector<uint32_t> activeAttribs;
+	for (uint32_t vaid = 0u; vaid < MAX_ATTRIBS; ++vaid)
+	{
+        const auto& vbuf = _meshbuffer->getAttribBoundBuffer(vaid).buffer;
+		if (_meshbuffer->isAttributeEnabled(vaid) && vbuf)
+			activeAttribs.push_back(vaid);
+	}
+	core::vector<CMeshManipulator::SIntegerAttr> foundAttribsI[MAX_ATTRIBS];
+	core::vector<core::vectorSIMDf> foundAttribsF[MAX_ATTRIBS];
+	core::for_each(core::execution::par, activeAttribs.begin(), activeAttribs.end(), [&](const uint32_t vaid) -> void
+	{
+        const E_FORMAT type = _meshbuffer->getAttribFormat(vaid);
+		if (!isNormalizedFormat(type) && isIntegerFormat(type))
+			foundAttribsI[vaid] = CMeshManipulator::findBetterFormatI(&newAttribs[vaid].type, &newAttribs[vaid].size, &newAttribs[vaid].prevType, _meshbuffer, vaid, _errMetric[vaid]);
+		else
+			foundAttribsF[vaid] = CMeshManipulator::findBetterFormatF(&newAttribs[vaid].type, &newAttribs[vaid].size, &newAttribs[vaid].prevType, _meshbuffer, vaid, _errMetric[vaid]);
+	});
 
+	// attributes which could not be decoded (e.g. BGRA integer formats) come back empty and get no slot in the new vertex
 	core::unordered_map<uint32_t, core::vector<CMeshManipulator::SIntegerAttr>> attribsI;
 	core::unordered_map<uint32_t, core::vector<core::vectorSIMDf>> attribsF;
-	for (size_t vaid = 0u; vaid < MAX_ATTRIBS; ++vaid)
+	uint32_t droppedAttribMask = 0u;
+	for (const uint32_t vaid : activeAttribs)
 	{
-        const E_FORMAT type = _meshbuffer->getAttribFormat(vaid);
-
-        const auto& vbuf = _meshbuffer->getAttribBoundBuffer(vaid).buffer;
-		if (_meshbuffer->isAttributeEnabled(vaid) && vbuf)
-		{
-			if (!isNormalizedFormat(type) && isIntegerFormat(type))
-				attribsI[vaid] = CMeshManipulator::findBetterFormatI(&newAttribs[vaid].type, &newAttribs[vaid].size, &newAttribs[vaid].prevType, _meshbuffer, vaid, _errMetric[vaid]);
-			else
-				attribsF[vaid] = CMeshManipulator::findBetterFormatF(&newAttribs[vaid].type, &newAttribs[vaid].size, &newAttribs[vaid].prevType, _meshbuffer, vaid, _errMetric[vaid], quantizationCache);
-		}
+		if (!foundAttribsI[vaid].empty())
+			attribsI[vaid] = std::move(foundAttribsI[vaid]);
+		else if (!foundAttribsF[vaid].empty())
+			attribsF[vaid] = std::move(foundAttribsF[vaid]);
+		else
+			droppedAttribMask |= 0x1u<<vaid;
 	}
 
 	const size_t activeAttributeCount = attribsI.size() + attribsF.size();
+	if (!activeAttributeCount)
+		return;
 
 #ifdef _NBL_DEBUG
 	{
@@ -807,7 +1016,11 @@ void IMeshManipulator::requantizeMeshBuffer(ICPUMeshBuffer* _meshbuffer, const S
 		_NBL_DEBUG_BREAK_IF(sizesSet.size() != 1);
 	}
 #endif
-	const size_t vertexCnt = (!attribsI.empty() ? attribsI.begin()->second.size() : (!attribsF.empty() ? attribsF.begin()->second.size() : 0));
+	size_t vertexCnt = 0u;
+	for (const auto& attr : attribsI)
+		vertexCnt = core::max(vertexCnt, attr.second.size());
+	for (const auto& attr : attribsF)
+		vertexCnt = core::max(vertexCnt, attr.second.size());
 
 	std::sort(newAttribs, newAttribs + MAX_ATTRIBS, std::greater<CMeshManipulator::SAttrib>()); // sort decreasing by size
 
@@ -829,6 +1042,8 @@ void IMeshManipulator::requantizeMeshBuffer(ICPUMeshBuffer* _meshbuffer, const S
     assert(_meshbuffer->getVertexBufferBindings()[0].buffer);
     assert(_meshbuffer->isVertexAttribBufferBindingEnabled(VTX_BUF_BINDING));
     _meshbuffer->setVertexBufferBinding({ 0u, core::smart_refctd_ptr(newVertexBuffer) }, VTX_BUF_BINDING);
+	// the attributes were read starting at the old base vertex, the new buffer starts at the first of them
+	_meshbuffer->setBaseVertex(0);
 
     auto* pipeline = _meshbuffer->getPipeline();
     auto& vtxParams = pipeline->getVertexInputParams();
@@ -841,30 +1056,50 @@ void IMeshManipulator::requantizeMeshBuffer(ICPUMeshBuffer* _meshbuffer, const S
         vtxParams.attributes[vaid].binding = VTX_BUF_BINDING;
         vtxParams.attributes[vaid].format = newAttribs[i].type;
         vtxParams.attributes[vaid].relativeOffset = newAttribs[i].offset;
+	}
+	// the old vertex buffer is gone, so whatever could not be requantized must not read from the new one
+	vtxParams.enabledAttribFlags &= ~droppedAttribMask;
 
-		core::unordered_map<uint32_t, core::vector<CMeshManipulator::SIntegerAttr>>::iterator iti = attribsI.find(newAttribs[i].vaid);
-		if (iti != attribsI.end())
+	// interleave all the attributes in parallel, writing straight into the new buffer instead of looking the attribute up for every vertex
+	uint8_t* const newVertexData = reinterpret_cast<uint8_t*>(newVertexBuffer->getPointer());
+	struct SChunk
+	{
+		uint32_t begin, end;
+	};
+	auto chunks = CMeshManipulator::createVertexChunks<SChunk>(vertexCnt);
+	core::for_each(core::execution::par, chunks.begin(), chunks.end(), [&](const SChunk& chunk) -> void
+	{
+		for (size_t i = 0u; i < activeAttributeCount; ++i)
 		{
-			const core::vector<CMeshManipulator::SIntegerAttr>& attrVec = iti->second;
-			for (size_t ai = 0u; ai < attrVec.size(); ++ai)
+			const E_FORMAT type = newAttribs[i].type;
+			uint8_t* dst = newVertexData + newAttribs[i].offset + chunk.begin*vertexSize;
+
+			auto iti = attribsI.find(newAttribs[i].vaid);
+			if (iti != attribsI.end())
 			{
-				const bool check = _meshbuffer->setAttribute(attrVec[ai].pointer, newAttribs[i].vaid, ai);
-				_NBL_DEBUG_BREAK_IF(!check)
+				const core::vector<CMeshManipulator::SIntegerAttr>& attrVec = iti->second;
+				const uint32_t end = core::min<size_t>(chunk.end, attrVec.size());
+				for (uint32_t ai = chunk.begin; ai < end; ++ai, dst += vertexSize)
+				{
+					[[maybe_unused]] const bool check = ICPUMeshBuffer::setAttribute(attrVec[ai].pointer, dst, type);
+					_NBL_DEBUG_BREAK_IF(!check)
+				}
+				continue;
 			}
-			continue;
-		}
 
-		core::unordered_map<uint32_t, core::vector<core::vectorSIMDf>>::iterator itf = attribsF.find(newAttribs[i].vaid);
-		if (itf != attribsF.end())
-		{
-			const core::vector<core::vectorSIMDf>& attrVec = itf->second;
-			for (size_t ai = 0u; ai < attrVec.size(); ++ai)
+			auto itf = attribsF.find(newAttribs[i].vaid);
+			if (itf != attribsF.end())
 			{
-				const bool check = _meshbuffer->setAttribute(attrVec[ai], newAttribs[i].vaid, ai);
-				_NBL_DEBUG_BREAK_IF(!check)
+				const core::vector<core::vectorSIMDf>& attrVec = itf->second;
+				const uint32_t end = core::min<size_t>(chunk.end, attrVec.size());
+				for (uint32_t ai = chunk.begin; ai < end; ++ai, dst += vertexSize)
+				{
+					[[maybe_unused]] const bool check = ICPUMeshBuffer::setAttribute(attrVec[ai], dst, type);
+					_NBL_DEBUG_BREAK_IF(!check)
+				}
 			}
 		}
-	}
+	});
 }
 
 
@@ -920,7 +1155,7 @@ void CMeshManipulator::_filterInvalidTriangles(ICPUMeshBuffer* _input)
 template void CMeshManipulator::_filterInvalidTriangles<uint16_t>(ICPUMeshBuffer* _input);
 template void CMeshManipulator::_filterInvalidTriangles<uint32_t>(ICPUMeshBuffer* _input);
 
-core::vector<core::vectorSIMDf> CMeshManipulator::findBetterFormatF(E_FORMAT* _outType, size_t* _outSize, E_FORMAT* _outPrevType, const ICPUMeshBuffer* _meshbuffer, uint32_t _attrId, const SErrorMetric& _errMetric, CQuantNormalCache& _cache)
+core::vector<core::vectorSIMDf> CMeshManipulator::findBetterFormatF(E_FORMAT* _outType, size_t* _outSize, E_FORMAT* _outPrevType, const ICPUMeshBuffer* _meshbuffer, uint32_t _attrId, const SErrorMetric& _errMetric)
 {
 	if (!_meshbuffer->getPipeline())
         return {};
@@ -930,48 +1165,51 @@ core::vector<core::vectorSIMDf> CMeshManipulator::findBetterFormatF(E_FORMAT* _o
     if (!isFloatingPointFormat(thisType) && !isNormalizedFormat(thisType) && !isScaledFormat(thisType))
         return {};
 
-	core::vector<core::vectorSIMDf> attribs;
-
-
-    const uint32_t cpa = getFormatChannelCount(thisType);
-
-	float min[4]{ FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
-	float max[4]{ -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
-
-	core::vectorSIMDf attr;
     const uint32_t cnt = IMeshManipulator::upperBoundVertexID(_meshbuffer);
-    for (uint32_t idx = 0u; idx < cnt; ++idx)
+	core::vector<core::vectorSIMDf> attribs(cnt);
+
+	// decode and reduce the range in parallel, with the attribute pointer and stride fetched once instead of per vertex
+	const uint8_t* const src = _meshbuffer->getAttribPointer(_attrId);
+	const uint32_t stride = _meshbuffer->getAttribStride(_attrId);
+	const auto* srcBuffer = _meshbuffer->getAttribBoundBuffer(_attrId).buffer.get();
+	const uint8_t* const srcEnd = reinterpret_cast<const uint8_t*>(srcBuffer->getPointer())+srcBuffer->getSize()-getTexelOrBlockBytesize(thisType);
+	struct SChunk
+	{
+		uint32_t begin, end;
+		core::vectorSIMDf min = core::vectorSIMDf(FLT_MAX);
+		core::vectorSIMDf max = core::vectorSIMDf(-FLT_MAX);
+	};
+	auto chunks = createVertexChunks<SChunk>(cnt);
+	core::for_each(core::execution::par,chunks.begin(),chunks.end(),[&](SChunk& chunk) -> void
 	{
-        _meshbuffer->getAttribute(attr, _attrId, idx);
-		attribs.push_back(attr);
-		for (uint32_t i = 0; i < cpa ; ++i)
+		for (uint32_t idx=chunk.begin; idx<chunk.end; ++idx)
 		{
-			if (attr.pointer[i] < min[i])
-				min[i] = attr.pointer[i];
-			if (attr.pointer[i] > max[i])
-				max[i] = attr.pointer[i];
+			const uint8_t* const vertex = src+size_t(idx)*stride;
+			if (!src || vertex>srcEnd || !ICPUMeshBuffer::getAttribute(attribs[idx],vertex,thisType))
+				continue;
+			chunk.min = core::min(chunk.min,attribs[idx]);
+			chunk.max = core::max(chunk.max,attribs[idx]);
 		}
+	});
+	core::vectorSIMDf min(FLT_MAX), max(-FLT_MAX);
+	for (const auto& chunk : chunks)
+	{
+		min = core::min(min,chunk.min);
+		max = core::max(max,chunk.max);
 	}
 
-	core::vector<SAttribTypeChoice> possibleTypes = findTypesOfProperRangeF(thisType, getTexelOrBlockBytesize(thisType), min, max, _errMetric);
+	core::vector<SAttribTypeChoice> possibleTypes = findTypesOfProperRangeF(thisType, getTexelOrBlockBytesize(thisType), min.pointer, max.pointer, _errMetric);
 	std::sort(possibleTypes.begin(), possibleTypes.end(), [](const SAttribTypeChoice& t1, const SAttribTypeChoice& t2) { return getTexelOrBlockBytesize(t1.type) < getTexelOrBlockBytesize(t2.type); });
 
 	*_outPrevType = thisType;
     *_outType = thisType;
     *_outSize = getTexelOrBlockBytesize(*_outType);
 
-	for (const SAttribTypeChoice& t : possibleTypes)
+	const uint32_t bestType = calcMaxQuantizationError({ thisType }, possibleTypes, attribs, _errMetric);
+	if (bestType<possibleTypes.size() && getTexelOrBlockBytesize(possibleTypes[bestType].type) < getTexelOrBlockBytesize(thisType))
 	{
-		if (calcMaxQuantizationError({ thisType }, t, attribs, _errMetric, _cache))
-		{
-            if (getTexelOrBlockBytesize(t.type) < getTexelOrBlockBytesize(thisType))
-            {
-                *_outType = t.type;
-                *_outSize = getTexelOrBlockBytesize(*_outType);
-            }
-
-			return attribs;
-		}
+		*_outType = possibleTypes[bestType].type;
+		*_outSize = getTexelOrBlockBytesize(*_outType);
 	}
 
 	return attribs;
@@ -990,50 +1228,51 @@ core::vector<CMeshManipulator::SIntegerAttr> CMeshManipulator::findBetterFormatI
     if (isBGRALayoutFormat(thisType))
         return {}; // BGRA is supported only by a few normalized types (this is function for integer types)
 
-	core::vector<SIntegerAttr> attribs;
-
-
     const uint32_t cpa = getFormatChannelCount(thisType);
+	const bool isSigned = isSignedFormat(thisType);
 
-	uint32_t min[4];
-	uint32_t max[4];
-	if (!isSignedFormat(thisType))
-		for (size_t i = 0; i < 4; ++i)
-			min[i] = UINT_MAX;
-	else
-		for (size_t i = 0; i < 4; ++i)
-			min[i] = INT_MAX;
-	if (!isSignedFormat(thisType))
-		for (size_t i = 0; i < 4; ++i)
-			max[i] = 0;
-	else
-		for (size_t i = 0; i < 4; ++i)
-			max[i] = INT_MIN;
-
-
-	SIntegerAttr attr;
     const uint32_t cnt = IMeshManipulator::upperBoundVertexID(_meshbuffer);
-    for (uint32_t idx = 0u; idx < cnt; ++idx)
+	core::vector<SIntegerAttr> attribs(cnt);
+
+	// decode and reduce the range in parallel, with the attribute pointer and stride fetched once instead of per vertex
+	const uint8_t* const src = _meshbuffer->getAttribPointer(_attrId);
+	const uint32_t stride = _meshbuffer->getAttribStride(_attrId);
+	const auto* srcBuffer = _meshbuffer->getAttribBoundBuffer(_attrId).buffer.get();
+	const uint8_t* const srcEnd = reinterpret_cast<const uint8_t*>(srcBuffer->getPointer())+srcBuffer->getSize()-getTexelOrBlockBytesize(thisType);
+	struct SChunk
+	{
+		uint32_t begin, end;
+		core::vectorSIMDu32 min, max;
+	};
+	// signed values get biased so the same unsigned comparisons work for both
+	const core::vectorSIMDu32 bias(isSigned ? 0x80000000u:0u);
+	auto chunks = createVertexChunks<SChunk>(cnt);
+	core::for_each(core::execution::par,chunks.begin(),chunks.end(),[&](SChunk& chunk) -> void
 	{
-        _meshbuffer->getAttribute(attr.pointer, _attrId, idx);
-		attribs.push_back(attr);
-		for (uint32_t i = 0; i < cpa; ++i)
+		chunk.min = core::vectorSIMDu32(UINT_MAX);
+		chunk.max = core::vectorSIMDu32(0u);
+		for (uint32_t idx=chunk.begin; idx<chunk.end; ++idx)
 		{
-			if (!isSignedFormat(thisType))
-			{
-				if (attr.pointer[i] < min[i])
-					min[i] = attr.pointer[i];
-				if (attr.pointer[i] > max[i])
-					max[i] = attr.pointer[i];
-			}
-			else
-			{
-				if (((int32_t*)attr.pointer + i)[0] < ((int32_t*)min + i)[0])
-					min[i] = attr.pointer[i];
-				if (((int32_t*)attr.pointer + i)[0] > ((int32_t*)max + i)[0])
-					max[i] = attr.pointer[i];
-			}
+			const uint8_t* const vertex = src+size_t(idx)*stride;
+			if (!src || vertex>srcEnd || !ICPUMeshBuffer::getAttribute(attribs[idx].pointer,vertex,thisType))
+				continue;
+			const core::vectorSIMDu32 value = core::vectorSIMDu32(attribs[idx].pointer)^bias;
+			chunk.min = core::min(chunk.min,value);
+			chunk.max = core::max(chunk.max,value);
 		}
+	});
+	core::vectorSIMDu32 minBiased(UINT_MAX), maxBiased(0u);
+	for (const auto& chunk : chunks)
+	{
+		minBiased = core::min(minBiased,chunk.min);
+		maxBiased = core::max(maxBiased,chunk.max);
+	}
+	uint32_t min[4];
+	uint32_t max[4];
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		min[i] = minBiased.pointer[i]^bias.pointer[i];
+		max[i] = maxBiased.pointer[i]^bias.pointer[i];
 	}
 
 	*_outPrevType = *_outType = thisType;
@@ -1372,86 +1611,139 @@ core::vector<CMeshManipulator::SAttribTypeChoice> CMeshManipulator::findTypesOfP
 	return possibleTypes;
 }
 
-bool CMeshManipulator::calcMaxQuantizationError(const SAttribTypeChoice& _srcType, const SAttribTypeChoice& _dstType, const core::vector<core::vectorSIMDf>& _srcData, const SErrorMetric& _errMetric, CQuantNormalCache& _cache)
+uint32_t CMeshManipulator::calcMaxQuantizationError(const SAttribTypeChoice& _srcType, const core::vector<SAttribTypeChoice>& _dstTypes, const core::vector<core::vectorSIMDf>& _srcData, const SErrorMetric& _errMetric)
 {
     using namespace video;
 
 	using QuantF_t = core::vectorSIMDf(*)(const core::vectorSIMDf&, E_FORMAT, E_FORMAT, CQuantNormalCache & _cache);
 
-	QuantF_t quantFunc = nullptr;
-
-	if (_errMetric.method == EEM_ANGLES)
+	auto getQuantFunc = [&_errMetric](const E_FORMAT _dstType) -> QuantF_t
 	{
-		switch (_dstType.type)
+		QuantF_t quantFunc = nullptr;
+
+		if (_errMetric.method == EEM_ANGLES)
 		{
-		case EF_R8_SNORM:
-        case EF_R8G8_SNORM:
-        case EF_R8G8B8_SNORM:
-        case EF_R8G8B8A8_SNORM:
-			quantFunc = [](const core::vectorSIMDf& _in, E_FORMAT, E_FORMAT, CQuantNormalCache& _cache) -> core::vectorSIMDf {
+			switch (_dstType)
+			{
+			case EF_R8_SNORM:
+	        case EF_R8G8_SNORM:
+	        case EF_R8G8B8_SNORM:
+	        case EF_R8G8B8A8_SNORM:
+				quantFunc = [](const core::vectorSIMDf& _in, E_FORMAT, E_FORMAT, CQuantNormalCache& _cache) -> core::vectorSIMDf {
+					uint8_t buf[32];
+					((CQuantNormalCache::value_type_t<EF_R8G8B8_SNORM>*)buf)[0] = _cache.quantize<EF_R8G8B8_SNORM>(_in);
+
+					core::vectorSIMDf retval;
+					ICPUMeshBuffer::getAttribute(retval, buf, EF_R8G8B8A8_SNORM);
+					retval.w = 1.f;
+					return retval;
+				};
+				break;
+			case EF_A2R10G10B10_SNORM_PACK32:
+			case EF_A2B10G10R10_SNORM_PACK32: // bgra
+				quantFunc = [](const core::vectorSIMDf& _in, E_FORMAT, E_FORMAT, CQuantNormalCache& _cache) -> core::vectorSIMDf {
+					uint8_t buf[32];
+					((CQuantNormalCache::value_type_t<EF_A2B10G10R10_SNORM_PACK32>*)buf)[0] = _cache.quantize<EF_A2B10G10R10_SNORM_PACK32>(_in);
+
+					core::vectorSIMDf retval;
+					ICPUMeshBuffer::getAttribute(retval, buf, EF_A2R10G10B10_SNORM_PACK32);
+					retval.w = 1.f;
+					return retval;
+				};
+				break;
+	        case EF_R16_SNORM:
+	        case EF_R16G16_SNORM:
+	        case EF_R16G16B16_SNORM:
+	        case EF_R16G16B16A16_SNORM:
+				quantFunc = [](const core::vectorSIMDf& _in, E_FORMAT, E_FORMAT, CQuantNormalCache& _cache) -> core::vectorSIMDf {
+					uint8_t buf[32];
+					((CQuantNormalCache::value_type_t<EF_R16G16B16_SNORM>*)buf)[0] = _cache.quantize<EF_R16G16B16_SNORM>(_in);
+
+					core::vectorSIMDf retval;
+					ICPUMeshBuffer::getAttribute(retval, buf, EF_R16G16B16A16_SNORM);
+					retval.w = 1.f;
+					return retval;
+				};
+				break;
+	        default: 
+	            quantFunc = nullptr;
+	            break;
+			}
+		}
+		else
+		{
+			quantFunc = [](const core::vectorSIMDf& _in, E_FORMAT _inType, E_FORMAT _outType, CQuantNormalCache& _cache) -> core::vectorSIMDf {
 				uint8_t buf[32];
-				((CQuantNormalCache::value_type_t<EF_R8G8B8_SNORM>*)buf)[0] = _cache.quantize<EF_R8G8B8_SNORM>(_in);
-
-				core::vectorSIMDf retval;
-				ICPUMeshBuffer::getAttribute(retval, buf, EF_R8G8B8A8_SNORM);
-				retval.w = 1.f;
-				return retval;
+				ICPUMeshBuffer::setAttribute(_in, buf, _outType);
+				core::vectorSIMDf out(0.f, 0.f, 0.f, 1.f);
+				ICPUMeshBuffer::getAttribute(out, buf, _outType);
+				return out;
 			};
-			break;
-		case EF_A2R10G10B10_SNORM_PACK32:
-		case EF_A2B10G10R10_SNORM_PACK32: // bgra
-			quantFunc = [](const core::vectorSIMDf& _in, E_FORMAT, E_FORMAT, CQuantNormalCache& _cache) -> core::vectorSIMDf {
-				uint8_t buf[32];
-				((CQuantNormalCache::value_type_t<EF_A2B10G10R10_SNORM_PACK32>*)buf)[0] = _cache.quantize<EF_A2B10G10R10_SNORM_PACK32>(_in);
+		}
 
-				core::vectorSIMDf retval;
-				ICPUMeshBuffer::getAttribute(retval, buf, EF_A2R10G10B10_SNORM_PACK32);
-				retval.w = 1.f;
-				return retval;
-			};
-			break;
-        case EF_R16_SNORM:
-        case EF_R16G16_SNORM:
-        case EF_R16G16B16_SNORM:
-        case EF_R16G16B16A16_SNORM:
-			quantFunc = [](const core::vectorSIMDf& _in, E_FORMAT, E_FORMAT, CQuantNormalCache& _cache) -> core::vectorSIMDf {
-				uint8_t buf[32];
-				((CQuantNormalCache::value_type_t<EF_R16G16B16_SNORM>*)buf)[0] = _cache.quantize<EF_R16G16B16_SNORM>(_in);
+		return quantFunc;
+	};
 
-				core::vectorSIMDf retval;
-				ICPUMeshBuffer::getAttribute(retval, buf, EF_R16G16B16A16_SNORM);
-				retval.w = 1.f;
-				return retval;
-			};
-			break;
-        default: 
-            quantFunc = nullptr;
-            break;
-		}
-	}
-	else
+	// every candidate gets a bit, they're sorted by preference so the result is the lowest one which never failed
+	constexpr uint32_t MaxCandidates = 64u;
+	const uint32_t candidateCount = core::min<uint32_t>(_dstTypes.size(),MaxCandidates);
+	if (candidateCount==0u)
+		return _dstTypes.size();
+	const uint64_t allCandidates = candidateCount!=MaxCandidates ? ((0x1ull<<candidateCount)-1ull):~0ull;
+
+	QuantF_t quantFuncs[MaxCandidates];
+	uint64_t initiallyFailed = 0ull;
+	for (uint32_t i=0u; i<candidateCount; i++)
 	{
-		quantFunc = [](const core::vectorSIMDf& _in, E_FORMAT _inType, E_FORMAT _outType, CQuantNormalCache& _cache) -> core::vectorSIMDf {
-			uint8_t buf[32];
-			ICPUMeshBuffer::setAttribute(_in, buf, _outType);
-			core::vectorSIMDf out(0.f, 0.f, 0.f, 1.f);
-			ICPUMeshBuffer::getAttribute(out, buf, _outType);
-			return out;
-		};
+		quantFuncs[i] = getQuantFunc(_dstTypes[i].type);
+		_NBL_DEBUG_BREAK_IF(!quantFuncs[i])
+		if (!quantFuncs[i])
+			initiallyFailed |= 0x1ull<<i;
 	}
+	std::atomic<uint64_t> failed = initiallyFailed;
 
-	_NBL_DEBUG_BREAK_IF(!quantFunc)
-	if (!quantFunc)
-		return false;
-
-	for (const core::vectorSIMDf& d : _srcData)
+	// Every chunk only verifies the most preferred candidate still alive and moves onto the next one once that fails (anywhere),
+	// so the expensive quantizations of the larger formats never run if a smaller format passes.
+	struct SChunk
 	{
-		const core::vectorSIMDf quantized = quantFunc(d, _srcType.type, _dstType.type, _cache);
-        if (!compareFloatingPointAttribute(d, quantized, getFormatChannelCount(_srcType.type), _errMetric))
-            return false;
+		uint32_t begin, end;
+		uint64_t verified = 0ull;
+	};
+	auto chunks = createVertexChunks<SChunk>(_srcData.size());
+	const uint32_t cpa = getFormatChannelCount(_srcType.type);
+	// the cache is safe to use concurrently and its values only depend on the key, so one gets shared by all chunks
+	CQuantNormalCache cache;
+	auto verifyChunk = [&](SChunk& chunk) -> void
+	{
+		for (uint64_t alive=allCandidates&~failed.load(); alive && !(chunk.verified&alive&-alive); alive=allCandidates&~failed.load())
+		{
+			const uint32_t i = core::findLSB(alive);
+			const uint64_t candidate = 0x1ull<<i;
+			bool passed = true;
+			for (uint32_t idx=chunk.begin; passed && idx<chunk.end; idx++)
+			{
+				constexpr uint32_t SyncInterval = 256u;
+				if ((idx-chunk.begin)%SyncInterval==0u && (failed.load(std::memory_order_relaxed)&candidate))
+					passed = false;
+				else if (!compareFloatingPointAttribute(_srcData[idx], quantFuncs[i](_srcData[idx], _srcType.type, _dstTypes[i].type, cache), cpa, _errMetric))
+				{
+					failed.fetch_or(candidate);
+					passed = false;
+				}
+			}
+			if (passed)
+				chunk.verified |= candidate;
+		}
+	};
+	// a chunk could have finished before another one failed the candidate it verified, so repeat until they all agree
+	for (uint64_t alive=allCandidates&~failed.load(); alive; alive=allCandidates&~failed.load())
+	{
+		const uint64_t best = alive&-alive;
+		if (std::all_of(chunks.begin(),chunks.end(),[best](const SChunk& chunk) -> bool {return chunk.verified&best;}))
+			return core::findLSB(best);
+		core::for_each(core::execution::par,chunks.begin(),chunks.end(),verifyChunk);
 	}
-
-	return true;
+	return _dstTypes.size();
 }
 
 core::smart_refctd_ptr<ICPUBuffer> IMeshManipulator::idxBufferFromLineStripsToLines(const void* _input, uint32_t& _idxCount, E_INDEX_TYPE _inIndexType, E_INDEX_TYPE _outIndexType)
@@ -65,7 +65,23 @@ class CMeshManipulator : public IMeshManipulator
 			return out;
 		}
 
-		static core::vector<core::vectorSIMDf> findBetterFormatF(E_FORMAT* _outType, size_t* _outSize, E_FORMAT* _outPrevType, const ICPUMeshBuffer* _meshbuffer, uint32_t _attrId, const SErrorMetric& _errMetric, CQuantNormalCache& _cache);
+		//! Splits `_count` vertices into ranges worth a task each, `Chunk` needs `begin` and `end` members
+		template<class Chunk>
+		static inline core::vector<Chunk> createVertexChunks(const uint32_t _count)
+		{
+			constexpr uint32_t MinChunkSize = 0x1u<<12u;
+			constexpr uint32_t MaxChunkCount = 0x1u<<10u;
+			const uint32_t chunkCount = std::clamp(_count/MinChunkSize,1u,MaxChunkCount);
+			core::vector<Chunk> chunks(chunkCount);
+			for (uint32_t i=0u; i<chunkCount; i++)
+			{
+				chunks[i].begin = uint64_t(_count)*i/chunkCount;
+				chunks[i].end = uint64_t(_count)*(i+1u)/chunkCount;
+			}
+			return chunks;
+		}
+
+		static core::vector<core::vectorSIMDf> findBetterFormatF(E_FORMAT* _outType, size_t* _outSize, E_FORMAT* _outPrevType, const ICPUMeshBuffer* _meshbuffer, uint32_t _attrId, const SErrorMetric& _errMetric);
 
 		struct SIntegerAttr
 		{
@@ -77,9 +93,9 @@ class CMeshManipulator : public IMeshManipulator
 		static E_FORMAT getBestTypeI(E_FORMAT _originalType, size_t* _outSize, const uint32_t* _min, const uint32_t* _max);
 		static core::vector<SAttribTypeChoice> findTypesOfProperRangeF(E_FORMAT _type, size_t _sizeThreshold, const float* _min, const float* _max, const SErrorMetric& _errMetric);
 
-		//! Calculates quantization errors and compares them with given epsilon.
-		/** @returns false when first of calculated errors goes above epsilon or true if reached end without such. */
-		static bool calcMaxQuantizationError(const SAttribTypeChoice& _srcType, const SAttribTypeChoice& _dstType, const core::vector<core::vectorSIMDf>& _data, const SErrorMetric& _errMetric, CQuantNormalCache& _cache);
+		//! Calculates quantization errors of the candidate types (ordered by preference) in parallel and compares them with given epsilon.
+		/** @returns index of the first of `_dstTypes` whose errors never go above epsilon, or `_dstTypes.size()` if there's no such type. */
+		static uint32_t calcMaxQuantizationError(const SAttribTypeChoice& _srcType, const core::vector<SAttribTypeChoice>& _dstTypes, const core::vector<core::vectorSIMDf>& _data, const SErrorMetric& _errMetric);
 
 		template<typename InType, typename OutType>
 		static inline core::smart_refctd_ptr<ICPUBuffer> lineStripsToLines(const void* _input, uint32_t& _idxCount)
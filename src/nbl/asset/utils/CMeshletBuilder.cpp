@@ -0,0 +1,301 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/core/declarations.h"
+#include "nbl/core/execution.h"
+#include "nbl/core/math/morton.h"
+
+#include "nbl/asset/utils/CMeshletBuilder.h"
+
+#include <numeric>
+
+namespace nbl::asset
+{
+
+namespace
+{
+
+// positions are expected to have a 0 in the w component
+template<class PositionGetter>
+CMeshletBuilder::SCullData computeCullDataImpl(PositionGetter&& getPosition, const uint32_t triangleCount)
+{
+	CMeshletBuilder::SCullData retval;
+	retval.boundingSphere.set(0.f,0.f,0.f,0.f);
+	retval.coneApex.set(0.f,0.f,0.f,1.f);
+	retval.coneAxis.set(0.f,0.f,1.f,1.f);
+	if (triangleCount==0u)
+		return retval;
+
+	const uint32_t cornerCount = triangleCount*3u;
+	core::vectorSIMDf center;
+	// Ritter's bounding sphere, initial diameter from the most distant pair of axis extremes
+	{
+		uint32_t minCorner[3] = {0u,0u,0u};
+		uint32_t maxCorner[3] = {0u,0u,0u};
+		for (uint32_t i=1u; i<cornerCount; i++)
+		{
+			const auto p = getPosition(i);
+			for (uint32_t axis=0u; axis<3u; axis++)
+			{
+				if (p.pointer[axis]<getPosition(minCorner[axis]).pointer[axis])
+					minCorner[axis] = i;
+				if (p.pointer[axis]>getPosition(maxCorner[axis]).pointer[axis])
+					maxCorner[axis] = i;
+			}
+		}
+		float maxDistanceSq = -1.f;
+		for (uint32_t axis=0u; axis<3u; axis++)
+		{
+			const auto a = getPosition(minCorner[axis]);
+			const auto b = getPosition(maxCorner[axis]);
+			const float distanceSq = core::dot(b-a,b-a).x;
+			if (distanceSq>maxDistanceSq)
+			{
+				maxDistanceSq = distanceSq;
+				center = (a+b)*0.5f;
+			}
+		}
+		float radius = sqrtf(maxDistanceSq)*0.5f;
+		for (uint32_t i=0u; i<cornerCount; i++)
+		{
+			const core::vectorSIMDf offset = getPosition(i)-center;
+			const float distanceSq = core::dot(offset,offset).x;
+			if (distanceSq>radius*radius)
+			{
+				const float distance = sqrtf(distanceSq);
+				const float newRadius = (radius+distance)*0.5f;
+				center += offset*((newRadius-radius)/distance);
+				radius = newRadius;
+			}
+		}
+		retval.boundingSphere = center;
+		retval.boundingSphere.w = radius;
+	}
+
+	// normal cone
+	core::vector<core::vectorSIMDf> normals;
+	normals.reserve(triangleCount);
+	core::vectorSIMDf axis(0.f);
+	for (uint32_t i=0u; i<cornerCount; i+=3u)
+	{
+		const auto p0 = getPosition(i);
+		core::vectorSIMDf normal = core::cross(getPosition(i+1u)-p0,getPosition(i+2u)-p0);
+		const float area = core::length(normal).x;
+		if (area==0.f)
+			continue;
+		normal /= area;
+		normal.w = 0.f;
+		normals.push_back(normal);
+		axis += normal;
+	}
+	const float axisLength = core::length(axis).x;
+	if (normals.empty() || axisLength==0.f)
+		return retval;
+	axis /= axisLength;
+
+	float minDot = 1.f;
+	for (const auto& normal : normals)
+		minDot = std::min(core::dot(axis,normal).x,minDot);
+	retval.coneAxis = axis;
+	// too wide, would need a near-hemisphere, just never cull
+	if (minDot<=0.1f)
+	{
+		retval.coneApex = center;
+		retval.coneApex.w = 1.f;
+		retval.coneAxis.w = 1.f;
+		return retval;
+	}
+
+	// move the apex back along the axis far enough to be behind every triangle's plane
+	float maxT = 0.f;
+	uint32_t normalIx = 0u;
+	for (uint32_t i=0u; i<cornerCount; i+=3u)
+	{
+		const auto p0 = getPosition(i);
+		if (core::length(core::cross(getPosition(i+1u)-p0,getPosition(i+2u)-p0)).x==0.f)
+			continue;
+		const auto& normal = normals[normalIx++];
+		const float t = core::dot(center-p0,normal).x/core::dot(axis,normal).x;
+		maxT = std::max(t,maxT);
+	}
+	retval.coneApex = center-axis*maxT;
+	retval.coneApex.w = 1.f;
+	retval.coneAxis.w = sqrtf(1.f-minDot*minDot);
+	return retval;
+}
+
+}
+
+CMeshletBuilder::SMeshlets CMeshletBuilder::build(const ICPUMeshBuffer* _meshbuffer, const uint32_t* _indices, const uint32_t _triangleCount, const SParams& _params)
+{
+	assert(_params.maxVertices>=3u && _params.maxVertices<=MAX_VERTICES_LIMIT);
+	assert(_params.maxTriangles>0u);
+
+	SMeshlets retval;
+	if (_triangleCount==0u)
+		return retval;
+
+	const uint32_t indexCount = _triangleCount*3u;
+	const uint32_t vertexCount = *std::max_element(_indices,_indices+indexCount)+1u;
+
+	core::vector<core::vectorSIMDf> positions(vertexCount);
+	core::for_each(core::execution::par,positions.begin(),positions.end(),[&](core::vectorSIMDf& pos) -> void
+	{
+		pos = _meshbuffer->getPosition(&pos-positions.data());
+		pos.w = 0.f;
+	});
+
+	// STEP: vertex to triangle adjacency
+	core::vector<uint32_t> adjacencyOffsets(vertexCount+1u,0u);
+	for (uint32_t i=0u; i<indexCount; i++)
+		adjacencyOffsets[_indices[i]+1u]++;
+	std::inclusive_scan(adjacencyOffsets.begin(),adjacencyOffsets.end(),adjacencyOffsets.begin());
+	core::vector<uint32_t> adjacency(indexCount);
+	{
+		core::vector<uint32_t> cursor(adjacencyOffsets.begin(),adjacencyOffsets.end()-1u);
+		for (uint32_t i=0u; i<indexCount; i++)
+			adjacency[cursor[_indices[i]]++] = i/3u;
+	}
+	// triangles not yet put in a meshlet, per vertex
+	core::vector<uint32_t> liveTriangles(vertexCount);
+	for (uint32_t i=0u; i<vertexCount; i++)
+		liveTriangles[i] = adjacencyOffsets[i+1u]-adjacencyOffsets[i];
+
+	// STEP: order seeds spatially, so that a meshlet which runs out of neighbours continues nearby
+	core::vector<uint32_t> seedOrder(_triangleCount);
+	{
+		core::vector<core::vectorSIMDf> centroids(_triangleCount);
+		core::vectorSIMDf minEdge(FLT_MAX), maxEdge(-FLT_MAX);
+		for (uint32_t i=0u; i<_triangleCount; i++)
+		{
+			const uint32_t* tri = _indices+i*3u;
+			centroids[i] = (positions[tri[0]]+positions[tri[1]]+positions[tri[2]])/3.f;
+			minEdge = core::min(minEdge,centroids[i]);
+			maxEdge = core::max(maxEdge,centroids[i]);
+		}
+		core::vectorSIMDf scale = core::vectorSIMDf(65535.f)/(maxEdge-minEdge);
+		for (uint32_t axis=0u; axis<3u; axis++)
+		if (!std::isfinite(scale.pointer[axis]))
+			scale.pointer[axis] = 0.f;
+
+		core::vector<uint64_t> keys(_triangleCount);
+		core::for_each(core::execution::par,keys.begin(),keys.end(),[&](uint64_t& key) -> void
+		{
+			const core::vectorSIMDf fixedPoint = (centroids[&key-keys.data()]-minEdge)*scale;
+			key = core::morton3d_encode<uint64_t,16u>(uint64_t(fixedPoint.x),uint64_t(fixedPoint.y),uint64_t(fixedPoint.z));
+		});
+		std::iota(seedOrder.begin(),seedOrder.end(),0u);
+		std::stable_sort(seedOrder.begin(),seedOrder.end(),[&keys](const uint32_t a, const uint32_t b) -> bool {return keys[a]<keys[b];});
+	}
+
+	// STEP: greedy clustering
+	constexpr uint8_t InvalidLocalIx = 0xffu;
+	core::vector<uint8_t> localIx(vertexCount,InvalidLocalIx);
+	core::vector<uint8_t> emitted(_triangleCount,0u);
+	retval.vertices.reserve(indexCount/2u);
+	retval.localIndices.reserve(indexCount);
+
+	SMeshlet current = {0u,0u,0u,0u};
+	auto countNewVertices = [&](const uint32_t triangle) -> uint32_t
+	{
+		const uint32_t* tri = _indices+triangle*3u;
+		uint32_t retval = localIx[tri[0]]==InvalidLocalIx ? 1u:0u;
+		if (localIx[tri[1]]==InvalidLocalIx && tri[1]!=tri[0])
+			retval++;
+		if (localIx[tri[2]]==InvalidLocalIx && tri[2]!=tri[0] && tri[2]!=tri[1])
+			retval++;
+		return retval;
+	};
+	auto flush = [&]() -> void
+	{
+		if (current.triangleCount==0u)
+			return;
+		for (uint32_t i=0u; i<current.vertexCount; i++)
+			localIx[retval.vertices[current.vertexOffset+i]] = InvalidLocalIx;
+		retval.meshlets.push_back(current);
+		current = {static_cast<uint32_t>(retval.vertices.size()),static_cast<uint32_t>(retval.localIndices.size()/3u),0u,0u};
+	};
+	auto append = [&](const uint32_t triangle) -> void
+	{
+		emitted[triangle] = 1u;
+		for (uint32_t i=0u; i<3u; i++)
+		{
+			const uint32_t vertex = _indices[triangle*3u+i];
+			if (localIx[vertex]==InvalidLocalIx)
+			{
+				localIx[vertex] = current.vertexCount++;
+				retval.vertices.push_back(vertex);
+			}
+			retval.localIndices.push_back(localIx[vertex]);
+			liveTriangles[vertex]--;
+		}
+		current.triangleCount++;
+	};
+
+	uint32_t seedCursor = 0u;
+	for (uint32_t emittedCount=0u; emittedCount<_triangleCount; emittedCount++)
+	{
+		uint32_t best = ~0u;
+		uint32_t bestNewVertices = ~0u;
+		uint32_t bestLiveTriangles = ~0u;
+		for (uint32_t i=0u; i<current.vertexCount && bestNewVertices; i++)
+		{
+			const uint32_t vertex = retval.vertices[current.vertexOffset+i];
+			if (liveTriangles[vertex]==0u)
+				continue;
+			for (uint32_t j=adjacencyOffsets[vertex]; j<adjacencyOffsets[vertex+1u]; j++)
+			{
+				const uint32_t triangle = adjacency[j];
+				if (emitted[triangle])
+					continue;
+				const uint32_t newVertices = countNewVertices(triangle);
+				const uint32_t* tri = _indices+triangle*3u;
+				// prefer triangles that would otherwise end up stranded
+				const uint32_t live = liveTriangles[tri[0]]+liveTriangles[tri[1]]+liveTriangles[tri[2]];
+				if (newVertices<bestNewVertices || (newVertices==bestNewVertices && live<bestLiveTriangles))
+				{
+					best = triangle;
+					bestNewVertices = newVertices;
+					bestLiveTriangles = live;
+				}
+			}
+		}
+		if (best==~0u)
+		{
+			while (emitted[seedOrder[seedCursor]])
+				seedCursor++;
+			best = seedOrder[seedCursor];
+			bestNewVertices = countNewVertices(best);
+		}
+
+		if (current.vertexCount+bestNewVertices>_params.maxVertices || current.triangleCount>=_params.maxTriangles)
+			flush();
+		append(best);
+	}
+	flush();
+
+	// STEP: cluster culling bounds
+	retval.cullData.resize(retval.meshlets.size());
+	core::for_each(core::execution::par,retval.meshlets.begin(),retval.meshlets.end(),[&](const SMeshlet& meshlet) -> void
+	{
+		const uint32_t* vertices = retval.vertices.data()+meshlet.vertexOffset;
+		const uint8_t* localIndices = retval.localIndices.data()+meshlet.triangleOffset*3u;
+		retval.cullData[&meshlet-retval.meshlets.data()] = computeCullDataImpl([&](const uint32_t corner) -> const core::vectorSIMDf& {return positions[vertices[localIndices[corner]]];},meshlet.triangleCount);
+	});
+
+	return retval;
+}
+
+CMeshletBuilder::SCullData CMeshletBuilder::computeCullData(const ICPUMeshBuffer* _meshbuffer, const uint32_t* _indices, const uint32_t _triangleCount)
+{
+	core::vector<core::vectorSIMDf> positions(_triangleCount*3u);
+	for (uint32_t i=0u; i<positions.size(); i++)
+	{
+		positions[i] = _meshbuffer->getPosition(_indices[i]);
+		positions[i].w = 0.f;
+	}
+	return computeCullDataImpl([&positions](const uint32_t corner) -> const core::vectorSIMDf& {return positions[corner];},_triangleCount);
+}
+
+}
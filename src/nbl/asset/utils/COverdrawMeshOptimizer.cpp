@@ -45,9 +45,9 @@ void COverdrawMeshOptimizer::createOptimized(asset::ICPUMeshBuffer* _outbuffer,
 	{
 		const size_t dataSize = indexSize*idxCount;
 		indexCopy = _NBL_ALIGNED_MALLOC(dataSize,indexSize);
-		memcpy(outIndices,inIndices,dataSize);
-		inIndices16 = reinterpret_cast<const uint16_t*>(dataSize);
-		inIndices32 = reinterpret_cast<const uint32_t*>(dataSize);
+		memcpy(indexCopy,inIndices,dataSize);
+		inIndices16 = reinterpret_cast<const uint16_t*>(indexCopy);
+		inIndices32 = reinterpret_cast<const uint32_t*>(indexCopy);
 	}
 	uint16_t* outIndices16 = reinterpret_cast<uint16_t*>(outIndices);
 	uint32_t* outIndices32 = reinterpret_cast<uint32_t*>(outIndices);
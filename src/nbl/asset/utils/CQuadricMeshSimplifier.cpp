@@ -0,0 +1,428 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/core/declarations.h"
+#include "nbl/core/execution.h"
+
+#include "CQuadricMeshSimplifier.h"
+
+#include <numeric>
+
+namespace nbl::asset
+{
+
+core::vector<uint32_t> CQuadricMeshSimplifier::simplify(const ICPUMeshBuffer* _meshbuffer, core::vector<uint32_t>&& _indices, const uint32_t _vertexCount, const uint32_t _targetTriangleCount,
+	const IMeshManipulator::SSimplificationParams& _params, float& _outError)
+{
+	_outError = 0.f;
+	core::vector<uint32_t> indices = std::move(_indices);
+	if (indices.size()/3u<=_targetTriangleCount || _vertexCount==0u)
+		return indices;
+
+	const uint32_t posAttr = _meshbuffer->getPositionAttributeIx();
+	core::vector<core::vectorSIMDf> positions(_vertexCount);
+	core::for_each(core::execution::par,positions.begin(),positions.end(),[&](core::vectorSIMDf& pos) -> void
+	{
+		pos.set(0.f,0.f,0.f,1.f);
+		_meshbuffer->getAttribute(pos,posAttr,&pos-positions.data());
+	});
+
+	// STEP: weld vertices with equal positions and attributes, find the attribute seams
+	const auto& vertexInput = _meshbuffer->getPipeline()->getVertexInputParams();
+	auto sameAttributes = [&](const uint32_t u, const uint32_t v) -> bool
+	{
+		for (uint32_t i=0u; i<ICPUMeshBuffer::MAX_VERTEX_ATTRIB_COUNT; i++)
+		{
+			if (i==posAttr || !_meshbuffer->isAttributeEnabled(i))
+				continue;
+			if (vertexInput.bindings[vertexInput.attributes[i].binding].inputRate!=EVIR_PER_VERTEX)
+				continue;
+			const uint8_t* base = _meshbuffer->getAttribPointer(i);
+			if (!base)
+				continue;
+
+			const auto format = _meshbuffer->getAttribFormat(i);
+			const auto stride = _meshbuffer->getAttribStride(i);
+			if (_params.errMetrics && !isIntegerFormat(format) && !isScaledFormat(format))
+			{
+				core::vectorSIMDf a, b;
+				ICPUMeshBuffer::getAttribute(a,base+u*stride,format);
+				ICPUMeshBuffer::getAttribute(b,base+v*stride,format);
+				if (!IMeshManipulator::compareFloatingPointAttribute(a,b,getFormatChannelCount(format),_params.errMetrics[i]))
+					return false;
+			}
+			else if (memcmp(base+u*stride,base+v*stride,getTexelOrBlockBytesize(format))!=0)
+				return false;
+		}
+		return true;
+	};
+
+	core::vector<uint32_t> byPosition;
+	{
+		core::vector<uint8_t> referenced(_vertexCount,0u);
+		for (const auto ix : indices)
+			referenced[ix] = 1u;
+		for (uint32_t i=0u; i<_vertexCount; i++)
+		if (referenced[i])
+			byPosition.push_back(i);
+	}
+	auto samePosition = [&positions](const uint32_t u, const uint32_t v) -> bool
+	{
+		return positions[u].x==positions[v].x && positions[u].y==positions[v].y && positions[u].z==positions[v].z;
+	};
+	std::sort(byPosition.begin(),byPosition.end(),[&positions](const uint32_t u, const uint32_t v) -> bool
+	{
+		const auto& a = positions[u];
+		const auto& b = positions[v];
+		if (a.x!=b.x)
+			return a.x<b.x;
+		if (a.y!=b.y)
+			return a.y<b.y;
+		if (a.z!=b.z)
+			return a.z<b.z;
+		return u<v;
+	});
+
+	// the weld target of every vertex, and the first vertex with the same position which stands in for the position
+	core::vector<uint32_t> remap(_vertexCount);
+	std::iota(remap.begin(),remap.end(),0u);
+	core::vector<uint32_t> positionClass(remap);
+	// the range of `byPosition` with all the vertices of a position, indexed by the position's class
+	core::vector<std::pair<uint32_t,uint32_t>> classVertices(_vertexCount);
+	core::vector<uint8_t> kind(_vertexCount,EVK_MANIFOLD);
+	for (size_t runBegin=0u; runBegin<byPosition.size();)
+	{
+		size_t runEnd = runBegin+1u;
+		while (runEnd<byPosition.size() && samePosition(byPosition[runEnd],byPosition[runBegin]))
+			runEnd++;
+
+		const uint32_t cls = byPosition[runBegin];
+		classVertices[cls] = {runBegin,runEnd};
+		uint32_t wedgeCount = 0u;
+		for (size_t i=runBegin; i<runEnd; i++)
+		{
+			const uint32_t v = byPosition[i];
+			positionClass[v] = cls;
+			for (size_t j=runBegin; j<i; j++)
+			{
+				const uint32_t u = byPosition[j];
+				if (remap[u]==u && sameAttributes(u,v))
+				{
+					remap[v] = u;
+					break;
+				}
+			}
+			if (remap[v]==v)
+				wedgeCount++;
+		}
+		if (wedgeCount>1u)
+			kind[cls] = EVK_LOCKED;
+		runBegin = runEnd;
+	}
+
+	// remap and drop the triangles which are degenerate already
+	auto isDegenerate = [&positionClass](const uint32_t* tri) -> bool
+	{
+		return positionClass[tri[0]]==positionClass[tri[1]] || positionClass[tri[1]]==positionClass[tri[2]] || positionClass[tri[2]]==positionClass[tri[0]];
+	};
+	{
+		size_t outIx = 0u;
+		for (size_t i=0u; i<indices.size(); i+=3u)
+		{
+			uint32_t tri[3] = {remap[indices[i]],remap[indices[i+1u]],remap[indices[i+2u]]};
+			if (isDegenerate(tri))
+				continue;
+			std::copy_n(tri,3u,indices.data()+outIx);
+			outIx += 3u;
+		}
+		indices.resize(outIx);
+	}
+
+	// STEP: classify the positions by the edges between them, an edge used by a single triangle is a border, by more than two it's non-manifold
+	// gets redone after every pass of collapses, since collapsing along a border turns the neighbouring border edges into new ones
+	core::vector<uint64_t> edges;
+	core::vector<uint64_t> borderEdges;
+	core::vector<uint8_t> borderEdgeCount(_vertexCount);
+	auto classifyEdges = [&]() -> void
+	{
+		edges.clear();
+		for (size_t i=0u; i<indices.size(); i+=3u)
+		for (uint32_t k=0u; k<3u; k++)
+			edges.push_back(edgeKey(positionClass[indices[i+k]],positionClass[indices[i+(k+1u)%3u]]));
+		std::sort(edges.begin(),edges.end());
+
+		borderEdges.clear();
+		std::fill(borderEdgeCount.begin(),borderEdgeCount.end(),0u);
+		auto lock = [&kind](const uint32_t cls) -> void {kind[cls] = EVK_LOCKED;};
+		for (size_t runBegin=0u; runBegin<edges.size();)
+		{
+			size_t runEnd = runBegin+1u;
+			while (runEnd<edges.size() && edges[runEnd]==edges[runBegin])
+				runEnd++;
+
+			const uint32_t a = edges[runBegin]>>32ull;
+			const uint32_t b = static_cast<uint32_t>(edges[runBegin]);
+			if (runEnd-runBegin==1u)
+			{
+				borderEdges.push_back(edges[runBegin]);
+				for (const auto cls : {a,b})
+				{
+					if (_params.lockBorders || (++borderEdgeCount[cls])>2u) // more than two border edges is a bowtie
+						lock(cls);
+					else if (kind[cls]==EVK_MANIFOLD)
+						kind[cls] = EVK_BORDER;
+				}
+			}
+			else if (runEnd-runBegin>2u)
+			{
+				lock(a);
+				lock(b);
+			}
+			runBegin = runEnd;
+		}
+	};
+	classifyEdges();
+	auto isBorderEdge = [&](const uint32_t u, const uint32_t v) -> bool
+	{
+		return std::binary_search(borderEdges.begin(),borderEdges.end(),edgeKey(positionClass[u],positionClass[v]));
+	};
+
+	// STEP: quadrics of the planes of the triangles around each position, weighted by area
+	auto faceNormal = [&positions](const uint32_t* tri) -> core::vectorSIMDf
+	{
+		return core::cross(positions[tri[1]]-positions[tri[0]],positions[tri[2]]-positions[tri[0]]);
+	};
+	core::vector<SQuadric> quadrics(_vertexCount);
+	{
+		core::vector<SQuadric> triangleQuadrics(indices.size()/3u);
+		core::for_each(core::execution::par,triangleQuadrics.begin(),triangleQuadrics.end(),[&](SQuadric& quadric) -> void
+		{
+			const uint32_t* tri = indices.data()+(&quadric-triangleQuadrics.data())*3u;
+			const auto normal = faceNormal(tri);
+			const double doubleArea = core::length(normal)[0];
+			quadric = {};
+			if (doubleArea<=0.0)
+				return;
+			const double n[3] = {normal.x/doubleArea,normal.y/doubleArea,normal.z/doubleArea};
+			const auto& p0 = positions[tri[0]];
+			quadric = SQuadric::fromPlane(n,-(n[0]*p0.x+n[1]*p0.y+n[2]*p0.z),doubleArea*0.5);
+		});
+		for (size_t t=0u; t<triangleQuadrics.size(); t++)
+		for (uint32_t k=0u; k<3u; k++)
+			quadrics[positionClass[indices[t*3u+k]]] += triangleQuadrics[t];
+
+		// keep the borders in place with planes perpendicular to the triangles through the border edges
+		if (!_params.lockBorders)
+		for (size_t t=0u; t<triangleQuadrics.size(); t++)
+		{
+			const uint32_t* tri = indices.data()+t*3u;
+			const auto normal = core::normalize(faceNormal(tri));
+			for (uint32_t k=0u; k<3u; k++)
+			{
+				const uint32_t u = tri[k];
+				const uint32_t v = tri[(k+1u)%3u];
+				if (!isBorderEdge(u,v))
+					continue;
+				const auto edge = positions[v]-positions[u];
+				const double lengthSq = core::dot(edge,edge)[0];
+				const auto perpendicular = core::normalize(core::cross(edge,normal));
+				const double n[3] = {perpendicular.x,perpendicular.y,perpendicular.z};
+				const auto& p = positions[u];
+				constexpr double BorderWeight = 10.0;
+				const auto quadric = SQuadric::fromPlane(n,-(n[0]*p.x+n[1]*p.y+n[2]*p.z),lengthSq*BorderWeight);
+				quadrics[positionClass[u]] += quadric;
+				quadrics[positionClass[v]] += quadric;
+			}
+		}
+	}
+
+	auto canCollapse = [&](const uint32_t from, const uint32_t to) -> bool
+	{
+		switch (kind[positionClass[from]])
+		{
+			case EVK_MANIFOLD:
+				return true;
+			case EVK_BORDER:
+				return kind[positionClass[to]]!=EVK_MANIFOLD && isBorderEdge(from,to);
+			default:
+				break;
+		}
+		return false;
+	};
+
+	// STEP: collapse edges in passes, every pass collapses a set of the cheapest edges which don't share any triangles
+	const double maxCost = double(_params.maxError)*double(_params.maxError);
+	double resultCost = 0.0;
+	core::vector<uint32_t> adjacencyOffsets(_vertexCount+1u);
+	core::vector<uint32_t> adjacency;
+	core::vector<uint32_t> collapseTo(_vertexCount);
+	core::vector<uint8_t> touched(_vertexCount);
+	core::vector<uint64_t> candidateEdges;
+	core::vector<SCollapse> collapses;
+	core::vector<uint32_t> fromLinkVertices, toLinkVertices, edgeOpposites;
+	core::vector<uint64_t> fromLinkEdges, toLinkEdges;
+	while (indices.size()/3u>_targetTriangleCount)
+	{
+		// vertex to triangle adjacency
+		std::fill(adjacencyOffsets.begin(),adjacencyOffsets.end(),0u);
+		for (const auto ix : indices)
+			adjacencyOffsets[ix+1u]++;
+		std::inclusive_scan(adjacencyOffsets.begin(),adjacencyOffsets.end(),adjacencyOffsets.begin());
+		adjacency.resize(indices.size());
+		{
+			core::vector<uint32_t> cursor(adjacencyOffsets.begin(),adjacencyOffsets.end()-1u);
+			for (size_t i=0u; i<indices.size(); i++)
+				adjacency[cursor[indices[i]]++] = i/3u;
+		}
+
+		candidateEdges.clear();
+		for (size_t i=0u; i<indices.size(); i+=3u)
+		for (uint32_t k=0u; k<3u; k++)
+			candidateEdges.push_back(edgeKey(indices[i+k],indices[i+(k+1u)%3u]));
+		std::sort(candidateEdges.begin(),candidateEdges.end());
+		candidateEdges.erase(std::unique(candidateEdges.begin(),candidateEdges.end()),candidateEdges.end());
+
+		collapses.resize(candidateEdges.size());
+		core::for_each(core::execution::par,collapses.begin(),collapses.end(),[&](SCollapse& collapse) -> void
+		{
+			const uint64_t edge = candidateEdges[&collapse-collapses.data()];
+			collapse = {INFINITY,~0u,~0u};
+			auto consider = [&](const uint32_t from, const uint32_t to) -> void
+			{
+				if (!canCollapse(from,to))
+					return;
+				const float cost = quadrics[positionClass[from]].error(positions[to]);
+				if (cost<collapse.cost)
+					collapse = {cost,from,to};
+			};
+			consider(edge>>32ull,static_cast<uint32_t>(edge));
+			consider(static_cast<uint32_t>(edge),edge>>32ull);
+		});
+		std::sort(collapses.begin(),collapses.end());
+
+		std::iota(collapseTo.begin(),collapseTo.end(),0u);
+		std::fill(touched.begin(),touched.end(),0u);
+		const uint32_t trianglesToRemove = indices.size()/3u-_targetTriangleCount;
+		uint32_t removed = 0u;
+		uint32_t collapsedCount = 0u;
+		for (const auto& collapse : collapses)
+		{
+			if (removed>=trianglesToRemove || !(collapse.cost<=maxCost))
+				break;
+			const uint32_t fromClass = positionClass[collapse.from];
+			const uint32_t toClass = positionClass[collapse.to];
+			if (touched[fromClass] || touched[toClass])
+				continue;
+
+			// reject collapses which flip any of the triangles that stay
+			const auto* adjacentBegin = adjacency.data()+adjacencyOffsets[collapse.from];
+			const auto* adjacentEnd = adjacency.data()+adjacencyOffsets[collapse.from+1u];
+			uint32_t goingAway = 0u;
+			bool flips = false;
+			for (auto it=adjacentBegin; !flips && it!=adjacentEnd; it++)
+			{
+				const uint32_t* tri = indices.data()+(*it)*3u;
+				if (positionClass[tri[0]]==toClass || positionClass[tri[1]]==toClass || positionClass[tri[2]]==toClass)
+				{
+					goingAway++;
+					continue;
+				}
+				uint32_t moved[3];
+				for (uint32_t k=0u; k<3u; k++)
+					moved[k] = tri[k]==collapse.from ? collapse.to:tri[k];
+				flips = core::dot(faceNormal(tri),faceNormal(moved))[0]<0.f;
+			}
+			if (flips)
+				continue;
+
+			// link condition, the only neighbours (and edges opposite to them) the two ends may share are the ones of the triangles
+			// on the collapsed edge, otherwise the collapse would pinch the surface or fold it onto itself (e.g. a tetrahedron into two triangles)
+			// the links are of positions, across a seam the triangles around a position reference different vertices
+			edgeOpposites.clear();
+			auto gatherLink = [&](const uint32_t centerClass, const uint32_t otherClass, core::vector<uint32_t>& outVertices, core::vector<uint64_t>& outEdges) -> void
+			{
+				outVertices.clear();
+				outEdges.clear();
+				const auto& run = classVertices[centerClass];
+				for (auto i=run.first; i<run.second; i++)
+				{
+					const uint32_t center = byPosition[i];
+					for (auto it=adjacency.data()+adjacencyOffsets[center]; it!=adjacency.data()+adjacencyOffsets[center+1u]; it++)
+					{
+						const uint32_t* tri = indices.data()+(*it)*3u;
+						const uint32_t k = tri[0]==center ? 0u:(tri[1]==center ? 1u:2u);
+						const uint32_t u = positionClass[tri[(k+1u)%3u]];
+						const uint32_t v = positionClass[tri[(k+2u)%3u]];
+						if (u==otherClass || v==otherClass)
+						{
+							edgeOpposites.push_back(u==otherClass ? v:u);
+							continue;
+						}
+						outVertices.push_back(u);
+						outVertices.push_back(v);
+						outEdges.push_back(edgeKey(u,v));
+					}
+				}
+				std::sort(outVertices.begin(),outVertices.end());
+				outVertices.erase(std::unique(outVertices.begin(),outVertices.end()),outVertices.end());
+				std::sort(outEdges.begin(),outEdges.end());
+			};
+			gatherLink(fromClass,toClass,fromLinkVertices,fromLinkEdges);
+			gatherLink(toClass,fromClass,toLinkVertices,toLinkEdges);
+			// true if the sorted ranges share an element which is not the opposite vertex of a triangle on the edge
+			auto intersects = [&edgeOpposites](const auto& a, const auto& b) -> bool
+			{
+				for (auto ita=a.begin(), itb=b.begin(); ita!=a.end() && itb!=b.end();)
+				{
+					if (*ita<*itb)
+						ita++;
+					else if (*itb<*ita)
+						itb++;
+					else if constexpr (std::is_same_v<typename std::decay_t<decltype(a)>::value_type,uint32_t>)
+					{
+						if (std::find(edgeOpposites.begin(),edgeOpposites.end(),*ita)==edgeOpposites.end())
+							return true;
+						ita++;
+						itb++;
+					}
+					else
+						return true;
+				}
+				return false;
+			};
+			if (intersects(fromLinkVertices,toLinkVertices) || intersects(fromLinkEdges,toLinkEdges))
+				continue;
+
+			collapseTo[collapse.from] = collapse.to;
+			quadrics[toClass] += quadrics[fromClass];
+			// by position, so that no other collapse in this pass goes through a different vertex of the same position
+			touched[toClass] = 1u;
+			for (auto it=adjacentBegin; it!=adjacentEnd; it++)
+			for (uint32_t k=0u; k<3u; k++)
+				touched[positionClass[indices[(*it)*3u+k]]] = 1u;
+			removed += goingAway;
+			resultCost = std::max<double>(resultCost,collapse.cost);
+			collapsedCount++;
+		}
+		if (!collapsedCount)
+			break;
+
+		size_t outIx = 0u;
+		for (size_t i=0u; i<indices.size(); i+=3u)
+		{
+			uint32_t tri[3] = {collapseTo[indices[i]],collapseTo[indices[i+1u]],collapseTo[indices[i+2u]]};
+			if (isDegenerate(tri))
+				continue;
+			std::copy_n(tri,3u,indices.data()+outIx);
+			outIx += 3u;
+		}
+		indices.resize(outIx);
+		classifyEdges();
+	}
+
+	_outError = std::sqrt(resultCost);
+	return indices;
+}
+
+}
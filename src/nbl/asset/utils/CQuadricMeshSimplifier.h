@@ -0,0 +1,108 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef __NBL_ASSET_C_QUADRIC_MESH_SIMPLIFIER_H_INCLUDED__
+#define __NBL_ASSET_C_QUADRIC_MESH_SIMPLIFIER_H_INCLUDED__
+
+#include "nbl/asset/ICPUMeshBuffer.h"
+#include "nbl/asset/utils/IMeshManipulator.h"
+
+// Garland & Heckbert "Surface Simplification Using Quadric Error Metrics", with the vertex classification and
+// collapse-onto-existing-vertex scheme of zeux's meshoptimizer (https://github.com/zeux/meshoptimizer) available under MIT license
+
+namespace nbl
+{
+namespace asset
+{
+
+class CQuadricMeshSimplifier
+{
+		enum E_VERTEX_KIND : uint8_t
+		{
+			EVK_MANIFOLD,
+			// can only collapse along a border edge onto another border vertex
+			EVK_BORDER,
+			// seams, non-manifold and (optionally) border vertices
+			EVK_LOCKED
+		};
+
+		struct SQuadric
+		{
+			// symmetric 3x3 matrix, vector and constant of the plane distance squared, all premultiplied by the weight
+			double a00, a11, a22, a01, a02, a12;
+			double b0, b1, b2;
+			double c;
+			double weight;
+
+			static inline SQuadric fromPlane(const double* n, const double d, const double w)
+			{
+				return {
+					w*n[0]*n[0],w*n[1]*n[1],w*n[2]*n[2],w*n[0]*n[1],w*n[0]*n[2],w*n[1]*n[2],
+					w*n[0]*d,w*n[1]*d,w*n[2]*d,
+					w*d*d,
+					w
+				};
+			}
+
+			inline SQuadric& operator+=(const SQuadric& other)
+			{
+				a00 += other.a00; a11 += other.a11; a22 += other.a22; a01 += other.a01; a02 += other.a02; a12 += other.a12;
+				b0 += other.b0; b1 += other.b1; b2 += other.b2;
+				c += other.c;
+				weight += other.weight;
+				return *this;
+			}
+
+			//! weighted average of the squared distances to the planes
+			inline double error(const core::vectorSIMDf& p) const
+			{
+				if (weight<=0.0)
+					return 0.0;
+				const double x = p.x, y = p.y, z = p.z;
+				const double e = a00*x*x+a11*y*y+a22*z*z+2.0*(a01*x*y+a02*x*z+a12*y*z+b0*x+b1*y+b2*z)+c;
+				return std::max(e,0.0)/weight;
+			}
+		};
+
+		struct SCollapse
+		{
+			float cost;
+			uint32_t from;
+			uint32_t to;
+
+			inline bool operator<(const SCollapse& other) const
+			{
+				return cost<other.cost;
+			}
+		};
+
+		// private, undefined constructor
+		CQuadricMeshSimplifier() = delete;
+
+	public:
+		//! Simplifies a triangle list referencing vertices of `_meshbuffer`, returns the new triangle list
+		/**
+		@param _meshbuffer Source of the positions and of the attributes used to detect seams.
+		@param _indices Triangle list, gets consumed.
+		@param _vertexCount Upper bound of the vertex IDs in `_indices`.
+		@param _targetTriangleCount Stop once the triangle count drops to this or below.
+		@param _params Rest of the limits, `targetTriangleRatio` is ignored.
+		@param _outError Object space error of the result.
+		*/
+		static core::vector<uint32_t> simplify(const ICPUMeshBuffer* _meshbuffer, core::vector<uint32_t>&& _indices, const uint32_t _vertexCount, const uint32_t _targetTriangleCount,
+			const IMeshManipulator::SSimplificationParams& _params, float& _outError);
+
+	private:
+		static inline uint64_t edgeKey(uint32_t a, uint32_t b)
+		{
+			if (a>b)
+				std::swap(a,b);
+			return (uint64_t(a)<<32ull)|b;
+		}
+};
+
+}
+}
+
+#endif
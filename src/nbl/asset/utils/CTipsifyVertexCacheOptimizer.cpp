@@ -0,0 +1,120 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/core/declarations.h"
+
+#include "nbl/asset/utils/CTipsifyVertexCacheOptimizer.h"
+
+namespace nbl::asset
+{
+
+template<typename IdxT>
+void CTipsifyVertexCacheOptimizer::optimizeTriangleOrdering(const size_t _numVerts, const size_t _numIndices, const IdxT* _indices, IdxT* _outIndices, const uint32_t _cacheSize)
+{
+	const uint32_t triangleCount = _numIndices/3u;
+	if (_numVerts==0u || triangleCount==0u)
+	{
+		if (_indices!=_outIndices)
+			memmove(_outIndices,_indices,_numIndices*sizeof(IdxT));
+		return;
+	}
+
+	// vertex to triangle adjacency, `liveTriangles` counts the triangles not emitted yet
+	core::vector<uint32_t> liveTriangles(_numVerts,0u);
+	for (size_t i=0u; i<triangleCount*3u; i++)
+	{
+		assert(_indices[i]<_numVerts);
+		liveTriangles[_indices[i]]++;
+	}
+	core::vector<uint32_t> adjacencyOffsets(_numVerts+1u);
+	adjacencyOffsets[0] = 0u;
+	for (size_t v=0u; v<_numVerts; v++)
+		adjacencyOffsets[v+1u] = adjacencyOffsets[v]+liveTriangles[v];
+	core::vector<uint32_t> adjacency(adjacencyOffsets.back());
+	{
+		core::vector<uint32_t> fill(adjacencyOffsets.begin(),adjacencyOffsets.end()-1u);
+		for (uint32_t t=0u; t<triangleCount; t++)
+		for (uint32_t c=0u; c<3u; c++)
+			adjacency[fill[_indices[t*3u+c]]++] = t;
+	}
+
+	// a vertex is in the cache if it was last used less than `_cacheSize` misses ago
+	core::vector<uint32_t> cacheTimestamps(_numVerts,0u);
+	uint32_t timestamp = _cacheSize+1u;
+	core::vector<bool> emitted(triangleCount,false);
+	core::vector<uint32_t> deadEnd;
+	deadEnd.reserve(triangleCount*3u);
+	core::vector<uint32_t> candidates;
+	uint32_t inputCursor = 0u;
+
+	auto skipDeadEnd = [&]() -> uint32_t
+	{
+		while (!deadEnd.empty())
+		{
+			const uint32_t vertex = deadEnd.back();
+			deadEnd.pop_back();
+			if (liveTriangles[vertex])
+				return vertex;
+		}
+		for (; inputCursor<_numVerts; inputCursor++)
+		if (liveTriangles[inputCursor])
+			return inputCursor;
+		return ~0u;
+	};
+
+	core::vector<IdxT> output(triangleCount*3u);
+	size_t outputSize = 0u;
+	for (uint32_t fanningVertex=skipDeadEnd(); fanningVertex!=~0u;)
+	{
+		candidates.clear();
+		for (uint32_t i=adjacencyOffsets[fanningVertex]; i<adjacencyOffsets[fanningVertex+1u]; i++)
+		{
+			const uint32_t triangle = adjacency[i];
+			if (emitted[triangle])
+				continue;
+			emitted[triangle] = true;
+			for (uint32_t c=0u; c<3u; c++)
+			{
+				const uint32_t vertex = _indices[triangle*3u+c];
+				output[outputSize++] = vertex;
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+				if (timestamp-cacheTimestamps[vertex]>_cacheSize)
+					cacheTimestamps[vertex] = timestamp++;
+			}
+		}
+
+		// prefer the candidate that will still be in the cache after all its remaining triangles get fanned, and was added to it the earliest
+		uint32_t bestVertex = ~0u;
+		int32_t bestPriority = -1;
+		for (const uint32_t vertex : candidates)
+		{
+			if (!liveTriangles[vertex])
+				continue;
+			int32_t priority = 0;
+			const uint32_t age = timestamp-cacheTimestamps[vertex];
+			if (age+2u*liveTriangles[vertex]<=_cacheSize)
+				priority = age;
+			if (priority>bestPriority)
+			{
+				bestPriority = priority;
+				bestVertex = vertex;
+			}
+		}
+		fanningVertex = bestVertex!=~0u ? bestVertex:skipDeadEnd();
+	}
+	assert(outputSize==triangleCount*3u);
+
+	memcpy(_outIndices,output.data(),outputSize*sizeof(IdxT));
+	// leftover indices of an incomplete triangle stay where they were
+	if (_indices!=_outIndices)
+		memmove(_outIndices+outputSize,_indices+outputSize,(_numIndices-outputSize)*sizeof(IdxT));
+}
+
+// explicit instantiations
+template void CTipsifyVertexCacheOptimizer::optimizeTriangleOrdering<uint16_t>(const size_t, const size_t, const uint16_t*, uint16_t*, const uint32_t);
+template void CTipsifyVertexCacheOptimizer::optimizeTriangleOrdering<uint32_t>(const size_t, const size_t, const uint32_t*, uint32_t*, const uint32_t);
+
+}
@@ -0,0 +1,529 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/core/alloc/CArenaAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#ifdef _NBL_PLATFORM_WINDOWS_
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+using namespace nbl;
+using namespace core;
+
+namespace
+{
+// can't use `_NBL_ALIGNED_MALLOC` in here, it might be us
+void* systemAlignedMalloc(size_t bytes, size_t alignment)
+{
+#ifdef _NBL_PLATFORM_WINDOWS_
+	return ::_aligned_malloc(bytes,alignment);
+#else
+	void* p;
+	if (::posix_memalign(&p,std::max<size_t>(alignment,sizeof(void*)),bytes)!=0)
+		return nullptr;
+	return p;
+#endif
+}
+void systemAlignedFree(void* p)
+{
+#ifdef _NBL_PLATFORM_WINDOWS_
+	::_aligned_free(p);
+#else
+	::free(p);
+#endif
+}
+
+// spans and large allocations of at least a span, transparent huge pages need the range to be aligned to the huge page size
+void* mapHugePageBacked(size_t bytes)
+{
+	void* p = systemAlignedMalloc(bytes,CArenaAllocator::SpanSize);
+#if defined(MADV_HUGEPAGE)
+	if (p)
+		::madvise(p,bytes,MADV_HUGEPAGE);
+#endif
+	return p;
+}
+
+// sizes are `2^k` and `1.5*2^k`, so an object is aligned to the lowest set bit of its size class (spans start at 0 offset)
+constexpr uint32_t SizeClasses[CArenaAllocator::SizeClassCount] = {
+	16u,32u,48u,64u,96u,128u,192u,256u,384u,512u,768u,1024u,
+	1536u,2048u,3072u,4096u,6144u,8192u,12288u,16384u,24576u,32768u
+};
+static_assert(SizeClasses[CArenaAllocator::SizeClassCount-1u]==CArenaAllocator::MaxSmallSize);
+
+constexpr uint32_t InvalidSizeClass = ~0u;
+inline uint32_t findSizeClass(const size_t bytes, const size_t alignment)
+{
+	for (uint32_t i=0u; i<CArenaAllocator::SizeClassCount; i++)
+	{
+		const uint32_t size = SizeClasses[i];
+		if (size>=bytes && (size&(~size+1u))>=alignment)
+			return i;
+	}
+	return InvalidSizeClass;
+}
+// objects moved between a thread cache and the shared pool at once
+inline uint32_t batchSize(const uint32_t sizeClass)
+{
+	return std::clamp(0x10000u/SizeClasses[sizeClass],2u,64u);
+}
+
+// intrusive singly linked list of free objects
+struct SFreeObject
+{
+	SFreeObject* next;
+};
+
+// Two level map from span index to `sizeClass+1`, zero means the pointer is a large allocation.
+// A small object span covers its whole `SpanSize` range, so no large allocation can ever share a span index with it.
+class CPageMap
+{
+		static constexpr uint32_t AddressBits = 48u;
+		static constexpr uint32_t IndexBits = AddressBits-CArenaAllocator::SpanShift;
+		static constexpr uint32_t LeafBits = 14u;
+		static constexpr uint32_t RootBits = IndexBits-LeafBits;
+
+	public:
+		inline uint8_t get(const void* ptr) const
+		{
+			const uint64_t index = reinterpret_cast<uintptr_t>(ptr)>>CArenaAllocator::SpanShift;
+			if (index>>IndexBits)
+				return 0u;
+			const uint8_t* leaf = m_root[index>>LeafBits].load(std::memory_order_acquire);
+			return leaf ? leaf[index&((0x1u<<LeafBits)-1u)]:0u;
+		}
+		// only called under a size class' lock, but different size classes can race for a leaf
+		inline bool set(const void* span, const uint8_t value)
+		{
+			const uint64_t index = reinterpret_cast<uintptr_t>(span)>>CArenaAllocator::SpanShift;
+			if (index>>IndexBits)
+				return false;
+			auto& root = m_root[index>>LeafBits];
+			uint8_t* leaf = root.load(std::memory_order_acquire);
+			if (!leaf)
+			{
+				uint8_t* newLeaf = reinterpret_cast<uint8_t*>(::calloc(0x1u<<LeafBits,1u));
+				if (!newLeaf)
+					return false;
+				if (root.compare_exchange_strong(leaf,newLeaf,std::memory_order_acq_rel))
+					leaf = newLeaf;
+				else
+					::free(newLeaf);
+			}
+			leaf[index&((0x1u<<LeafBits)-1u)] = value;
+			return true;
+		}
+
+	private:
+		std::atomic<uint8_t*> m_root[0x1u<<RootBits] = {};
+};
+
+struct alignas(64) SCentralList
+{
+	std::mutex mutex;
+	SFreeObject* freeHead = nullptr;
+	// never used objects of the newest span
+	uint8_t* carveCursor = nullptr;
+	uint8_t* carveEnd = nullptr;
+	uint64_t objectsHandedOut = 0ull;
+	uint64_t refills = 0ull;
+	uint64_t flushes = 0ull;
+};
+
+struct SCentral
+{
+	CPageMap pageMap;
+	SCentralList lists[CArenaAllocator::SizeClassCount];
+	std::atomic<uint64_t> spanCount = 0ull;
+	std::atomic<uint64_t> largeAllocationCount = 0ull;
+	std::atomic<uint64_t> largeBytesInUse = 0ull;
+	std::atomic<uint64_t> hugePageBytesInUse = 0ull;
+	// freed huge page backed blocks, faulting in and zeroing fresh huge pages costs far more than the allocation itself
+	struct SHugeBlockCache
+	{
+		_NBL_STATIC_INLINE_CONSTEXPR uint32_t MaxBlocks = 16u;
+		_NBL_STATIC_INLINE_CONSTEXPR size_t MaxBytes = CArenaAllocator::SpanSize*64ull;
+
+		std::mutex mutex;
+		struct SBlock
+		{
+			void* base;
+			size_t size;
+		} blocks[MaxBlocks];
+		uint32_t count = 0u;
+		size_t bytes = 0ull;
+
+		// best fit, but won't hand out a block more than twice the size asked for
+		inline void* take(const size_t size)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			uint32_t best = MaxBlocks;
+			for (uint32_t i=0u; i<count; i++)
+			if (blocks[i].size>=size && blocks[i].size<=(size<<1ull) && (best==MaxBlocks || blocks[i].size<blocks[best].size))
+				best = i;
+			if (best==MaxBlocks)
+				return nullptr;
+			void* retval = blocks[best].base;
+			bytes -= blocks[best].size;
+			blocks[best] = blocks[--count];
+			return retval;
+		}
+		// evicts the oldest blocks to make room
+		inline void give(void* base, const size_t size)
+		{
+			if (size>MaxBytes)
+			{
+				systemAlignedFree(base);
+				return;
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			while (count==MaxBlocks || bytes+size>MaxBytes)
+			{
+				systemAlignedFree(blocks[0].base);
+				bytes -= blocks[0].size;
+				std::copy(blocks+1u,blocks+count,blocks);
+				count--;
+			}
+			blocks[count++] = {base,size};
+			bytes += size;
+		}
+	} hugeBlockCache;
+
+	// returns the number of objects linked into `outHead`
+	inline uint32_t refill(const uint32_t sizeClass, const uint32_t count, SFreeObject*& outHead)
+	{
+		auto& list = lists[sizeClass];
+		const uint32_t objectSize = SizeClasses[sizeClass];
+		std::lock_guard<std::mutex> lock(list.mutex);
+		list.refills++;
+
+		uint32_t taken = 0u;
+		SFreeObject* head = nullptr;
+		for (; taken<count; taken++)
+		{
+			SFreeObject* object;
+			if (list.freeHead)
+			{
+				object = list.freeHead;
+				list.freeHead = object->next;
+			}
+			else
+			{
+				if (list.carveCursor==list.carveEnd)
+				{
+					auto* span = reinterpret_cast<uint8_t*>(mapHugePageBacked(CArenaAllocator::SpanSize));
+					if (!span)
+						break;
+					if (!pageMap.set(span,static_cast<uint8_t>(sizeClass+1u)))
+					{
+						systemAlignedFree(span);
+						break;
+					}
+					spanCount++;
+					list.carveCursor = span;
+					list.carveEnd = span+(CArenaAllocator::SpanSize/objectSize)*objectSize;
+				}
+				object = reinterpret_cast<SFreeObject*>(list.carveCursor);
+				list.carveCursor += objectSize;
+			}
+			object->next = head;
+			head = object;
+		}
+		list.objectsHandedOut += taken;
+		outHead = head;
+		return taken;
+	}
+
+	inline void flush(const uint32_t sizeClass, SFreeObject* head, SFreeObject* tail, const uint32_t count)
+	{
+		auto& list = lists[sizeClass];
+		std::lock_guard<std::mutex> lock(list.mutex);
+		list.flushes++;
+		tail->next = list.freeHead;
+		list.freeHead = head;
+		list.objectsHandedOut -= count;
+	}
+};
+
+// never destroyed, threads can free memory during static destruction
+SCentral& getCentral()
+{
+	alignas(SCentral) static uint8_t storage[sizeof(SCentral)];
+	static SCentral* central = new (storage) SCentral();
+	return *central;
+}
+
+struct SThreadCache
+{
+	struct SList
+	{
+		SFreeObject* head = nullptr;
+		uint32_t count = 0u;
+	};
+	SList lists[CArenaAllocator::SizeClassCount];
+
+	~SThreadCache();
+
+	inline void* allocate(const uint32_t sizeClass)
+	{
+		auto& list = lists[sizeClass];
+		if (!list.head)
+		{
+			list.count = getCentral().refill(sizeClass,batchSize(sizeClass),list.head);
+			if (!list.head)
+				return nullptr;
+		}
+		SFreeObject* object = list.head;
+		list.head = object->next;
+		list.count--;
+		return object;
+	}
+
+	inline void deallocate(void* ptr, const uint32_t sizeClass)
+	{
+		auto& list = lists[sizeClass];
+		auto* object = reinterpret_cast<SFreeObject*>(ptr);
+		object->next = list.head;
+		list.head = object;
+		// keep at most two batches, give one back
+		const uint32_t batch = batchSize(sizeClass);
+		if (++list.count>batch*2u)
+			flush(sizeClass,batch);
+	}
+
+	inline void flush(const uint32_t sizeClass, const uint32_t count)
+	{
+		auto& list = lists[sizeClass];
+		if (!count)
+			return;
+		SFreeObject* head = list.head;
+		SFreeObject* tail = head;
+		for (uint32_t i=1u; i<count; i++)
+			tail = tail->next;
+		list.head = tail->next;
+		list.count -= count;
+		getCentral().flush(sizeClass,head,tail,count);
+	}
+
+	inline void flushAll()
+	{
+		for (uint32_t i=0u; i<CArenaAllocator::SizeClassCount; i++)
+			flush(i,lists[i].count);
+	}
+};
+thread_local SThreadCache t_cache;
+// Frees after this thread's cache got destroyed go straight to the shared pools. Has to be trivially destructible,
+// so that unlike any member of `t_cache` it can still be read while the thread's other thread locals get destroyed.
+thread_local bool t_cacheDestroyed = false;
+SThreadCache::~SThreadCache()
+{
+	flushAll();
+	t_cacheDestroyed = true;
+}
+
+// large allocations keep their base pointer and size right in front of the returned pointer
+struct SLargeHeader
+{
+	void* base;
+	size_t size;
+};
+static_assert(sizeof(SLargeHeader)==CArenaAllocator::LargeHeaderSize);
+}
+
+
+void* CArenaAllocator::allocate(size_t bytes, size_t alignment) noexcept
+{
+	if (bytes==0ull)
+		return nullptr;
+	alignment = std::max<size_t>(alignment,alignof(SFreeObject));
+
+	if (bytes<=MaxSmallSize)
+	{
+		const uint32_t sizeClass = findSizeClass(bytes,alignment);
+		if (sizeClass!=InvalidSizeClass)
+		{
+			if (!t_cacheDestroyed)
+				return t_cache.allocate(sizeClass);
+			SFreeObject* object;
+			return getCentral().refill(sizeClass,1u,object) ? object:nullptr;
+		}
+	}
+
+	auto& central = getCentral();
+	const size_t headerSize = core::alignUp(sizeof(SLargeHeader),alignment);
+	const size_t totalSize = headerSize+bytes;
+	const bool hugePages = totalSize>=SpanSize;
+	void* base;
+	if (hugePages)
+	{
+		const size_t mappedSize = core::alignUp(totalSize,SpanSize);
+		base = central.hugeBlockCache.take(mappedSize);
+		if (!base)
+			base = mapHugePageBacked(mappedSize);
+	}
+	else
+		base = systemAlignedMalloc(totalSize,alignment);
+	if (!base)
+		return nullptr;
+	central.largeAllocationCount++;
+	central.largeBytesInUse += totalSize;
+	if (hugePages)
+		central.hugePageBytesInUse += core::alignUp(totalSize,SpanSize);
+
+	auto* retval = reinterpret_cast<uint8_t*>(base)+headerSize;
+	reinterpret_cast<SLargeHeader*>(retval)[-1] = {base,totalSize};
+	return retval;
+}
+
+void CArenaAllocator::deallocate(void* ptr) noexcept
+{
+	if (!ptr)
+		return;
+
+	auto& central = getCentral();
+	const uint8_t sizeClassPlusOne = central.pageMap.get(ptr);
+	if (sizeClassPlusOne)
+	{
+		const uint32_t sizeClass = sizeClassPlusOne-1u;
+		if (!t_cacheDestroyed)
+			t_cache.deallocate(ptr,sizeClass);
+		else
+		{
+			auto* object = reinterpret_cast<SFreeObject*>(ptr);
+			central.flush(sizeClass,object,object,1u);
+		}
+		return;
+	}
+
+	const SLargeHeader header = reinterpret_cast<const SLargeHeader*>(ptr)[-1];
+	central.largeAllocationCount--;
+	central.largeBytesInUse -= header.size;
+	if (header.size>=SpanSize)
+	{
+		// a block taken from the cache might be bigger than asked for, but the size is only used to account and to find a fit
+		const size_t mappedSize = core::alignUp(header.size,SpanSize);
+		central.hugePageBytesInUse -= mappedSize;
+		central.hugeBlockCache.give(header.base,mappedSize);
+	}
+	else
+		systemAlignedFree(header.base);
+}
+
+CArenaAllocator::SStatistics CArenaAllocator::getStatistics()
+{
+	auto& central = getCentral();
+	SStatistics retval = {};
+	retval.spanCount = central.spanCount.load();
+	for (uint32_t i=0u; i<SizeClassCount; i++)
+	{
+		auto& list = central.lists[i];
+		std::lock_guard<std::mutex> lock(list.mutex);
+		retval.smallBytesHandedOut += list.objectsHandedOut*SizeClasses[i];
+		retval.centralRefills += list.refills;
+		retval.centralFlushes += list.flushes;
+	}
+	retval.largeAllocationCount = central.largeAllocationCount.load();
+	retval.largeBytesInUse = central.largeBytesInUse.load();
+	retval.hugePageBytesInUse = central.hugePageBytesInUse.load();
+	{
+		std::lock_guard<std::mutex> lock(central.hugeBlockCache.mutex);
+		retval.hugePageBytesCached = central.hugeBlockCache.bytes;
+	}
+	return retval;
+}
+
+void CArenaAllocator::flushThreadCache()
+{
+	if (!t_cacheDestroyed)
+		t_cache.flushAll();
+}
+
+
+void* CArenaAllocator::CLoadArena::allocateFromChunk(SChunk* chunk, size_t bytes, size_t alignment) noexcept
+{
+	const auto base = reinterpret_cast<uintptr_t>(chunk);
+	size_t offset = chunk->offset.load(std::memory_order_relaxed);
+	while (true)
+	{
+		const size_t aligned = core::alignUp(base+offset,alignment)-base;
+		if (aligned+bytes>chunk->size)
+			return nullptr;
+		if (chunk->offset.compare_exchange_weak(offset,aligned+bytes,std::memory_order_relaxed))
+			return reinterpret_cast<void*>(base+aligned);
+	}
+}
+
+void* CArenaAllocator::CLoadArena::allocate(size_t bytes, size_t alignment) noexcept
+{
+	if (bytes==0ull)
+		return nullptr;
+
+	void* retval = nullptr;
+	if (SChunk* chunk=m_current.load(std::memory_order_acquire))
+		retval = allocateFromChunk(chunk,bytes,alignment);
+	if (!retval)
+	{
+		std::lock_guard<std::mutex> lock(m_chunkMutex);
+		// someone might have added a chunk while we waited
+		SChunk* current = m_current.load(std::memory_order_acquire);
+		if (current)
+			retval = allocateFromChunk(current,bytes,alignment);
+		if (!retval)
+		{
+			// the chunk only needs the alignment of its header, asking the system for more would grow the allocator's header too,
+			// the default chunk size plus that header then fills exactly one span
+			const size_t chunkSize = std::max<size_t>(m_chunkSize,sizeof(SChunk)+(alignment-1ull)+bytes);
+			void* mem = CArenaAllocator::allocate(chunkSize,alignof(SChunk));
+			if (!mem)
+				return nullptr;
+			auto* chunk = new (mem) SChunk{current,chunkSize,{sizeof(SChunk)}};
+			// nobody else can see the chunk yet
+			retval = allocateFromChunk(chunk,bytes,alignment);
+			assert(retval);
+			// oversized allocations don't replace a chunk with more space left in it
+			if (!current || chunkSize-chunk->offset.load(std::memory_order_relaxed)>=current->size-current->offset.load(std::memory_order_relaxed))
+				m_current.store(chunk,std::memory_order_release);
+			else
+			{
+				chunk->prev = current->prev;
+				current->prev = chunk;
+			}
+			m_bytesReserved.fetch_add(chunkSize,std::memory_order_relaxed);
+		}
+	}
+	m_bytesAllocated.fetch_add(bytes,std::memory_order_relaxed);
+	return retval;
+}
+
+void CArenaAllocator::CLoadArena::reset() noexcept
+{
+	std::lock_guard<std::mutex> lock(m_chunkMutex);
+	for (SChunk* chunk=m_current.exchange(nullptr); chunk;)
+	{
+		SChunk* prev = chunk->prev;
+		chunk->~SChunk();
+		CArenaAllocator::deallocate(chunk);
+		chunk = prev;
+	}
+	m_bytesAllocated = 0ull;
+	m_bytesReserved = 0ull;
+}
+
+
+#ifdef _NBL_USE_ARENA_ALLOCATOR_
+void* nbl::impl::arena_malloc(size_t size, size_t alignment) noexcept
+{
+	return CArenaAllocator::allocate(size,alignment);
+}
+void nbl::impl::arena_free(void* addr) noexcept
+{
+	CArenaAllocator::deallocate(addr);
+}
+#endif
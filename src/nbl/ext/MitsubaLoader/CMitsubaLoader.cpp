@@ -4,6 +4,9 @@
 // For conditions of distribution and use, see copyright notice in nabla.h
 
 #include <cwchar>
+#include <functional>
+
+#include "nbl/core/execution.h"
 
 #include "nbl/ext/MitsubaLoader/CMitsubaLoader.h"
 #include "nbl/ext/MitsubaLoader/ParserUtil.h"
@@ -509,6 +512,10 @@ asset::SAssetBundle CMitsubaLoader::loadAsset(system::IFile* _file, const asset:
 			createAndCacheVertexShader(m_assetMgr, DUMMY_VERTEX_SHADER);
 		}
 
+		// geometry loading and processing is independent per shape, the instance and material setup stays serial
+		if (_params.loaderFlags & IAssetLoader::ELPF_PARALLEL_DEPENDENCY_LOADING)
+			prefetchShapes(ctx, _hierarchyLevel, parserManager.shapegroups, _params.logger);
+
 		core::map<core::smart_refctd_ptr<asset::ICPUMesh>,std::pair<std::string,CElementShape::Type>> meshes;
 		for (auto& shapepair : parserManager.shapegroups)
 		{
@@ -693,8 +700,6 @@ static core::smart_refctd_ptr<ICPUMesh> createMeshFromGeomCreatorReturnType(IGeo
 
 SContext::shape_ass_type CMitsubaLoader::loadBasicShape(SContext& ctx, uint32_t hierarchyLevel, CElementShape* shape, const core::matrix3x4SIMD& relTform, const system::logger_opt_ptr& logger)
 {
-	constexpr uint32_t UV_ATTRIB_ID = 2u;
-
 	auto addInstance = [shape,&ctx,&relTform,&logger,this](SContext::shape_ass_type& mesh)
 	{
 		auto bsdf = getBSDFtreeTraversal(ctx, shape->bsdf, logger);
@@ -713,17 +718,82 @@ SContext::shape_ass_type CMitsubaLoader::loadBasicShape(SContext& ctx, uint32_t
 
 	auto found = ctx.shapeCache.find(shape);
 	if (found != ctx.shapeCache.end()) {
-		addInstance(found->second);
+		// a null entry means the geometry failed to load during the prefetch
+		if (found->second)
+			addInstance(found->second);
 
 		return found->second;
 	}
 
+	auto mesh = loadShapeGeometry(ctx, hierarchyLevel, shape, logger);
+	applyShapeGeometryTransform(shape);
+	if (!mesh)
+		return nullptr;
+
+	addInstance(mesh);
+	// cache and return
+	ctx.shapeCache.insert({ shape,mesh });
+	return mesh;
+}
+
+void CMitsubaLoader::applyShapeGeometryTransform(CElementShape* shape)
+{
+	switch (shape->type)
+	{
+		case CElementShape::Type::SPHERE:
+			{
+				core::matrix3x4SIMD tform;
+				tform.setScale(core::vectorSIMDf(shape->sphere.radius,shape->sphere.radius,shape->sphere.radius));
+				tform.setTranslation(shape->sphere.center);
+				shape->transform.matrix = core::concatenateBFollowedByA(shape->transform.matrix,core::matrix4SIMD(tform));
+			}
+			break;
+		case CElementShape::Type::CYLINDER:
+			{
+				auto diff = shape->cylinder.p0-shape->cylinder.p1;
+				core::vectorSIMDf up(0.f);
+				float maxDot = diff[0];
+				uint32_t index = 0u;
+				for (auto i = 1u; i < 3u; i++)
+					if (diff[i] < maxDot)
+					{
+						maxDot = diff[i];
+						index = i;
+					}
+				up[index] = 1.f;
+				core::matrix3x4SIMD tform;
+				// mesh is left haded so transforming by LH matrix is fine (I hope but lets check later on)
+				core::matrix3x4SIMD::buildCameraLookAtMatrixLH(shape->cylinder.p0,shape->cylinder.p1,up).getInverse(tform);
+				core::matrix3x4SIMD scale;
+				scale.setScale(core::vectorSIMDf(shape->cylinder.radius,shape->cylinder.radius,core::length(diff).x));
+				shape->transform.matrix = core::concatenateBFollowedByA(shape->transform.matrix,core::matrix4SIMD(core::concatenateBFollowedByA(tform,scale)));
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+static inline asset::IAssetLoader::SAssetLoadParams getModelLoadParams(const SContext& ctx)
+{
+	auto loadParams = ctx.inner.params;
+	loadParams.loaderFlags = static_cast<IAssetLoader::E_LOADER_PARAMETER_FLAGS>(loadParams.loaderFlags | IAssetLoader::ELPF_RIGHT_HANDED_MESHES);
+	return loadParams;
+}
+
+SContext::shape_ass_type CMitsubaLoader::loadShapeGeometry(const SContext& ctx, uint32_t hierarchyLevel, const CElementShape* shape, const system::logger_opt_ptr& logger)
+{
+	constexpr uint32_t UV_ATTRIB_ID = 2u;
+
 	auto loadModel = [&](const ext::MitsubaLoader::SPropertyElementData& filename, int64_t index=-1) -> core::smart_refctd_ptr<asset::ICPUMesh>
 	{
 		assert(filename.type==ext::MitsubaLoader::SPropertyElementData::Type::STRING);
-		auto loadParams = ctx.inner.params;
-		loadParams.loaderFlags = static_cast<IAssetLoader::E_LOADER_PARAMETER_FLAGS>(loadParams.loaderFlags | IAssetLoader::ELPF_RIGHT_HANDED_MESHES);
-		auto retval = interm_getAssetInHierarchy(m_assetMgr, filename.svalue, loadParams, hierarchyLevel/*+ICPUScene::MESH_HIERARCHY_LEVELS_BELOW*/, ctx.override_);
+		asset::SAssetBundle retval;
+		auto prefetched = ctx.modelCache.find(filename.svalue);
+		if (prefetched!=ctx.modelCache.end())
+			retval = prefetched->second;
+		else
+			retval = interm_getAssetInHierarchy(m_assetMgr, filename.svalue, getModelLoadParams(ctx), hierarchyLevel/*+ICPUScene::MESH_HIERARCHY_LEVELS_BELOW*/, ctx.override_);
 		if (retval.getAssetType()!=asset::IAsset::ET_MESH)
 			return nullptr;
 		auto contentRange = retval.getContents();
@@ -768,34 +838,9 @@ SContext::shape_ass_type CMitsubaLoader::loadBasicShape(SContext& ctx, uint32_t
 		case CElementShape::Type::SPHERE:
 			mesh = createMeshFromGeomCreatorReturnType(ctx.creator->createSphereMesh(1.f,64u,64u), m_assetMgr);
 			flipNormals = flipNormals!=shape->sphere.flipNormals;
-			{
-				core::matrix3x4SIMD tform;
-				tform.setScale(core::vectorSIMDf(shape->sphere.radius,shape->sphere.radius,shape->sphere.radius));
-				tform.setTranslation(shape->sphere.center);
-				shape->transform.matrix = core::concatenateBFollowedByA(shape->transform.matrix,core::matrix4SIMD(tform));
-			}
 			break;
 		case CElementShape::Type::CYLINDER:
-			{
-				auto diff = shape->cylinder.p0-shape->cylinder.p1;
-				mesh = createMeshFromGeomCreatorReturnType(ctx.creator->createCylinderMesh(1.f, 1.f, 64), m_assetMgr);
-				core::vectorSIMDf up(0.f);
-				float maxDot = diff[0];
-				uint32_t index = 0u;
-				for (auto i = 1u; i < 3u; i++)
-					if (diff[i] < maxDot)
-					{
-						maxDot = diff[i];
-						index = i;
-					}
-				up[index] = 1.f;
-				core::matrix3x4SIMD tform;
-				// mesh is left haded so transforming by LH matrix is fine (I hope but lets check later on)
-				core::matrix3x4SIMD::buildCameraLookAtMatrixLH(shape->cylinder.p0,shape->cylinder.p1,up).getInverse(tform);
-				core::matrix3x4SIMD scale;
-				scale.setScale(core::vectorSIMDf(shape->cylinder.radius,shape->cylinder.radius,core::length(diff).x));
-				shape->transform.matrix = core::concatenateBFollowedByA(shape->transform.matrix,core::matrix4SIMD(core::concatenateBFollowedByA(tform,scale)));
-			}
+			mesh = createMeshFromGeomCreatorReturnType(ctx.creator->createCylinderMesh(1.f, 1.f, 64), m_assetMgr);
 			flipNormals = flipNormals!=shape->cylinder.flipNormals;
 			break;
 		case CElementShape::Type::RECTANGLE:
@@ -814,7 +859,7 @@ SContext::shape_ass_type CMitsubaLoader::loadBasicShape(SContext& ctx, uint32_t
 			if (mesh && shape->obj.flipTexCoords)
 			{
 				newMesh = core::smart_refctd_ptr_static_cast<asset::ICPUMesh> (mesh->clone(1u));
-				for (auto& meshbuffer : mesh->getMeshBufferVector())
+				for (auto& meshbuffer : newMesh->getMeshBufferVector())
 				{
 					auto binding = meshbuffer->getVertexBufferBindings()[UV_ATTRIB_ID];
 					if (binding.buffer)
@@ -852,7 +897,7 @@ SContext::shape_ass_type CMitsubaLoader::loadBasicShape(SContext& ctx, uint32_t
 					constexpr uint32_t COLOR_BUF_BINDING = 15u;
 					uint32_t* newRGB = reinterpret_cast<uint32_t*>(newRGBbuff->getPointer());
 					uint32_t offset = 0u;
-					for (auto& meshbuffer : mesh->getMeshBufferVector())
+					for (auto& meshbuffer : newMesh->getMeshBufferVector())
 					{
 						core::vectorSIMDf rgb;
 						for (uint32_t i=0u; meshbuffer->getAttribute(rgb,COLOR_ATTR,i); i++,offset++)
@@ -900,7 +945,7 @@ SContext::shape_ass_type CMitsubaLoader::loadBasicShape(SContext& ctx, uint32_t
 	// flip normals if necessary
 	if (flipNormals)
 	{
-		for (auto& meshbuffer : mesh->getMeshBufferVector())
+		for (auto& meshbuffer : newMesh->getMeshBufferVector())
 		{
 			auto binding = meshbuffer->getIndexBufferBinding();
 			binding.buffer = core::smart_refctd_ptr_static_cast<ICPUBuffer>(binding.buffer->clone(0u));
@@ -910,7 +955,7 @@ SContext::shape_ass_type CMitsubaLoader::loadBasicShape(SContext& ctx, uint32_t
 	}
 	// recompute normalis if necessary
 	if (faceNormals || !std::isnan(maxSmoothAngle))
-	for (auto& meshbuffer : mesh->getMeshBufferVector())
+	for (auto& meshbuffer : newMesh->getMeshBufferVector())
 	{
 		const float smoothAngleCos = cos(core::radians(maxSmoothAngle));
 
@@ -928,12 +973,90 @@ SContext::shape_ass_type CMitsubaLoader::loadBasicShape(SContext& ctx, uint32_t
 		meshbuffer = std::move(newMeshBuffer);
 	}
 	IMeshManipulator::recalculateBoundingBox(newMesh.get());
-	mesh = std::move(newMesh);
+	return newMesh;
+}
 
-	addInstance(mesh);
-	// cache and return
-	ctx.shapeCache.insert({ shape,mesh });
-	return mesh;
+void CMitsubaLoader::prefetchShapes(SContext& ctx, uint32_t hierarchyLevel, const core::vector<std::pair<CElementShape*,std::string>>& shapes, const system::logger_opt_ptr& logger)
+{
+	// gather every basic shape `getMesh` could reach, in a deterministic order
+	core::vector<CElementShape*> basicShapes;
+	{
+		core::unordered_set<const CElementShape*> visited;
+		std::function<void(CElementShape*)> gather = [&](CElementShape* shape) -> void
+		{
+			if (!shape || !visited.insert(shape).second)
+				return;
+			switch (shape->type)
+			{
+				case CElementShape::Type::INSTANCE:
+					if (shape->instance.parent)
+						gather(shape->instance.parent);
+					break;
+				case CElementShape::Type::SHAPEGROUP:
+					for (auto i=0u; i<shape->shapegroup.childCount; i++)
+						gather(shape->shapegroup.children[i]);
+					break;
+				default:
+					if (ctx.shapeCache.find(shape)==ctx.shapeCache.end())
+						basicShapes.push_back(shape);
+					break;
+			}
+		};
+		for (const auto& shapepair : shapes)
+		if (shapepair.first->type!=CElementShape::Type::SHAPEGROUP)
+			gather(shapepair.first);
+	}
+	if (basicShapes.empty())
+		return;
+
+	// load every distinct model file once, concurrently
+	{
+		core::vector<std::string> filenames;
+		{
+			core::unordered_set<std::string> uniqueFilenames;
+			for (const auto* shape : basicShapes)
+			{
+				const SPropertyElementData* filename;
+				switch (shape->type)
+				{
+					case CElementShape::Type::OBJ:
+						filename = &shape->obj.filename;
+						break;
+					case CElementShape::Type::PLY:
+						filename = &shape->ply.filename;
+						break;
+					case CElementShape::Type::SERIALIZED:
+						filename = &shape->serialized.filename;
+						break;
+					default:
+						continue;
+				}
+				if (ctx.modelCache.find(filename->svalue)==ctx.modelCache.end() && uniqueFilenames.insert(filename->svalue).second)
+					filenames.push_back(filename->svalue);
+			}
+		}
+
+		const auto loadParams = getModelLoadParams(ctx);
+		core::vector<asset::SAssetBundle> bundles(filenames.size());
+		core::for_each(core::execution::par,filenames.begin(),filenames.end(),[&](const std::string& filename) -> void
+		{
+			bundles[&filename-filenames.data()] = interm_getAssetInHierarchy(m_assetMgr,filename,loadParams,hierarchyLevel,ctx.override_);
+		});
+		for (size_t i=0u; i<filenames.size(); i++)
+			ctx.modelCache.emplace(std::move(filenames[i]),std::move(bundles[i]));
+	}
+
+	// then clone and process the geometry of every shape concurrently, the shapes themselves only get modified afterwards
+	core::vector<SContext::shape_ass_type> geometries(basicShapes.size());
+	core::for_each(core::execution::par,basicShapes.begin(),basicShapes.end(),[&](CElementShape* const& shape) -> void
+	{
+		geometries[&shape-basicShapes.data()] = loadShapeGeometry(ctx,hierarchyLevel,shape,logger);
+	});
+	for (size_t i=0u; i<basicShapes.size(); i++)
+	{
+		applyShapeGeometryTransform(basicShapes[i]);
+		ctx.shapeCache.insert({basicShapes[i],std::move(geometries[i])});
+	}
 }
 
 void CMitsubaLoader::cacheTexture(SContext& ctx, uint32_t hierarchyLevel, const CElementTexture* tex, const CMitsubaMaterialCompilerFrontend::E_IMAGE_VIEW_SEMANTIC semantic)
@@ -4,6 +4,8 @@
 
 #include "nbl/asset/compile_config.h"
 
+#include "nbl/core/execution.h"
+
 #include "nbl/ext/MitsubaLoader/CSerializedLoader.h"
 #include "nbl/ext/MitsubaLoader/CMitsubaSerializedMetadata.h"
 
@@ -38,26 +40,107 @@ constexpr auto COLOR_ATTRIBUTE = 1;
 constexpr auto UV_ATTRIBUTE = 2;
 constexpr auto NORMAL_ATTRIBUTE = 3;
 
-// maybe move to core
-#define PAGE_SIZE 4096
-struct alignas(PAGE_SIZE) Page_t
+// how many vertices get converted at once when the source data can't be inflated straight into the final buffers
+constexpr uint32_t STAGING_VERTEX_COUNT = 2048u;
+
+
+//! Inflates a mesh's zlib stream piece by piece straight into the destination memory
+class CInflateStream
 {
-	uint8_t data[PAGE_SIZE];
+	public:
+		CInflateStream(const uint8_t* data, const size_t size)
+		{
+			memset(&m_stream,0,sizeof(z_stream));
+			m_stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+			m_stream.avail_in = static_cast<uInt>(size);
+			m_valid = inflateInit(&m_stream)==Z_OK;
+		}
+		~CInflateStream()
+		{
+			if (m_valid)
+				inflateEnd(&m_stream);
+		}
+
+		inline bool isValid() const {return m_valid;}
+		inline size_t getTotalOut() const {return m_stream.total_out;}
+
+		//! fails if the stream ends or is corrupt before `size` bytes could be produced
+		inline bool read(void* dst, size_t size)
+		{
+			auto* out = reinterpret_cast<Bytef*>(dst);
+			while (m_valid && size)
+			{
+				const uInt chunk = static_cast<uInt>(core::min<size_t>(size,0x40000000ull));
+				m_stream.next_out = out;
+				m_stream.avail_out = chunk;
+				while (m_stream.avail_out)
+				{
+					const int32_t err = inflate(&m_stream,Z_SYNC_FLUSH);
+					if (err==Z_STREAM_END && m_stream.avail_out)
+						return false;
+					if (err!=Z_OK && err!=Z_STREAM_END)
+						return (m_valid=false);
+				}
+				out += chunk;
+				size -= chunk;
+			}
+			return m_valid;
+		}
+
+	private:
+		z_stream m_stream;
+		bool m_valid;
 };
-#undef PAGE_SIZE
 
+// plain loops the compiler turns into packed conversions
+static inline void convertDoublesToFloats(float* dst, const double* src, const size_t count)
+{
+	for (size_t i=0u; i<count; i++)
+		dst[i] = static_cast<float>(src[i]);
+}
+static inline uint32_t findMaxIndex(const uint32_t* indices, const size_t count)
+{
+	uint32_t maxIx = 0u;
+	for (size_t i=0u; i<count; i++)
+		maxIx = core::max(maxIx,indices[i]);
+	return maxIx;
+}
+static inline void narrowIndices(uint16_t* dst, const uint32_t* src, const size_t count)
+{
+	for (size_t i=0u; i<count; i++)
+		dst[i] = static_cast<uint16_t>(src[i]);
+}
 
-template<typename T, size_t N>
-struct alignas(T) unaligned_gvecN
+//! reads `floatCount` float or double values into `dst` converting to single precision on the fly
+static inline bool inflateFloats(CInflateStream& stream, const bool sourceIsDoubles, float* dst, size_t floatCount, double* staging)
 {
-	T pointer[N];
-};
+	if (!sourceIsDoubles)
+		return stream.read(dst,sizeof(float)*floatCount);
 
-using unaligned_vec2 = unaligned_gvecN<float,2ull>;
-using unaligned_vec3 = unaligned_gvecN<float,3ull>;
+	constexpr size_t StagingFloats = STAGING_VERTEX_COUNT*3u;
+	for (size_t i=0u; i<floatCount; i+=StagingFloats)
+	{
+		const size_t count = core::min(floatCount-i,StagingFloats);
+		if (!stream.read(staging,sizeof(double)*count))
+			return false;
+		convertDoublesToFloats(dst+i,staging,count);
+	}
+	return true;
+}
 
-using unaligned_dvec2 = unaligned_gvecN<double,2ull>;
-using unaligned_dvec3 = unaligned_gvecN<double,3ull>;
+//! reads a 3 component attribute in chunks of `STAGING_VERTEX_COUNT` and hands them over as floats for encoding
+template<class Encoder>
+static inline bool inflateVec3Attribute(CInflateStream& stream, const bool sourceIsDoubles, const uint64_t vertexCount, float* floatStaging, double* doubleStaging, Encoder&& encode)
+{
+	for (uint64_t i=0u; i<vertexCount; i+=STAGING_VERTEX_COUNT)
+	{
+		const uint32_t count = core::min<uint64_t>(vertexCount-i,STAGING_VERTEX_COUNT);
+		if (!inflateFloats(stream,sourceIsDoubles,floatStaging,count*3u,doubleStaging))
+			return false;
+		encode(floatStaging,i,count);
+	}
+	return true;
+}
 
 
 //! creates/loads an animated mesh from the file.
@@ -77,30 +160,30 @@ asset::SAssetBundle CSerializedLoader::loadAsset(system::IFile* _file, const ass
 		_NBL_DEBUG_BREAK_IF(true);
 		assert(false);
 	}
+	// shared with every other loader and `loadAsset` call, the cache does its own locking so meshes can be decoded in parallel
 	CQuantNormalCache* const quantNormalCache = _params.meshManipulatorOverride->getQuantNormalCache();
 
 	size_t maxSize = 0u;
 	{
 		FileHeader header;
-		system::future<size_t> future;
-		ctx.inner.mainFile->read(future, &header, 0u, sizeof(header));
-		future.get();
-		if (header!=FileHeader())
+		system::IFile::success_t success;
+		ctx.inner.mainFile->read(success, &header, 0u, sizeof(header));
+		if (!success || header!=FileHeader())
 		{
 			_params.logger.log("Not a valid `.serialized` file", system::ILogger::E_LOG_LEVEL::ELL_ERROR, ctx.inner.mainFile->getFileName().string().c_str());
 			return {};
 		}
 
 		size_t backPos = ctx.inner.mainFile->getSize() - sizeof(uint32_t);
-		ctx.inner.mainFile->read(future,&ctx.meshCount,backPos,sizeof(uint32_t));
-		future.get();
-		if (ctx.meshCount==0u)
+		ctx.inner.mainFile->read(success,&ctx.meshCount,backPos,sizeof(uint32_t));
+		if (!success || ctx.meshCount==0u)
 			return {};
 
 		ctx.meshOffsets = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<uint64_t> >(ctx.meshCount*2u);
 		backPos -= sizeof(uint64_t)*ctx.meshCount;
-		ctx.inner.mainFile->read(future, ctx.meshOffsets->data(),backPos,sizeof(uint64_t)*ctx.meshCount);
-		future.get();
+		ctx.inner.mainFile->read(success, ctx.meshOffsets->data(),backPos,sizeof(uint64_t)*ctx.meshCount);
+		if (!success)
+			return {};
 		for (uint32_t i=0; i<ctx.meshCount; i++)
 		{
 			size_t localSize;
@@ -117,68 +200,68 @@ asset::SAssetBundle CSerializedLoader::loadAsset(system::IFile* _file, const ass
 	if (maxSize==0u)
 		return {};
 
-	auto meta = core::make_smart_refctd_ptr<CMitsubaSerializedMetadata>(ctx.meshCount,core::smart_refctd_ptr(IRenderpassIndependentPipelineLoader::m_basicViewParamsSemantics));
-	core::vector<core::smart_refctd_ptr<ICPUMesh>> meshes; meshes.reserve(ctx.meshCount);
+	// resolve the shared assets up-front, so that the per-mesh decode doesn't touch the asset manager or the override
+	enum E_SHADER_PATH : uint32_t
+	{
+		ESP_VERTEX_COLOR = 0u,
+		ESP_VERTEX_UV,
+		ESP_VERTEX_NORMAL,
+		ESP_COUNT
+	};
+	std::pair<core::smart_refctd_ptr<ICPUSpecializedShader>,core::smart_refctd_ptr<ICPUSpecializedShader>> shaders[ESP_COUNT];
+	{
+		const char* basepaths[ESP_COUNT] = {
+			"nbl/builtin/material/debug/vertex_color/specialized_shader", // if only positions are present, shaders with debug vertex colors are assumed
+			"nbl/builtin/material/debug/vertex_uv/specialized_shader",
+			"nbl/builtin/material/debug/vertex_normal/specialized_shader"
+		};
+		const IAsset::E_TYPE types[]{ IAsset::E_TYPE::ET_SPECIALIZED_SHADER, IAsset::E_TYPE::ET_SPECIALIZED_SHADER, static_cast<IAsset::E_TYPE>(0u) };
+		for (auto p=0u; p<ESP_COUNT; p++)
+		{
+			const std::string basepath = basepaths[p];
+			auto bundle = m_assetMgr->findAssets(basepath+".vert", types);
+			shaders[p].first = core::smart_refctd_ptr_static_cast<ICPUSpecializedShader>(bundle->begin()->getContents().begin()[0]);
+			bundle = m_assetMgr->findAssets(basepath+".frag", types);
+			shaders[p].second = core::smart_refctd_ptr_static_cast<ICPUSpecializedShader>(bundle->begin()->getContents().begin()[0]);
+		}
+	}
+	auto mbPipelineLayout = _override->findDefaultAsset<ICPUPipelineLayout>("nbl/builtin/material/lambertian/no_texture/pipeline_layout",ctx.inner,_hierarchyLevel+ICPUMesh::PIPELINE_LAYOUT_HIERARCHYLEVELS_BELOW).first;
 
-	uint8_t* data = reinterpret_cast<uint8_t*>(_NBL_ALIGNED_MALLOC(maxSize,alignof(double)));
-	constexpr size_t CHUNK = 256ull*1024ull;
-	core::vector<Page_t> decompressed(CHUNK/sizeof(Page_t));
-	system::future<size_t> future;
-	for (uint32_t i=0; i<ctx.meshCount; i++)
+	// the whole file is needed anyway, so use the mapping when there is one and only copy the compressed blocks otherwise
+	const uint8_t* const mappedFile = reinterpret_cast<const uint8_t*>(static_cast<const system::IFile*>(ctx.inner.mainFile)->getMappedPointer());
+
+	struct SDecodedMesh
 	{
-		auto localSize = ctx.meshOffsets->operator[](i+ctx.meshCount);
-		ctx.inner.mainFile->read(future,data,sizeof(FileHeader)+ctx.meshOffsets->operator[](i),localSize);
-		// decompress
-		size_t decompressSize;
+		core::smart_refctd_ptr<ICPUMesh> mesh;
+		std::string name;
+	};
+	auto decodeMesh = [&](const uint32_t i) -> SDecodedMesh
+	{
+		const auto localSize = ctx.meshOffsets->operator[](i+ctx.meshCount);
+		const size_t fileOffset = sizeof(FileHeader)+ctx.meshOffsets->operator[](i);
+		core::vector<uint8_t> compressedStorage;
+		const uint8_t* compressed = mappedFile ? (mappedFile+fileOffset):nullptr;
+		if (!compressed)
 		{
-			// Setup the inflate stream.
-			z_stream stream;
-			stream.next_in = (Bytef*)data;
-			stream.avail_in = (uInt)localSize;
-			stream.total_in = 0;
-			stream.next_out = (Bytef*)decompressed.data();
-			stream.avail_out = CHUNK;
-			stream.total_out = 0u;
-			stream.zalloc = (alloc_func)0;
-			stream.zfree = (free_func)0;
-
-			int32_t err = inflateInit(&stream, -MAX_WBITS);
-			if (err == Z_OK)
-			{
-				while (err == Z_OK && err != Z_STREAM_END)
-				{
-					err = inflate(&stream, Z_SYNC_FLUSH);
-					if (err!=Z_OK || err==Z_STREAM_END || stream.avail_out)
-						continue;
-
-					if (stream.total_out+CHUNK>decompressed.size()*sizeof(Page_t))
-						decompressed.resize(decompressed.size()+CHUNK/sizeof(Page_t));
-					stream.next_out = reinterpret_cast<Bytef*>(decompressed.data())+stream.total_out;
-					stream.avail_out = CHUNK;
-				}
-			}
-			decompressSize = stream.total_out;
-			int32_t err2 = inflateEnd(&stream);
+			compressedStorage.resize(localSize);
+			system::IFile::success_t success;
+			ctx.inner.mainFile->read(success,compressedStorage.data(),fileOffset,localSize);
+			if (!success)
+				return {};
+			compressed = compressedStorage.data();
+		}
 
-			if (err == Z_OK || err == Z_STREAM_END)
-				err = err2;
-			if (err != Z_OK)
-			{
-				std::string msg("Error decompressing mesh ix ");
-				msg += std::to_string(i);
-				_params.logger.log(msg, system::ILogger::E_LOG_LEVEL::ELL_ERROR);
-				continue;
-			}
+		CInflateStream stream(compressed,localSize);
+		if (!stream.isValid())
+		{
+			_params.logger.log("Error decompressing mesh ix %d", system::ILogger::E_LOG_LEVEL::ELL_ERROR, i);
+			return {};
 		}
-		// too small to hold anything
-		if (decompressSize < sizeof(uint8_t)+sizeof(uint64_t)*2ull)
-			continue;
 
-		// some tracking
-		uint8_t* ptr = reinterpret_cast<uint8_t*>(decompressed.data());
-		uint8_t* streamEnd = ptr+decompressSize;
 		// vertex size determination
-		auto flags = *(reinterpret_cast<uint32_t*&>(ptr)++);
+		uint32_t flags;
+		if (!stream.read(&flags,sizeof(flags)))
+			return {};
 		size_t typeSize;
 		{
 			if (flags & MF_SINGLE_FLOAT)
@@ -186,95 +269,140 @@ asset::SAssetBundle CSerializedLoader::loadAsset(system::IFile* _file, const ass
 			else if (flags & MF_DOUBLE_FLOAT)
 				typeSize = sizeof(double);
 			else
-				continue;
+				return {};
 		}
 		const bool sourceIsDoubles = typeSize==sizeof(double);
-		const bool requiresNormals = (flags&MF_PER_VERTEX_NORMALS) || (flags&MF_FACE_NORMALS);
+		const bool hasVertexNormals = flags&MF_PER_VERTEX_NORMALS;
+		const bool hasFaceNormals = flags&MF_FACE_NORMALS;
+		const bool requiresNormals = hasVertexNormals || hasFaceNormals;
 		const bool hasUVs = flags&MF_TEXTURE_COORDINATES;
 		const bool hasColors = flags&MF_VERTEX_COLORS;
 
-		// get name
-		char* stringPtr = reinterpret_cast<char*>(ptr);
-		while (ptr < streamEnd)
-		if (! *(ptr++))
+		// get name, its short so going byte by byte is fine
+		std::string name;
+		for (char c; ; name.push_back(c))
+		{
+			if (!stream.read(&c,sizeof(c)))
+				return {};
+			if (!c)
 				break;
-		// name too long
-		const size_t stringLen = reinterpret_cast<char*>(ptr)-stringPtr;
-		if (ptr+sizeof(uint64_t)*2ull > streamEnd)
-			continue;
+		}
 
 		// 
-		const uint64_t vertexCount = *(reinterpret_cast<uint64_t*&>(ptr)++);
+		uint64_t counts[2];
+		if (!stream.read(counts,sizeof(counts)))
+			return {};
+		const uint64_t vertexCount = counts[0];
 		if (vertexCount<3ull || vertexCount>0xFFFFFFFFull)
-			continue;
-		const uint64_t triangleCount = *(reinterpret_cast<uint64_t*&>(ptr)++);
+			return {};
+		const uint64_t triangleCount = counts[1];
 		if (triangleCount<1ull)
-			continue;
-		const size_t indexDataSize = sizeof(uint32_t)*3ull*triangleCount;
-		{
-			size_t vertexDataSize = 3ull;
-			if (requiresNormals)
-				vertexDataSize += 3ull;
-			if (hasUVs)
-				vertexDataSize += 2ull;
-			if (hasColors)
-				vertexDataSize += 3ull;
-			vertexDataSize *= typeSize*vertexCount;
-			if (ptr+vertexDataSize > streamEnd)
-				continue;
-			size_t totalDataSize = vertexDataSize+indexDataSize;
-			if (ptr+totalDataSize > streamEnd)
-				continue;
-		}
+			return {};
+		const size_t indexCount = 3ull*triangleCount;
 
-		auto indexbuf = core::make_smart_refctd_ptr<asset::ICPUBuffer>(indexDataSize);
-		const uint32_t posAttrSize = typeSize*3u;
+		core::vector<double> doubleStaging(sourceIsDoubles ? (STAGING_VERTEX_COUNT*3u):0u);
+		core::vector<float> floatStaging(STAGING_VERTEX_COUNT*3u);
+
+		// positions always end up as single precision floats
+		constexpr size_t posAttrSize = sizeof(float)*3u;
 		auto posbuf = core::make_smart_refctd_ptr<asset::ICPUBuffer>(vertexCount*posAttrSize);
-		core::smart_refctd_ptr<asset::ICPUBuffer> normalbuf,uvbuf,colorbuf;
+		float* const posPtr = reinterpret_cast<float*>(posbuf->getPointer());
+		if (!inflateFloats(stream,sourceIsDoubles,posPtr,vertexCount*3u,doubleStaging.data()))
+			return {};
+		core::aabbox3df aabb;
+		aabb.reset(posPtr[0],posPtr[1],posPtr[2]);
+		for (uint64_t v=1ull; v<vertexCount; v++)
+			aabb.addInternalPoint(posPtr[v*3u+0u],posPtr[v*3u+1u],posPtr[v*3u+2u]);
+
+		using normal_t = CQuantNormalCache::value_type_t<EF_A2B10G10R10_SNORM_PACK32>;
+		core::smart_refctd_ptr<asset::ICPUBuffer> normalbuf;
 		if (requiresNormals)
-			normalbuf = core::make_smart_refctd_ptr<asset::ICPUBuffer>(sizeof(uint32_t)*vertexCount);
+			normalbuf = core::make_smart_refctd_ptr<asset::ICPUBuffer>(sizeof(normal_t)*vertexCount);
+		normal_t* const normalPtr = !normalbuf ? nullptr:reinterpret_cast<normal_t*>(normalbuf->getPointer());
+		// normals are only stored when they're per-vertex
+		if (hasVertexNormals)
+		{
+			auto quantizeNormals = [&](const float* normals, const uint64_t firstVertex, const uint32_t count) -> void
+			{
+				for (uint32_t v=0u; v<count; v++)
+					normalPtr[firstVertex+v] = quantNormalCache->quantize<EF_A2B10G10R10_SNORM_PACK32>(core::vectorSIMDf(normals[v*3u+0u],normals[v*3u+1u],normals[v*3u+2u]));
+			};
+			if (!inflateVec3Attribute(stream,sourceIsDoubles,vertexCount,floatStaging.data(),doubleStaging.data(),quantizeNormals))
+				return {};
+		}
+
 		// TODO: UV quantization and optimization (maybe lets just always use half floats?)
 		constexpr size_t uvAttrSize = sizeof(float)*2u;
+		core::smart_refctd_ptr<asset::ICPUBuffer> uvbuf;
 		if (hasUVs)
+		{
 			uvbuf = core::make_smart_refctd_ptr<asset::ICPUBuffer>(uvAttrSize*vertexCount);
+			if (!inflateFloats(stream,sourceIsDoubles,reinterpret_cast<float*>(uvbuf->getPointer()),vertexCount*2u,doubleStaging.data()))
+				return {};
+		}
+
+		core::smart_refctd_ptr<asset::ICPUBuffer> colorbuf;
 		if (hasColors)
+		{
 			colorbuf = core::make_smart_refctd_ptr<asset::ICPUBuffer>(sizeof(uint32_t)*vertexCount);
+			uint32_t* const colorPtr = reinterpret_cast<uint32_t*>(colorbuf->getPointer());
+			auto encodeColors = [colorPtr](const float* colors, const uint64_t firstVertex, const uint32_t count) -> void
+			{
+				for (uint32_t v=0u; v<count; v++)
+				{
+					const double color[3] = {colors[v*3u+0u],colors[v*3u+1u],colors[v*3u+2u]};
+					asset::encodePixels<asset::EF_B10G11R11_UFLOAT_PACK32,double>(colorPtr+firstVertex+v,color);
+				}
+			};
+			if (!inflateVec3Attribute(stream,sourceIsDoubles,vertexCount,floatStaging.data(),doubleStaging.data(),encodeColors))
+				return {};
+		}
 
-		void* posPtr = posbuf->getPointer();
-		CQuantNormalCache::value_type_t<EF_A2B10G10R10_SNORM_PACK32>* normalPtr = !normalbuf ? nullptr:reinterpret_cast<CQuantNormalCache::value_type_t<EF_A2B10G10R10_SNORM_PACK32>*>(normalbuf->getPointer());
-		unaligned_vec2* uvPtr = !uvbuf ? nullptr:reinterpret_cast<unaligned_vec2*>(uvbuf->getPointer());
-		uint32_t* colorPtr = !colorbuf ? nullptr:reinterpret_cast<uint32_t*>(colorbuf->getPointer());
-
-
-		auto meshBuffer = core::make_smart_refctd_ptr<asset::ICPUMeshBuffer>();
-		meshBuffer->setPositionAttributeIx(POSITION_ATTRIBUTE);
+		// indices get inflated straight into the buffer and narrowed if the vertex count allows
+		auto indexbuf = core::make_smart_refctd_ptr<asset::ICPUBuffer>(sizeof(uint32_t)*indexCount);
+		const uint32_t* const indexPtr = reinterpret_cast<const uint32_t*>(indexbuf->getPointer());
+		if (!stream.read(indexbuf->getPointer(),indexbuf->getSize()) || findMaxIndex(indexPtr,indexCount)>=vertexCount)
+			return {};
 
-		auto chooseShaderPath = [&]() -> std::string
+		// create per-face normals, vertices shared between faces get the normal of the last one
+		if (hasFaceNormals && !hasVertexNormals)
 		{
-			if (!hasColors)
+			auto getPosition = [posPtr](const uint32_t ix) -> core::vectorSIMDf
+			{
+				return core::vectorSIMDf(posPtr[ix*3u+0u],posPtr[ix*3u+1u],posPtr[ix*3u+2u]);
+			};
+			for (size_t j=0ull; j<indexCount; j+=3ull)
 			{
-				if (hasUVs)
-					return "nbl/builtin/material/debug/vertex_uv/specialized_shader";
-				if (requiresNormals)
-					return "nbl/builtin/material/debug/vertex_normal/specialized_shader";
+				const uint32_t* triangleIndices = indexPtr+j;
+				const auto pos0 = getPosition(triangleIndices[0]);
+				const auto normal = core::normalize(core::cross(getPosition(triangleIndices[1])-pos0,getPosition(triangleIndices[2])-pos0));
+				const auto quantized = quantNormalCache->quantize<EF_A2B10G10R10_SNORM_PACK32>(normal);
+				for (uint64_t k=0ull; k<3ull; k++)
+					normalPtr[triangleIndices[k]] = quantized;
 			}
-			return "nbl/builtin/material/debug/vertex_color/specialized_shader"; // if only positions are present, shaders with debug vertex colors are assumed
-		};
-		
-		core::smart_refctd_ptr<ICPUSpecializedShader> mbVertexShader;
-		core::smart_refctd_ptr<ICPUSpecializedShader> mbFragmentShader;
-		{
-			const IAsset::E_TYPE types[]{ IAsset::E_TYPE::ET_SPECIALIZED_SHADER, IAsset::E_TYPE::ET_SPECIALIZED_SHADER, static_cast<IAsset::E_TYPE>(0u) };
-			const std::string basepath = chooseShaderPath();
+		}
 
-			auto bundle = m_assetMgr->findAssets(basepath+".vert", types);
-			mbVertexShader = core::smart_refctd_ptr_static_cast<ICPUSpecializedShader>(bundle->begin()->getContents().begin()[0]);
-			bundle = m_assetMgr->findAssets(basepath+".frag", types);
-			mbFragmentShader = core::smart_refctd_ptr_static_cast<ICPUSpecializedShader>(bundle->begin()->getContents().begin()[0]);
+		asset::E_INDEX_TYPE indexType = asset::EIT_32BIT;
+		if (vertexCount<=0x10000ull)
+		{
+			auto narrowedbuf = core::make_smart_refctd_ptr<asset::ICPUBuffer>(sizeof(uint16_t)*indexCount);
+			narrowIndices(reinterpret_cast<uint16_t*>(narrowedbuf->getPointer()),indexPtr,indexCount);
+			indexbuf = std::move(narrowedbuf);
+			indexType = asset::EIT_16BIT;
 		}
-		auto mbPipelineLayout = _override->findDefaultAsset<ICPUPipelineLayout>("nbl/builtin/material/lambertian/no_texture/pipeline_layout",ctx.inner,_hierarchyLevel+ICPUMesh::PIPELINE_LAYOUT_HIERARCHYLEVELS_BELOW).first;
 
 
+		auto meshBuffer = core::make_smart_refctd_ptr<asset::ICPUMeshBuffer>();
+
+		E_SHADER_PATH shaderPath = ESP_VERTEX_COLOR;
+		if (!hasColors)
+		{
+			if (hasUVs)
+				shaderPath = ESP_VERTEX_UV;
+			else if (requiresNormals)
+				shaderPath = ESP_VERTEX_NORMAL;
+		}
+
 		asset::SBlendParams blendParams;
 		asset::SRasterizationParams rastarizationParams;
 		asset::SPrimitiveAssemblyParams primitiveAssemblyParams;
@@ -293,159 +421,56 @@ asset::SAssetBundle CSerializedLoader::loadAsset(system::IFile* _file, const ass
 		};
 
 		meshBuffer->setPositionAttributeIx(POSITION_ATTRIBUTE);
-		enableAttribute(POSITION_ATTRIBUTE,sourceIsDoubles ? asset::EF_R64G64B64_SFLOAT:asset::EF_R32G32B32_SFLOAT,posbuf);
-		{
-			core::aabbox3df aabb;
-			auto readPositions = [&aabb,ptr,posPtr](const auto& pos) -> void
-			{
-				size_t vertexIx = std::distance(reinterpret_cast<decltype(&pos)>(ptr),&pos);
-				const auto* coords = pos.pointer;
-				if (vertexIx)
-					aabb.addInternalPoint(coords[0],coords[1],coords[2]);
-				else
-					aabb.reset(coords[0],coords[1],coords[2]);
-				reinterpret_cast<std::remove_const_t<std::remove_reference_t<decltype(pos)>>*>(posPtr)[vertexIx] = pos;
-			};
-			if (sourceIsDoubles)
-			{
-				auto*& typedPtr = reinterpret_cast<unaligned_dvec3*&>(ptr);
-				std::for_each_n(core::execution::seq,typedPtr,vertexCount,readPositions);
-				typedPtr += vertexCount;
-			}
-			else
-			{
-				auto*& typedPtr = reinterpret_cast<unaligned_vec3*&>(ptr);
-				std::for_each_n(core::execution::seq,typedPtr,vertexCount,readPositions);
-				typedPtr += vertexCount;
-			}
-			meshBuffer->setBoundingBox(aabb);
-		}
+		enableAttribute(POSITION_ATTRIBUTE,asset::EF_R32G32B32_SFLOAT,posbuf);
+		meshBuffer->setBoundingBox(aabb);
 		if (requiresNormals)
 		{
 			enableAttribute(NORMAL_ATTRIBUTE,asset::EF_A2B10G10R10_SNORM_PACK32,normalbuf);
-			auto readNormals = [quantNormalCache,ptr,normalPtr](const auto& nml) -> void
-			{
-				size_t vertexIx = std::distance(reinterpret_cast<decltype(&nml)>(ptr),&nml);
-				core::vectorSIMDf simdNormal(nml.pointer[0],nml.pointer[1],nml.pointer[2]);
-				normalPtr[vertexIx] = quantNormalCache->quantize<EF_A2B10G10R10_SNORM_PACK32>(simdNormal);
-			};
-			const bool read = flags&MF_PER_VERTEX_NORMALS;
-			if (sourceIsDoubles)
-			{
-				auto*& typedPtr = reinterpret_cast<unaligned_dvec3*&>(ptr);
-				if (read)
-					std::for_each_n(core::execution::seq,typedPtr,vertexCount,readNormals);
-				typedPtr += vertexCount;
-			}
-			else
-			{
-				auto*& typedPtr = reinterpret_cast<unaligned_vec3*&>(ptr);
-				if (read)
-					std::for_each_n(core::execution::seq,typedPtr,vertexCount,readNormals);
-				typedPtr += vertexCount;
-			}
 			meshBuffer->setNormalAttributeIx(NORMAL_ATTRIBUTE);
 		}
 		if (hasUVs)
-		{
 			enableAttribute(UV_ATTRIBUTE,asset::EF_R32G32_SFLOAT,uvbuf);
-			auto readUVs = [ptr,uvPtr](const auto& uv) -> void
-			{
-				size_t vertexIx = std::distance(reinterpret_cast<decltype(&uv)>(ptr),&uv);
-				for (auto k=0u; k<2u; k++)
-					uvPtr[vertexIx].pointer[k] = uv.pointer[k];
-			};
-			if (sourceIsDoubles)
-			{
-				auto*& typedPtr = reinterpret_cast<unaligned_dvec2*&>(ptr);
-				std::for_each_n(core::execution::seq,typedPtr,vertexCount,readUVs);
-				typedPtr += vertexCount;
-			}
-			else
-			{
-				auto*& typedPtr = reinterpret_cast<unaligned_vec2*&>(ptr);
-				std::for_each_n(core::execution::seq,typedPtr,vertexCount,readUVs);
-				typedPtr += vertexCount;
-			}
-		}
 		if (hasColors)
-		{
 			enableAttribute(COLOR_ATTRIBUTE,asset::EF_B10G11R11_UFLOAT_PACK32,colorbuf);
-			auto readColors = [ptr,colorPtr](const auto& color) -> void
-			{
-				size_t vertexIx = std::distance(reinterpret_cast<decltype(&color)>(ptr),&color);
-				const double colors[3] = {color.pointer[0],color.pointer[1],color.pointer[2]};
-				asset::encodePixels<asset::EF_B10G11R11_UFLOAT_PACK32,double>(colorPtr+vertexIx,colors);
-			};
-			if (sourceIsDoubles)
-			{
-				auto*& typedPtr = reinterpret_cast<unaligned_dvec3*&>(ptr);
-				std::for_each_n(core::execution::seq,typedPtr,vertexCount,readColors);
-				typedPtr += vertexCount;
-			}
-			else
-			{
-				auto*& typedPtr = reinterpret_cast<unaligned_vec3*&>(ptr);
-				std::for_each_n(core::execution::seq,typedPtr,vertexCount,readColors);
-				typedPtr += vertexCount;
-			}
-		}
-
-		auto mbPipeline = core::make_smart_refctd_ptr<asset::ICPURenderpassIndependentPipeline>(std::move(mbPipelineLayout), nullptr, nullptr, inputParams, blendParams, primitiveAssemblyParams, rastarizationParams);
-		mbPipeline->setShaderAtStage(asset::ISpecializedShader::E_SHADER_STAGE::ESS_VERTEX, mbVertexShader.get());
-		mbPipeline->setShaderAtStage(asset::ISpecializedShader::E_SHADER_STAGE::ESS_FRAGMENT, mbFragmentShader.get());
-
-		meshBuffer->setIndexBufferBinding({0u,indexbuf});
-		meshBuffer->setIndexCount(triangleCount * 3u);
-		meshBuffer->setIndexType(asset::EIT_32BIT);
-
-		// read indices and possibly create per-face normals
-		auto readIndices = [&]() -> bool
-		{
-			uint32_t* indexPtr = reinterpret_cast<uint32_t*>(indexbuf->getPointer());
-			for (uint64_t j=0ull; j<triangleCount; j++)
-			{
-				uint32_t* triangleIndices = indexPtr;
-				for (uint64_t k=0ull; k<3ull; k++)
-				{
-					triangleIndices[k] = *(reinterpret_cast<uint32_t*&>(ptr)++);
-					if (triangleIndices[k] >= static_cast<uint32_t>(vertexCount))
-						return false;
-				}
-				indexPtr += 3u;
 
-				if (flags & MF_FACE_NORMALS)
-				{
-					core::vectorSIMDf pos[3];
-					for (uint64_t k=0ull; k<3ull; k++)
-						pos[k] = meshBuffer->getPosition(triangleIndices[k]);
-					auto normal = core::cross(pos[1]-pos[0],pos[2]-pos[0]);
-					for (uint64_t k=0ull; k<3ull; k++)
-						meshBuffer->setAttribute(normal,NORMAL_ATTRIBUTE,k);
-				}
-			}
-			return true;
-		};
-		if (!readIndices())
-			continue;
+		auto mbPipeline = core::make_smart_refctd_ptr<asset::ICPURenderpassIndependentPipeline>(core::smart_refctd_ptr(mbPipelineLayout), nullptr, nullptr, inputParams, blendParams, primitiveAssemblyParams, rastarizationParams);
+		mbPipeline->setShaderAtStage(asset::IShader::ESS_VERTEX, shaders[shaderPath].first.get());
+		mbPipeline->setShaderAtStage(asset::IShader::ESS_FRAGMENT, shaders[shaderPath].second.get());
 
+		meshBuffer->setIndexBufferBinding({0u,std::move(indexbuf)});
+		meshBuffer->setIndexCount(indexCount);
+		meshBuffer->setIndexType(indexType);
+		meshBuffer->setPipeline(std::move(mbPipeline));
 
 		auto mesh = core::make_smart_refctd_ptr<asset::ICPUMesh>();
+		mesh->setBoundingBox(meshBuffer->getBoundingBox());
+		mesh->getMeshBufferVector().emplace_back(std::move(meshBuffer));
+		return {std::move(mesh),std::move(name)};
+	};
 
-		meta->placeMeta(meshes.size(),mbPipeline.get(),mesh.get(),{std::string(stringPtr,stringLen),i});
+	// every mesh is an independent zlib stream, so decode them all at once
+	core::vector<SDecodedMesh> decoded(ctx.meshCount);
+	core::for_each(core::execution::par,decoded.begin(),decoded.end(),[&](SDecodedMesh& out) -> void
+	{
+		out = decodeMesh(static_cast<uint32_t>(&out-decoded.data()));
+	});
 
-		meshBuffer->setPipeline(std::move(mbPipeline));
+	// metadata and output order stay the same as in the file
+	auto meta = core::make_smart_refctd_ptr<CMitsubaSerializedMetadata>(ctx.meshCount,core::smart_refctd_ptr(IRenderpassIndependentPipelineLoader::m_basicViewParamsSemantics));
+	core::vector<core::smart_refctd_ptr<ICPUMesh>> meshes; meshes.reserve(ctx.meshCount);
+	for (uint32_t i=0; i<ctx.meshCount; i++)
+	{
+		auto& mesh = decoded[i].mesh;
+		if (!mesh)
+			continue;
 
-		mesh->setBoundingBox(meshBuffer->getBoundingBox());
-		mesh->getMeshBufferVector().emplace_back(std::move(meshBuffer));
+		meta->placeMeta(meshes.size(),mesh->getMeshBufferVector().front()->getPipeline(),mesh.get(),{std::move(decoded[i].name),i});
 		meshes.push_back(std::move(mesh));
 	}
-	_NBL_ALIGNED_FREE(data);
 
 	return SAssetBundle(std::move(meta),std::move(meshes));
 }
 
-
 }
 }
 }
@@ -0,0 +1,253 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/scene/CCPUAnimationEngine.h"
+
+#include <numeric>
+
+#include "nbl/core/execution.h"
+#include "nbl/asset/utils/IMeshManipulator.h"
+
+using namespace nbl;
+using namespace scene;
+
+
+auto CCPUAnimationEngine::sample(const animation_t animation, const timestamp_t time, uint32_t* keyframeCursor) const -> SFatKeyframe
+{
+	const auto& anim = m_library->getAnimation(animation);
+	const uint32_t keyframeCount = anim.getKeyframeCount();
+	if (keyframeCount==0u)
+		return {};
+
+	const Keyframe* keyframes = &m_library->getKeyframe(anim.getKeyframeOffset());
+	const timestamp_t* timestamps = &m_library->getTimestamp(anim.getTimestampOffset());
+	// clamp to the ends of the animation
+	const uint32_t lastKeyframe = keyframeCount-1u;
+	if (time<=timestamps[0])
+	{
+		if (keyframeCursor)
+			*keyframeCursor = 0u;
+		return keyframes[0];
+	}
+	if (time>=timestamps[lastKeyframe])
+	{
+		if (keyframeCursor)
+			*keyframeCursor = lastKeyframe;
+		return keyframes[lastKeyframe];
+	}
+
+	// find the keyframe `k` such that `timestamps[k]<=time<timestamps[k+1]`, first try where we were last time and the one after
+	auto brackets = [&](const uint32_t k) -> bool {return k<lastKeyframe && timestamps[k]<=time && time<timestamps[k+1u];};
+	uint32_t k;
+	if (keyframeCursor && brackets(*keyframeCursor))
+		k = *keyframeCursor;
+	else if (keyframeCursor && brackets(*keyframeCursor+1u))
+		k = *keyframeCursor+1u;
+	else
+		k = std::upper_bound(timestamps,timestamps+keyframeCount,time)-timestamps-1u;
+	if (keyframeCursor)
+		*keyframeCursor = k;
+
+	const float fraction = float(time-timestamps[k])/float(timestamps[k+1u]-timestamps[k]);
+	const auto interpolationMode = anim.getInterpolationMode();
+	if (interpolationMode==Animation::EIM_NEAREST)
+		return keyframes[fraction<0.5f ? k:(k+1u)];
+
+	const SFatKeyframe start(keyframes[k]), end(keyframes[k+1u]);
+	SFatKeyframe result;
+	switch (m_rotationInterpolation)
+	{
+		case ERI_NLERP:
+			result.rotation = core::quaternion::normalize(core::quaternion::lerp(start.rotation,end.rotation,fraction));
+			break;
+		case ERI_SLERP:
+			result.rotation = core::quaternion::slerp(start.rotation,end.rotation,fraction);
+			break;
+		default:
+			result.rotation = core::quaternion::normalize(core::quaternion::flerp(start.rotation,end.rotation,fraction));
+			break;
+	}
+	if (interpolationMode==Animation::EIM_CUBIC)
+	{
+		// the keyframes don't store any tangents, so use a Catmull-Rom spline through the neighbouring keyframes
+		const SFatKeyframe before(keyframes[k ? (k-1u):k]), after(keyframes[core::min(k+2u,lastKeyframe)]);
+		auto catmullRom = [fraction](const core::vectorSIMDf& p0, const core::vectorSIMDf& p1, const core::vectorSIMDf& p2, const core::vectorSIMDf& p3) -> core::vectorSIMDf
+		{
+			const core::vectorSIMDf a = p1*2.f;
+			const core::vectorSIMDf b = p2-p0;
+			const core::vectorSIMDf c = p0*2.f-p1*5.f+p2*4.f-p3;
+			const core::vectorSIMDf d = (p1-p2)*3.f+p3-p0;
+			return (a+(b+(c+d*fraction)*fraction)*fraction)*0.5f;
+		};
+		result.scale = catmullRom(before.scale,start.scale,end.scale,after.scale);
+		result.translation = catmullRom(before.translation,start.translation,end.translation,after.translation);
+	}
+	else
+	{
+		result.scale = core::mix(start.scale,end.scale,core::vectorSIMDf(fraction));
+		result.translation = core::mix(start.translation,end.translation,core::vectorSIMDf(fraction));
+	}
+	return result;
+}
+
+bool CCPUAnimationEngine::sample(const SInstance* begin, const SInstance* end) const
+{
+	for (auto it=begin; it!=end; it++)
+	if (!it->skeleton || !it->outJointTransforms || (it->skeleton->getJointCount() && !it->skeleton->getParentJointIDBinding().buffer))
+		return false;
+
+	const uint32_t animationCapacity = m_library->getAnimationCapacity();
+	core::for_each(core::execution::par,begin,end,[&](const SInstance& instance) -> void
+	{
+		const auto* skeleton = instance.skeleton;
+		const uint32_t jointCount = skeleton->getJointCount();
+		auto* const outJointTransforms = instance.outJointTransforms;
+
+		// sample the relative transforms into the output first, then compose them in place
+		bool parentsFirst = true;
+		for (joint_id_t j=0u; j<jointCount; j++)
+		{
+			const animation_t animation = instance.jointAnimations ? instance.jointAnimations[j]:invalid_animation;
+			if (animation<animationCapacity)
+				outJointTransforms[j] = sample(animation,instance.time,instance.keyframeCursors ? (instance.keyframeCursors+j):nullptr).constructMatrix();
+			else
+				outJointTransforms[j] = skeleton->getDefaultTransformMatrix(j);
+			if (instance.outRelativeTransforms)
+				instance.outRelativeTransforms[j] = outJointTransforms[j];
+
+			const auto parent = skeleton->getParentJointID(j);
+			if (parent!=asset::ICPUSkeleton::invalid_joint_id && parent>=j)
+				parentsFirst = false;
+		}
+
+		if (parentsFirst) // common case, the parent transform is always final by the time we get to its children
+		{
+			for (joint_id_t j=0u; j<jointCount; j++)
+			{
+				const auto parent = skeleton->getParentJointID(j);
+				if (parent!=asset::ICPUSkeleton::invalid_joint_id)
+					outJointTransforms[j] = core::matrix3x4SIMD::concatenateBFollowedByA(outJointTransforms[parent],outJointTransforms[j]);
+			}
+			return;
+		}
+
+		// otherwise walk up to the first finished ancestor and compose back down
+		core::vector<bool> done(jointCount,false);
+		core::vector<joint_id_t> chain;
+		for (joint_id_t j=0u; j<jointCount; j++)
+		{
+			for (auto joint=j; joint!=asset::ICPUSkeleton::invalid_joint_id && !done[joint]; joint=skeleton->getParentJointID(joint))
+			{
+				assert(chain.size()<jointCount); // cycle in the hierarchy
+				chain.push_back(joint);
+			}
+			while (!chain.empty())
+			{
+				const auto joint = chain.back();
+				chain.pop_back();
+				const auto parent = skeleton->getParentJointID(joint);
+				if (parent!=asset::ICPUSkeleton::invalid_joint_id)
+					outJointTransforms[joint] = core::matrix3x4SIMD::concatenateBFollowedByA(outJointTransforms[parent],outJointTransforms[joint]);
+				done[joint] = true;
+			}
+		}
+	});
+	return true;
+}
+
+bool CCPUAnimationEngine::skinMeshBuffer(asset::ICPUMeshBuffer* meshbuffer, const core::matrix3x4SIMD* jointTransforms, const joint_id_t* translationTable)
+{
+	if (!meshbuffer || !jointTransforms || !meshbuffer->isSkinned())
+		return false;
+
+	const uint32_t posAttrId = meshbuffer->getPositionAttributeIx();
+	if (!meshbuffer->isAttributeEnabled(posAttrId) || !meshbuffer->getAttribBoundBuffer(posAttrId).buffer)
+		return false;
+	const uint32_t normalAttrId = meshbuffer->getNormalAttributeIx();
+	const bool skinNormals = meshbuffer->isAttributeEnabled(normalAttrId) && meshbuffer->getAttribBoundBuffer(normalAttrId).buffer;
+	const uint32_t jointIDAttrId = meshbuffer->getJointIDAttributeIx();
+	const uint32_t jointWeightAttrId = meshbuffer->getJointWeightAttributeIx();
+	const bool hasWeights = meshbuffer->isAttributeEnabled(jointWeightAttrId);
+
+	const uint32_t jointCount = meshbuffer->getJointCount();
+	const auto* inverseBindPoses = meshbuffer->getInverseBindPoses();
+	core::vector<core::matrix3x4SIMD> skinningTransforms(jointCount);
+	for (uint32_t j=0u; j<jointCount; j++)
+		skinningTransforms[j] = core::matrix3x4SIMD::concatenateBFollowedByA(jointTransforms[translationTable ? translationTable[j]:j],inverseBindPoses[j]);
+
+	const uint32_t maxInfluences = core::min(meshbuffer->deduceMaxJointsPerVertex(),meshbuffer->getMaxJointsPerVertex());
+	const uint32_t maxWeights = hasWeights ? asset::getFormatChannelCount(meshbuffer->getAttribFormat(jointWeightAttrId)):0u;
+	const uint32_t vertexCount = asset::IMeshManipulator::upperBoundVertexID(meshbuffer);
+
+	struct SAttribute
+	{
+		SAttribute(asset::ICPUMeshBuffer* meshbuffer, const uint32_t attrId) :
+			ptr(meshbuffer->getAttribPointer(attrId)), stride(meshbuffer->getAttribStride(attrId)), format(meshbuffer->getAttribFormat(attrId)) {}
+
+		inline uint8_t* operator[](const uint32_t vertex) const {return ptr+size_t(vertex)*stride;}
+
+		uint8_t* ptr;
+		uint32_t stride;
+		asset::E_FORMAT format;
+	};
+	const SAttribute position(meshbuffer,posAttrId), jointIDs(meshbuffer,jointIDAttrId);
+	const SAttribute normal = skinNormals ? SAttribute(meshbuffer,normalAttrId):position;
+	const SAttribute jointWeights = hasWeights ? SAttribute(meshbuffer,jointWeightAttrId):position;
+
+	constexpr uint32_t MinChunkSize = 0x1u<<12u;
+	const uint32_t chunkCount = core::max(vertexCount/MinChunkSize,1u);
+	core::vector<uint32_t> chunks(chunkCount);
+	std::iota(chunks.begin(),chunks.end(),0u);
+	core::for_each(core::execution::par,chunks.begin(),chunks.end(),[&](const uint32_t chunk) -> void
+	{
+		const uint32_t vertexEnd = uint64_t(vertexCount)*(chunk+1u)/chunkCount;
+		for (uint32_t v=uint64_t(vertexCount)*chunk/chunkCount; v<vertexEnd; v++)
+		{
+			uint32_t ids[4] = {~0u,~0u,~0u,~0u};
+			asset::ICPUMeshBuffer::getAttribute(ids,jointIDs[v],jointIDs.format);
+			core::vectorSIMDf weights(0.f);
+			if (hasWeights)
+				asset::ICPUMeshBuffer::getAttribute(weights,jointWeights[v],jointWeights.format);
+
+			// blend the matrices, like the GLSL skinning functions do
+			core::matrix3x4SIMD skinningTransform;
+			skinningTransform.rows[2] = skinningTransform.rows[1] = skinningTransform.rows[0] = core::vectorSIMDf(0.f);
+			bool influenced = false;
+			float weightRemainder = 1.f;
+			for (uint32_t i=0u; i<maxInfluences; i++)
+			{
+				const float weight = i<maxWeights ? weights[i]:weightRemainder;
+				if (ids[i]<jointCount && weight>FLT_MIN)
+				{
+					skinningTransform += skinningTransforms[ids[i]]*weight;
+					influenced = true;
+				}
+				if (i<maxWeights)
+					weightRemainder -= weights[i];
+			}
+			// leave the vertices without any joint influence in model space
+			if (!influenced)
+				continue;
+
+			core::vectorSIMDf pos;
+			asset::ICPUMeshBuffer::getAttribute(pos,position[v],position.format);
+			skinningTransform.pseudoMulWith4x1(pos);
+			asset::ICPUMeshBuffer::setAttribute(pos,position[v],position.format);
+
+			if (skinNormals)
+			{
+				core::vectorSIMDf n;
+				asset::ICPUMeshBuffer::getAttribute(n,normal[v],normal.format);
+				const auto cofactors = skinningTransform.getSub3x3TransposeCofactors();
+				cofactors.mulSub3x3WithNx1(n);
+				// same as `nbl_glsl_fastNormalTransform`, flip if the transform mirrors
+				n = core::normalize(n);
+				if (core::dot(skinningTransform.rows[0],cofactors.rows[0]).x<0.f)
+					n = -n;
+				asset::ICPUMeshBuffer::setAttribute(n,normal[v],normal.format);
+			}
+		}
+	});
+	return true;
+}
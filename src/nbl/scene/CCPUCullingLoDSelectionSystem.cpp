@@ -0,0 +1,419 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/scene/CCPUCullingLoDSelectionSystem.h"
+
+#include "nbl/core/execution.h"
+
+#include <atomic>
+
+using namespace nbl;
+using namespace scene;
+
+
+namespace
+{
+
+constexpr uint32_t ParallelChunkSize = 0x1u<<12u;
+constexpr uint32_t MaxParallelChunks = 256u;
+
+// the 6 planes of an NDC of [-1,1]^2 x [0,1], same as `nbl_glsl_shapes_Frustum_extract`, a point is inside if `dot(plane,vec4(p,1))>0` for all
+inline void extractFrustumPlanes(const core::matrix4SIMD& proj, core::vectorSIMDf (&planes)[6])
+{
+	planes[0] = proj.rows[3]+proj.rows[0];
+	planes[1] = proj.rows[3]+proj.rows[1];
+	planes[2] = proj.rows[2];
+	planes[3] = proj.rows[3]-proj.rows[0];
+	planes[4] = proj.rows[3]-proj.rows[1];
+	planes[5] = proj.rows[3]-proj.rows[2];
+}
+
+inline __m128 abs_ps(const __m128 v)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.f),v);
+}
+
+// the 6 planes transposed into 2 batches of 4, for testing one box against all planes at once
+struct SFrustumSoA
+{
+	SFrustumSoA(const core::matrix4SIMD& mvp)
+	{
+		core::vectorSIMDf planes[6];
+		extractFrustumPlanes(mvp,planes);
+		for (uint32_t i=0u; i<2u; i++)
+		{
+			// second batch tests planes 4 and 5 twice
+			__m128 p0 = planes[i*4u].getAsRegister();
+			__m128 p1 = planes[i*4u+1u].getAsRegister();
+			__m128 p2 = planes[i ? 4u:2u].getAsRegister();
+			__m128 p3 = planes[i ? 5u:3u].getAsRegister();
+			_MM_TRANSPOSE4_PS(p0,p1,p2,p3);
+			x[i] = p0;
+			y[i] = p1;
+			z[i] = p2;
+			w[i] = p3;
+		}
+	}
+
+	// same as `nbl_glsl_shapes_Frustum_fastestDoesNotIntersectAABB`, the farthest point in front of any plane is behind it
+	inline bool cullsAABB(const core::vectorSIMDf& aabbMin, const core::vectorSIMDf& aabbMax) const
+	{
+		const core::vectorSIMDf center = (aabbMax+aabbMin)*0.5f;
+		const core::vectorSIMDf extent = (aabbMax-aabbMin)*0.5f;
+		const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+		const __m128 ex = _mm_set1_ps(extent.x), ey = _mm_set1_ps(extent.y), ez = _mm_set1_ps(extent.z);
+		int culled = 0;
+		for (uint32_t i=0u; i<2u; i++)
+		{
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x[i],cx),_mm_mul_ps(y[i],cy)),_mm_add_ps(_mm_mul_ps(z[i],cz),w[i]));
+			d = _mm_add_ps(d,_mm_add_ps(_mm_add_ps(_mm_mul_ps(abs_ps(x[i]),ex),_mm_mul_ps(abs_ps(y[i]),ey)),_mm_mul_ps(abs_ps(z[i]),ez)));
+			culled |= _mm_movemask_ps(_mm_cmple_ps(d,_mm_setzero_ps()));
+		}
+		return culled;
+	}
+
+	__m128 x[2], y[2], z[2], w[2];
+};
+
+}
+
+
+bool CCPUCullingLoDSelectionSystem::HiZBuffer::build(const float* depth, const uint32_t width, const uint32_t height, const bool reverseZ)
+{
+	m_mips.clear();
+	if (!depth || width==0u || height==0u)
+		return false;
+	m_reverseZ = reverseZ;
+
+	auto& base = m_mips.emplace_back();
+	base.width = width;
+	base.height = height;
+	base.texels.resize(size_t(width)*height);
+	const float sign = reverseZ ? -1.f:1.f;
+	for (size_t i=0u; i<base.texels.size(); i++)
+		base.texels[i] = depth[i]*sign;
+
+	// every mip rounds up, so a texel of level `k` covers exactly the level 0 texels `x>>k==X`
+	while (m_mips.back().width>1u || m_mips.back().height>1u)
+	{
+		const auto& prev = m_mips.back();
+		SMip mip;
+		mip.width = (prev.width+1u)>>1u;
+		mip.height = (prev.height+1u)>>1u;
+		mip.texels.resize(size_t(mip.width)*mip.height);
+		for (uint32_t y=0u; y<mip.height; y++)
+		{
+			const float* row0 = prev.texels.data()+size_t(y<<1u)*prev.width;
+			const float* row1 = prev.texels.data()+size_t(std::min((y<<1u)+1u,prev.height-1u))*prev.width;
+			for (uint32_t x=0u; x<mip.width; x++)
+			{
+				const uint32_t x0 = x<<1u;
+				const uint32_t x1 = std::min(x0+1u,prev.width-1u);
+				mip.texels[size_t(y)*mip.width+x] = std::max(std::max(row0[x0],row0[x1]),std::max(row1[x0],row1[x1]));
+			}
+		}
+		m_mips.push_back(std::move(mip));
+	}
+	return true;
+}
+
+bool CCPUCullingLoDSelectionSystem::HiZBuffer::isOccluded(const core::matrix4SIMD& mvp, const core::vectorSIMDf& aabbMin, const core::vectorSIMDf& aabbMax) const
+{
+	if (m_mips.empty())
+		return false;
+
+	// all 8 corners in 2 batches
+	const __m128 cx = _mm_setr_ps(aabbMin.x,aabbMax.x,aabbMin.x,aabbMax.x);
+	const __m128 cy = _mm_setr_ps(aabbMin.y,aabbMin.y,aabbMax.y,aabbMax.y);
+	const __m128 cz[2] = {_mm_set1_ps(aabbMin.z),_mm_set1_ps(aabbMax.z)};
+	auto transform = [&](const core::vectorSIMDf& row, const __m128 z) -> __m128
+	{
+		return _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(row.x),cx),_mm_mul_ps(_mm_set1_ps(row.y),cy)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(row.z),z),_mm_set1_ps(row.w))
+		);
+	};
+	__m128 minX,minY,minZ,maxX,maxY,maxZ;
+	for (uint32_t i=0u; i<2u; i++)
+	{
+		const __m128 w = transform(mvp.rows[3],cz[i]);
+		// the box crosses the camera plane, the projected rectangle would be bogus
+		if (_mm_movemask_ps(_mm_cmple_ps(w,_mm_setzero_ps())))
+			return false;
+		const __m128 rcpW = _mm_div_ps(_mm_set1_ps(1.f),w);
+		const __m128 x = _mm_mul_ps(transform(mvp.rows[0],cz[i]),rcpW);
+		const __m128 y = _mm_mul_ps(transform(mvp.rows[1],cz[i]),rcpW);
+		const __m128 z = _mm_mul_ps(transform(mvp.rows[2],cz[i]),rcpW);
+		if (i)
+		{
+			minX = _mm_min_ps(minX,x); maxX = _mm_max_ps(maxX,x);
+			minY = _mm_min_ps(minY,y); maxY = _mm_max_ps(maxY,y);
+			minZ = _mm_min_ps(minZ,z); maxZ = _mm_max_ps(maxZ,z);
+		}
+		else
+		{
+			minX = maxX = x;
+			minY = maxY = y;
+			minZ = maxZ = z;
+		}
+	}
+	auto hmin = [](const __m128 v) -> float
+	{
+		const __m128 m = _mm_min_ps(v,_mm_shuffle_ps(v,v,_MM_SHUFFLE(1,0,3,2)));
+		return _mm_cvtss_f32(_mm_min_ps(m,_mm_shuffle_ps(m,m,_MM_SHUFFLE(2,3,0,1))));
+	};
+	auto hmax = [](const __m128 v) -> float
+	{
+		const __m128 m = _mm_max_ps(v,_mm_shuffle_ps(v,v,_MM_SHUFFLE(1,0,3,2)));
+		return _mm_cvtss_f32(_mm_max_ps(m,_mm_shuffle_ps(m,m,_MM_SHUFFLE(2,3,0,1))));
+	};
+
+	const auto& base = m_mips.front();
+	const float u0 = (hmin(minX)*0.5f+0.5f)*float(base.width);
+	const float u1 = (hmax(maxX)*0.5f+0.5f)*float(base.width);
+	const float v0 = (hmin(minY)*0.5f+0.5f)*float(base.height);
+	const float v1 = (hmax(maxY)*0.5f+0.5f)*float(base.height);
+	// nothing to compare against, don't cull what frustum culling let through
+	if (!(u1>=0.f && v1>=0.f && u0<float(base.width) && v0<float(base.height)))
+		return false;
+	const uint32_t x0 = u0>0.f ? uint32_t(u0):0u;
+	const uint32_t y0 = v0>0.f ? uint32_t(v0):0u;
+	const uint32_t x1 = std::min(uint32_t(u1),base.width-1u);
+	const uint32_t y1 = std::min(uint32_t(v1),base.height-1u);
+	const float nearest = m_reverseZ ? -hmax(maxZ):hmin(minZ);
+
+	// coarsest level where the rectangle touches at most 2x2 texels
+	uint32_t level = 0u;
+	while (((x1>>level)-(x0>>level))>1u || ((y1>>level)-(y0>>level))>1u)
+		level++;
+	const auto& mip = m_mips[level];
+	float farthest = -FLT_MAX;
+	for (uint32_t y=y0>>level; y<=(y1>>level); y++)
+	for (uint32_t x=x0>>level; x<=(x1>>level); x++)
+		farthest = std::max(farthest,mip.texels[size_t(y)*mip.width+x]);
+	return nearest>farthest;
+}
+
+bool CCPUCullingLoDSelectionSystem::processInstancesAndFillIndirectDraws(const Params& params, Counts& outCounts)
+{
+	outCounts = {};
+	if (!params.lodTables || !params.lodInfos || !params.instanceTransforms || !params.drawCommands || !params.outPerViewPerInstanceMVPs)
+		return false;
+	if (params.instanceList.end()<params.instanceList.begin() || params.drawcallsToScan.end()<params.drawcallsToScan.begin())
+		return false;
+
+	auto* const drawCommands = params.drawCommands;
+	// clear the instance counts like the first dispatch does
+	for (const auto drawcallDWORDOffset : params.drawcallsToScan)
+		drawCommands[(drawcallDWORDOffset&0x7fffffffu)+1u] = 0u;
+
+	const uint32_t instanceCount = params.instanceList.size();
+	const uint32_t chunkCount = std::clamp(instanceCount/ParallelChunkSize,1u,MaxParallelChunks);
+	m_chunks.resize(chunkCount);
+	for (uint32_t i=0u; i<chunkCount; i++)
+	{
+		auto& chunk = m_chunks[i];
+		chunk.begin = uint64_t(instanceCount)*i/chunkCount;
+		chunk.end = uint64_t(instanceCount)*(i+1u)/chunkCount;
+		// keep the allocations around for the next call
+		chunk.instances.clear();
+		chunk.draws.clear();
+	}
+
+	const auto* const instances = params.instanceList.begin();
+	const auto* const lodTables = reinterpret_cast<const uint8_t*>(params.lodTables);
+	const auto* const lodInfos = reinterpret_cast<const uint8_t*>(params.lodInfos);
+	auto getTable = [lodTables](const uint32_t lodTableUvec4Offset) -> const LoDTableInfo*
+	{
+		return reinterpret_cast<const LoDTableInfo*>(lodTables+lodTableUvec4Offset*sizeof(uint32_t)*4u);
+	};
+	auto getLoDInfo = [lodInfos](const uint32_t lodInfoUvec2Offset) -> const LoDInfo*
+	{
+		return reinterpret_cast<const LoDInfo*>(lodInfos+lodInfoUvec2Offset*sizeof(uint32_t)*2u);
+	};
+
+	// instance cull and LoD select
+	core::vectorSIMDf worldPlanes[6];
+	extractFrustumPlanes(params.viewProj,worldPlanes);
+	core::for_each(core::execution::par,m_chunks.begin(),m_chunks.end(),[&](SChunk& chunk) -> void
+	{
+		for (uint32_t first=chunk.begin; first<chunk.end; first+=4u)
+		{
+			// SoA over 4 instances, lanes past the end repeat the last instance and get masked off
+			const uint32_t laneCount = std::min(chunk.end-first,4u);
+			const InstanceToCull* lanes[4];
+			for (uint32_t l=0u; l<4u; l++)
+				lanes[l] = instances+first+std::min(l,laneCount-1u);
+
+			// transposed instance transforms, `m[j][k]` is row `j` column `k` of every lane's matrix
+			__m128 m[3][4];
+			for (uint32_t j=0u; j<3u; j++)
+			{
+				__m128 r0 = params.instanceTransforms[lanes[0]->instanceGUID].rows[j].getAsRegister();
+				__m128 r1 = params.instanceTransforms[lanes[1]->instanceGUID].rows[j].getAsRegister();
+				__m128 r2 = params.instanceTransforms[lanes[2]->instanceGUID].rows[j].getAsRegister();
+				__m128 r3 = params.instanceTransforms[lanes[3]->instanceGUID].rows[j].getAsRegister();
+				_MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+				m[j][0] = r0; m[j][1] = r1; m[j][2] = r2; m[j][3] = r3;
+			}
+			__m128 center[3], extent[3];
+			{
+				__m128 min0 = _mm_loadu_ps(getTable(lanes[0]->lodTableUvec4Offset)->aabbMin);
+				__m128 min1 = _mm_loadu_ps(getTable(lanes[1]->lodTableUvec4Offset)->aabbMin);
+				__m128 min2 = _mm_loadu_ps(getTable(lanes[2]->lodTableUvec4Offset)->aabbMin);
+				__m128 min3 = _mm_loadu_ps(getTable(lanes[3]->lodTableUvec4Offset)->aabbMin);
+				_MM_TRANSPOSE4_PS(min0,min1,min2,min3);
+				__m128 max0 = _mm_loadu_ps(getTable(lanes[0]->lodTableUvec4Offset)->aabbMax);
+				__m128 max1 = _mm_loadu_ps(getTable(lanes[1]->lodTableUvec4Offset)->aabbMax);
+				__m128 max2 = _mm_loadu_ps(getTable(lanes[2]->lodTableUvec4Offset)->aabbMax);
+				__m128 max3 = _mm_loadu_ps(getTable(lanes[3]->lodTableUvec4Offset)->aabbMax);
+				_MM_TRANSPOSE4_PS(max0,max1,max2,max3);
+				const __m128 half = _mm_set1_ps(0.5f);
+				center[0] = _mm_mul_ps(_mm_add_ps(max0,min0),half);
+				center[1] = _mm_mul_ps(_mm_add_ps(max1,min1),half);
+				center[2] = _mm_mul_ps(_mm_add_ps(max2,min2),half);
+				extent[0] = _mm_mul_ps(_mm_sub_ps(max0,min0),half);
+				extent[1] = _mm_mul_ps(_mm_sub_ps(max1,min1),half);
+				extent[2] = _mm_mul_ps(_mm_sub_ps(max2,min2),half);
+			}
+			// the world space planes brought into every instance's object space, then the same test as `nbl_glsl_fastestFrustumCullAABB`
+			int culled = 0;
+			for (const auto& plane : worldPlanes)
+			{
+				const __m128 px = _mm_set1_ps(plane.x), py = _mm_set1_ps(plane.y), pz = _mm_set1_ps(plane.z);
+				__m128 d = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(px,m[0][3]),_mm_mul_ps(py,m[1][3])),
+					_mm_add_ps(_mm_mul_ps(pz,m[2][3]),_mm_set1_ps(plane.w))
+				);
+				for (uint32_t k=0u; k<3u; k++)
+				{
+					const __m128 q = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px,m[0][k]),_mm_mul_ps(py,m[1][k])),_mm_mul_ps(pz,m[2][k]));
+					d = _mm_add_ps(d,_mm_add_ps(_mm_mul_ps(q,center[k]),_mm_mul_ps(abs_ps(q),extent[k])));
+				}
+				culled |= _mm_movemask_ps(_mm_cmple_ps(d,_mm_setzero_ps()));
+			}
+
+			for (uint32_t l=0u; l<laneCount; l++)
+			{
+				if (culled&(0x1<<l))
+					continue;
+				const auto& instance = *lanes[l];
+				const auto& transform = params.instanceTransforms[instance.instanceGUID];
+				const auto* table = getTable(instance.lodTableUvec4Offset);
+
+				uint32_t lodInfoUvec2Offset = invalid_lod;
+				{
+					core::vectorSIMDf objectCenter;
+					for (uint32_t k=0u; k<3u; k++)
+						objectCenter.pointer[k] = (table->aabbMin[k]+table->aabbMax[k])*0.5f;
+					objectCenter.w = 1.f;
+					core::vectorSIMDf worldCenter = objectCenter;
+					transform.pseudoMulWith4x1(worldCenter);
+					const core::vectorSIMDf toCamera = params.cameraPosition-worldCenter;
+					float maxScaleSq = 0.f;
+					for (uint32_t k=0u; k<3u; k++)
+					{
+						const core::vectorSIMDf axis(transform.rows[0][k],transform.rows[1][k],transform.rows[2][k]);
+						maxScaleSq = std::max(maxScaleSq,core::dot(axis,axis).x);
+					}
+					const float distanceSq = (toCamera.x*toCamera.x+toCamera.y*toCamera.y+toCamera.z*toCamera.z)/maxScaleSq;
+					for (uint32_t lod=0u; lod<table->levelCount; lod++)
+					{
+						const uint32_t candidate = table->leveInfoUvec2Offsets[lod];
+						if (distanceSq>=getLoDInfo(candidate)->choiceParams.distanceSqAtReferenceFoV*params.fovDilationFactor)
+						{
+							lodInfoUvec2Offset = candidate;
+							break;
+						}
+					}
+				}
+				if (lodInfoUvec2Offset==invalid_lod)
+					continue;
+
+				auto& pvsInstance = chunk.instances.emplace_back();
+				pvsInstance.mvp = core::matrix4SIMD::concatenateBFollowedByA(params.viewProj,core::matrix4SIMD(transform));
+				pvsInstance.instanceGUID = instance.instanceGUID;
+				pvsInstance.lodInfoUvec2Offset = lodInfoUvec2Offset;
+				if (params.occluders)
+				{
+					const core::vectorSIMDf aabbMin(table->aabbMin[0],table->aabbMin[1],table->aabbMin[2]);
+					const core::vectorSIMDf aabbMax(table->aabbMax[0],table->aabbMax[1],table->aabbMax[2]);
+					if (params.occluders->isOccluded(pvsInstance.mvp,aabbMin,aabbMax))
+						chunk.instances.pop_back();
+				}
+			}
+		}
+	});
+
+	// stable compaction of the potentially visible instances
+	uint32_t pvsInstanceCount = 0u;
+	for (auto& chunk : m_chunks)
+	{
+		chunk.firstPerViewPerInstanceID = pvsInstanceCount;
+		pvsInstanceCount += chunk.instances.size();
+	}
+	outCounts.potentiallyVisibleInstances = pvsInstanceCount;
+
+	// drawcall cull, the instance counts get incremented the same way as in `instance_draw_cull.comp`
+	core::for_each(core::execution::par,m_chunks.begin(),m_chunks.end(),[&](SChunk& chunk) -> void
+	{
+		for (uint32_t i=0u; i<chunk.instances.size(); i++)
+		{
+			const auto& pvsInstance = chunk.instances[i];
+			const uint32_t perViewPerInstanceID = chunk.firstPerViewPerInstanceID+i;
+			params.outPerViewPerInstanceMVPs[perViewPerInstanceID] = pvsInstance.mvp;
+			if (params.outPotentiallyVisibleInstances)
+				params.outPotentiallyVisibleInstances[perViewPerInstanceID] = {pvsInstance.instanceGUID,pvsInstance.lodInfoUvec2Offset};
+
+			const SFrustumSoA frustum(pvsInstance.mvp);
+			const auto* lodInfo = getLoDInfo(pvsInstance.lodInfoUvec2Offset);
+			for (uint32_t drawcallID=0u; drawcallID<lodInfo->drawcallInfoCount; drawcallID++)
+			{
+				const auto& drawcallInfo = lodInfo->drawcallInfos[drawcallID];
+				const auto aabb = drawcallInfo.getAABB().decompress();
+				const core::vectorSIMDf aabbMin(aabb.MinEdge.X,aabb.MinEdge.Y,aabb.MinEdge.Z);
+				const core::vectorSIMDf aabbMax(aabb.MaxEdge.X,aabb.MaxEdge.Y,aabb.MaxEdge.Z);
+				if (frustum.cullsAABB(aabbMin,aabbMax))
+					continue;
+				if (params.occluders && params.occluders->isOccluded(pvsInstance.mvp,aabbMin,aabbMax))
+					continue;
+
+				const uint32_t drawcallDWORDOffsetAndFlag = drawcallInfo.getDrawcallDWORDOffset();
+				const uint32_t drawcallDWORDOffset = drawcallDWORDOffsetAndFlag&0x7fffffffu;
+				auto& draw = chunk.draws.emplace_back();
+				draw.perViewPerInstanceID = perViewPerInstanceID;
+				draw.drawBaseInstanceDWORDOffset = drawcallDWORDOffset+4u-(drawcallDWORDOffsetAndFlag>>31u);
+				draw.instanceID = std::atomic_ref<uint32_t>(drawCommands[drawcallDWORDOffset+1u]).fetch_add(1u,std::memory_order_relaxed);
+			}
+		}
+	});
+
+	// exclusive prefix sum of the instance counts into the base instances
+	uint32_t drawInstanceCount = 0u;
+	for (const auto drawcallDWORDOffsetAndFlag : params.drawcallsToScan)
+	{
+		const uint32_t drawcallDWORDOffset = drawcallDWORDOffsetAndFlag&0x7fffffffu;
+		drawCommands[drawcallDWORDOffset+4u-(drawcallDWORDOffsetAndFlag>>31u)] = drawInstanceCount;
+		drawInstanceCount += drawCommands[drawcallDWORDOffset+1u];
+	}
+	if (drawInstanceCount>params.perInstanceRedirectAttribCapacity || (!params.outPerInstanceRedirectAttribs && drawInstanceCount))
+	{
+		for (const auto drawcallDWORDOffset : params.drawcallsToScan)
+			drawCommands[(drawcallDWORDOffset&0x7fffffffu)+1u] = 0u;
+		return false;
+	}
+	outCounts.drawInstances = drawInstanceCount;
+
+	// scatter like `instance_ref_counting_sort_scatter.comp`
+	core::for_each(core::execution::par,m_chunks.begin(),m_chunks.end(),[&](const SChunk& chunk) -> void
+	{
+		for (const auto& draw : chunk.draws)
+		{
+			auto& redirect = params.outPerInstanceRedirectAttribs[drawCommands[draw.drawBaseInstanceDWORDOffset]+draw.instanceID];
+			redirect[0] = chunk.instances[draw.perViewPerInstanceID-chunk.firstPerViewPerInstanceID].instanceGUID;
+			redirect[1] = draw.perViewPerInstanceID;
+		}
+	});
+	return true;
+}
@@ -0,0 +1,190 @@
+// Copyright (C) 2018-2020 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#include "nbl/scene/CCPUTransformTreeManager.h"
+
+#include "nbl/core/execution.h"
+
+using namespace nbl;
+using namespace scene;
+
+
+bool CCPUTransformTreeManager::addNodes(const AdditionRequest& request)
+{
+	if (!request.tree || !request.outNodes.begin() || request.outNodes.end()<request.outNodes.begin())
+		return false;
+	if (request.outNodes.empty())
+		return true;
+
+	auto* const tree = request.tree;
+	if (!tree->allocateNodes(request.outNodes))
+		return false;
+
+	const node_t* const nodes = request.outNodes.begin();
+	core::for_each(core::execution::par_unseq,request.outNodes.begin(),request.outNodes.end(),[&](const node_t& node) -> void
+	{
+		const uint32_t i = &node-nodes;
+		tree->m_parents[node] = request.parents ? request.parents[i]:CCPUTransformTree::invalid_node;
+		tree->m_relativeTransforms[node] = request.relativeTransforms ? request.relativeTransforms[i]:core::matrix3x4SIMD();
+		tree->m_modifiedStamps[node] = ITransformTree::initial_modified_timestamp;
+		tree->m_recomputedStamps[node] = ITransformTree::initial_recomputed_timestamp;
+	});
+	return true;
+}
+
+void CCPUTransformTreeManager::updateLocalTransforms(CCPUTransformTree* tree, const ModificationRequestRange* rangesBegin, const ModificationRequestRange* rangesEnd, const RelativeTransformModificationRequest* requests)
+{
+	core::for_each(core::execution::par_unseq,rangesBegin,rangesEnd,[tree,requests](const ModificationRequestRange& range) -> void
+	{
+		auto& relativeTransform = tree->m_relativeTransforms[range.nodeID];
+		for (auto i=range.requestsBegin; i<range.requestsEnd; i++)
+		{
+			const auto& request = requests[i];
+			// the type bits stuffed into the scale are part of the matrix on the GPU too
+			const auto& modification = *reinterpret_cast<const core::matrix3x4SIMD*>(request.data);
+			switch (request.getType())
+			{
+				case RelativeTransformModificationRequest::ET_CONCATENATE_AFTER:
+					relativeTransform = core::matrix3x4SIMD::concatenateBFollowedByA(modification,relativeTransform);
+					break;
+				case RelativeTransformModificationRequest::ET_CONCATENATE_BEFORE:
+					relativeTransform = core::matrix3x4SIMD::concatenateBFollowedByA(relativeTransform,modification);
+					break;
+				case RelativeTransformModificationRequest::ET_WEIGHTED_ACCUMULATE:
+					relativeTransform += modification;
+					break;
+				default:
+					relativeTransform = modification;
+					break;
+			}
+		}
+		tree->m_modifiedStamps[range.nodeID] = range.newTimestamp;
+	});
+}
+
+void CCPUTransformTreeManager::recomputeGlobalTransforms(CCPUTransformTree* tree, const node_t* nodesBegin, const node_t* nodesEnd)
+{
+	const uint32_t nodeCount = nodesEnd-nodesBegin;
+	if (nodeCount==0u)
+		return;
+
+	// a new epoch means nothing has been claimed yet, without clearing the whole array
+	if ((++tree->m_recomputeEpoch)==0u)
+	{
+		for (uint32_t i=0u; i<tree->getCapacity(); i++)
+			tree->m_recomputeClaims[i].store(0u,std::memory_order_relaxed);
+		tree->m_recomputeEpoch = 1u;
+	}
+	const uint32_t epoch = tree->m_recomputeEpoch;
+
+	constexpr uint32_t MinBatchSize = 0x1u<<12u;
+	constexpr uint32_t MaxBatchCount = 0x1u<<8u;
+	const uint32_t batchCount = std::clamp(nodeCount/MinBatchSize,1u,MaxBatchCount);
+	m_recomputeBatches.resize(batchCount);
+	for (uint32_t i=0u; i<batchCount; i++)
+	{
+		auto& batch = m_recomputeBatches[i];
+		batch.begin = nodesBegin+uint64_t(nodeCount)*i/batchCount;
+		batch.end = nodesBegin+uint64_t(nodeCount)*(i+1u)/batchCount;
+		// keep the allocations around for the next call
+		for (auto& level : batch.levels)
+			level.clear();
+	}
+
+	const auto* const parents = tree->m_parents.data();
+	const auto* const modifiedStamps = tree->m_modifiedStamps.data();
+	const auto* const recomputedStamps = tree->m_recomputedStamps.data();
+	auto* const claims = tree->m_recomputeClaims.get();
+	core::for_each(core::execution::par,m_recomputeBatches.begin(),m_recomputeBatches.end(),[&](SRecomputeBatch& batch) -> void
+	{
+		for (auto it=batch.begin; it!=batch.end; it++)
+		{
+			uint32_t depth = 0u;
+			for (auto parent=parents[*it]; parent!=CCPUTransformTree::invalid_node; parent=parents[parent])
+				depth++;
+			// whoever claims a node first also takes care of all its ancestors, so a shared path is only walked once
+			for (auto node=*it; node!=CCPUTransformTree::invalid_node; node=parents[node],depth--)
+			{
+				if (claims[node].exchange(epoch,std::memory_order_relaxed)==epoch)
+					break;
+				// up to date nodes keep their global transform even if an ancestor changed, same as on the GPU
+				if (recomputedStamps[node]==modifiedStamps[node])
+					continue;
+				if (batch.levels.size()<=depth)
+					batch.levels.resize(depth+1u);
+				batch.levels[depth].push_back(node);
+			}
+		}
+	});
+
+	size_t levelCount = 0u;
+	for (const auto& batch : m_recomputeBatches)
+		levelCount = std::max(levelCount,batch.levels.size());
+
+	const bool normalMatrices = tree->hasNormalMatrices();
+	const auto* const relativeTransforms = tree->m_relativeTransforms.data();
+	auto* const globalTransforms = tree->m_globalTransforms.data();
+	for (size_t depth=0u; depth<levelCount; depth++)
+	core::for_each(core::execution::par,m_recomputeBatches.begin(),m_recomputeBatches.end(),[&](const SRecomputeBatch& batch) -> void
+	{
+		if (depth>=batch.levels.size())
+			return;
+		for (const auto node : batch.levels[depth])
+		{
+			const auto parent = parents[node];
+			auto& globalTransform = globalTransforms[node];
+			if (parent!=CCPUTransformTree::invalid_node)
+				globalTransform = core::matrix3x4SIMD::concatenateBFollowedByA(globalTransforms[parent],relativeTransforms[node]);
+			else // relative transform == global transform for a root node
+				globalTransform = relativeTransforms[node];
+			tree->m_recomputedStamps[node] = modifiedStamps[node];
+			if (normalMatrices)
+				tree->m_normalMatrices[node] = encodeNormalMatrix(globalTransform);
+		}
+	});
+}
+
+CCPUTransformTree::normal_matrix_t CCPUTransformTreeManager::encodeNormalMatrix(const CCPUTransformTree::global_transform_t& globalTransform)
+{
+	const auto cofactors = globalTransform.getSub3x3TransposeCofactors();
+	const float determinant = core::dot(globalTransform.rows[0],cofactors.rows[0]).x;
+
+	// GLSL `packSnorm2x16`
+	auto packSnorm2x16 = [](const float x, const float y) -> uint32_t
+	{
+		auto packSnorm16 = [](const float v) -> uint32_t
+		{
+			const float scaled = std::clamp(v,-1.f,1.f)*32767.f;
+			// round half away from zero without a libm call
+			return static_cast<uint16_t>(static_cast<int16_t>(scaled+(scaled<0.f ? -0.5f:0.5f)));
+		};
+		return packSnorm16(x)|(packSnorm16(y)<<16u);
+	};
+
+	float maxComponent = 0.f;
+	for (auto i=0u; i<3u; i++)
+	for (auto j=0u; j<3u; j++)
+		maxComponent = std::max(maxComponent,std::abs(cofactors.rows[i][j]));
+	// negative scale if the transform flips the handedness
+	const float scale = (determinant<0.f ? -1.f:1.f)/maxComponent;
+	// column `c` of the GLSL `mat3`
+	auto m = [&](const uint32_t c, const uint32_t r) -> float {return cofactors.rows[r][c]*scale;};
+
+	CCPUTransformTree::normal_matrix_t compr;
+	compr.compressedComponents[0] = packSnorm2x16(m(0,1),m(0,2));
+	compr.compressedComponents[1] = packSnorm2x16(m(1,0),m(1,1));
+	compr.compressedComponents[2] = packSnorm2x16(m(1,2),m(2,0));
+	compr.compressedComponents[3] = packSnorm2x16(m(2,1),m(2,2));
+	for (auto& comp : compr.compressedComponents)
+		comp &= 0xFFFCFFFCu;
+
+	const uint32_t firstComp = packSnorm2x16(m(0,0),0.f);
+	const uint32_t firstCompParted = (firstComp<<8u)|firstComp;
+	// different mask is not a typo, important to trim this component to 14 bits as well, otherwise bias
+	compr.compressedComponents[0] |= (firstCompParted & 0x00030000u);
+	compr.compressedComponents[1] |= ((firstCompParted >> 2u) & 0x00030003u);
+	compr.compressedComponents[2] |= ((firstCompParted >> 4u) & 0x00030003u);
+	compr.compressedComponents[3] |= ((firstCompParted >> 6u) & 0x00030003u);
+	return compr;
+}
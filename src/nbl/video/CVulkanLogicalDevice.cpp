@@ -65,6 +65,82 @@ IGPUEvent::E_STATUS CVulkanLogicalDevice::setEvent(IGPUEvent* _event)
         return IGPUEvent::ES_FAILURE;
 }
 
+core::smart_refctd_ptr<IGPUSemaphore> CVulkanLogicalDevice::createTimelineSemaphore_impl(const uint64_t initialValue)
+{
+    VkSemaphoreTypeCreateInfo vk_typeInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO, nullptr };
+    vk_typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    vk_typeInfo.initialValue = initialValue;
+
+    VkSemaphoreCreateInfo vk_createInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+    vk_createInfo.pNext = &vk_typeInfo;
+    vk_createInfo.flags = static_cast<VkSemaphoreCreateFlags>(0); // flags must be 0
+
+    VkSemaphore vk_semaphore;
+    if (m_devf.vk.vkCreateSemaphore(m_vkdev, &vk_createInfo, nullptr, &vk_semaphore) == VK_SUCCESS)
+        return core::make_smart_refctd_ptr<CVulkanSemaphore>(
+            core::smart_refctd_ptr<CVulkanLogicalDevice>(this), vk_semaphore, IGPUSemaphore::ET_TIMELINE);
+    else
+        return nullptr;
+}
+
+// the core entry points are only there on Vulkan 1.2 devices, otherwise the feature comes from VK_KHR_timeline_semaphore
+bool CVulkanLogicalDevice::getSemaphoreCounterValue_impl(const IGPUSemaphore* _semaphore, uint64_t& _outValue)
+{
+    if (_semaphore->getAPIType() != EAT_VULKAN)
+        return false;
+
+    const auto vk_getSemaphoreCounterValue = m_devf.vk.vkGetSemaphoreCounterValue ? m_devf.vk.vkGetSemaphoreCounterValue:m_devf.vk.vkGetSemaphoreCounterValueKHR;
+    VkSemaphore vk_semaphore = IBackendObject::device_compatibility_cast<const CVulkanSemaphore*>(_semaphore, this)->getInternalObject();
+    return vk_getSemaphoreCounterValue(m_vkdev, vk_semaphore, &_outValue) == VK_SUCCESS;
+}
+
+IGPUSemaphore::E_STATUS CVulkanLogicalDevice::waitSemaphores_impl(uint32_t _count, const IGPUSemaphore::SWaitInfo* _infos, bool _waitAll, uint64_t _timeout)
+{
+    constexpr uint32_t MAX_SEMAPHORE_COUNT = 100u;
+    assert(_count <= MAX_SEMAPHORE_COUNT);
+
+    VkSemaphore vk_semaphores[MAX_SEMAPHORE_COUNT];
+    uint64_t vk_values[MAX_SEMAPHORE_COUNT];
+    for (uint32_t i = 0u; i < _count; ++i)
+    {
+        if (_infos[i].semaphore->getAPIType() != EAT_VULKAN)
+            return IGPUSemaphore::ES_ERROR;
+
+        vk_semaphores[i] = IBackendObject::device_compatibility_cast<const CVulkanSemaphore*>(_infos[i].semaphore, this)->getInternalObject();
+        vk_values[i] = _infos[i].value;
+    }
+
+    VkSemaphoreWaitInfo vk_waitInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO, nullptr };
+    vk_waitInfo.flags = _waitAll ? 0u:VK_SEMAPHORE_WAIT_ANY_BIT;
+    vk_waitInfo.semaphoreCount = _count;
+    vk_waitInfo.pSemaphores = vk_semaphores;
+    vk_waitInfo.pValues = vk_values;
+
+    const auto vk_waitSemaphores = m_devf.vk.vkWaitSemaphores ? m_devf.vk.vkWaitSemaphores:m_devf.vk.vkWaitSemaphoresKHR;
+    switch (vk_waitSemaphores(m_vkdev, &vk_waitInfo, _timeout))
+    {
+    case VK_SUCCESS:
+        return IGPUSemaphore::ES_SUCCESS;
+    case VK_TIMEOUT:
+        return IGPUSemaphore::ES_TIMEOUT;
+    default:
+        return IGPUSemaphore::ES_ERROR;
+    }
+}
+
+bool CVulkanLogicalDevice::signalSemaphore_impl(const IGPUSemaphore::SWaitInfo& _signal)
+{
+    if (_signal.semaphore->getAPIType() != EAT_VULKAN)
+        return false;
+
+    VkSemaphoreSignalInfo vk_signalInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO, nullptr };
+    vk_signalInfo.semaphore = IBackendObject::device_compatibility_cast<const CVulkanSemaphore*>(_signal.semaphore, this)->getInternalObject();
+    vk_signalInfo.value = _signal.value;
+
+    const auto vk_signalSemaphore = m_devf.vk.vkSignalSemaphore ? m_devf.vk.vkSignalSemaphore:m_devf.vk.vkSignalSemaphoreKHR;
+    return vk_signalSemaphore(m_vkdev, &vk_signalInfo) == VK_SUCCESS;
+}
+
 IDeviceMemoryAllocator::SMemoryOffset CVulkanLogicalDevice::allocate(const SAllocateInfo& info)
 {
     IDeviceMemoryAllocator::SMemoryOffset ret = {nullptr, IDeviceMemoryAllocator::InvalidMemoryOffset};
@@ -895,6 +895,11 @@ protected:
         return false;
     }
 
+    core::smart_refctd_ptr<IGPUSemaphore> createTimelineSemaphore_impl(const uint64_t initialValue) override;
+    bool getSemaphoreCounterValue_impl(const IGPUSemaphore* _semaphore, uint64_t& _outValue) override;
+    IGPUSemaphore::E_STATUS waitSemaphores_impl(uint32_t _count, const IGPUSemaphore::SWaitInfo* _infos, bool _waitAll, uint64_t _timeout) override;
+    bool signalSemaphore_impl(const IGPUSemaphore::SWaitInfo& _signal) override;
+
     core::smart_refctd_ptr<IGPUFramebuffer> createFramebuffer_impl(IGPUFramebuffer::SCreationParams&& params) override
     {
         // This flag isn't supported until Vulkan 1.2
@@ -36,7 +36,8 @@ bool CVulkanQueue::submit(uint32_t _count, const SSubmitInfo* _submits, IGPUFenc
     uint32_t memSize = STACK_MEM_SIZE;
 
     const uint32_t submitsSz = sizeof(VkSubmitInfo)*_count;
-    const uint32_t memNeeded = submitsSz + (waitSemCnt + signalSemCnt)*sizeof(VkSemaphore) + cmdBufCnt*sizeof(VkCommandBuffer);
+    const uint32_t timelineSubmitsSz = sizeof(VkTimelineSemaphoreSubmitInfo)*_count;
+    const uint32_t memNeeded = submitsSz + timelineSubmitsSz + (waitSemCnt + signalSemCnt)*sizeof(VkSemaphore) + cmdBufCnt*sizeof(VkCommandBuffer);
     if (memNeeded > memSize)
     {
         memSize = memNeeded;
@@ -48,6 +49,8 @@ bool CVulkanQueue::submit(uint32_t _count, const SSubmitInfo* _submits, IGPUFenc
 
     VkSubmitInfo* submits = reinterpret_cast<VkSubmitInfo*>(mem);
     mem += submitsSz;
+    VkTimelineSemaphoreSubmitInfo* timelineSubmits = reinterpret_cast<VkTimelineSemaphoreSubmitInfo*>(mem);
+    mem += timelineSubmitsSz;
 
     VkSemaphore* waitSemaphores = reinterpret_cast<VkSemaphore*>(mem);
     mem += waitSemCnt*sizeof(VkSemaphore);
@@ -100,6 +103,18 @@ bool CVulkanQueue::submit(uint32_t _count, const SSubmitInfo* _submits, IGPUFenc
 
         static_assert(sizeof(VkPipelineStageFlags) == sizeof(asset::E_PIPELINE_STAGE_FLAGS));
         sb.pWaitDstStageMask = reinterpret_cast<const VkPipelineStageFlags*>(_sb.pWaitDstStageMask);
+
+        if (_sb.pWaitValues || _sb.pSignalValues)
+        {
+            auto& timelineSb = timelineSubmits[i];
+            timelineSb.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            timelineSb.pNext = nullptr;
+            timelineSb.waitSemaphoreValueCount = _sb.pWaitValues ? sb.waitSemaphoreCount:0u;
+            timelineSb.pWaitSemaphoreValues = _sb.pWaitValues;
+            timelineSb.signalSemaphoreValueCount = _sb.pSignalValues ? sb.signalSemaphoreCount:0u;
+            timelineSb.pSignalSemaphoreValues = _sb.pSignalValues;
+            sb.pNext = &timelineSb;
+        }
     }
 
     VkFence fence = _fence ? IBackendObject::device_compatibility_cast<CVulkanFence*>(_fence, m_originDevice)->getInternalObject() : VK_NULL_HANDLE;
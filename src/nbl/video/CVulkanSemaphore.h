@@ -14,7 +14,7 @@ class CVulkanSemaphore final : public IGPUSemaphore
 {
 public:
     CVulkanSemaphore(core::smart_refctd_ptr<ILogicalDevice>&& _vkdev,
-        VkSemaphore semaphore) : IGPUSemaphore(std::move(_vkdev)), m_semaphore(semaphore)
+        VkSemaphore semaphore, const E_TYPE type=ET_BINARY) : IGPUSemaphore(std::move(_vkdev),type), m_semaphore(semaphore)
     {}
 
     ~CVulkanSemaphore();
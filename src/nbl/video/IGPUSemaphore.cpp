@@ -0,0 +1,24 @@
+#include "nbl/video/IGPUSemaphore.h"
+#include "nbl/video/ILogicalDevice.h"
+
+namespace nbl::video
+{
+
+IGPUSemaphore::E_STATUS GPUTimelineEventHandlerBase::waitForValue(IGPUSemaphore* semaphore, uint64_t value, uint64_t timeout)
+{
+    auto* device = const_cast<ILogicalDevice*>(semaphore->getOriginDevice());
+    const IGPUSemaphore::SWaitInfo waitInfo = {semaphore,value};
+    const auto status = device->waitSemaphores(1u,&waitInfo,true,timeout);
+    return status==IGPUSemaphore::ES_ERROR ? IGPUSemaphore::ES_SUCCESS:status;
+}
+
+uint64_t GPUTimelineEventHandlerBase::getCounterValue(IGPUSemaphore* semaphore)
+{
+    auto* device = const_cast<ILogicalDevice*>(semaphore->getOriginDevice());
+    uint64_t value;
+    if (!device->getSemaphoreCounterValue(semaphore,value))
+        return ~0ull;
+    return value;
+}
+
+}
@@ -16,10 +16,9 @@ ICommandPoolCache::ICommandPoolCache(ILogicalDevice* device, const uint32_t queu
 
 void ICommandPoolCache::releaseSet(ILogicalDevice* device, const uint32_t poolIx)
 {
-	// TODO: support CommandPool resetting!
-	//m_cache[m_poolIx]->reset();
-	// temporary workaround
-	m_cache[poolIx] = device->createCommandPool(m_queueFamilyIx,m_flags);
+	// resetting keeps the pool's command buffers and command segments around for reuse
+	if (!m_cache[poolIx]->reset())
+		m_cache[poolIx] = device->createCommandPool(m_queueFamilyIx,m_flags);
 	m_cmdPoolAllocator.free_addr(poolIx,1u);
 }
 
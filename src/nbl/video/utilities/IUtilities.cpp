@@ -106,6 +106,7 @@ IGPUQueue::SSubmitInfo IUtilities::updateImageViaStagingBuffer(
             IGPUQueue::SSubmitInfo submit = intendedNextSubmit;
             submit.signalSemaphoreCount = 0u;
             submit.pSignalSemaphores = nullptr;
+            submit.pSignalValues = nullptr;
             assert(submit.isValid());
             submissionQueue->submit(1u, &submit, submissionFence);
             m_device->blockForFences(1u, &submissionFence);
@@ -114,6 +115,7 @@ IGPUQueue::SSubmitInfo IUtilities::updateImageViaStagingBuffer(
             intendedNextSubmit.waitSemaphoreCount = 0u;
             intendedNextSubmit.pWaitSemaphores = nullptr;
             intendedNextSubmit.pWaitDstStageMask = nullptr;
+            intendedNextSubmit.pWaitValues = nullptr;
             // before resetting we need poll all events in the allocator's deferred free list
             m_defaultUploadBuffer->cull_frees();
             // we can reset the fence and commandbuffer because we fully wait for the GPU to finish here
@@ -0,0 +1,41 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_TESTS_NBL_TEST_H_INCLUDED_
+#define _NBL_TESTS_NBL_TEST_H_INCLUDED_
+
+#include <cstdio>
+#include <atomic>
+
+namespace nbl::test
+{
+
+inline std::atomic_uint32_t failures = 0u;
+
+//! doesn't abort, so one run reports every failed check
+inline bool check(const bool condition, const char* expression, const char* file, const int line)
+{
+	if (!condition)
+	{
+		std::fprintf(stderr,"%s:%d: check failed: %s\n",file,line,expression);
+		failures++;
+	}
+	return condition;
+}
+
+inline int result()
+{
+	const uint32_t count = failures.load();
+	if (count)
+		std::fprintf(stderr,"%u checks failed\n",count);
+	else
+		std::printf("all checks passed\n");
+	return count ? 1:0;
+}
+
+}
+
+#define NBL_TEST_CHECK(...) ::nbl::test::check(static_cast<bool>(__VA_ARGS__),#__VA_ARGS__,__FILE__,__LINE__)
+
+#endif
@@ -0,0 +1,67 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+#ifndef _NBL_TESTS_NBL_TEST_GEOMETRY_H_INCLUDED_
+#define _NBL_TESTS_NBL_TEST_GEOMETRY_H_INCLUDED_
+
+#include "nbl/asset/ICPUMeshBuffer.h"
+#include "nbl/asset/utils/IGeometryCreator.h"
+
+namespace nbl::test
+{
+
+//! wraps the output of a geometry creator, there are no shaders or pipeline layout since the tests only read the attributes back
+inline core::smart_refctd_ptr<asset::ICPUMeshBuffer> makeMeshBuffer(const asset::IGeometryCreator::return_type& geometry)
+{
+	auto pipeline = core::make_smart_refctd_ptr<asset::ICPURenderpassIndependentPipeline>(
+		nullptr,nullptr,nullptr,geometry.inputParams,asset::SBlendParams{},geometry.assemblyParams,asset::SRasterizationParams{}
+	);
+	auto meshbuffer = core::make_smart_refctd_ptr<asset::ICPUMeshBuffer>();
+	meshbuffer->setPipeline(std::move(pipeline));
+	for (uint32_t i=0u; i<asset::ICPUMeshBuffer::MAX_ATTR_BUF_BINDING_COUNT; i++)
+	if (geometry.bindings[i].buffer)
+		meshbuffer->setVertexBufferBinding(asset::SBufferBinding<asset::ICPUBuffer>(geometry.bindings[i]),i);
+	meshbuffer->setIndexBufferBinding(asset::SBufferBinding<asset::ICPUBuffer>(geometry.indexBuffer));
+	meshbuffer->setIndexType(geometry.indexType);
+	meshbuffer->setIndexCount(geometry.indexCount);
+	meshbuffer->setPositionAttributeIx(0u);
+	return meshbuffer;
+}
+
+//! indexed triangle list with tightly packed float positions in attribute 0, and if there are any, UVs in attribute 1 (vertices with equal positions and different UVs make a seam)
+inline core::smart_refctd_ptr<asset::ICPUMeshBuffer> makeTriangleMeshBuffer(const core::vector<core::vectorSIMDf>& positions, const core::vector<uint32_t>& indices, const core::vector<core::vectorSIMDf>& uvs={})
+{
+	asset::IGeometryCreator::return_type geometry = {};
+	geometry.inputParams.enabledAttribFlags = uvs.empty() ? 0b1u:0b11u;
+	geometry.inputParams.enabledBindingFlags = uvs.empty() ? 0b1u:0b11u;
+	geometry.inputParams.attributes[0] = {0u,asset::EF_R32G32B32_SFLOAT,0u};
+	geometry.inputParams.bindings[0] = {sizeof(float)*3u,asset::EVIR_PER_VERTEX};
+	geometry.inputParams.attributes[1] = {1u,asset::EF_R32G32_SFLOAT,0u};
+	geometry.inputParams.bindings[1] = {sizeof(float)*2u,asset::EVIR_PER_VERTEX};
+	geometry.assemblyParams.primitiveType = asset::EPT_TRIANGLE_LIST;
+
+	auto packAttribute = [](const core::vector<core::vectorSIMDf>& values, const uint32_t components) -> asset::SBufferBinding<asset::ICPUBuffer>
+	{
+		auto buffer = core::make_smart_refctd_ptr<asset::ICPUBuffer>(sizeof(float)*components*values.size());
+		float* out = reinterpret_cast<float*>(buffer->getPointer());
+		for (const auto& value : values)
+		for (uint32_t i=0u; i<components; i++)
+			*(out++) = value[i];
+		return {0ull,std::move(buffer)};
+	};
+	geometry.bindings[0] = packAttribute(positions,3u);
+	if (!uvs.empty())
+		geometry.bindings[1] = packAttribute(uvs,2u);
+
+	auto indexBuffer = core::make_smart_refctd_ptr<asset::ICPUBuffer>(sizeof(uint32_t)*indices.size());
+	memcpy(indexBuffer->getPointer(),indices.data(),indexBuffer->getSize());
+	geometry.indexBuffer = {0ull,std::move(indexBuffer)};
+	geometry.indexType = asset::EIT_32BIT;
+	geometry.indexCount = indices.size();
+	return makeMeshBuffer(geometry);
+}
+
+}
+
+#endif
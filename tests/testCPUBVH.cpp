@@ -0,0 +1,249 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// Every way of tracing the BVH must agree with brute force intersection of all primitives.
+#include "nbl/asset/utils/CCPUBVH.h"
+
+#include <random>
+
+#include "nblTest.h"
+
+using namespace nbl;
+using namespace asset;
+
+// deliberately not a multiple of the packet size, so the batched queries need several packets and a partial one
+constexpr uint32_t RayCount = CCPUBVH::MAX_PACKET_SIZE*4u+44u;
+constexpr uint32_t TriangleCount = 2000u;
+constexpr uint32_t BoxCount = 50u;
+
+struct SBruteForceHit
+{
+	float t = FLT_MAX;
+	uint32_t geometryIndex = CCPUBVH::INVALID_INDEX;
+	uint32_t primitiveIndex = CCPUBVH::INVALID_INDEX;
+	uint32_t instanceIndex = CCPUBVH::INVALID_INDEX;
+};
+
+struct SScene
+{
+	core::vector<core::vectorSIMDf> triangles; // 3 vertices each
+	core::vector<core::aabbox3df> boxes;
+
+	void intersect(const CCPUBVH::SRay& ray, const core::vectorSIMDf& offset, const uint32_t instanceIndex, SBruteForceHit& hit) const
+	{
+		for (uint32_t i=0u; i<triangles.size()/3u; i++)
+		{
+			const auto p0 = triangles[i*3u]+offset;
+			const auto edge1 = triangles[i*3u+1u]-triangles[i*3u];
+			const auto edge2 = triangles[i*3u+2u]-triangles[i*3u];
+			const auto pvec = core::cross(ray.direction,edge2);
+			const float det = core::dot(edge1,pvec).x;
+			if (det==0.f)
+				continue;
+			const auto tvec = ray.origin-p0;
+			const float u = core::dot(tvec,pvec).x/det;
+			const auto qvec = core::cross(tvec,edge1);
+			const float v = core::dot(ray.direction,qvec).x/det;
+			const float t = core::dot(edge2,qvec).x/det;
+			if (u<0.f || v<0.f || u+v>1.f || t<ray.tMin || t>=hit.t)
+				continue;
+			hit = {t,0u,i,instanceIndex};
+		}
+		for (uint32_t i=0u; i<boxes.size(); i++)
+		{
+			float tNear = ray.tMin, tFar = FLT_MAX;
+			for (uint32_t axis=0u; axis<3u; axis++)
+			{
+				const float minEdge = (&boxes[i].MinEdge.X)[axis]+offset[axis];
+				const float maxEdge = (&boxes[i].MaxEdge.X)[axis]+offset[axis];
+				const float t0 = (minEdge-ray.origin[axis])/ray.direction[axis];
+				const float t1 = (maxEdge-ray.origin[axis])/ray.direction[axis];
+				tNear = std::max(tNear,std::min(t0,t1));
+				tFar = std::min(tFar,std::max(t0,t1));
+			}
+			if (tNear>tFar || tNear>=hit.t)
+				continue;
+			hit = {tNear,1u,i,instanceIndex};
+		}
+	}
+};
+
+static bool sameT(const float a, const float b)
+{
+	return std::abs(a-b)<=1e-4f*std::max(1.f,std::abs(b));
+}
+
+static bool matches(const CCPUBVH::SHit& hit, const SBruteForceHit& expected)
+{
+	if (expected.geometryIndex==CCPUBVH::INVALID_INDEX)
+		return !hit.isValid();
+	// ties between overlapping primitives may resolve either way, the distance has to agree
+	return hit.isValid() && sameT(hit.t,expected.t) && hit.instanceIndex==expected.instanceIndex;
+}
+
+template<typename T>
+static core::smart_refctd_ptr<ICPUBuffer> makeBuffer(const T* data, const size_t count)
+{
+	auto buffer = core::make_smart_refctd_ptr<ICPUBuffer>(sizeof(T)*count);
+	for (size_t i=0u; i<count; i++)
+		reinterpret_cast<T*>(buffer->getPointer())[i] = data[i];
+	return buffer;
+}
+
+// every variant of the queries against the same brute force reference
+static void checkQueries(const CCPUBVH* bvh, const core::vector<CCPUBVH::SRay>& rays, const core::vector<SBruteForceHit>& expected)
+{
+	core::vector<CCPUBVH::SHit> packetHits(rays.size());
+	bvh->traceClosest(rays.data(),packetHits.data(),rays.size());
+	core::vector<uint64_t> occluded((rays.size()+63u)/64u,0xdeadbeefull);
+	const uint32_t occludedCount = bvh->traceAny(rays.data(),occluded.data(),rays.size());
+
+	uint32_t expectedOccludedCount = 0u;
+	for (uint32_t i=0u; i<rays.size(); i++)
+	{
+		CCPUBVH::SHit hit;
+		const bool found = bvh->traceClosest(rays[i],hit);
+		NBL_TEST_CHECK(found==hit.isValid());
+		NBL_TEST_CHECK(matches(hit,expected[i]));
+		NBL_TEST_CHECK(matches(packetHits[i],expected[i]));
+
+		const bool shouldBeOccluded = expected[i].t<FLT_MAX;
+		expectedOccludedCount += shouldBeOccluded ? 1u:0u;
+		NBL_TEST_CHECK(bvh->traceAny(rays[i])==shouldBeOccluded);
+		NBL_TEST_CHECK(bool((occluded[i/64u]>>(i%64u))&0x1ull)==shouldBeOccluded);
+	}
+	NBL_TEST_CHECK(occludedCount==expectedOccludedCount);
+	// bits past the last ray of the partial packet stay clear
+	NBL_TEST_CHECK((occluded.back()>>(rays.size()%64u))==0ull);
+}
+
+int main()
+{
+	std::mt19937 rng(7u);
+	std::uniform_real_distribution<float> unit(-1.f,1.f);
+	auto randomVec = [&](const float scale) -> core::vectorSIMDf {return core::vectorSIMDf(unit(rng),unit(rng),unit(rng),0.f)*scale;};
+
+	SScene scene;
+	for (uint32_t i=0u; i<TriangleCount; i++)
+	{
+		const auto center = randomVec(4.f);
+		for (uint32_t v=0u; v<3u; v++)
+			scene.triangles.push_back(center+randomVec(0.5f));
+	}
+	for (uint32_t i=0u; i<BoxCount; i++)
+	{
+		const auto center = randomVec(4.f);
+		const auto extent = core::abs(randomVec(0.3f))+core::vectorSIMDf(0.01f);
+		scene.boxes.emplace_back(center.x-extent.x,center.y-extent.y,center.z-extent.z,center.x+extent.x,center.y+extent.y,center.z+extent.z);
+	}
+
+	core::vector<CCPUBVH::SRay> rays(RayCount);
+	for (auto& ray : rays)
+	{
+		ray.origin = randomVec(6.f);
+		// aim roughly at the scene so that most rays hit something
+		ray.direction = core::normalize(randomVec(3.f)-ray.origin);
+	}
+
+	// STEP: bottom level with a triangle and an AABB geometry
+	core::smart_refctd_ptr<CCPUBVH> bottomLevel;
+	{
+		core::vector<float> vertices;
+		for (const auto& vertex : scene.triangles)
+		for (uint32_t i=0u; i<3u; i++)
+			vertices.push_back(vertex[i]);
+		// shuffle the triangles through the indices, the vertices stay where they are
+		core::vector<uint32_t> indices(scene.triangles.size());
+		for (uint32_t i=0u; i<TriangleCount; i++)
+		for (uint32_t v=0u; v<3u; v++)
+			indices[i*3u+v] = ((i*7919u)%TriangleCount)*3u+v;
+
+		auto buildInfo = ICPUAccelerationStructure::HostBuildGeometryInfo();
+		buildInfo.type = IAccelerationStructure::ET_BOTTOM_LEVEL;
+		buildInfo.buildMode = IAccelerationStructure::EBM_BUILD;
+		buildInfo.geometries = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<ICPUAccelerationStructure::HostBuildGeometryInfo::Geom>>(2u);
+		auto& triangles = buildInfo.geometries->operator[](0u);
+		triangles.type = IAccelerationStructure::EGT_TRIANGLES;
+		triangles.data.triangles.vertexFormat = EF_R32G32B32_SFLOAT;
+		triangles.data.triangles.vertexData = {0ull,makeBuffer(vertices.data(),vertices.size())};
+		triangles.data.triangles.vertexStride = sizeof(float)*3u;
+		triangles.data.triangles.maxVertex = scene.triangles.size()-1u;
+		triangles.data.triangles.indexType = EIT_32BIT;
+		triangles.data.triangles.indexData = {0ull,makeBuffer(indices.data(),indices.size())};
+		auto& aabbs = buildInfo.geometries->operator[](1u);
+		aabbs.type = IAccelerationStructure::EGT_AABBS;
+		aabbs.data.aabbs.data = {0ull,makeBuffer(scene.boxes.data(),scene.boxes.size())};
+		aabbs.data.aabbs.stride = sizeof(IAccelerationStructure::AABB_Position);
+
+		auto ranges = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<IAccelerationStructure::BuildRangeInfo>>(2u);
+		ranges->operator[](0u) = {TriangleCount,0u,0u,0u};
+		ranges->operator[](1u) = {BoxCount,0u,0u,0u};
+
+		auto as = ICPUAccelerationStructure::create({IAccelerationStructure::ECF_NONE,IAccelerationStructure::ET_BOTTOM_LEVEL});
+		as->setBuildInfoAndRanges(std::move(buildInfo),ranges);
+		bottomLevel = CCPUBVH::create(as.get());
+
+		// the reference has to see the same triangle order as the indices
+		SScene shuffled;
+		shuffled.boxes = scene.boxes;
+		for (const auto index : indices)
+			shuffled.triangles.push_back(scene.triangles[index]);
+		scene = std::move(shuffled);
+	}
+	NBL_TEST_CHECK(bottomLevel && bottomLevel->getPrimitiveCount()==TriangleCount+BoxCount);
+	if (!bottomLevel)
+		return test::result();
+	{
+		core::vector<SBruteForceHit> expected(RayCount);
+		for (uint32_t i=0u; i<RayCount; i++)
+			scene.intersect(rays[i],core::vectorSIMDf(0.f),CCPUBVH::INVALID_INDEX,expected[i]);
+		checkQueries(bottomLevel.get(),rays,expected);
+	}
+
+	// STEP: top level with translated instances, one of which gets masked out
+	{
+		const core::vectorSIMDf offsets[3] = {core::vectorSIMDf(0.f),core::vectorSIMDf(5.f,0.f,0.f),core::vectorSIMDf(0.f,-3.f,2.f)};
+		IAccelerationStructure::Instance instances[4];
+		for (uint32_t i=0u; i<4u; i++)
+		{
+			instances[i].mat.setTranslation(offsets[i%3u]);
+			instances[i].instanceCustomIndex = 100u+i;
+			instances[i].accelerationStructureReference = 0u;
+		}
+		instances[3].mask = 0x0u;
+
+		auto buildInfo = ICPUAccelerationStructure::HostBuildGeometryInfo();
+		buildInfo.type = IAccelerationStructure::ET_TOP_LEVEL;
+		buildInfo.buildMode = IAccelerationStructure::EBM_BUILD;
+		buildInfo.geometries = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<ICPUAccelerationStructure::HostBuildGeometryInfo::Geom>>(1u);
+		auto& geometry = buildInfo.geometries->operator[](0u);
+		geometry.type = IAccelerationStructure::EGT_INSTANCES;
+		geometry.data.instances.data = {0ull,makeBuffer(instances,4u)};
+		auto ranges = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<IAccelerationStructure::BuildRangeInfo>>(1u);
+		ranges->operator[](0u) = {4u,0u,0u,0u};
+
+		auto as = ICPUAccelerationStructure::create({IAccelerationStructure::ECF_NONE,IAccelerationStructure::ET_TOP_LEVEL});
+		as->setBuildInfoAndRanges(std::move(buildInfo),ranges);
+		const core::smart_refctd_ptr<const CCPUBVH> bottomLevels[1] = {bottomLevel};
+		auto topLevel = CCPUBVH::create(as.get(),{bottomLevels,bottomLevels+1u});
+		NBL_TEST_CHECK(topLevel && topLevel->getPrimitiveCount()==4u);
+		if (!topLevel)
+			return test::result();
+
+		core::vector<SBruteForceHit> expected(RayCount);
+		for (uint32_t i=0u; i<RayCount; i++)
+		for (uint32_t instance=0u; instance<3u; instance++)
+			scene.intersect(rays[i],offsets[instance],instance,expected[i]);
+		checkQueries(topLevel.get(),rays,expected);
+
+		for (const auto& ray : rays)
+		{
+			CCPUBVH::SHit hit;
+			if (topLevel->traceClosest(ray,hit))
+				NBL_TEST_CHECK(hit.instanceCustomIndex==100u+hit.instanceIndex);
+		}
+	}
+
+	return test::result();
+}
@@ -0,0 +1,246 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// The HiZ test must be conservative, and the host culling must fill the draws and redirects like the GPU path (or fail cleanly).
+#include "nbl/scene/CCPUCullingLoDSelectionSystem.h"
+
+#include <array>
+#include <random>
+
+#include "nblTest.h"
+
+using namespace nbl;
+using namespace scene;
+
+using culling_t = CCPUCullingLoDSelectionSystem;
+
+constexpr uint32_t DepthWidth = 64u;
+constexpr uint32_t DepthHeight = 48u;
+
+// with this as the MVP the box coordinates are NDC already
+static const core::matrix4SIMD IdentityMVP;
+
+static bool isOccluded(const culling_t::HiZBuffer& hiZ, const core::matrix4SIMD& mvp, const float minX, const float minY, const float minZ, const float maxX, const float maxY, const float maxZ)
+{
+	return hiZ.isOccluded(mvp,core::vectorSIMDf(minX,minY,minZ),core::vectorSIMDf(maxX,maxY,maxZ));
+}
+
+static void testHiZ()
+{
+	// a wall at depth 0.5 with a far plane hole in the top right quadrant
+	core::vector<float> depth(DepthWidth*DepthHeight,0.5f);
+	for (uint32_t y=DepthHeight/2u; y<DepthHeight; y++)
+	for (uint32_t x=DepthWidth/2u; x<DepthWidth; x++)
+		depth[y*DepthWidth+x] = 1.f;
+	culling_t::HiZBuffer hiZ;
+	NBL_TEST_CHECK(!hiZ.isOccluded(IdentityMVP,core::vectorSIMDf(-0.5f,-0.5f,0.9f),core::vectorSIMDf(-0.4f,-0.4f,0.95f)));
+	NBL_TEST_CHECK(hiZ.build(depth.data(),DepthWidth,DepthHeight));
+	NBL_TEST_CHECK(hiZ.getWidth()==DepthWidth && hiZ.getHeight()==DepthHeight);
+	// 64x48, 32x24, 16x12, 8x6, 4x3, 2x2, 1x1
+	NBL_TEST_CHECK(hiZ.getMipCount()==7u);
+
+	// behind the wall
+	NBL_TEST_CHECK(isOccluded(hiZ,IdentityMVP,-0.9f,-0.9f,0.6f,-0.1f,-0.1f,0.7f));
+	// in front of the wall, or straddling it
+	NBL_TEST_CHECK(!isOccluded(hiZ,IdentityMVP,-0.9f,-0.9f,0.3f,-0.1f,-0.1f,0.4f));
+	NBL_TEST_CHECK(!isOccluded(hiZ,IdentityMVP,-0.9f,-0.9f,0.4f,-0.1f,-0.1f,0.6f));
+	// behind the wall, but reaching into the hole
+	NBL_TEST_CHECK(!isOccluded(hiZ,IdentityMVP,-0.5f,-0.5f,0.6f,0.1f,0.1f,0.7f));
+	// crossing the left screen edge behind the wall, only the on screen part counts
+	NBL_TEST_CHECK(isOccluded(hiZ,IdentityMVP,-1.5f,-0.9f,0.6f,-0.5f,-0.1f,0.7f));
+	// crossing the right screen edge into the hole
+	NBL_TEST_CHECK(!isOccluded(hiZ,IdentityMVP,0.5f,0.5f,0.6f,1.5f,0.9f,0.7f));
+	// entirely off screen, there's nothing to compare against
+	NBL_TEST_CHECK(!isOccluded(hiZ,IdentityMVP,-1.5f,-0.9f,0.6f,-1.2f,-0.1f,0.7f));
+	// crossing the camera plane of a projection with `w=z`
+	{
+		const core::matrix4SIMD perspective(
+			1.f,0.f,0.f,0.f,
+			0.f,1.f,0.f,0.f,
+			0.f,0.f,1.f,-0.1f,
+			0.f,0.f,1.f,0.f
+		);
+		NBL_TEST_CHECK(isOccluded(hiZ,perspective,-0.5f,-0.5f,2.f,-0.4f,-0.4f,3.f));
+		NBL_TEST_CHECK(!isOccluded(hiZ,perspective,-0.5f,-0.5f,-1.f,-0.4f,-0.4f,3.f));
+	}
+
+	// reverse Z stores larger depth for nearer surfaces
+	{
+		core::vector<float> reverseDepth(depth.size());
+		for (size_t i=0u; i<depth.size(); i++)
+			reverseDepth[i] = 1.f-depth[i];
+		culling_t::HiZBuffer reverseHiZ;
+		NBL_TEST_CHECK(reverseHiZ.build(reverseDepth.data(),DepthWidth,DepthHeight,true));
+		NBL_TEST_CHECK(reverseHiZ.isReverseZ());
+		const core::matrix4SIMD reverseMVP(
+			1.f,0.f,0.f,0.f,
+			0.f,1.f,0.f,0.f,
+			0.f,0.f,-1.f,1.f,
+			0.f,0.f,0.f,1.f
+		);
+		NBL_TEST_CHECK(isOccluded(reverseHiZ,reverseMVP,-0.9f,-0.9f,0.6f,-0.1f,-0.1f,0.7f));
+		NBL_TEST_CHECK(!isOccluded(reverseHiZ,reverseMVP,-0.9f,-0.9f,0.3f,-0.1f,-0.1f,0.4f));
+		NBL_TEST_CHECK(!isOccluded(reverseHiZ,reverseMVP,-0.5f,-0.5f,0.6f,0.1f,0.1f,0.7f));
+	}
+
+	// random depth and boxes, an occluded box must be behind every on screen texel it covers
+	std::mt19937 rng(2022u);
+	std::uniform_real_distribution<float> depthDist(0.2f,0.9f);
+	std::uniform_real_distribution<float> ndcDist(-1.3f,1.3f);
+	std::uniform_real_distribution<float> sizeDist(0.f,0.4f);
+	for (auto& texel : depth)
+		texel = depthDist(rng);
+	NBL_TEST_CHECK(hiZ.build(depth.data(),DepthWidth,DepthHeight));
+	uint32_t occludedCount = 0u;
+	for (uint32_t i=0u; i<4096u; i++)
+	{
+		const float minX = ndcDist(rng), minY = ndcDist(rng), minZ = depthDist(rng)+0.1f;
+		const float maxX = minX+sizeDist(rng), maxY = minY+sizeDist(rng), maxZ = minZ+sizeDist(rng);
+		if (!isOccluded(hiZ,IdentityMVP,minX,minY,minZ,maxX,maxY,maxZ))
+			continue;
+		occludedCount++;
+		const int32_t x0 = std::max<int32_t>(std::floor((minX*0.5f+0.5f)*DepthWidth),0);
+		const int32_t x1 = std::min<int32_t>(std::floor((maxX*0.5f+0.5f)*DepthWidth),DepthWidth-1u);
+		const int32_t y0 = std::max<int32_t>(std::floor((minY*0.5f+0.5f)*DepthHeight),0);
+		const int32_t y1 = std::min<int32_t>(std::floor((maxY*0.5f+0.5f)*DepthHeight),DepthHeight-1u);
+		NBL_TEST_CHECK(x0<=x1 && y0<=y1);
+		for (int32_t y=y0; y<=y1; y++)
+		for (int32_t x=x0; x<=x1; x++)
+			NBL_TEST_CHECK(minZ>depth[y*DepthWidth+x]);
+	}
+	// otherwise the loop above tested nothing
+	NBL_TEST_CHECK(occludedCount>0u);
+}
+
+static void testProcessInstances()
+{
+	using lod_table_info_t = culling_t::LoDTableInfo;
+	using lod_info_t = culling_t::LoDInfo;
+	constexpr uint32_t InstanceCount = 37u;
+	// one indexed drawcall, the instance count is DWORD 1 and the base instance DWORD 4
+	constexpr uint32_t DrawcallDWORDOffset = 5u;
+
+	// a single table with a single level drawing a small cube
+	const core::aabbox3df cube(-0.05f,-0.05f,-0.05f,0.05f,0.05f,0.05f);
+	ILevelOfDetailLibrary::InfoContainerAdaptor<lod_table_info_t> tables;
+	{
+		auto& table = tables.emplace_back(1u);
+		table = lod_table_info_t(1u,cube);
+		table.leveInfoUvec2Offsets[0] = 0u;
+	}
+	ILevelOfDetailLibrary::InfoContainerAdaptor<lod_info_t> lodInfos;
+	{
+		auto& lodInfo = lodInfos.emplace_back(1u);
+		lodInfo = lod_info_t(1u,{0.f});
+		lodInfo.drawcallInfos[0] = ILevelOfDetailLibrary::DrawcallInfo(DrawcallDWORDOffset,cube);
+	}
+
+	// every third instance is outside the frustum
+	core::vector<core::matrix3x4SIMD> transforms(InstanceCount);
+	core::vector<culling_t::InstanceToCull> instances(InstanceCount);
+	uint32_t expectedVisible = 0u;
+	for (uint32_t i=0u; i<InstanceCount; i++)
+	{
+		const bool inside = i%3u;
+		expectedVisible += inside ? 1u:0u;
+		transforms[i].setTranslation(core::vectorSIMDf(inside ? (float(i)/InstanceCount-0.5f):3.f,0.f,0.5f));
+		instances[i] = {i,0u};
+	}
+
+	auto system = culling_t::create();
+	core::vector<uint32_t> drawCommands(16u,0xdeadbeefu);
+	const uint32_t drawcallsToScan[] = {DrawcallDWORDOffset};
+	core::vector<core::matrix4SIMD> mvps(InstanceCount);
+	core::vector<culling_t::InstanceToCull> pvs(InstanceCount);
+	core::vector<std::array<uint32_t,2u>> redirects(InstanceCount);
+
+	culling_t::Params params;
+	params.lodTables = tables.data();
+	params.lodInfos = lodInfos.data();
+	params.instanceList = {instances.data(),instances.data()+instances.size()};
+	params.instanceTransforms = transforms.data();
+	params.viewProj = IdentityMVP;
+	params.cameraPosition.set(0.f,0.f,0.f);
+	params.drawcallsToScan = {drawcallsToScan,drawcallsToScan+1u};
+	params.drawCommands = drawCommands.data();
+	params.outPerViewPerInstanceMVPs = mvps.data();
+	params.outPotentiallyVisibleInstances = pvs.data();
+	params.outPerInstanceRedirectAttribs = reinterpret_cast<uint32_t(*)[2]>(redirects.data());
+	params.perInstanceRedirectAttribCapacity = InstanceCount;
+
+	culling_t::Counts counts;
+	NBL_TEST_CHECK(system->processInstancesAndFillIndirectDraws(params,counts));
+	NBL_TEST_CHECK(counts.potentiallyVisibleInstances==expectedVisible);
+	NBL_TEST_CHECK(counts.drawInstances==expectedVisible);
+	NBL_TEST_CHECK(drawCommands[DrawcallDWORDOffset+1u]==expectedVisible);
+	NBL_TEST_CHECK(drawCommands[DrawcallDWORDOffset+4u]==0u);
+	// only the instance count and base instance get written
+	NBL_TEST_CHECK(drawCommands[DrawcallDWORDOffset]==0xdeadbeefu && drawCommands[DrawcallDWORDOffset+2u]==0xdeadbeefu && drawCommands[DrawcallDWORDOffset+3u]==0xdeadbeefu);
+	{
+		core::vector<uint32_t> drawn(InstanceCount,0u);
+		for (uint32_t i=0u; i<counts.drawInstances; i++)
+		{
+			const auto instanceGUID = redirects[i][0];
+			const auto perViewPerInstanceID = redirects[i][1];
+			NBL_TEST_CHECK(instanceGUID<InstanceCount && perViewPerInstanceID<counts.potentiallyVisibleInstances);
+			if (instanceGUID>=InstanceCount || perViewPerInstanceID>=counts.potentiallyVisibleInstances)
+				continue;
+			drawn[instanceGUID]++;
+			NBL_TEST_CHECK(pvs[perViewPerInstanceID].instanceGUID==instanceGUID);
+			NBL_TEST_CHECK(mvps[perViewPerInstanceID].rows[0].w==transforms[instanceGUID].rows[0].w);
+		}
+		for (uint32_t i=0u; i<InstanceCount; i++)
+			NBL_TEST_CHECK(drawn[i]==((i%3u) ? 1u:0u));
+	}
+
+	// a wall in front of the left half of the screen occludes the instances whose whole box projects onto it
+	{
+		core::vector<float> depth(DepthWidth*DepthHeight,1.f);
+		for (uint32_t y=0u; y<DepthHeight; y++)
+		for (uint32_t x=0u; x<DepthWidth/2u; x++)
+			depth[y*DepthWidth+x] = 0.2f;
+		culling_t::HiZBuffer hiZ;
+		hiZ.build(depth.data(),DepthWidth,DepthHeight);
+		auto occludedParams = params;
+		occludedParams.occluders = &hiZ;
+		NBL_TEST_CHECK(system->processInstancesAndFillIndirectDraws(occludedParams,counts));
+		uint32_t expectedUnoccluded = 0u;
+		for (uint32_t i=0u; i<InstanceCount; i++)
+		if (i%3u && uint32_t(((transforms[i].rows[0].w+cube.MaxEdge.X)*0.5f+0.5f)*DepthWidth)>=DepthWidth/2u)
+			expectedUnoccluded++;
+		NBL_TEST_CHECK(counts.drawInstances==expectedUnoccluded);
+		NBL_TEST_CHECK(counts.drawInstances<expectedVisible);
+	}
+
+	// not enough room for the redirects, the instance counts must get zeroed
+	{
+		auto tooSmall = params;
+		tooSmall.perInstanceRedirectAttribCapacity = expectedVisible-1u;
+		NBL_TEST_CHECK(!system->processInstancesAndFillIndirectDraws(tooSmall,counts));
+		NBL_TEST_CHECK(drawCommands[DrawcallDWORDOffset+1u]==0u);
+	}
+	// no redirect output at all while something gets drawn
+	{
+		auto noRedirects = params;
+		noRedirects.outPerInstanceRedirectAttribs = nullptr;
+		NBL_TEST_CHECK(!system->processInstancesAndFillIndirectDraws(noRedirects,counts));
+		NBL_TEST_CHECK(drawCommands[DrawcallDWORDOffset+1u]==0u);
+	}
+	// no redirect output is fine when nothing gets drawn
+	{
+		auto nothingVisible = params;
+		nothingVisible.outPerInstanceRedirectAttribs = nullptr;
+		nothingVisible.perInstanceRedirectAttribCapacity = 0u;
+		nothingVisible.instanceList = {instances.data(),instances.data()+1u};
+		NBL_TEST_CHECK(system->processInstancesAndFillIndirectDraws(nothingVisible,counts));
+		NBL_TEST_CHECK(counts.drawInstances==0u);
+	}
+}
+
+int main()
+{
+	testHiZ();
+	testProcessInstances();
+	return test::result();
+}
@@ -0,0 +1,216 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// Random edits and reparentings of a random forest, then global transforms and normal matrices recomputed for random nodes (with duplicates) must match a
+// full top-down recompute on every requested path, while nodes off those paths keep their (possibly stale) values and timestamps untouched.
+#include "nbl/scene/CCPUTransformTreeManager.h"
+
+#include <algorithm>
+#include <random>
+
+#include "nblTest.h"
+
+using namespace nbl;
+using namespace scene;
+
+using request_t = CCPUTransformTreeManager::RelativeTransformModificationRequest;
+using range_t = CCPUTransformTreeManager::ModificationRequestRange;
+
+constexpr uint32_t NodeCount = 40000u;
+// parents are picked among this many preceding nodes, makes for trees a few dozen levels deep
+constexpr uint32_t ParentWindow = 48u;
+constexpr uint32_t RoundCount = 6u;
+
+template<typename T>
+static bool bitwiseEqual(const T& lhs, const T& rhs)
+{
+	return memcmp(&lhs,&rhs,sizeof(T))==0;
+}
+
+static core::matrix3x4SIMD randomTransform(std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> angle(-core::PI<float>(),core::PI<float>());
+	std::uniform_real_distribution<float> scale(0.9f,1.1f);
+	std::uniform_real_distribution<float> translation(-1.f,1.f);
+	// some of them flip the handedness, which the normal matrix encoding has to keep track of
+	const float flip = rng()%8u ? 1.f:-1.f;
+	core::matrix3x4SIMD retval;
+	retval.setScaleRotationAndTranslation(
+		core::vectorSIMDf(scale(rng)*flip,scale(rng),scale(rng)),
+		core::quaternion(angle(rng),angle(rng),angle(rng)),
+		core::vectorSIMDf(translation(rng),translation(rng),translation(rng))
+	);
+	return retval;
+}
+
+int main()
+{
+	std::mt19937 rng(46u);
+
+	auto tree = CCPUTransformTree::create(NodeCount,true);
+	auto manager = CCPUTransformTreeManager::create();
+	NBL_TEST_CHECK(tree && tree->hasNormalMatrices() && !CCPUTransformTree::create(0u));
+
+	// `order` is topological, a node's parent always comes before it
+	core::vector<CCPUTransformTree::node_t> order(NodeCount,CCPUTransformTree::invalid_node);
+	NBL_TEST_CHECK(tree->allocateNodes({order.data(),order.data()+NodeCount}));
+	core::vector<uint32_t> position(NodeCount);
+	for (uint32_t i=0u; i<NodeCount; i++)
+		position[order[i]] = i;
+	auto randomParent = [&](const uint32_t i) -> CCPUTransformTree::parent_t
+	{
+		if (i<ParentWindow || rng()%32u==0u)
+			return CCPUTransformTree::invalid_node;
+		return order[i-1u-rng()%ParentWindow];
+	};
+	{
+		core::vector<CCPUTransformTree::parent_t> parents(NodeCount);
+		core::vector<CCPUTransformTree::relative_transform_t> relativeTransforms(NodeCount);
+		for (uint32_t i=0u; i<NodeCount; i++)
+		{
+			parents[i] = randomParent(i);
+			relativeTransforms[i] = randomTransform(rng);
+		}
+		NBL_TEST_CHECK(manager->addNodes({tree.get(),{order.data(),order.data()+NodeCount},parents.data(),relativeTransforms.data()}));
+		NBL_TEST_CHECK(tree->getAllocated()==NodeCount && tree->getFree()==0u);
+		for (uint32_t i=0u; i<NodeCount; i++)
+			NBL_TEST_CHECK(tree->getParents()[order[i]]==parents[i] && bitwiseEqual(tree->getRelativeTransforms()[order[i]],relativeTransforms[i]));
+	}
+
+	core::vector<CCPUTransformTree::relative_transform_t> expectedRelative(tree->getRelativeTransforms(),tree->getRelativeTransforms()+NodeCount);
+	core::vector<CCPUTransformTree::global_transform_t> reference(NodeCount);
+	for (uint32_t round=0u; round<RoundCount; round++)
+	{
+		const auto timestamp = static_cast<CCPUTransformTree::timestamp_t>(round);
+		auto* const parents = tree->getParents();
+
+		// the first round sets every node, later ones only edit or reparent a few
+		core::vector<uint8_t> modified(NodeCount,false);
+		for (uint32_t i=0u; i<NodeCount; i++)
+		{
+			const auto node = order[i];
+			modified[node] = round==0u || rng()%8u==0u;
+			if (round!=0u && rng()%64u==0u)
+			{
+				parents[node] = randomParent(i);
+				modified[node] = true;
+			}
+		}
+
+		core::vector<request_t> requests;
+		core::vector<range_t> ranges;
+		// descendants of a modified node get their timestamps bumped with empty ranges, otherwise they'd count as up to date
+		core::vector<uint8_t> dirty(NodeCount,false);
+		for (const auto node : order)
+		{
+			const auto parent = parents[node];
+			dirty[node] = modified[node] || (parent!=CCPUTransformTree::invalid_node && dirty[parent]);
+			if (!dirty[node])
+				continue;
+
+			range_t range;
+			range.nodeID = node;
+			range.requestsBegin = requests.size();
+			const uint32_t requestCount = modified[node] ? (round==0u ? 1u:rng()%4u):0u;
+			for (uint32_t r=0u; r<requestCount; r++)
+			{
+				const auto type = static_cast<request_t::E_TYPE>(round==0u ? request_t::ET_OVERWRITE:rng()%request_t::ET_COUNT);
+				requests.emplace_back(type,randomTransform(rng),type==request_t::ET_WEIGHTED_ACCUMULATE ? 0.25f:1.f);
+				// the type bits are part of the matrix
+				const auto& modification = *reinterpret_cast<const core::matrix3x4SIMD*>(requests.back().data);
+				auto& relative = expectedRelative[node];
+				switch (type)
+				{
+					case request_t::ET_CONCATENATE_AFTER:
+						relative = core::matrix3x4SIMD::concatenateBFollowedByA(modification,relative);
+						break;
+					case request_t::ET_CONCATENATE_BEFORE:
+						relative = core::matrix3x4SIMD::concatenateBFollowedByA(relative,modification);
+						break;
+					case request_t::ET_WEIGHTED_ACCUMULATE:
+						relative += modification;
+						break;
+					default:
+						relative = modification;
+						break;
+				}
+			}
+			range.requestsEnd = requests.size();
+			range.newTimestamp = timestamp;
+			ranges.push_back(range);
+		}
+		std::shuffle(ranges.begin(),ranges.end(),rng);
+		manager->updateLocalTransforms(tree.get(),ranges.data(),ranges.data()+ranges.size(),requests.data());
+		for (const auto node : order)
+		{
+			NBL_TEST_CHECK(bitwiseEqual(tree->getRelativeTransforms()[node],expectedRelative[node]));
+			NBL_TEST_CHECK(!dirty[node] || tree->getModifiedTimestamps()[node]==timestamp);
+		}
+
+		// a quarter of the nodes in random order, some of them more than once, everything in the first round
+		core::vector<CCPUTransformTree::node_t> toRecompute;
+		for (const auto node : order)
+		if (round==0u || rng()%4u==0u)
+		{
+			toRecompute.push_back(node);
+			if (rng()%16u==0u)
+				toRecompute.push_back(node);
+		}
+		std::shuffle(toRecompute.begin(),toRecompute.end(),rng);
+
+		const core::vector<CCPUTransformTree::global_transform_t> globalsBefore(tree->getGlobalTransforms(),tree->getGlobalTransforms()+NodeCount);
+		const core::vector<CCPUTransformTree::recomputed_stamp_t> stampsBefore(tree->getRecomputedTimestamps(),tree->getRecomputedTimestamps()+NodeCount);
+		const core::vector<CCPUTransformTree::normal_matrix_t> normalsBefore(tree->getNormalMatrices(),tree->getNormalMatrices()+NodeCount);
+		manager->recomputeGlobalTransforms(tree.get(),toRecompute.data(),toRecompute.data()+toRecompute.size());
+
+		// full recompute from the roots down
+		for (const auto node : order)
+		{
+			const auto parent = parents[node];
+			reference[node] = parent!=CCPUTransformTree::invalid_node ? core::matrix3x4SIMD::concatenateBFollowedByA(reference[parent],expectedRelative[node]):expectedRelative[node];
+		}
+		core::vector<uint8_t> onPath(NodeCount,false);
+		for (const auto requested : toRecompute)
+		for (auto node=requested; node!=CCPUTransformTree::invalid_node && !onPath[node]; node=parents[node])
+			onPath[node] = true;
+
+		uint32_t leftStale = 0u;
+		for (const auto node : order)
+		{
+			const bool upToDate = tree->getRecomputedTimestamps()[node]==tree->getModifiedTimestamps()[node];
+			const auto& global = tree->getGlobalTransforms()[node];
+			const auto& normalMatrix = tree->getNormalMatrices()[node];
+			if (onPath[node])
+			{
+				NBL_TEST_CHECK(upToDate);
+				NBL_TEST_CHECK(bitwiseEqual(global,reference[node]));
+				NBL_TEST_CHECK(bitwiseEqual(normalMatrix,CCPUTransformTreeManager::encodeNormalMatrix(reference[node])));
+			}
+			else
+			{
+				NBL_TEST_CHECK(tree->getRecomputedTimestamps()[node]==stampsBefore[node]);
+				NBL_TEST_CHECK(bitwiseEqual(global,globalsBefore[node]) && bitwiseEqual(normalMatrix,normalsBefore[node]));
+				// every descendant of an edit got bumped, so whatever counts as up to date has to be right
+				if (upToDate)
+					NBL_TEST_CHECK(bitwiseEqual(global,reference[node]));
+				else
+					leftStale++;
+			}
+		}
+		// make sure the stale nodes off the requested paths actually got exercised
+		NBL_TEST_CHECK(round==0u || leftStale!=0u);
+	}
+
+	// freed nodes go back to the allocator and come out again
+	core::vector<CCPUTransformTree::node_t> removed(order.begin(),order.begin()+NodeCount/2u);
+	manager->removeNodes(tree.get(),removed.data(),removed.data()+removed.size());
+	NBL_TEST_CHECK(tree->getAllocated()==NodeCount-removed.size());
+	core::vector<CCPUTransformTree::node_t> readded(removed.size(),CCPUTransformTree::invalid_node);
+	NBL_TEST_CHECK(manager->addNodes({tree.get(),{readded.data(),readded.data()+readded.size()}}));
+	NBL_TEST_CHECK(tree->getFree()==0u);
+	for (const auto node : readded)
+		NBL_TEST_CHECK(tree->getParents()[node]==CCPUTransformTree::invalid_node && bitwiseEqual(tree->getRelativeTransforms()[node],core::matrix3x4SIMD()));
+
+	return test::result();
+}
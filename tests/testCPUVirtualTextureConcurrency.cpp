@@ -0,0 +1,160 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// Textures get allocated (also through the base class), committed and aliased from many threads at once,
+// no two of them may share page table space or physical pages, and aliases must see their master's pages.
+#include "nbl/asset/utils/ICPUVirtualTexture.h"
+
+#include <functional>
+#include <set>
+#include <thread>
+
+#include "nblTest.h"
+
+using namespace nbl;
+using namespace asset;
+
+constexpr uint32_t ThreadCount = 8u;
+constexpr uint32_t TexturesPerThread = 2u;
+constexpr uint32_t TextureExtent = 512u;
+constexpr uint32_t PageExtentLog2 = 7u;
+constexpr uint32_t MipLevelCount = 10u;
+
+// full mip chain, the virtual texture packs the levels smaller than a page into a miptail
+static core::smart_refctd_ptr<ICPUImage> createTexture(const uint8_t value)
+{
+	ICPUImage::SCreationParams params = {};
+	params.type = IImage::ET_2D;
+	params.format = EF_R8G8B8A8_UNORM;
+	params.extent = {TextureExtent,TextureExtent,1u};
+	params.mipLevels = MipLevelCount;
+	params.arrayLayers = 1u;
+	params.samples = IImage::ESCF_1_BIT;
+	auto image = ICPUImage::create(std::move(params));
+
+	auto regions = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<ICPUImage::SBufferCopy>>(MipLevelCount);
+	size_t bufferSize = 0u;
+	for (uint32_t i=0u; i<MipLevelCount; i++)
+	{
+		const uint32_t mipExtent = TextureExtent>>i;
+		auto& region = (*regions)[i];
+		region.bufferOffset = bufferSize;
+		region.bufferRowLength = mipExtent;
+		region.bufferImageHeight = 0u;
+		region.imageSubresource.aspectMask = IImage::EAF_COLOR_BIT;
+		region.imageSubresource.mipLevel = i;
+		region.imageSubresource.baseArrayLayer = 0u;
+		region.imageSubresource.layerCount = 1u;
+		region.imageOffset = {0,0,0};
+		region.imageExtent = {mipExtent,mipExtent,1u};
+		bufferSize += mipExtent*mipExtent*4u;
+	}
+	auto buffer = core::make_smart_refctd_ptr<ICPUBuffer>(bufferSize);
+	memset(buffer->getPointer(),value,buffer->getSize());
+	image->setBufferAndRegions(std::move(buffer),regions);
+	return image;
+}
+
+static uint32_t readPageTableTexel(const ICPUVirtualTexture* vt, const uint32_t x, const uint32_t y, const uint32_t layer)
+{
+	const ICPUImage* pageTable = vt->getPageTable();
+	const core::vectorSIMDu32 texelPos(x,y,0u,layer);
+	const auto* region = pageTable->getRegion(0u,texelPos);
+	const uint64_t byteoffset = region->getByteOffset(texelPos,region->getByteStrides(pageTable->getTexelBlockInfo()));
+	return *reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(pageTable->getBuffer()->getPointer())+byteoffset);
+}
+
+int main()
+{
+	// storages get created on demand, like the Mitsuba loader does it
+	const E_FORMAT format = EF_R8G8B8A8_UNORM;
+	auto vt = core::make_smart_refctd_ptr<ICPUVirtualTexture>([](E_FORMAT_CLASS) -> uint32_t {return 4u;},PageExtentLog2,8u,14u);
+	IVirtualTexture<ICPUImageView,ICPUSampler>* const base = vt.get();
+
+	IImage::SSubresourceRange subres = {};
+	subres.levelCount = MipLevelCount;
+	subres.layerCount = 1u;
+	const VkExtent3D extent = {TextureExtent,TextureExtent,1u};
+	// aliases only cover the levels with page table entries of their own
+	IImage::SSubresourceRange aliasSubres = subres;
+	aliasSubres.levelCount = MipLevelCount-PageExtentLog2;
+
+	struct STexture
+	{
+		core::smart_refctd_ptr<ICPUImage> image;
+		// texture data can't be default constructed
+		ICPUVirtualTexture::SMasterTextureData addr = ICPUVirtualTexture::SMasterTextureData::invalid();
+		// same layout as `SViewAliasTextureData`
+		ICPUVirtualTexture::SMasterTextureData alias = ICPUVirtualTexture::SMasterTextureData::invalid();
+		bool committed = false;
+	};
+	core::vector<STexture> textures(ThreadCount*TexturesPerThread+1u);
+	for (size_t i=0u; i<textures.size(); i++)
+		textures[i].image = createTexture(i);
+	// the first allocation of a format creates its storage, which is not thread-safe
+	textures.back().addr = vt->alloc(format,extent,subres,ISampler::ETC_CLAMP_TO_EDGE,ISampler::ETC_CLAMP_TO_EDGE);
+
+	auto runThreads = [](const std::function<void(uint32_t)>& work) -> void
+	{
+		core::vector<std::thread> threads;
+		for (uint32_t t=0u; t<ThreadCount; t++)
+			threads.emplace_back(work,t);
+		for (auto& thread : threads)
+			thread.join();
+	};
+	runThreads([&](const uint32_t t) -> void
+	{
+		for (uint32_t i=0u; i<TexturesPerThread; i++)
+		{
+			auto& texture = textures[t*TexturesPerThread+i];
+			// every other allocation goes through the base class, which must take the same lock
+			if (i&0x1u)
+				texture.addr = base->alloc(format,extent,subres,ISampler::ETC_CLAMP_TO_EDGE,ISampler::ETC_CLAMP_TO_EDGE);
+			else
+				texture.addr = vt->alloc(format,extent,subres,ISampler::ETC_CLAMP_TO_EDGE,ISampler::ETC_CLAMP_TO_EDGE);
+		}
+	});
+	// creates the page table and the physical storage
+	vt->shrink();
+	runThreads([&](const uint32_t t) -> void
+	{
+		for (uint32_t i=0u; i<TexturesPerThread; i++)
+		{
+			auto& texture = textures[t*TexturesPerThread+i];
+			if (ICPUVirtualTexture::SMasterTextureData::is_invalid(texture.addr))
+				continue;
+			texture.committed = vt->commit(texture.addr,texture.image.get(),subres,ISampler::ETC_CLAMP_TO_EDGE,ISampler::ETC_CLAMP_TO_EDGE,ISampler::ETBC_FLOAT_OPAQUE_BLACK);
+			const auto alias = vt->createAlias(texture.addr,format,aliasSubres);
+			memcpy(&texture.alias,&alias,sizeof(alias));
+		}
+	});
+	textures.back().committed = vt->commit(textures.back().addr,textures.back().image.get(),subres,ISampler::ETC_CLAMP_TO_EDGE,ISampler::ETC_CLAMP_TO_EDGE,ISampler::ETBC_FLOAT_OPAQUE_BLACK);
+	textures.back().alias = textures.back().addr;
+
+	constexpr uint32_t PagesPerSide = TextureExtent>>PageExtentLog2;
+	std::set<std::tuple<uint32_t,uint32_t,uint32_t>> pageTableTexels;
+	std::set<uint32_t> physicalPages;
+	for (const auto& texture : textures)
+	{
+		NBL_TEST_CHECK(!ICPUVirtualTexture::SMasterTextureData::is_invalid(texture.addr));
+		NBL_TEST_CHECK(!ICPUVirtualTexture::SMasterTextureData::is_invalid(texture.alias));
+		NBL_TEST_CHECK(texture.committed);
+		if (!texture.committed || ICPUVirtualTexture::SMasterTextureData::is_invalid(texture.alias))
+			continue;
+		const bool hasAlias = &texture!=&textures.back();
+		for (uint32_t y=0u; y<PagesPerSide; y++)
+		for (uint32_t x=0u; x<PagesPerSide; x++)
+		{
+			NBL_TEST_CHECK(pageTableTexels.emplace(texture.addr.pgTab_x+x,texture.addr.pgTab_y+y,texture.addr.pgTab_layer).second);
+			if (hasAlias)
+				NBL_TEST_CHECK(pageTableTexels.emplace(texture.alias.pgTab_x+x,texture.alias.pgTab_y+y,texture.alias.pgTab_layer).second);
+			const uint32_t physAddr = readPageTableTexel(vt.get(),texture.addr.pgTab_x+x,texture.addr.pgTab_y+y,texture.addr.pgTab_layer);
+			// low 16 bits are the page itself, the high ones the miptail page
+			NBL_TEST_CHECK(physicalPages.insert(physAddr&0xffffu).second);
+			NBL_TEST_CHECK(readPageTableTexel(vt.get(),texture.alias.pgTab_x+x,texture.alias.pgTab_y+y,texture.alias.pgTab_layer)==physAddr);
+		}
+	}
+
+	return test::result();
+}
@@ -0,0 +1,206 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// Single threaded the allocator must hand out blocks in the same order as `PoolAddressAllocator` (also after `reset` and resizes),
+// and threads hammering a pool of a few blocks (where ABA would strike) must never get the same block twice or lose one.
+#include "nbl/core/declarations.h"
+
+#include <random>
+#include <thread>
+
+#include "nblTest.h"
+
+using namespace nbl;
+
+using allocator_t = core::ConcurrentPoolAddressAllocator<uint32_t>;
+using reference_t = core::PoolAddressAllocator<uint32_t>;
+
+constexpr uint32_t AddressOffset = 48u;
+constexpr uint32_t AlignOffset = 16u;
+constexpr uint32_t BlockSize = 32u;
+constexpr uint32_t ThreadCount = 8u;
+constexpr uint32_t IterationCount = 20000u;
+
+struct SReservedSpace
+{
+	SReservedSpace(const size_t size) : ptr(_NBL_ALIGNED_MALLOC(size,_NBL_SIMD_ALIGNMENT)) {}
+	~SReservedSpace() {_NBL_ALIGNED_FREE(ptr);}
+
+	void* const ptr;
+};
+
+static uint32_t bufferSize(const uint32_t blockCount)
+{
+	return AlignOffset+blockCount*BlockSize;
+}
+
+// takes everything that's left, in the order the allocator hands it out
+template<class Allocator>
+static core::vector<uint32_t> drain(Allocator& allocator)
+{
+	core::vector<uint32_t> retval;
+	for (uint32_t addr; (addr=allocator.alloc_addr(BlockSize,BlockSize))!=Allocator::invalid_address;)
+		retval.push_back(addr);
+	return retval;
+}
+
+int main()
+{
+	// same block order as the single threaded allocator, through frees, `reset` and resizing
+	{
+		constexpr uint32_t BlockCount = 64u;
+		SReservedSpace reservedSpaces[4] = {
+			allocator_t::reserved_size(BlockSize,bufferSize(BlockCount),BlockSize),reference_t::reserved_size(BlockSize,bufferSize(BlockCount),BlockSize),
+			allocator_t::reserved_size(BlockSize,bufferSize(BlockCount*2u),BlockSize),reference_t::reserved_size(BlockSize,bufferSize(BlockCount*2u),BlockSize)
+		};
+		allocator_t allocator(reservedSpaces[0].ptr,AddressOffset,AlignOffset,BlockSize,bufferSize(BlockCount),BlockSize);
+		reference_t reference(reservedSpaces[1].ptr,AddressOffset,AlignOffset,BlockSize,bufferSize(BlockCount),BlockSize);
+		NBL_TEST_CHECK(allocator.get_free_size()==BlockCount*BlockSize);
+		NBL_TEST_CHECK(allocator.alloc_addr(BlockSize+1u,1u)==allocator_t::invalid_address && allocator.alloc_addr(BlockSize,BlockSize*2u)==allocator_t::invalid_address);
+
+		std::mt19937 rng(40u);
+		core::vector<uint32_t> held;
+		for (uint32_t i=0u; i<1000u; i++)
+		{
+			if (held.size()<BlockCount && rng()%3u)
+			{
+				const uint32_t addr = allocator.alloc_addr(1u+rng()%BlockSize,1u);
+				NBL_TEST_CHECK(addr==reference.alloc_addr(BlockSize,1u));
+				held.push_back(addr);
+			}
+			else if (!held.empty())
+			{
+				std::swap(held[rng()%held.size()],held.back());
+				allocator.free_addr(held.back(),BlockSize);
+				reference.free_addr(held.back(),BlockSize);
+				held.pop_back();
+			}
+		}
+		NBL_TEST_CHECK(allocator.get_allocated_size()==held.size()*BlockSize);
+
+		// growing keeps the free blocks' order and appends the new blocks
+		{
+			allocator_t grown(bufferSize(BlockCount*2u),allocator,reservedSpaces[2].ptr);
+			reference_t grownReference(bufferSize(BlockCount*2u),reference,reservedSpaces[3].ptr);
+			NBL_TEST_CHECK(drain(grown)==drain(grownReference));
+		}
+
+		allocator.reset();
+		reference.reset();
+		const auto order = drain(allocator);
+		NBL_TEST_CHECK(order==drain(reference) && order.size()==BlockCount);
+		for (uint32_t i=0u; i<order.size(); i++)
+			NBL_TEST_CHECK(order[i]==AddressOffset+AlignOffset+i*BlockSize);
+
+		// batches skip what's already allocated or invalid, and come back in full
+		allocator.reset();
+		uint32_t addresses[5] = {allocator_t::invalid_address,1234u,allocator_t::invalid_address,allocator_t::invalid_address,allocator_t::invalid_address};
+		const uint32_t bytes[5] = {BlockSize,BlockSize,BlockSize+1u,1u,BlockSize};
+		const uint32_t alignments[5] = {1u,1u,1u,BlockSize,BlockSize};
+		allocator.multi_alloc_addr(5u,addresses,bytes,alignments);
+		NBL_TEST_CHECK(addresses[1]==1234u && addresses[2]==allocator_t::invalid_address);
+		NBL_TEST_CHECK(addresses[0]==order[0] && addresses[3]==order[1] && addresses[4]==order[2]);
+		addresses[1] = allocator_t::invalid_address;
+		allocator.multi_free_addr(5u,addresses,bytes);
+		NBL_TEST_CHECK(allocator.get_allocated_size()==0u && drain(allocator).size()==BlockCount);
+	}
+
+	// a pool of a handful of blocks makes every thread pop and push the same few blocks all the time, the case the ABA tag is there for
+	for (const uint32_t blockCount : {4u,ThreadCount*allocator_t::maxMultiOps})
+	{
+		SReservedSpace reservedSpace(allocator_t::reserved_size(BlockSize,bufferSize(blockCount),BlockSize));
+		allocator_t allocator(reservedSpace.ptr,AddressOffset,AlignOffset,BlockSize,bufferSize(blockCount),BlockSize);
+		// which thread holds a block, a block handed out twice would find someone else there
+		auto owners = std::make_unique<std::atomic_uint32_t[]>(blockCount);
+		for (uint32_t i=0u; i<blockCount; i++)
+			owners[i] = 0u;
+
+		core::vector<std::thread> threads;
+		for (uint32_t t=0u; t<ThreadCount; t++)
+		threads.emplace_back([&,t]() -> void
+		{
+			const uint32_t self = t+1u;
+			std::mt19937 rng(t);
+			core::vector<uint32_t> held;
+			core::vector<uint32_t> batch, batchBytes, batchAlignments;
+			auto take = [&](const uint32_t addr) -> void
+			{
+				const bool valid = addr>=AddressOffset+AlignOffset && (addr-AddressOffset-AlignOffset)%BlockSize==0u && allocator.addressToBlockID(addr)<blockCount;
+				NBL_TEST_CHECK(valid);
+				if (!valid)
+					return;
+				NBL_TEST_CHECK(owners[allocator.addressToBlockID(addr)].exchange(self)==0u);
+				held.push_back(addr);
+			};
+			auto giveBack = [&](const uint32_t addr) -> void
+			{
+				NBL_TEST_CHECK(owners[allocator.addressToBlockID(addr)].exchange(0u)==self);
+			};
+
+			for (uint32_t i=0u; i<IterationCount; i++)
+			{
+				const uint32_t count = 1u+rng()%core::min(allocator_t::maxMultiOps,blockCount);
+				if (held.empty() || rng()%2u)
+				{
+					if (count==1u)
+					{
+						const uint32_t addr = allocator.alloc_addr(BlockSize,1u);
+						if (addr!=allocator_t::invalid_address)
+							take(addr);
+					}
+					else
+					{
+						batch.assign(count,allocator_t::invalid_address);
+						batchBytes.assign(count,BlockSize);
+						batchAlignments.assign(count,1u);
+						allocator.multi_alloc_addr(count,batch.data(),batchBytes.data(),batchAlignments.data());
+						for (const auto addr : batch)
+						if (addr!=allocator_t::invalid_address)
+							take(addr);
+					}
+				}
+				else
+				{
+					std::shuffle(held.begin(),held.end(),rng);
+					const uint32_t freeCount = core::min<uint32_t>(count,held.size());
+					batch.assign(held.end()-freeCount,held.end());
+					held.resize(held.size()-freeCount);
+					for (const auto addr : batch)
+						giveBack(addr);
+					if (freeCount==1u)
+						allocator.free_addr(batch.front(),BlockSize);
+					else
+					{
+						batchBytes.assign(freeCount,BlockSize);
+						allocator.multi_free_addr(freeCount,batch.data(),batchBytes.data());
+					}
+				}
+				if (i%64u==0u)
+					std::this_thread::yield();
+			}
+			for (const auto addr : held)
+			{
+				giveBack(addr);
+				allocator.free_addr(addr,BlockSize);
+			}
+		});
+		for (auto& thread : threads)
+			thread.join();
+
+		// nothing got lost or duplicated
+		NBL_TEST_CHECK(allocator.get_allocated_size()==0u);
+		auto leftover = drain(allocator);
+		std::sort(leftover.begin(),leftover.end());
+		NBL_TEST_CHECK(leftover.size()==blockCount && std::adjacent_find(leftover.begin(),leftover.end())==leftover.end());
+
+		// and `reset` brings back the initial order no matter how the stack got shuffled
+		allocator.reset();
+		const auto order = drain(allocator);
+		NBL_TEST_CHECK(order.size()==blockCount);
+		for (uint32_t i=0u; i<order.size(); i++)
+			NBL_TEST_CHECK(order[i]==AddressOffset+AlignOffset+i*BlockSize);
+	}
+
+	return test::result();
+}
@@ -0,0 +1,167 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// A constant environment must bake to irradiance `E=PI*L` and to `L` in every prefiltered mip, and a dark environment with one very bright texel
+// (the case the environment samples are there for) must stay close to a brute force integration of the split-sum lobe without any fireflies.
+#include "nbl/asset/utils/CEnvironmentMapBaker.h"
+#include "nbl/asset/format/decodePixels.h"
+
+#include "nblTest.h"
+
+using namespace nbl;
+using namespace asset;
+
+using baker_t = CEnvironmentMapBaker;
+
+constexpr uint32_t EquirectWidth = 64u;
+constexpr uint32_t EquirectHeight = 32u;
+constexpr uint32_t CubeSize = 16u;
+constexpr uint32_t FaceSize = 16u;
+
+static core::smart_refctd_ptr<ICPUImage> createEnvironment(const uint32_t width, const uint32_t height, const uint32_t layers, const core::vectorSIMDf& radiance)
+{
+	ICPUImage::SCreationParams params = {};
+	params.type = IImage::ET_2D;
+	params.format = EF_R32G32B32A32_SFLOAT;
+	params.extent = {width,height,1u};
+	params.mipLevels = 1u;
+	params.arrayLayers = layers;
+	params.samples = IImage::ESCF_1_BIT;
+	params.flags = layers==6u ? IImage::ECF_CUBE_COMPATIBLE_BIT:IImage::ECF_NONE;
+	auto image = ICPUImage::create(std::move(params));
+
+	auto regions = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<ICPUImage::SBufferCopy>>(1u);
+	auto& region = regions->front();
+	region.bufferOffset = 0u;
+	region.bufferRowLength = width;
+	region.bufferImageHeight = height;
+	region.imageSubresource.aspectMask = IImage::EAF_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0u;
+	region.imageSubresource.baseArrayLayer = 0u;
+	region.imageSubresource.layerCount = layers;
+	region.imageOffset = {0,0,0};
+	region.imageExtent = {width,height,1u};
+	const size_t texelCount = size_t(width)*height*layers;
+	auto buffer = core::make_smart_refctd_ptr<ICPUBuffer>(texelCount*sizeof(float)*4ull);
+	float* texels = reinterpret_cast<float*>(buffer->getPointer());
+	for (size_t i=0u; i<texelCount; i++)
+		radiance.storeTo4Floats(texels+i*4u);
+	image->setBufferAndRegions(std::move(buffer),regions);
+	return image;
+}
+
+// calls `f(mip,face,direction,value)` for every texel of the baked cubemap
+template<typename F>
+static void forEachTexel(const ICPUImage* prefiltered, F&& f)
+{
+	const auto& params = prefiltered->getCreationParameters();
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(prefiltered->getBuffer()->getPointer());
+	const uint32_t texelSize = getTexelOrBlockBytesize(params.format);
+	for (uint32_t mip=0u; mip<params.mipLevels; mip++)
+	{
+		const uint32_t size = core::max(params.extent.width>>mip,1u);
+		const uint8_t* mipData = data+prefiltered->getRegions().begin()[mip].bufferOffset;
+		for (uint32_t face=0u; face<6u; face++)
+		for (uint32_t y=0u; y<size; y++)
+		for (uint32_t x=0u; x<size; x++)
+		{
+			const void* src[4] = {mipData+((size_t(face)*size+y)*size+x)*texelSize,nullptr,nullptr,nullptr};
+			double decoded[4];
+			decodePixelsRuntime(params.format,src,decoded,0u,0u);
+			const auto dir = core::normalize(baker_t::getCubeFaceDirection(face,(float(x)+0.5f)/float(size)*2.f-1.f,(float(y)+0.5f)/float(size)*2.f-1.f));
+			f(mip,face,dir,core::vectorSIMDf(decoded[0],decoded[1],decoded[2],decoded[3]));
+		}
+	}
+}
+
+static bool closeTo(const core::vectorSIMDf& value, const core::vectorSIMDf& expected, const float relativeTolerance)
+{
+	const auto error = core::abs(value-expected);
+	return error.x<=expected.x*relativeTolerance && error.y<=expected.y*relativeTolerance && error.z<=expected.z*relativeTolerance;
+}
+
+int main()
+{
+	// constant radiance, both parametrizations
+	const core::vectorSIMDf constantRadiance(0.5f,1.f,2.f);
+	for (const bool cube : {false,true})
+	{
+		const auto environment = cube ? createEnvironment(CubeSize,CubeSize,6u,constantRadiance):createEnvironment(EquirectWidth,EquirectHeight,1u,constantRadiance);
+		baker_t::SParams params;
+		params.environment = environment.get();
+		params.faceSize = FaceSize;
+		params.sampleCount = 256u;
+		params.prefilteredFormat = EF_R32G32B32A32_SFLOAT;
+		const auto result = baker_t::bake(params);
+		NBL_TEST_CHECK(result.prefiltered && result.prefiltered->getCreationParameters().mipLevels==core::findMSB(FaceSize)+1u);
+		if (!result.prefiltered)
+			continue;
+
+		forEachTexel(result.prefiltered.get(),[&](const uint32_t mip, const uint32_t face, const core::vectorSIMDf& dir, const core::vectorSIMDf& value) -> void
+		{
+			NBL_TEST_CHECK(closeTo(value,constantRadiance,1e-5f) && value.w==1.f);
+			NBL_TEST_CHECK(closeTo(baker_t::evaluateSH9(result.irradianceSH,dir),constantRadiance*core::PI<float>(),1e-3f));
+		});
+	}
+
+	// dim background and a single texel carrying most of the energy
+	{
+		const core::vectorSIMDf background(0.05f,0.05f,0.05f);
+		const core::vectorSIMDf sun(3000.f,2000.f,1000.f);
+		constexpr uint32_t SunX = 40u, SunY = 9u;
+		const auto environment = createEnvironment(EquirectWidth,EquirectHeight,1u,background);
+		float* texels = reinterpret_cast<float*>(environment->getBuffer()->getPointer());
+		sun.storeTo4Floats(texels+(SunY*EquirectWidth+SunX)*4u);
+
+		baker_t::SParams params;
+		params.environment = environment.get();
+		params.faceSize = FaceSize;
+		params.sampleCount = 1024u;
+		params.scrambleSeed = 50u;
+		params.prefilteredFormat = EF_R32G32B32A32_SFLOAT;
+		const auto result = baker_t::bake(params);
+		NBL_TEST_CHECK(result.prefiltered);
+		if (!result.prefiltered)
+			return test::result();
+		const uint32_t mipCount = result.prefiltered->getCreationParameters().mipLevels;
+
+		// the split-sum lobe integrated over every environment texel, supersampled so that the bright one gets resolved
+		constexpr uint32_t Supersampling = 8u;
+		auto bruteForce = [&](const core::vectorSIMDf& N, const float alpha2) -> core::vectorSIMDf
+		{
+			core::vectorSIMDf radiance(0.f);
+			double weight = 0.0;
+			for (uint32_t y=0u; y<EquirectHeight*Supersampling; y++)
+			{
+				const float cosTop = std::cos(core::PI<float>()*float(y)/float(EquirectHeight*Supersampling));
+				const float cosBottom = std::cos(core::PI<float>()*float(y+1u)/float(EquirectHeight*Supersampling));
+				const float solidAngle = 2.f*core::PI<float>()/float(EquirectWidth*Supersampling)*(cosTop-cosBottom);
+				for (uint32_t x=0u; x<EquirectWidth*Supersampling; x++)
+				{
+					const auto L = baker_t::getEquirectDirection((float(x)+0.5f)/float(EquirectWidth*Supersampling),(float(y)+0.5f)/float(EquirectHeight*Supersampling));
+					const float NdotL = core::dot(N,L).x;
+					if (NdotL<=0.f)
+						continue;
+					const float NdotH = std::sqrt((1.f+NdotL)*0.5f);
+					const float denom = NdotH*NdotH*(alpha2-1.f)+1.f;
+					const float w = NdotL*alpha2/(denom*denom)*solidAngle;
+					radiance += core::vectorSIMDf(texels+(size_t(y/Supersampling)*EquirectWidth+x/Supersampling)*4u)*w;
+					weight += w;
+				}
+			}
+			return radiance/float(weight);
+		};
+
+		// the sun is tiny in every lobe but the sharpest, without the environment samples some texels are off by orders of magnitude
+		forEachTexel(result.prefiltered.get(),[&](const uint32_t mip, const uint32_t face, const core::vectorSIMDf& dir, const core::vectorSIMDf& value) -> void
+		{
+			if (mip==0u)
+				return;
+			const float roughness = float(mip)/float(mipCount-1u);
+			NBL_TEST_CHECK(closeTo(value,bruteForce(dir,roughness*roughness*roughness*roughness),0.02f));
+		});
+	}
+
+	return test::result();
+}
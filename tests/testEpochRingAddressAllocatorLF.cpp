@@ -0,0 +1,167 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// Producers pin, allocate, fill and hand allocations over while a submitter retires epochs and a fake GPU reclaims them one submission late,
+// nothing the GPU could still be reading may ever be handed out again (the allocator behind `StreamingTransientDataBufferLF`).
+#include "nbl/core/declarations.h"
+
+#include <algorithm>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "nblTest.h"
+
+using namespace nbl;
+
+using allocator_t = core::EpochRingAddressAllocatorLF<uint32_t>;
+
+constexpr uint32_t AddressOffset = 256u;
+constexpr uint32_t RingSize = 0x40000u;
+constexpr uint32_t ChunkSize = 0x1000u;
+constexpr uint32_t ProducerCount = 6u;
+constexpr uint32_t BatchesPerProducer = 3000u;
+
+struct SAllocation
+{
+	uint32_t address;
+	uint32_t size;
+	uint32_t tag;
+};
+
+static uint8_t tagByte(const uint32_t tag, const uint32_t i)
+{
+	return static_cast<uint8_t>((tag*2654435761u)>>24u)^static_cast<uint8_t>(i);
+}
+
+// every allocation still in flight must be intact and none of them may overlap
+static void verify(const core::vector<SAllocation>& inFlight, const uint8_t* memory)
+{
+	auto sorted = inFlight;
+	std::sort(sorted.begin(),sorted.end(),[](const SAllocation& lhs, const SAllocation& rhs) -> bool {return lhs.address<rhs.address;});
+	for (size_t i=1u; i<sorted.size(); i++)
+		NBL_TEST_CHECK(sorted[i-1u].address+sorted[i-1u].size<=sorted[i].address);
+	for (const auto& allocation : inFlight)
+	{
+		bool intact = true;
+		for (uint32_t i=0u; i<allocation.size; i++)
+			intact = intact && memory[allocation.address+i]==tagByte(allocation.tag,i);
+		NBL_TEST_CHECK(intact);
+	}
+}
+
+int main()
+{
+	// a whole ring allocation only comes back once its epoch's value is reached, and pinned threads hold back `retire`
+	{
+		allocator_t allocator(AddressOffset,RingSize,ChunkSize);
+		NBL_TEST_CHECK(allocator.alloc_addr(RingSize+1u,1u)==allocator_t::invalid_address);
+		NBL_TEST_CHECK(allocator.alloc_addr(RingSize,ChunkSize)==AddressOffset);
+		NBL_TEST_CHECK(allocator.alloc_addr(1u,1u)==allocator_t::invalid_address);
+		NBL_TEST_CHECK(allocator.max_size()==0u);
+		NBL_TEST_CHECK(allocator.retire(5u));
+		allocator.reclaim(4u);
+		NBL_TEST_CHECK(allocator.pending_epochs()==1u && allocator.oldest_pending_value()==5u);
+		NBL_TEST_CHECK(allocator.alloc_addr(1u,1u)==allocator_t::invalid_address);
+		allocator.reclaim(5u);
+		NBL_TEST_CHECK(allocator.pending_epochs()==0u && allocator.max_size()==RingSize);
+
+		std::atomic_bool pinned = false, handedOver = false;
+		std::thread producer([&]() -> void
+		{
+			allocator.pin();
+			pinned = true;
+			NBL_TEST_CHECK(allocator.alloc_addr(16u,16u)!=allocator_t::invalid_address);
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			handedOver = true;
+			allocator.unpin();
+		});
+		while (!pinned) {}
+		NBL_TEST_CHECK(allocator.retire(6u));
+		NBL_TEST_CHECK(handedOver);
+		producer.join();
+	}
+
+	allocator_t allocator(AddressOffset,RingSize,ChunkSize);
+	core::vector<uint8_t> memory(AddressOffset+RingSize);
+	std::mutex handOverMutex;
+	core::vector<SAllocation> handedOver;
+	std::atomic_uint64_t completedValue = 0ull;
+	std::atomic_uint32_t producersLeft = ProducerCount;
+
+	core::vector<std::thread> producers;
+	for (uint32_t p=0u; p<ProducerCount; p++)
+	producers.emplace_back([&,p]() -> void
+	{
+		std::mt19937 rng(p);
+		std::uniform_int_distribution<uint32_t> countDist(1u,4u);
+		std::uniform_int_distribution<uint32_t> sizeDist(1u,3000u);
+		std::uniform_int_distribution<uint32_t> alignmentLog2Dist(0u,8u);
+		core::vector<SAllocation> batch;
+		for (uint32_t b=0u; b<BatchesPerProducer;)
+		{
+			batch.clear();
+			allocator.pin();
+			const uint32_t count = countDist(rng);
+			for (uint32_t i=0u; i<count; i++)
+			{
+				const uint32_t size = sizeDist(rng);
+				const uint32_t alignment = 0x1u<<alignmentLog2Dist(rng);
+				const uint32_t address = allocator.alloc_addr(size,alignment);
+				if (address==allocator_t::invalid_address)
+					break;
+				NBL_TEST_CHECK((address&(alignment-1u))==0u && address>=AddressOffset && address+size<=AddressOffset+RingSize);
+				const uint32_t tag = (p<<24u)|(b<<2u)|i;
+				for (uint32_t j=0u; j<size; j++)
+					memory[address+j] = tagByte(tag,j);
+				batch.push_back({address,size,tag});
+			}
+			// stands in for the rest of the work done before handing over, gives `retire` a chance to run meanwhile
+			std::this_thread::yield();
+			// the half-made batch gets handed over anyway, a pinned thread must not wait for the GPU
+			{
+				std::lock_guard lock(handOverMutex);
+				handedOver.insert(handedOver.end(),batch.begin(),batch.end());
+			}
+			allocator.unpin();
+			if (batch.size()==count)
+				b++;
+			else
+			{
+				allocator.reclaim(completedValue.load());
+				std::this_thread::yield();
+			}
+		}
+		producersLeft--;
+	});
+
+	// the submitter, the GPU finishes reading a submission only once the next one got submitted
+	core::vector<SAllocation> submitted, previous;
+	for (uint64_t value=1ull; true; value++)
+	{
+		const bool last = !producersLeft.load();
+		NBL_TEST_CHECK(allocator.retire(value));
+		previous.swap(submitted);
+		{
+			std::lock_guard lock(handOverMutex);
+			submitted.swap(handedOver);
+			handedOver.clear();
+		}
+		auto inFlight = previous;
+		inFlight.insert(inFlight.end(),submitted.begin(),submitted.end());
+		verify(inFlight,memory.data());
+		completedValue = value-1ull;
+		allocator.reclaim(completedValue);
+		if (last)
+			break;
+	}
+	for (auto& producer : producers)
+		producer.join();
+	completedValue = ~0ull;
+	allocator.reclaim(completedValue);
+	// the head is wherever the producers left it, so only the larger side of the ring is contiguous
+	NBL_TEST_CHECK(allocator.pending_epochs()==0u && allocator.max_size()>=RingSize/2u);
+
+	return test::result();
+}
@@ -0,0 +1,166 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// FFT convolutions must match brute force ones, at transform sizes with and without a radix-2 stage, with off-center kernels,
+// single channel kernels applied to every channel, and the kernel spectrum reused across executions only while it is still usable.
+#include "nbl/asset/filters/CFFTConvolutionImageFilter.h"
+
+#include <random>
+
+#include "nblTest.h"
+
+using namespace nbl;
+using namespace asset;
+
+using filter_t = CFFTConvolutionImageFilter;
+
+struct SImage
+{
+	core::smart_refctd_ptr<ICPUImage> image;
+	uint32_t width, height, channelCount;
+
+	inline float* data() const {return reinterpret_cast<float*>(image->getBuffer()->getPointer());}
+	inline float& at(const uint32_t x, const uint32_t y, const uint32_t c) const {return data()[(size_t(y)*width+x)*channelCount+c];}
+};
+
+static SImage createImage(const E_FORMAT format, const uint32_t width, const uint32_t height, std::mt19937& rng)
+{
+	ICPUImage::SCreationParams params = {};
+	params.type = IImage::ET_2D;
+	params.format = format;
+	params.extent = {width,height,1u};
+	params.mipLevels = 1u;
+	params.arrayLayers = 1u;
+	params.samples = IImage::ESCF_1_BIT;
+	SImage retval = {ICPUImage::create(std::move(params)),width,height,getFormatChannelCount(format)};
+
+	auto regions = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<ICPUImage::SBufferCopy>>(1u);
+	auto& region = regions->front();
+	region.bufferOffset = 0u;
+	region.bufferRowLength = width;
+	region.bufferImageHeight = 0u;
+	region.imageSubresource.aspectMask = IImage::EAF_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0u;
+	region.imageSubresource.baseArrayLayer = 0u;
+	region.imageSubresource.layerCount = 1u;
+	region.imageOffset = {0,0,0};
+	region.imageExtent = {width,height,1u};
+	retval.image->setBufferAndRegions(core::make_smart_refctd_ptr<ICPUBuffer>(size_t(width)*height*retval.channelCount*sizeof(float)),regions);
+
+	std::uniform_real_distribution<float> dist(-1.f,1.f);
+	std::generate_n(retval.data(),size_t(width)*height*retval.channelCount,[&]() -> float {return dist(rng);});
+	return retval;
+}
+
+// `out(p) = sum_t kernel(t)*in(p+center-t)` over the `offset,extent` window of the input, zero outside of it
+static bool matchesBruteForce(const SImage& in, const SImage& out, const SImage& kernel, const filter_t::state_type& state, const int32_t centerX, const int32_t centerY)
+{
+	double maxError = 0.0, maxValue = 0.0;
+	for (int32_t y=0; y<int32_t(state.extent.height); y++)
+	for (int32_t x=0; x<int32_t(state.extent.width); x++)
+	for (uint32_t c=0u; c<in.channelCount; c++)
+	{
+		double expected = 0.0;
+		for (int32_t ky=0; ky<int32_t(kernel.height); ky++)
+		for (int32_t kx=0; kx<int32_t(kernel.width); kx++)
+		{
+			const int32_t sx = x+centerX-kx, sy = y+centerY-ky;
+			if (sx<0 || sy<0 || sx>=int32_t(state.extent.width) || sy>=int32_t(state.extent.height))
+				continue;
+			expected += double(kernel.at(kx,ky,kernel.channelCount>1u ? c:0u))*in.at(sx+state.inOffset.x,sy+state.inOffset.y,c);
+		}
+		maxError = core::max(maxError,core::abs(expected-out.at(x+state.outOffset.x,y+state.outOffset.y,c)));
+		maxValue = core::max(maxValue,core::abs(expected));
+	}
+	return maxError<=1e-5*core::max(maxValue,1.0);
+}
+
+int main()
+{
+	std::mt19937 rng(49u);
+
+	struct SCase
+	{
+		E_FORMAT format;
+		E_FORMAT kernelFormat;
+		VkExtent3D extent;
+		VkExtent3D kernelExtent;
+		core::vectorSIMDi32 kernelCenter;
+	};
+	const SCase cases[] = {
+		// pads to 32x16, both transform lengths are powers of 4
+		{EF_R32G32B32A32_SFLOAT,EF_R32G32B32A32_SFLOAT,{21u,9u,1u},{9u,5u,1u},core::vectorSIMDi32(-1)},
+		// pads to 64x32, both transform lengths (32 complex per row and 32 per column) end in a radix-2 stage
+		{EF_R32G32B32A32_SFLOAT,EF_R32_SFLOAT,{50u,20u,1u},{13u,11u,1u},core::vectorSIMDi32(2,9,0,0)},
+		// pads to 16x8, 8 complex per row and 8 per column are odd powers of two as well
+		{EF_R32G32_SFLOAT,EF_R32G32_SFLOAT,{9u,5u,1u},{7u,4u,1u},core::vectorSIMDi32(6,0,0,0)},
+		// kernel bigger than the image
+		{EF_R32_SFLOAT,EF_R32_SFLOAT,{6u,7u,1u},{17u,12u,1u},core::vectorSIMDi32(3,11,0,0)}
+	};
+	for (const auto& testCase : cases)
+	{
+		// only a window of the input and output gets used
+		const SImage in = createImage(testCase.format,testCase.extent.width+3u,testCase.extent.height+2u,rng);
+		const SImage out = createImage(testCase.format,testCase.extent.width+1u,testCase.extent.height+4u,rng);
+		const SImage kernel = createImage(testCase.kernelFormat,testCase.kernelExtent.width,testCase.kernelExtent.height,rng);
+
+		filter_t::state_type state;
+		state.inImage = in.image.get();
+		state.outImage = out.image.get();
+		state.inOffset = {2u,1u,0u};
+		state.outOffset = {1u,3u,0u};
+		state.extent = testCase.extent;
+		state.layerCount = 1u;
+		state.kernel = kernel.image.get();
+		state.kernelCenter = testCase.kernelCenter;
+		core::vector<uint8_t> scratch(filter_t::state_type::getRequiredScratchByteSize(in.image.get(),state.getPaddedExtent()));
+		state.scratchMemory = scratch.data();
+		state.scratchMemoryByteSize = scratch.size();
+
+		const int32_t centerX = testCase.kernelCenter.x<0 ? int32_t(testCase.kernelExtent.width/2u):testCase.kernelCenter.x;
+		const int32_t centerY = testCase.kernelCenter.y<0 ? int32_t(testCase.kernelExtent.height/2u):testCase.kernelCenter.y;
+		NBL_TEST_CHECK(filter_t::execute(core::execution::seq,&state));
+		NBL_TEST_CHECK(matchesBruteForce(in,out,kernel,state,centerX,centerY));
+
+		// the spectrum gets reused for another image of the same size, by the parallel path this time
+		const auto* spectrum = state.kernelSpectrum.get();
+		const SImage otherIn = createImage(testCase.format,in.width,in.height,rng);
+		state.inImage = otherIn.image.get();
+		NBL_TEST_CHECK(filter_t::execute(core::execution::par_unseq,&state));
+		NBL_TEST_CHECK(state.kernelSpectrum.get()==spectrum);
+		NBL_TEST_CHECK(matchesBruteForce(otherIn,out,kernel,state,centerX,centerY));
+	}
+
+	// a spectrum of the right padded size but with the wrong channel count has to get recreated from the kernel
+	{
+		const SImage in4 = createImage(EF_R32G32B32A32_SFLOAT,12u,6u,rng);
+		const SImage out4 = createImage(EF_R32G32B32A32_SFLOAT,12u,6u,rng);
+		const SImage kernel4 = createImage(EF_R32G32B32A32_SFLOAT,5u,3u,rng);
+		const SImage in2 = createImage(EF_R32G32_SFLOAT,12u,6u,rng);
+		const SImage out2 = createImage(EF_R32G32_SFLOAT,12u,6u,rng);
+		const SImage kernel2 = createImage(EF_R32G32_SFLOAT,5u,3u,rng);
+
+		filter_t::state_type state;
+		state.inImage = in4.image.get();
+		state.outImage = out4.image.get();
+		state.extent = {12u,6u,1u};
+		state.layerCount = 1u;
+		state.kernel = kernel4.image.get();
+		core::vector<uint8_t> scratch(filter_t::state_type::getRequiredScratchByteSize(in4.image.get(),state.getPaddedExtent()));
+		state.scratchMemory = scratch.data();
+		state.scratchMemoryByteSize = scratch.size();
+		NBL_TEST_CHECK(filter_t::execute(&state));
+		NBL_TEST_CHECK(matchesBruteForce(in4,out4,kernel4,state,2,1));
+		NBL_TEST_CHECK(state.kernelSpectrum && state.kernelSpectrum->getChannelCount()==4u);
+
+		state.inImage = in2.image.get();
+		state.outImage = out2.image.get();
+		state.kernel = kernel2.image.get();
+		NBL_TEST_CHECK(filter_t::execute(&state));
+		NBL_TEST_CHECK(state.kernelSpectrum->getChannelCount()==2u);
+		NBL_TEST_CHECK(matchesBruteForce(in2,out2,kernel2,state,2,1));
+	}
+
+	return test::result();
+}
@@ -0,0 +1,283 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// Materials sharing nodes and textures compiled on all cores must come out byte for byte the same as compiled one after another
+// (instructions, BSDF data, prefetch streams and virtual texture allocations), and the IR must not get touched.
+#include "nbl/asset/material_compiler/CMaterialCompilerGLSLRasterBackend.h"
+
+#include <random>
+
+#include "nblTest.h"
+
+using namespace nbl;
+using namespace asset;
+using namespace material_compiler;
+
+using backend_t = CMaterialCompilerGLSLRasterBackend;
+
+constexpr uint32_t TextureCount = 12u;
+constexpr uint32_t LeafCount = 48u;
+constexpr uint32_t RootCount = 96u;
+
+static core::smart_refctd_ptr<ICPUImageView> createTexture(const uint32_t extent)
+{
+	ICPUImage::SCreationParams params = {};
+	params.type = IImage::ET_2D;
+	params.format = EF_R8G8B8A8_UNORM;
+	params.extent = {extent,extent,1u};
+	params.mipLevels = 1u;
+	params.arrayLayers = 1u;
+	params.samples = IImage::ESCF_1_BIT;
+	auto image = ICPUImage::create(std::move(params));
+
+	auto regions = core::make_refctd_dynamic_array<core::smart_refctd_dynamic_array<ICPUImage::SBufferCopy>>(1u);
+	auto& region = regions->front();
+	region.bufferOffset = 0u;
+	region.bufferRowLength = extent;
+	region.bufferImageHeight = 0u;
+	region.imageSubresource.aspectMask = IImage::EAF_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0u;
+	region.imageSubresource.baseArrayLayer = 0u;
+	region.imageSubresource.layerCount = 1u;
+	region.imageOffset = {0,0,0};
+	region.imageExtent = {extent,extent,1u};
+	auto buffer = core::make_smart_refctd_ptr<ICPUBuffer>(extent*extent*4u);
+	memset(buffer->getPointer(),0x7f,buffer->getSize());
+	image->setBufferAndRegions(std::move(buffer),regions);
+
+	ICPUImageView::SCreationParams viewParams = {};
+	viewParams.image = std::move(image);
+	viewParams.viewType = ICPUImageView::ET_2D;
+	viewParams.format = EF_R8G8B8A8_UNORM;
+	viewParams.subresourceRange.aspectMask = IImage::EAF_COLOR_BIT;
+	viewParams.subresourceRange.levelCount = 1u;
+	viewParams.subresourceRange.layerCount = 1u;
+	return ICPUImageView::create(std::move(viewParams));
+}
+
+static void createContext(backend_t::SContext& ctx)
+{
+	ctx.vt.vt = core::make_smart_refctd_ptr<ICPUVirtualTexture>([](E_FORMAT_CLASS) -> uint32_t {return 4u;},7u,8u,14u);
+}
+
+// every node reachable from the roots together with its children, in order
+static core::vector<const IR::INode*> snapshot(const IR* ir)
+{
+	core::vector<const IR::INode*> retval;
+	core::stack<const IR::INode*> s;
+	for (const IR::INode* root : ir->roots)
+	{
+		s.push(root);
+		while (!s.empty())
+		{
+			const IR::INode* node = s.top();
+			s.pop();
+			retval.push_back(node);
+			for (const IR::INode* child : node->children)
+			{
+				retval.push_back(child);
+				s.push(child);
+			}
+		}
+	}
+	return retval;
+}
+
+template<typename T>
+static bool bytewiseEqual(const core::vector<T>& lhs, const core::vector<T>& rhs)
+{
+	return lhs.size()==rhs.size() && (lhs.empty() || memcmp(lhs.data(),rhs.data(),lhs.size()*sizeof(T))==0);
+}
+
+int main()
+{
+	core::smart_refctd_ptr<ICPUSampler> samplers[2];
+	for (uint32_t i=0u; i<2u; i++)
+	{
+		ICPUSampler::SParams params = {};
+		params.TextureWrapU = i ? ISampler::ETC_CLAMP_TO_EDGE:ISampler::ETC_REPEAT;
+		params.TextureWrapV = params.TextureWrapU;
+		params.BorderColor = ISampler::ETBC_FLOAT_OPAQUE_BLACK;
+		samplers[i] = core::make_smart_refctd_ptr<ICPUSampler>(params);
+	}
+	core::vector<core::smart_refctd_ptr<ICPUImageView>> images;
+	for (uint32_t i=0u; i<TextureCount; i++)
+		images.push_back(createTexture(32u<<(i%4u)));
+
+	std::mt19937 rng(0x31u);
+	auto randomTexture = [&]() -> IR::INode::STextureSource
+	{
+		const uint32_t i = rng()%TextureCount;
+		return {images[i],samplers[i%2u],1.f+static_cast<float>(rng()%4u)};
+	};
+	auto maybeTextured = [&](auto& param, const auto constant) -> void
+	{
+		if (rng()%2u)
+			param = randomTexture();
+		else
+			param = constant;
+	};
+
+	auto ir = core::make_smart_refctd_ptr<IR>();
+	// leaves get shared between materials, every kind of parameter can be a texture (also the ones the backend doesn't use)
+	core::vector<IR::INode*> leaves;
+	for (uint32_t i=0u; i<LeafCount; i++)
+	{
+		switch (i%4u)
+		{
+			case 0u:
+			{
+				auto* diffuse = ir->allocNode<IR::CMicrofacetDiffuseBSDFNode>();
+				maybeTextured(diffuse->alpha_u,0.1f);
+				diffuse->alpha_v = randomTexture();
+				maybeTextured(diffuse->reflectance,IR::INode::color_t(0.5f));
+				leaves.push_back(diffuse);
+				break;
+			}
+			case 1u:
+			{
+				auto* conductor = ir->allocNode<IR::CMicrofacetSpecularBSDFNode>();
+				maybeTextured(conductor->alpha_u,0.2f);
+				maybeTextured(conductor->alpha_v,0.3f);
+				conductor->etaK = IR::INode::color_t(2.f);
+				leaves.push_back(conductor);
+				break;
+			}
+			case 2u:
+			{
+				auto* dielectric = ir->allocNode<IR::CMicrofacetDielectricBSDFNode>();
+				maybeTextured(dielectric->alpha_u,0.05f);
+				maybeTextured(dielectric->alpha_v,0.05f);
+				dielectric->thin = rng()%2u;
+				leaves.push_back(dielectric);
+				break;
+			}
+			default:
+			{
+				auto* difftrans = ir->allocNode<IR::CMicrofacetDifftransBSDFNode>();
+				maybeTextured(difftrans->alpha_u,0.4f);
+				maybeTextured(difftrans->transmittance,IR::INode::color_t(0.25f));
+				leaves.push_back(difftrans);
+				break;
+			}
+		}
+	}
+	// some inner nodes get shared too
+	core::vector<IR::INode*> coatings;
+	for (uint32_t i=0u; i<LeafCount; i+=4u)
+	{
+		auto* coating = ir->allocNode<IR::CMicrofacetCoatingBSDFNode>();
+		coating->thicknessSigmaA = randomTexture();
+		maybeTextured(coating->alpha_u,0.1f);
+		coating->alpha_v = randomTexture();
+		coating->children = IR::INode::createChildrenArray(leaves[i+(i/4u)%2u*3u]);
+		coatings.push_back(coating);
+	}
+	for (uint32_t r=0u; r<RootCount; r++)
+	{
+		// a node may not appear twice within one material
+		core::vector<IR::INode*> pool(leaves.begin(),leaves.end());
+		std::shuffle(pool.begin(),pool.end(),rng);
+		auto takeLeaf = [&]() -> IR::INode*
+		{
+			auto* leaf = pool.back();
+			pool.pop_back();
+			return leaf;
+		};
+
+		IR::INode* node;
+		switch (r%5u)
+		{
+			case 0u:
+			{
+				auto* blend = ir->allocNode<IR::CBSDFBlendNode>();
+				maybeTextured(blend->weight,IR::INode::color_t(0.3f));
+				blend->children = IR::INode::createChildrenArray(takeLeaf(),takeLeaf());
+				node = blend;
+				break;
+			}
+			case 1u:
+			{
+				auto* mix = ir->allocNode<IR::CBSDFMixNode>();
+				mix->children = IR::INode::createChildrenArray(takeLeaf(),takeLeaf(),takeLeaf());
+				for (uint32_t i=0u; i<3u; i++)
+					mix->weights[i] = 1.f+i;
+				node = mix;
+				break;
+			}
+			case 2u:
+			{
+				// roots are never shared, only what is below them
+				auto* coating = coatings[r%coatings.size()];
+				pool.erase(std::find(pool.begin(),pool.end(),coating->children[0]));
+				auto* blend = ir->allocNode<IR::CBSDFBlendNode>();
+				blend->weight = IR::INode::color_t(0.5f);
+				blend->children = IR::INode::createChildrenArray(coating,takeLeaf());
+				node = blend;
+				break;
+			}
+			case 3u:
+			{
+				auto* opacity = ir->allocNode<IR::COpacityNode>();
+				maybeTextured(opacity->opacity,IR::INode::color_t(0.75f));
+				opacity->children = IR::INode::createChildrenArray(takeLeaf());
+				node = opacity;
+				break;
+			}
+			default:
+				node = ir->copyNode(takeLeaf());
+				break;
+		}
+		if (r%3u==0u)
+		{
+			auto* bumpmap = ir->allocNode<IR::CGeomModifierNode>(IR::CGeomModifierNode::ET_DERIVATIVE);
+			bumpmap->texture = randomTexture();
+			bumpmap->children = IR::INode::createChildrenArray(node);
+			node = bumpmap;
+		}
+		ir->addRootNode(node);
+	}
+
+	const auto irBefore = snapshot(ir.get());
+
+	backend_t backend;
+	for (const auto generatorChoiceStream : {backend_t::EGST_ABSENT,backend_t::EGST_PRESENT,backend_t::EGST_PRESENT_WITH_AOV_EXTRACTION})
+	{
+		backend_t::SContext sequentialCtx;
+		createContext(sequentialCtx);
+		const auto sequential = backend.compile(&sequentialCtx,ir.get(),generatorChoiceStream,false);
+		NBL_TEST_CHECK(!sequential.bsdfData.empty() && !sequential.prefetch_stream.empty() && !sequential.noNormPrecompStream);
+		NBL_TEST_CHECK(snapshot(ir.get())==irBefore);
+
+		// a few times, so different schedulings get a chance
+		for (uint32_t repeat=0u; repeat<4u; repeat++)
+		{
+			backend_t::SContext parallelCtx;
+			createContext(parallelCtx);
+			const auto parallel = backend.compile(&parallelCtx,ir.get(),generatorChoiceStream,true);
+			NBL_TEST_CHECK(snapshot(ir.get())==irBefore);
+
+			NBL_TEST_CHECK(bytewiseEqual(parallel.instructions,sequential.instructions));
+			NBL_TEST_CHECK(bytewiseEqual(parallel.prefetch_stream,sequential.prefetch_stream));
+			NBL_TEST_CHECK(bytewiseEqual(parallel.bsdfData,sequential.bsdfData));
+			NBL_TEST_CHECK(parallel.usedRegisterCount==sequential.usedRegisterCount && parallel.globalPrefetchRegCountFlags==sequential.globalPrefetchRegCountFlags);
+			NBL_TEST_CHECK(parallel.noPrefetchStream==sequential.noPrefetchStream && parallel.noNormPrecompStream==sequential.noNormPrecompStream);
+			NBL_TEST_CHECK(parallel.fragmentShaderSource_declarations==sequential.fragmentShaderSource_declarations);
+			NBL_TEST_CHECK(parallel.streams.size()==RootCount);
+			for (const IR::INode* root : ir->roots)
+			{
+				const auto found = sequential.streams.find(root);
+				NBL_TEST_CHECK(found!=sequential.streams.end() && memcmp(&parallel.streams.find(root)->second,&found->second,sizeof(found->second))==0);
+			}
+
+			const auto& sequentialCommits = sequentialCtx.vt.pendingCommits;
+			const auto& parallelCommits = parallelCtx.vt.pendingCommits;
+			NBL_TEST_CHECK(parallelCommits.size()==sequentialCommits.size());
+			for (size_t i=0u; i<core::min(parallelCommits.size(),sequentialCommits.size()); i++)
+				NBL_TEST_CHECK(memcmp(&parallelCommits[i].addr,&sequentialCommits[i].addr,sizeof(backend_t::SContext::VT::addr_t))==0);
+		}
+	}
+
+	return test::result();
+}
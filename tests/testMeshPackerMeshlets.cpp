@@ -0,0 +1,143 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// Meshlets committed through the mesh packer must reproduce every source triangle with all of its attributes,
+// and `allocMeshlets` must only reserve the index space the 8 bit local indices need.
+#include "nbl/asset/utils/CGeometryCreator.h"
+#include "nbl/asset/utils/CMeshManipulator.h"
+#include "nbl/asset/utils/CCPUMeshPackerV2.h"
+
+#include <algorithm>
+
+#include "nblTest.h"
+#include "nblTestGeometry.h"
+
+using namespace nbl;
+using namespace asset;
+
+using packer_t = CCPUMeshPackerV2<>;
+
+// all attribute bytes of a triangle's corners, starting with the corner whose bytes compare lowest so that rotated triangles compare equal
+using triangle_t = core::vector<uint8_t>;
+
+static triangle_t makeTriangle(core::vector<uint8_t> corners[3])
+{
+	const auto first = std::min_element(corners,corners+3)-corners;
+	triangle_t retval;
+	for (uint32_t c=0u; c<3u; c++)
+		retval.insert(retval.end(),corners[(first+c)%3u].begin(),corners[(first+c)%3u].end());
+	return retval;
+}
+
+int main()
+{
+	auto manipulator = core::make_smart_refctd_ptr<CMeshManipulator>();
+	const CGeometryCreator creator(manipulator.get());
+	// the triangle count of the second mesh buffer is odd, so is its index count
+	core::smart_refctd_ptr<ICPUMeshBuffer> meshBuffers[2] = {
+		test::makeMeshBuffer(creator.createSphereMesh(1.f,40u,24u)),
+		test::makeTriangleMeshBuffer(
+			{core::vectorSIMDf(0.f,0.f,0.f),core::vectorSIMDf(1.f,0.f,0.f),core::vectorSIMDf(0.f,1.f,0.f),core::vectorSIMDf(1.f,1.f,0.f),core::vectorSIMDf(2.f,1.f,0.f)},
+			{0u,1u,2u,2u,1u,3u,3u,1u,4u}
+		)
+	};
+	ICPUMeshBuffer* const meshBufferPtrs[2] = {meshBuffers[0].get(),meshBuffers[1].get()};
+	ICPUMeshBuffer* const* const mbBegin = meshBufferPtrs;
+	ICPUMeshBuffer* const* const mbEnd = mbBegin+2u;
+
+	IMeshPackerV2Base::SupportedFormatsContainer formats;
+	formats.insertFormatsFromMeshBufferRange(mbBegin,mbEnd);
+	packer_t::AllocationParams allocParams;
+	allocParams.indexBuffSupportedCnt = 1u<<20u;
+	allocParams.vertexBuffSupportedByteSize = 1u<<24u;
+	allocParams.MDIDataBuffSupportedCnt = 1u<<12u;
+	allocParams.indexBufferMinAllocCnt = 1u;
+	allocParams.vertexBufferMinAllocByteSize = 1u;
+	auto packer = core::make_smart_refctd_ptr<packer_t>(allocParams,formats);
+
+	packer_t::ReservedAllocationMeshBuffers reservations[2];
+	NBL_TEST_CHECK(packer->allocMeshlets(reservations,mbBegin,mbEnd));
+	for (uint32_t i=0u; i<2u; i++)
+	{
+		NBL_TEST_CHECK(reservations[i].indexAllocationReservedCnt==(meshBuffers[i]->getIndexCount()+1u)/2u);
+		NBL_TEST_CHECK(reservations[i].mdiAllocationOffset==core::GeneralpurposeAddressAllocator<uint32_t>::invalid_address);
+	}
+	packer->instantiateDataStorage();
+
+	CMeshletBuilder::SParams params;
+	params.maxVertices = 32u;
+	params.maxTriangles = 48u;
+	const uint32_t maxMeshletCount = packer->calcMeshletMaxCount(mbBegin,mbEnd,params);
+	core::vector<IMeshPackerBase::PackedMeshBufferData> pmbd(2u);
+	core::vector<packer_t::CombinedDataOffsetTable> cdots(maxMeshletCount);
+	core::vector<IMeshPackerBase::MeshletDescriptor> meshlets(maxMeshletCount);
+	const uint32_t meshletCount = packer->commitMeshlets(pmbd.data(),cdots.data(),meshlets.data(),reservations,mbBegin,mbEnd,params);
+	NBL_TEST_CHECK(meshletCount!=0u && meshletCount<=maxMeshletCount);
+	NBL_TEST_CHECK(pmbd[0].mdiParameterOffset==0u && pmbd[1].mdiParameterOffset==pmbd[0].mdiParameterCount);
+	NBL_TEST_CHECK(pmbd[1].mdiParameterOffset+pmbd[1].mdiParameterCount==meshletCount);
+
+	const auto& dataStore = packer->getPackerDataStore();
+	const uint8_t* const packedIndices = static_cast<const uint8_t*>(dataStore.indexBuffer->getPointer());
+	const uint8_t* const packedVertices = static_cast<const uint8_t*>(dataStore.vertexBuffer->getPointer());
+	for (uint32_t i=0u; i<2u; i++)
+	{
+		const ICPUMeshBuffer* mb = meshBuffers[i].get();
+		const auto& inputParams = mb->getPipeline()->getVertexInputParams();
+		auto forEachAttribute = [&](auto&& func) -> void
+		{
+			for (uint32_t location=0u; location<SVertexInputParams::MAX_VERTEX_ATTRIB_COUNT; location++)
+			if (inputParams.enabledAttribFlags&(0x1u<<location))
+				func(location,getTexelOrBlockBytesize(static_cast<E_FORMAT>(inputParams.attributes[location].format)));
+		};
+
+		core::vector<triangle_t> expected, packed;
+		for (uint32_t t=0u; t<mb->getIndexCount()/3u; t++)
+		{
+			core::vector<uint8_t> corners[3];
+			for (uint32_t c=0u; c<3u; c++)
+			forEachAttribute([&](const uint32_t location, const uint32_t attribSize) -> void
+			{
+				const uint8_t* src = mb->getAttribPointer(location)+mb->getIndexValue(t*3u+c)*mb->getAttribStride(location);
+				corners[c].insert(corners[c].end(),src,src+attribSize);
+			});
+			expected.push_back(makeTriangle(corners));
+		}
+
+		// the local indices must stay within this mesh buffer's reservation, which is counted in 16 bit units
+		const uint32_t reservationBegin = reservations[i].indexAllocationOffset*sizeof(uint16_t);
+		const uint32_t reservationEnd = reservationBegin+reservations[i].indexAllocationReservedCnt*sizeof(uint16_t);
+		for (uint32_t m=pmbd[i].mdiParameterOffset; m<pmbd[i].mdiParameterOffset+pmbd[i].mdiParameterCount; m++)
+		{
+			const auto& meshlet = meshlets[m];
+			NBL_TEST_CHECK(meshlet.vertexCount<=params.maxVertices && meshlet.triangleCount<=params.maxTriangles);
+			NBL_TEST_CHECK(meshlet.indexByteOffset>=reservationBegin && meshlet.indexByteOffset+meshlet.triangleCount*3u<=reservationEnd);
+			for (uint32_t t=0u; t<meshlet.triangleCount; t++)
+			{
+				core::vector<uint8_t> corners[3];
+				for (uint32_t c=0u; c<3u; c++)
+				{
+					const uint8_t localIx = packedIndices[meshlet.indexByteOffset+t*3u+c];
+					NBL_TEST_CHECK(localIx<meshlet.vertexCount);
+					forEachAttribute([&](const uint32_t location, const uint32_t attribSize) -> void
+					{
+						const uint8_t* src = packedVertices+(cdots[m].attribInfo[location].getOffset()+localIx)*attribSize;
+						corners[c].insert(corners[c].end(),src,src+attribSize);
+					});
+				}
+				packed.push_back(makeTriangle(corners));
+			}
+		}
+		std::sort(expected.begin(),expected.end());
+		std::sort(packed.begin(),packed.end());
+		NBL_TEST_CHECK(expected==packed);
+	}
+
+	// nothing may leak, including the MDI structs which never got reserved
+	packer->free(reservations,2u);
+	NBL_TEST_CHECK(packer->getIndexAllocator().get_allocated_size()==0u);
+	NBL_TEST_CHECK(packer->getVertexAllocator().get_allocated_size()==0u);
+	NBL_TEST_CHECK(packer->getMDIAllocator().get_allocated_size()==0u);
+
+	return test::result();
+}
@@ -0,0 +1,122 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// Meshlets must partition the triangle list within the limits, and their culling data must be conservative.
+#include "nbl/asset/utils/CGeometryCreator.h"
+#include "nbl/asset/utils/CMeshManipulator.h"
+#include "nbl/asset/utils/CMeshletBuilder.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+#include "nblTest.h"
+#include "nblTestGeometry.h"
+
+using namespace nbl;
+using namespace asset;
+
+using triangle_t = std::array<uint32_t,3u>;
+
+// the whole cluster is reported as backfacing, then the camera must be behind every triangle's plane
+static bool isCulled(const CMeshletBuilder::SCullData& cullData, const core::vectorSIMDf& cameraPos)
+{
+	core::vectorSIMDf apex = cullData.coneApex;
+	apex.w = 0.f;
+	core::vectorSIMDf axis = cullData.coneAxis;
+	axis.w = 0.f;
+	return core::dot(core::normalize(apex-cameraPos),axis).x>=cullData.coneAxis.w;
+}
+
+static bool isBackfacing(const core::vectorSIMDf* tri, const core::vectorSIMDf& cameraPos)
+{
+	const auto normal = core::cross(tri[1]-tri[0],tri[2]-tri[0]);
+	return core::dot(tri[0]-cameraPos,normal).x>=-1e-5f*core::length(normal).x;
+}
+
+int main()
+{
+	std::mt19937 rng(42u);
+	std::uniform_real_distribution<float> dist(-4.f,4.f);
+
+	auto manipulator = core::make_smart_refctd_ptr<CMeshManipulator>();
+	const CGeometryCreator creator(manipulator.get());
+	auto sphere = test::makeMeshBuffer(creator.createSphereMesh(1.f,48u,32u));
+	const uint32_t* indices = reinterpret_cast<const uint32_t*>(sphere->getIndices());
+	const uint32_t triangleCount = sphere->getIndexCount()/3u;
+
+	CMeshletBuilder::SParams params;
+	params.maxVertices = 32u;
+	params.maxTriangles = 40u;
+	const auto result = CMeshletBuilder::build(sphere.get(),indices,triangleCount,params);
+	NBL_TEST_CHECK(result.meshlets.size()==result.cullData.size());
+	NBL_TEST_CHECK(result.meshlets.size()<=CMeshletBuilder::calcMeshletCountBound(triangleCount,params));
+
+	// every input triangle ends up in exactly one meshlet, with its winding intact
+	core::vector<triangle_t> expected(triangleCount), clustered;
+	for (uint32_t i=0u; i<triangleCount; i++)
+	{
+		triangle_t tri = {indices[i*3u+0u],indices[i*3u+1u],indices[i*3u+2u]};
+		std::rotate(tri.begin(),std::min_element(tri.begin(),tri.end()),tri.end());
+		expected[i] = tri;
+	}
+	for (size_t m=0u; m<result.meshlets.size(); m++)
+	{
+		const auto& meshlet = result.meshlets[m];
+		NBL_TEST_CHECK(meshlet.vertexCount<=params.maxVertices);
+		NBL_TEST_CHECK(meshlet.triangleCount>0u && meshlet.triangleCount<=params.maxTriangles);
+		const auto& cullData = result.cullData[m];
+
+		core::vector<core::vectorSIMDf> corners;
+		for (uint32_t t=0u; t<meshlet.triangleCount; t++)
+		{
+			triangle_t tri;
+			for (uint32_t c=0u; c<3u; c++)
+			{
+				const uint8_t localIx = result.localIndices[(meshlet.triangleOffset+t)*3u+c];
+				NBL_TEST_CHECK(localIx<meshlet.vertexCount);
+				tri[c] = result.vertices[meshlet.vertexOffset+localIx];
+				corners.push_back(sphere->getPosition(tri[c]));
+			}
+			std::rotate(tri.begin(),std::min_element(tri.begin(),tri.end()),tri.end());
+			clustered.push_back(tri);
+		}
+
+		core::vectorSIMDf center = cullData.boundingSphere;
+		center.w = 0.f;
+		for (auto& corner : corners)
+		{
+			corner.w = 0.f;
+			NBL_TEST_CHECK(core::length(corner-center).x<=cullData.boundingSphere.w*1.0001f+1e-6f);
+		}
+		for (uint32_t i=0u; i<64u; i++)
+		{
+			const core::vectorSIMDf cameraPos(dist(rng),dist(rng),dist(rng),0.f);
+			if (!isCulled(cullData,cameraPos))
+				continue;
+			for (size_t c=0u; c<corners.size(); c+=3u)
+				NBL_TEST_CHECK(isBackfacing(corners.data()+c,cameraPos));
+		}
+	}
+	std::sort(expected.begin(),expected.end());
+	std::sort(clustered.begin(),clustered.end());
+	NBL_TEST_CHECK(expected==clustered);
+
+	// normals spanning more than a hemisphere around the average, such a cluster can never be culled
+	{
+		const core::vector<core::vectorSIMDf> positions = {
+			core::vectorSIMDf(0.f,0.f,0.f),core::vectorSIMDf(1.f,0.f,0.f),core::vectorSIMDf(0.f,1.f,0.f), // +Z
+			core::vectorSIMDf(0.f,0.f,0.f),core::vectorSIMDf(0.f,0.f,1.f),core::vectorSIMDf(1.f,0.f,0.f), // +Y
+			core::vectorSIMDf(0.f,0.f,0.f),core::vectorSIMDf(0.f,1.f,0.f),core::vectorSIMDf(1.f,0.f,0.f)  // -Z
+		};
+		const core::vector<uint32_t> wideIndices = {0u,1u,2u,3u,4u,5u,6u,7u,8u};
+		auto wide = test::makeTriangleMeshBuffer(positions,wideIndices);
+		const auto cullData = CMeshletBuilder::computeCullData(wide.get(),wideIndices.data(),3u);
+		NBL_TEST_CHECK(cullData.coneAxis.w==1.f);
+		for (uint32_t i=0u; i<256u; i++)
+			NBL_TEST_CHECK(!isCulled(cullData,core::vectorSIMDf(dist(rng),dist(rng),dist(rng),0.f)));
+	}
+
+	return test::result();
+}
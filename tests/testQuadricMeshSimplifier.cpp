@@ -0,0 +1,196 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// Edge collapses must never change the topology of the mesh (link condition), also across UV seams, and borders keep sliding as they get simplified.
+#include "nbl/asset/utils/CMeshManipulator.h"
+
+#include <random>
+
+#include "nblTest.h"
+#include "nblTestGeometry.h"
+
+using namespace nbl;
+using namespace asset;
+
+struct STopology
+{
+	int64_t eulerCharacteristic = 0;
+	uint32_t triangleCount = 0u;
+	uint32_t borderEdgeCount = 0u;
+	bool manifold = true;
+};
+
+// the topology of the surface, vertices which only differ in their UVs count as one
+static STopology analyse(const ICPUMeshBuffer* meshbuffer)
+{
+	STopology retval;
+	retval.triangleCount = meshbuffer->getIndexCount()/3u;
+	core::vector<uint32_t> indices(reinterpret_cast<const uint32_t*>(meshbuffer->getIndices()),reinterpret_cast<const uint32_t*>(meshbuffer->getIndices())+retval.triangleCount*3u);
+	{
+		const float* positions = reinterpret_cast<const float*>(meshbuffer->getAttribPointer(meshbuffer->getPositionAttributeIx()));
+		core::map<std::array<float,3u>,uint32_t> firstWithPosition;
+		for (auto& ix : indices)
+			ix = firstWithPosition.try_emplace({positions[ix*3u],positions[ix*3u+1u],positions[ix*3u+2u]},ix).first->second;
+	}
+
+	core::unordered_set<uint32_t> vertices;
+	core::unordered_map<uint64_t,uint32_t> directedEdges;
+	core::unordered_set<uint64_t> triangles;
+	for (uint32_t t=0u; t<retval.triangleCount; t++)
+	{
+		const uint32_t* tri = indices.data()+t*3u;
+		if (tri[0]==tri[1] || tri[1]==tri[2] || tri[2]==tri[0])
+			retval.manifold = false;
+		uint32_t sorted[3] = {tri[0],tri[1],tri[2]};
+		std::sort(sorted,sorted+3u);
+		// 21 bits per vertex is plenty for the test meshes
+		if (!triangles.insert((uint64_t(sorted[0])<<42ull)|(uint64_t(sorted[1])<<21ull)|sorted[2]).second)
+			retval.manifold = false;
+		for (uint32_t k=0u; k<3u; k++)
+		{
+			vertices.insert(tri[k]);
+			// consistently oriented manifold surfaces use every directed edge at most once
+			if ((directedEdges[(uint64_t(tri[k])<<32ull)|tri[(k+1u)%3u]]++)!=0u)
+				retval.manifold = false;
+		}
+	}
+
+	core::unordered_map<uint32_t,uint32_t> borderEdgesPerVertex;
+	uint32_t edgeCount = 0u;
+	for (const auto& directed : directedEdges)
+	{
+		const uint32_t from = directed.first>>32ull;
+		const uint32_t to = static_cast<uint32_t>(directed.first);
+		if (directedEdges.find((uint64_t(to)<<32ull)|from)==directedEdges.end())
+		{
+			edgeCount++;
+			retval.borderEdgeCount++;
+			borderEdgesPerVertex[from]++;
+			borderEdgesPerVertex[to]++;
+		}
+		else if (from<to)
+			edgeCount++;
+	}
+	// a vertex with more than two border edges is a bowtie
+	for (const auto& vertex : borderEdgesPerVertex)
+	if (vertex.second!=2u)
+		retval.manifold = false;
+
+	retval.eulerCharacteristic = int64_t(vertices.size())-int64_t(edgeCount)+int64_t(retval.triangleCount);
+	return retval;
+}
+
+// closed UV sphere with shared poles, a bit of noise so the collapses don't all cost the same
+// with `seam` every ring gets a duplicate of its first vertex with `u=1` to close it, otherwise the last segment wraps around to the first vertex
+static core::smart_refctd_ptr<ICPUMeshBuffer> createSphere(const uint32_t rings, const uint32_t segments, const bool seam=false)
+{
+	std::mt19937 rng(9u);
+	std::uniform_real_distribution<float> noise(0.97f,1.03f);
+	const uint32_t ringSize = seam ? segments+1u:segments;
+	core::vector<core::vectorSIMDf> positions, uvs;
+	positions.emplace_back(0.f,1.f,0.f);
+	uvs.emplace_back(0.5f,0.f);
+	for (uint32_t r=1u; r<rings; r++)
+	{
+		const float theta = core::PI<float>()*float(r)/float(rings);
+		for (uint32_t s=0u; s<segments; s++)
+		{
+			const float phi = 2.f*core::PI<float>()*float(s)/float(segments);
+			positions.push_back(core::vectorSIMDf(std::sin(theta)*std::cos(phi),std::cos(theta),std::sin(theta)*std::sin(phi))*noise(rng));
+			uvs.emplace_back(float(s)/float(segments),float(r)/float(rings));
+		}
+		if (seam)
+		{
+			positions.push_back(positions[positions.size()-segments]);
+			uvs.emplace_back(1.f,float(r)/float(rings));
+		}
+	}
+	positions.emplace_back(0.f,-1.f,0.f);
+	uvs.emplace_back(0.5f,1.f);
+	const uint32_t southPole = positions.size()-1u;
+
+	auto ringVertex = [segments,ringSize](const uint32_t r, const uint32_t s) -> uint32_t {return 1u+(r-1u)*ringSize+(s<ringSize ? s:s%segments);};
+	core::vector<uint32_t> indices;
+	for (uint32_t s=0u; s<segments; s++)
+	{
+		indices.insert(indices.end(),{0u,ringVertex(1u,s+1u),ringVertex(1u,s)});
+		indices.insert(indices.end(),{southPole,ringVertex(rings-1u,s),ringVertex(rings-1u,s+1u)});
+	}
+	for (uint32_t r=1u; r+1u<rings; r++)
+	for (uint32_t s=0u; s<segments; s++)
+	{
+		indices.insert(indices.end(),{ringVertex(r,s),ringVertex(r,s+1u),ringVertex(r+1u,s)});
+		indices.insert(indices.end(),{ringVertex(r,s+1u),ringVertex(r+1u,s+1u),ringVertex(r+1u,s)});
+	}
+	return seam ? test::makeTriangleMeshBuffer(positions,indices,uvs):test::makeTriangleMeshBuffer(positions,indices);
+}
+
+// open, slightly bumpy grid
+static core::smart_refctd_ptr<ICPUMeshBuffer> createGrid(const uint32_t size)
+{
+	std::mt19937 rng(3u);
+	std::uniform_real_distribution<float> bump(-0.01f,0.01f);
+	core::vector<core::vectorSIMDf> positions;
+	for (uint32_t y=0u; y<=size; y++)
+	for (uint32_t x=0u; x<=size; x++)
+		positions.emplace_back(float(x)/float(size),bump(rng),float(y)/float(size));
+	core::vector<uint32_t> indices;
+	for (uint32_t y=0u; y<size; y++)
+	for (uint32_t x=0u; x<size; x++)
+	{
+		const uint32_t v = y*(size+1u)+x;
+		indices.insert(indices.end(),{v,v+size+1u,v+1u});
+		indices.insert(indices.end(),{v+1u,v+size+1u,v+size+2u});
+	}
+	return test::makeTriangleMeshBuffer(positions,indices);
+}
+
+int main()
+{
+	for (const bool seam : {false,true})
+	{
+		constexpr uint32_t Rings = 24u;
+		auto sphere = createSphere(Rings,32u,seam);
+		const auto input = analyse(sphere.get());
+		NBL_TEST_CHECK(input.manifold && input.eulerCharacteristic==2 && input.borderEdgeCount==0u);
+		for (const float ratio : {0.5f,0.1f,0.01f,0.f})
+		{
+			IMeshManipulator::SSimplificationParams params;
+			params.targetTriangleRatio = ratio;
+			auto simplified = IMeshManipulator::createSimplifiedMeshBuffer(sphere.get(),params);
+			const auto output = analyse(simplified.get());
+			NBL_TEST_CHECK(output.manifold);
+			NBL_TEST_CHECK(output.eulerCharacteristic==2);
+			NBL_TEST_CHECK(output.borderEdgeCount==0u);
+			// a closed surface can't get below a tetrahedron, and the positions on a seam are locked (2V-4 triangles around them at least)
+			NBL_TEST_CHECK(output.triangleCount>=4u);
+			NBL_TEST_CHECK(output.triangleCount<=core::max<uint32_t>(input.triangleCount*ratio*1.5f,seam ? 2u*(Rings-1u):8u));
+		}
+	}
+
+	{
+		auto grid = createGrid(32u);
+		const auto input = analyse(grid.get());
+		NBL_TEST_CHECK(input.manifold && input.eulerCharacteristic==1);
+		for (const bool lockBorders : {true,false})
+		{
+			IMeshManipulator::SSimplificationParams params;
+			params.targetTriangleRatio = 0.02f;
+			params.lockBorders = lockBorders;
+			auto simplified = IMeshManipulator::createSimplifiedMeshBuffer(grid.get(),params);
+			const auto output = analyse(simplified.get());
+			NBL_TEST_CHECK(output.manifold);
+			NBL_TEST_CHECK(output.eulerCharacteristic==1);
+			if (lockBorders)
+				NBL_TEST_CHECK(output.borderEdgeCount==input.borderEdgeCount);
+			else // border vertices keep sliding along the border as it gets collapsed
+			{
+				NBL_TEST_CHECK(output.triangleCount<=input.triangleCount/20u);
+				NBL_TEST_CHECK(output.borderEdgeCount<=input.borderEdgeCount/4u);
+			}
+		}
+	}
+
+	return test::result();
+}
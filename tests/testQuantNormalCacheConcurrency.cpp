@@ -0,0 +1,157 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// Loaders and the geometry creator share the mesh manipulator's CQuantNormalCache, and get run concurrently
+// (IAssetManager::getAssets, the Mitsuba loader's shape prefetch), so concurrent quantization must match serial quantization.
+#include "nbl/core/execution.h"
+
+#include "nbl/asset/utils/CGeometryCreator.h"
+#include "nbl/asset/utils/CMeshManipulator.h"
+
+#include <random>
+#include <thread>
+
+#include "nblTest.h"
+
+using namespace nbl;
+using namespace asset;
+
+constexpr uint32_t ThreadCount = 8u;
+
+int main()
+{
+	// a few thousand distinct directions, every thread quantizes all of them in a different order
+	core::vector<core::vectorSIMDf> normals(4096u);
+	{
+		std::mt19937 rng(1337u);
+		std::uniform_real_distribution<float> dist(-1.f,1.f);
+		for (auto& n : normals)
+			n = core::normalize(core::vectorSIMDf(dist(rng),dist(rng),dist(rng)));
+	}
+	using quant_t = CQuantNormalCache::value_type_t<EF_A2B10G10R10_SNORM_PACK32>;
+	core::vector<quant_t> reference(normals.size());
+	{
+		CQuantNormalCache serialCache;
+		for (size_t i=0u; i<normals.size(); i++)
+			reference[i] = serialCache.quantize<EF_A2B10G10R10_SNORM_PACK32>(normals[i]);
+	}
+
+	{
+		CQuantNormalCache sharedCache;
+		core::vector<core::vector<quant_t>> results(ThreadCount,core::vector<quant_t>(normals.size()));
+		core::vector<std::thread> threads;
+		for (uint32_t t=0u; t<ThreadCount; t++)
+			threads.emplace_back([&,t]() -> void
+			{
+				for (size_t j=0u; j<normals.size(); j++)
+				{
+					const size_t i = (j*(2u*t+1u)+t*97u)%normals.size();
+					results[t][i] = sharedCache.quantize<EF_A2B10G10R10_SNORM_PACK32>(normals[i]);
+				}
+			});
+		for (auto& thread : threads)
+			thread.join();
+		for (const auto& result : results)
+		for (size_t i=0u; i<normals.size(); i++)
+			NBL_TEST_CHECK(result[i]==reference[i]);
+	}
+
+	// the serialized loader decodes meshes on the parallel policy and several `loadAsset` calls may run at once,
+	// all of them quantizing per-vertex normals in staging-sized chunks through the one manipulator's cache
+	{
+		constexpr uint32_t LoadCount = 4u;
+		constexpr uint32_t MeshCount = 16u;
+		constexpr size_t ChunkSize = 256u;
+		CQuantNormalCache sharedCache;
+		core::vector<core::vector<quant_t>> meshes(LoadCount*MeshCount,core::vector<quant_t>(normals.size()));
+		core::vector<std::thread> loads;
+		for (uint32_t l=0u; l<LoadCount; l++)
+			loads.emplace_back([&,l]() -> void
+			{
+				auto begin = meshes.begin()+l*MeshCount;
+				core::for_each(core::execution::par,begin,begin+MeshCount,[&](core::vector<quant_t>& mesh) -> void
+				{
+					const size_t rotation = (&mesh-meshes.data())*ChunkSize;
+					for (size_t firstVertex=0u; firstVertex<normals.size(); firstVertex+=ChunkSize)
+					{
+						const size_t chunk = (firstVertex+rotation)%normals.size();
+						for (size_t v=chunk; v<chunk+ChunkSize; v++)
+							mesh[v] = sharedCache.quantize<EF_A2B10G10R10_SNORM_PACK32>(normals[v]);
+					}
+				});
+			});
+		for (auto& load : loads)
+			load.join();
+		for (const auto& mesh : meshes)
+		for (size_t i=0u; i<normals.size(); i++)
+			NBL_TEST_CHECK(mesh[i]==reference[i]);
+	}
+
+	// a key is shared by every direction with the same ratios, whichever of them gets inserted first the key must quantize the same
+	{
+		std::mt19937 rng(28u);
+		std::uniform_real_distribution<float> scaleDist(0.5f,2.f);
+		uint32_t collisions = 0u;
+		for (const auto& n : normals)
+		{
+			const core::vectorSIMDf scaled = n*scaleDist(rng);
+			if (!(asset::impl::VectorUV(core::abs(n))==asset::impl::VectorUV(core::abs(scaled))))
+				continue;
+			collisions++;
+			CQuantNormalCache first, second;
+			const quant_t a = first.quantize<EF_A2B10G10R10_SNORM_PACK32>(n);
+			NBL_TEST_CHECK(first.quantize<EF_A2B10G10R10_SNORM_PACK32>(scaled)==a);
+			NBL_TEST_CHECK(second.quantize<EF_A2B10G10R10_SNORM_PACK32>(scaled)==a);
+			NBL_TEST_CHECK(second.quantize<EF_A2B10G10R10_SNORM_PACK32>(n)==a);
+		}
+		NBL_TEST_CHECK(collisions!=0u);
+	}
+
+	// the geometry creator quantizes through the shared manipulator's cache, different shapes built concurrently
+	// must come out the same as each one built alone
+	constexpr uint32_t ShapeCount = 3u;
+	auto create = [](const CGeometryCreator& creator, const uint32_t shape) -> IGeometryCreator::return_type
+	{
+		switch (shape)
+		{
+			case 0u:
+				return creator.createSphereMesh(1.f,64u,64u);
+			case 1u:
+				return creator.createCylinderMesh(1.f,1.f,64u);
+			default:
+				return creator.createConeMesh(1.f,2.f,64u);
+		}
+	};
+	auto sameVertices = [](const IGeometryCreator::return_type& a, const IGeometryCreator::return_type& b) -> bool
+	{
+		const auto* bufA = a.bindings[0].buffer.get();
+		const auto* bufB = b.bindings[0].buffer.get();
+		return bufA && bufB && bufA->getSize()==bufB->getSize() && memcmp(bufA->getPointer(),bufB->getPointer(),bufA->getSize())==0;
+	};
+	IGeometryCreator::return_type serialShapes[ShapeCount];
+	for (uint32_t shape=0u; shape<ShapeCount; shape++)
+	{
+		auto serialManipulator = core::make_smart_refctd_ptr<CMeshManipulator>();
+		serialShapes[shape] = create(CGeometryCreator(serialManipulator.get()),shape);
+	}
+	{
+		auto manipulator = core::make_smart_refctd_ptr<CMeshManipulator>();
+		const CGeometryCreator creator(manipulator.get());
+		core::vector<IGeometryCreator::return_type> shapes(ThreadCount);
+		{
+			core::vector<std::thread> threads;
+			for (uint32_t t=0u; t<ThreadCount; t++)
+				threads.emplace_back([&,t]() -> void
+				{
+					shapes[t] = create(creator,t%ShapeCount);
+				});
+			for (auto& thread : threads)
+				thread.join();
+		}
+		for (uint32_t t=0u; t<ThreadCount; t++)
+			NBL_TEST_CHECK(sameVertices(shapes[t],serialShapes[t%ShapeCount]));
+	}
+
+	return test::result();
+}
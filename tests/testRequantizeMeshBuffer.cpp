@@ -0,0 +1,77 @@
+// Copyright (C) 2018-2022 - DevSH Graphics Programming Sp. z O.O.
+// This file is part of the "Nabla Engine".
+// For conditions of distribution and use, see copyright notice in nabla.h
+
+// Requantization must keep every attribute it can decode within the error metric, and drop the ones it cannot (BGRA integer formats).
+#include "nbl/asset/utils/CMeshManipulator.h"
+
+#include <random>
+
+#include "nblTest.h"
+#include "nblTestGeometry.h"
+
+using namespace nbl;
+using namespace asset;
+
+constexpr uint32_t VertexCount = 5000u;
+
+int main()
+{
+	std::mt19937 rng(7u);
+	std::uniform_int_distribution<uint32_t> smallInt(0u,200u);
+
+	core::vector<core::vectorSIMDf> positions(VertexCount);
+	core::vector<uint32_t> indices(VertexCount);
+	for (uint32_t i=0u; i<VertexCount; i++)
+	{
+		// whole numbers in a small range, so a narrower format is picked
+		positions[i] = core::vectorSIMDf(float(smallInt(rng)),float(smallInt(rng)),float(smallInt(rng)));
+		indices[i] = i;
+	}
+	auto meshbuffer = test::makeTriangleMeshBuffer(positions,indices);
+
+	// attribute 1 is an integer pair which fits in bytes, attribute 2 is a BGRA integer format the requantizer cannot handle
+	core::vector<uint32_t> ids(VertexCount*2u);
+	for (auto& id : ids)
+		id = smallInt(rng);
+	{
+		auto idBuffer = core::make_smart_refctd_ptr<ICPUBuffer>(ids.size()*sizeof(uint32_t));
+		memcpy(idBuffer->getPointer(),ids.data(),idBuffer->getSize());
+		meshbuffer->setVertexBufferBinding({0ull,std::move(idBuffer)},1u);
+		auto bgraBuffer = core::make_smart_refctd_ptr<ICPUBuffer>(VertexCount*4u);
+		memset(bgraBuffer->getPointer(),0x7f,bgraBuffer->getSize());
+		meshbuffer->setVertexBufferBinding({0ull,std::move(bgraBuffer)},2u);
+
+		auto& params = meshbuffer->getPipeline()->getVertexInputParams();
+		params.enabledAttribFlags |= 0b110u;
+		params.enabledBindingFlags |= 0b110u;
+		params.attributes[1] = {1u,EF_R32G32_UINT,0u};
+		params.attributes[2] = {2u,EF_B8G8R8A8_UINT,0u};
+		params.bindings[1] = {sizeof(uint32_t)*2u,EVIR_PER_VERTEX};
+		params.bindings[2] = {4u,EVIR_PER_VERTEX};
+	}
+
+	IMeshManipulator::SErrorMetric errMetric[ICPUMeshBuffer::MAX_VERTEX_ATTRIB_COUNT];
+	IMeshManipulator::requantizeMeshBuffer(meshbuffer.get(),errMetric);
+
+	const auto& params = meshbuffer->getPipeline()->getVertexInputParams();
+	NBL_TEST_CHECK(params.enabledAttribFlags==0b011u);
+	NBL_TEST_CHECK(params.attributes[0].binding==0u && params.attributes[1].binding==0u);
+	NBL_TEST_CHECK(getTexelOrBlockBytesize(static_cast<E_FORMAT>(params.attributes[0].format))<sizeof(float)*3u);
+	NBL_TEST_CHECK(getTexelOrBlockBytesize(static_cast<E_FORMAT>(params.attributes[1].format))<sizeof(uint32_t)*2u);
+	const auto* vertexBuffer = meshbuffer->getVertexBufferBindings()[0].buffer.get();
+	NBL_TEST_CHECK(vertexBuffer && vertexBuffer->getSize()==size_t(params.bindings[0].stride)*VertexCount);
+
+	for (uint32_t i=0u; i<VertexCount; i++)
+	{
+		core::vectorSIMDf pos;
+		NBL_TEST_CHECK(meshbuffer->getAttribute(pos,0u,i));
+		for (uint32_t c=0u; c<3u; c++)
+			NBL_TEST_CHECK(core::abs(pos[c]-positions[i][c])<=errMetric[0].epsilon[c]);
+		uint32_t id[4];
+		NBL_TEST_CHECK(meshbuffer->getAttribute(id,1u,i));
+		NBL_TEST_CHECK(id[0]==ids[i*2u+0u] && id[1]==ids[i*2u+1u]);
+	}
+
+	return test::result();
+}